@@ -297,6 +297,14 @@ init_agent_read_config(const char *app)
                                NETSNMP_DS_APPLICATION_ID,
                                NETSNMP_DS_AGENT_PDU_STATS_THRESHOLD);
 #endif /* NETSNMP_NO_PDU_STATS */
+#ifndef NETSNMP_NO_TRAP_STATS
+    netsnmp_ds_register_config(ASN_INTEGER, app, "informMaxInflight",
+                               NETSNMP_DS_APPLICATION_ID,
+                               NETSNMP_DS_AGENT_INFORM_MAX_INFLIGHT);
+    netsnmp_ds_register_config(ASN_INTEGER, app, "informQueueLength",
+                               NETSNMP_DS_APPLICATION_ID,
+                               NETSNMP_DS_AGENT_INFORM_QUEUE_LENGTH);
+#endif /* NETSNMP_NO_TRAP_STATS */
 
     netsnmp_init_handler_conf();
 
@@ -125,6 +125,35 @@ char           *snmp_trapcommunity = NULL;
 long            snmp_enableauthentraps = SNMP_AUTHENTICATED_TRAPS_DISABLED;
 int             snmp_enableauthentrapsset = 0;
 
+/*
+ * While netsnmp_send_traps() runs, a v1 or v2c trap is encoded once for
+ * each (template, version, command, community) and the resulting packet
+ * is reused for every further sink with the same parameters.
+ */
+struct trap_encoding {
+    struct trap_encoding *next;
+    const netsnmp_pdu *template_pdu;
+    long            version;
+    int             command;
+    u_char         *community;
+    size_t          community_len;
+    long            reqid;
+    u_char         *packet;
+    size_t          packet_len;
+};
+
+static struct trap_encoding *trap_encodings = NULL;
+static int      trap_batch_depth = 0;
+
+#ifndef NETSNMP_NO_TRAP_STATS
+#define INFORM_QUEUE_LENGTH_DEFAULT 100
+#define INFORM_DROP_LOG_INTERVAL    6000    /* sysUpTime ticks: a minute */
+
+static int      inform_sending = 0;
+
+static void     _send_queued_informs(netsnmp_session *sess);
+#endif /* NETSNMP_NO_TRAP_STATS */
+
 /*
  * Prototypes 
  */
@@ -178,6 +207,10 @@ _dump_trap_stats(netsnmp_session *sess)
         DEBUGMSGT_NC(("stats:notif", "    %ld v3 errs, last @ %ld\n",
                       sess->trap_stats->sec_err_count,
                       sess->trap_stats->sec_err_last));
+        DEBUGMSGT_NC(("stats:notif", "    %ld in flight, %u queued, %ld dropped\n",
+                      sess->trap_stats->inform_inflight,
+                      sess->trap_stats->inform_queue_len,
+                      sess->trap_stats->inform_queue_drops));
     }
 }
 #endif /* NETSNMP_NO_TRAP_STATS */
@@ -754,6 +787,19 @@ convert_v1pdu_to_v2( netsnmp_pdu* template_v1pdu )
     return template_v2pdu;
 }
 
+static void
+_free_trap_encodings(void)
+{
+    struct trap_encoding *enc;
+
+    while ((enc = trap_encodings) != NULL) {
+        trap_encodings = enc->next;
+        free(enc->community);
+        free(enc->packet);
+        free(enc);
+    }
+}
+
 /**
  * This function allows you to make a distinction between generic 
  * traps from different classes of equipment. For example, you may want 
@@ -995,6 +1041,7 @@ netsnmp_send_traps(int trap, int specific,
      *   and call the trap callback routines,
      *   providing an appropriately formatted PDU in each case
      */
+    ++trap_batch_depth;
     for (sink = sinks; sink; sink = sink->next) {
 #ifndef NETSNMP_DISABLE_SNMPV1
         if (sink->version == SNMP_VERSION_1) {
@@ -1018,6 +1065,8 @@ netsnmp_send_traps(int trap, int specific,
     if (template_v2pdu)
         snmp_call_callbacks(SNMP_CALLBACK_APPLICATION,
                         SNMPD_CALLBACK_SEND_TRAP2, template_v2pdu);
+    if (--trap_batch_depth == 0)
+        _free_trap_encodings();
     snmp_free_pdu(template_v1pdu);
     snmp_free_pdu(template_v2pdu);
     return 0;
@@ -1098,6 +1147,8 @@ handle_inform_response(int op, netsnmp_session * session,
                        int reqid, netsnmp_pdu *pdu,
                        void *magic)
 {
+    int             done = 0;
+
     if (NULL == session)
         return 0;
 
@@ -1110,6 +1161,7 @@ handle_inform_response(int op, netsnmp_session * session,
         if (pdu->command != SNMP_MSG_REPORT) {
             DEBUGMSGTL(("trap", "received the inform response for reqid=%d\n",
                         reqid));
+            done = 1;
 #ifndef NETSNMP_NO_TRAP_STATS
             if (session->trap_stats) {
                 ++session->trap_stats->ack_count;
@@ -1135,6 +1187,8 @@ handle_inform_response(int op, netsnmp_session * session,
     case NETSNMP_CALLBACK_OP_SEC_ERROR:
         DEBUGMSGTL(("trap", "sec error sending an inform for reqid=%d\n",
                     reqid));
+        /* reports are followed by a SEC_ERROR once the request is over */
+        done = (op == NETSNMP_CALLBACK_OP_SEC_ERROR);
 #ifndef NETSNMP_NO_TRAP_STATS
         if (session->trap_stats) {
             session->trap_stats->sec_err_last = netsnmp_get_agent_uptime();
@@ -1147,6 +1201,7 @@ handle_inform_response(int op, netsnmp_session * session,
         DEBUGMSGTL(("trap",
                     "received a timeout sending an inform for reqid=%d\n",
                     reqid));
+        done = 1;
 #ifndef NETSNMP_NO_TRAP_STATS
         if (session->trap_stats) {
             ++session->trap_stats->timeouts;
@@ -1166,6 +1221,7 @@ handle_inform_response(int op, netsnmp_session * session,
 
     case NETSNMP_CALLBACK_OP_SEND_FAILED:
         DEBUGMSGTL(("trap", "failed to send an inform for reqid=%d\n", reqid));
+        done = 1;
 #ifndef NETSNMP_NO_TRAP_STATS
         if (session->trap_stats) {
             session->trap_stats->sent_last_fail = netsnmp_get_agent_uptime();
@@ -1178,6 +1234,16 @@ handle_inform_response(int op, netsnmp_session * session,
         DEBUGMSGTL(("trap", "received op=%d for reqid=%d when trying to send an inform\n", op, reqid));
     }
 
+#ifndef NETSNMP_NO_TRAP_STATS
+    if (done && !inform_sending && session->trap_stats &&
+        session->trap_stats->inform_inflight > 0) {
+        --session->trap_stats->inform_inflight;
+        /* not while the session is being closed */
+        if (snmp_sess_pointer(session))
+            _send_queued_informs(session);
+    }
+#endif /* NETSNMP_NO_TRAP_STATS */
+
 #ifndef NETSNMP_NO_TRAP_STATS
     if (session->trap_stats)
         _dump_trap_stats(session);
@@ -1187,6 +1253,174 @@ handle_inform_response(int op, netsnmp_session * session,
 }
 
 
+/*
+ * Send a v1/v2c trap, reusing the encoding made for an earlier sink with
+ * the same parameters during the current netsnmp_send_traps() call.
+ *
+ * Only unconfirmed TRAP and TRAP2 PDUs get here, so the sinks that share
+ * an encoding also share its request-id without anything having to match
+ * a response to it.  INFORMs are encoded per session and get their own
+ * request-id in send_trap_to_sess(), and a new one when they leave the
+ * inform queue, so responses and retries are matched per sink.
+ */
+static int
+_send_trap_encoded(netsnmp_session *sess, netsnmp_pdu *template_pdu,
+                   netsnmp_pdu *pdu)
+{
+    struct session_list *slp = snmp_sess_pointer(sess);
+    struct trap_encoding *enc;
+
+    if (NULL == slp)
+        return 0;
+
+    for (enc = trap_encodings; enc; enc = enc->next)
+        if (enc->template_pdu == template_pdu &&
+            enc->version == sess->version &&
+            enc->command == pdu->command &&
+            enc->community_len == sess->community_len &&
+            (0 == sess->community_len ||
+             0 == memcmp(enc->community, sess->community,
+                         sess->community_len)))
+            break;
+
+    if (NULL == enc) {
+        enc = SNMP_MALLOC_TYPEDEF(struct trap_encoding);
+        if (NULL == enc)
+            return snmp_sess_async_send(slp, pdu, &handle_trap_callback, NULL);
+        if (sess->community_len)
+            enc->community = netsnmp_memdup(sess->community,
+                                            sess->community_len);
+        if ((sess->community_len && NULL == enc->community) ||
+            snmp_sess_build_packet(slp, pdu, &enc->packet,
+                                   &enc->packet_len) != SNMPERR_SUCCESS) {
+            /* e.g. a transport with its own encoder */
+            free(enc->community);
+            free(enc);
+            return snmp_sess_async_send(slp, pdu, &handle_trap_callback, NULL);
+        }
+        enc->template_pdu = template_pdu;
+        enc->version = sess->version;
+        enc->command = pdu->command;
+        enc->community_len = sess->community_len;
+        enc->reqid = pdu->reqid;
+        enc->next = trap_encodings;
+        trap_encodings = enc;
+        DEBUGMSGTL(("trap", "encoded trap for version %ld, %" NETSNMP_PRIz
+                    "u bytes\n", enc->version, enc->packet_len));
+    } else {
+        DEBUGMSGTL(("trap", "reusing trap encoding for version %ld\n",
+                    enc->version));
+        /* the reqid is part of the shared packet */
+        pdu->reqid = enc->reqid;
+    }
+
+    return snmp_sess_async_send_packet(slp, pdu, enc->packet, enc->packet_len,
+                                       &handle_trap_callback, NULL);
+}
+
+#ifndef NETSNMP_NO_TRAP_STATS
+/*
+ * INFORM flow control: with informMaxInflight set, INFORMs beyond that
+ * many outstanding requests per session wait in a ring hung off the
+ * session's trap stats and are sent as earlier ones complete.
+ */
+static int
+_send_inform(netsnmp_session *sess, netsnmp_pdu *pdu)
+{
+    int             result;
+
+    /* callbacks made from within the send are not for a counted request */
+    inform_sending = 1;
+    result = snmp_async_send(sess, pdu, &handle_inform_response, NULL);
+    inform_sending = 0;
+    if (result && sess->trap_stats)
+        ++sess->trap_stats->inform_inflight;
+    return result;
+}
+
+/*
+ * Warn about dropped INFORMs, at most once a minute per destination.
+ */
+static void
+_log_inform_drops(netsnmp_session *sess)
+{
+    netsnmp_trap_stats *ts = sess->trap_stats;
+    u_long          now = netsnmp_get_agent_uptime();
+
+    if (ts->inform_drops_logged &&
+        now - ts->inform_drop_last_log < INFORM_DROP_LOG_INTERVAL)
+        return;
+    snmp_log(LOG_WARNING,
+             "inform queue for %s full: %lu informs dropped (%lu since the "
+             "last warning), %lu awaiting a response\n",
+             sess->paramName ? sess->paramName : "UNKNOWN",
+             ts->inform_queue_drops,
+             ts->inform_queue_drops - ts->inform_drops_logged,
+             ts->inform_inflight);
+    ts->inform_drops_logged = ts->inform_queue_drops;
+    ts->inform_drop_last_log = now;
+}
+
+static int
+_queue_inform(netsnmp_session *sess, netsnmp_pdu *pdu)
+{
+    netsnmp_trap_stats *ts = sess->trap_stats;
+    int             size;
+
+    if (NULL == ts->inform_queue) {
+        size = netsnmp_ds_get_int(NETSNMP_DS_APPLICATION_ID,
+                                  NETSNMP_DS_AGENT_INFORM_QUEUE_LENGTH);
+        if (size <= 0)
+            size = INFORM_QUEUE_LENGTH_DEFAULT;
+        ts->inform_queue = calloc(size, sizeof(netsnmp_pdu *));
+        if (NULL == ts->inform_queue)
+            return 0;
+        ts->inform_queue_size = size;
+    }
+    if (ts->inform_queue_len >= ts->inform_queue_size) {
+        ++ts->inform_queue_drops;
+        DEBUGMSGTL(("trap", "inform queue for %s full, dropping inform\n",
+                    sess->paramName ? sess->paramName : "UNKNOWN"));
+        _log_inform_drops(sess);
+        return 0;
+    }
+    ts->inform_queue[(ts->inform_queue_head + ts->inform_queue_len) %
+                     ts->inform_queue_size] = pdu;
+    ++ts->inform_queue_len;
+    return 1;
+}
+
+static void
+_send_queued_informs(netsnmp_session *sess)
+{
+    netsnmp_trap_stats *ts = sess->trap_stats;
+    int             max = netsnmp_ds_get_int(NETSNMP_DS_APPLICATION_ID,
+                                             NETSNMP_DS_AGENT_INFORM_MAX_INFLIGHT);
+    netsnmp_pdu    *pdu;
+
+    while (ts->inform_queue_len > 0 &&
+           (max <= 0 || ts->inform_inflight < (u_long)max)) {
+        pdu = ts->inform_queue[ts->inform_queue_head];
+        ts->inform_queue[ts->inform_queue_head] = NULL;
+        ts->inform_queue_head =
+            (ts->inform_queue_head + 1) % ts->inform_queue_size;
+        --ts->inform_queue_len;
+
+        pdu->reqid = snmp_get_next_reqid();
+        pdu->msgid = snmp_get_next_msgid();
+        if (_send_inform(sess, pdu) == 0) {
+            snmp_sess_perror("snmpd: send_trap", sess);
+            snmp_free_pdu(pdu);
+            continue;
+        }
+        snmp_increment_statistic(STAT_SNMPOUTTRAPS);
+        snmp_increment_statistic(STAT_SNMPOUTPKTS);
+        ts->sent_last_sent = netsnmp_get_agent_uptime();
+        ++ts->sent_count;
+    }
+}
+#endif /* NETSNMP_NO_TRAP_STATS */
+
 /*
  * send_trap_to_sess: sends a trap to a session but assumes that the
  * pdu is constructed correctly for the session type. 
@@ -1265,8 +1499,23 @@ send_trap_to_sess(netsnmp_session * sess, netsnmp_pdu *template_pdu)
          || template_pdu->command == AGENTX_MSG_NOTIFY
 #endif
        ) {
+#ifndef NETSNMP_NO_TRAP_STATS
+        int max = netsnmp_ds_get_int(NETSNMP_DS_APPLICATION_ID,
+                                     NETSNMP_DS_AGENT_INFORM_MAX_INFLIGHT);
+
+        if (max > 0 && sess->trap_stats &&
+            (sess->trap_stats->inform_queue_len > 0 ||
+             sess->trap_stats->inform_inflight >= (u_long)max)) {
+            if (!_queue_inform(sess, pdu))
+                snmp_free_pdu(pdu);
+            _dump_trap_stats(sess);
+            return;
+        }
+        result = _send_inform(sess, pdu);
+#else
         result =
             snmp_async_send(sess, pdu, &handle_inform_response, NULL);
+#endif /* NETSNMP_NO_TRAP_STATS */
     } else {
         if ((sess->version == SNMP_VERSION_3) &&
                 (pdu->command == SNMP_MSG_TRAP2) &&
@@ -1278,7 +1527,13 @@ send_trap_to_sess(netsnmp_session * sess, netsnmp_pdu *template_pdu)
             pdu->securityEngineIDLen = len;
         }
 
-        result = snmp_async_send(sess, pdu, &handle_trap_callback, NULL);
+        if (trap_batch_depth > 0 &&
+            (pdu->command == SNMP_MSG_TRAP || pdu->command == SNMP_MSG_TRAP2)
+            && (sess->version == SNMP_VERSION_1 ||
+                sess->version == SNMP_VERSION_2c))
+            result = _send_trap_encoded(sess, template_pdu, pdu);
+        else
+            result = snmp_async_send(sess, pdu, &handle_trap_callback, NULL);
     }
 
     if (result == 0) {
@@ -40,12 +40,13 @@ netsnmp_get_bulk_to_next_handler(void)
     return handler;
 }
 
-/** takes answered requests and decrements the repeat count and
- *  updates the requests to the next to-do varbind in the list */
-void
-netsnmp_bulk_to_next_fix_requests(netsnmp_request_info *requests)
+/** takes an answered request and, if it has repeats left, decrements
+ *  the repeat count and moves it on to its next to-do varbind.
+ *  @return 1 if the request was moved on, 0 if it is done with.
+ */
+int
+netsnmp_bulk_to_next_fix_request(netsnmp_request_info *request)
 {
-    netsnmp_request_info *request;
     /*
      * Make sure that:
      *    - repeats remain
@@ -53,31 +54,43 @@ netsnmp_bulk_to_next_fix_requests(netsnmp_request_info *requests)
      *    - answer didn't exceed range end (ala check_getnext_results)
      *    - there is a next variable
      * then
-     * update the varbinds for the next request series 
+     * update the varbind for the next request
      */
-    for (request = requests; request; request = request->next) {
-        if (request->repeat > 0 &&
-            request->requestvb->type != ASN_NULL &&
-            request->requestvb->type != ASN_PRIV_RETRY &&
-            (snmp_oid_compare(request->requestvb->name,
-                              request->requestvb->name_length,
-                              request->range_end,
-                              request->range_end_len) < 0) &&
-            request->requestvb->next_variable ) {
-            request->repeat--;
-            snmp_set_var_objid(request->requestvb->next_variable,
-                               request->requestvb->name,
-                               request->requestvb->name_length);
-            request->requestvb = request->requestvb->next_variable;
-            request->requestvb->type = ASN_PRIV_RETRY;
-            /*
-             * if inclusive == 2, it was set in check_getnext_results for
-             * the previous requestvb. Now that we've moved on, clear it.
-             */
-            if (2 == request->inclusive)
-                request->inclusive = 0;
-        }
+    if (request->repeat > 0 &&
+        request->requestvb->type != ASN_NULL &&
+        request->requestvb->type != ASN_PRIV_RETRY &&
+        (snmp_oid_compare(request->requestvb->name,
+                          request->requestvb->name_length,
+                          request->range_end,
+                          request->range_end_len) < 0) &&
+        request->requestvb->next_variable ) {
+        request->repeat--;
+        snmp_set_var_objid(request->requestvb->next_variable,
+                           request->requestvb->name,
+                           request->requestvb->name_length);
+        request->requestvb = request->requestvb->next_variable;
+        request->requestvb->type = ASN_PRIV_RETRY;
+        /*
+         * if inclusive == 2, it was set in check_getnext_results for
+         * the previous requestvb, and if it is 1 the request came as an
+         * inclusive AgentX search range.  Either way it applied to the
+         * previous requestvb only.  Now that we've moved on, clear it.
+         */
+        request->inclusive = 0;
+        return 1;
     }
+    return 0;
+}
+
+/** takes answered requests and decrements the repeat count and
+ *  updates the requests to the next to-do varbind in the list */
+void
+netsnmp_bulk_to_next_fix_requests(netsnmp_request_info *requests)
+{
+    netsnmp_request_info *request;
+
+    for (request = requests; request; request = request->next)
+        netsnmp_bulk_to_next_fix_request(request);
 }
 
 /** @internal Implements the bulk_to_next handler */
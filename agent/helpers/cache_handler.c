@@ -140,6 +140,15 @@ void            release_cached_resources(unsigned int regNo,
  *
  *          NETSNMP_CACHE_RESET_TIMER_ON_USE
  *
+ *  Frequently polled scalars:
+ *      If the values themselves are expensive to compute, and the
+ *      managers polling them can live with values up to 'timeout'
+ *      seconds old, inject a value cache (netsnmp_get_value_cache_handler)
+ *      at the top of the handler chain. This keeps the varbinds returned
+ *      for GET and GETNEXT requests, and answers the same requests from
+ *      them without calling the rest of the chain. The owning module can
+ *      drop the values early with netsnmp_cache_invalidate().
+ *
  *  @{
  */
 
@@ -379,6 +388,20 @@ netsnmp_cache_timer_stop(netsnmp_cache *cache)
     cache->timer_id = 0;
 }
 
+/** drops the cached data, so that it is loaded again when next needed */
+void
+netsnmp_cache_invalidate(netsnmp_cache *cache)
+{
+    if (NULL == cache)
+        return;
+
+    DEBUGMSGT(("helper:cache_handler", "invalidating cache %p\n", cache));
+    if (cache->valid)
+        _cache_free(cache);
+    cache->valid = 0;
+    cache->expired = 1;
+}
+
 
 /** returns a cache handler that can be injected into a given handler chain.  
  */
@@ -677,6 +700,10 @@ netsnmp_cache_helper_handler(netsnmp_mib_handler * handler,
          * call the load hook, and update the cache timestamp.
          * If it's not already there, add to reqinfo
          */
+        if (!cache->valid || netsnmp_cache_check_expired(cache))
+            cache->misses++;
+        else
+            cache->hits++;
         netsnmp_cache_check_and_reload(cache);
         netsnmp_cache_reqinfo_insert(cache, reqinfo, addrstr);
         /** next handler called automatically - 'AUTO_NEXT' */
@@ -717,6 +744,316 @@ netsnmp_cache_helper_handler(netsnmp_mib_handler * handler,
     return SNMP_ERR_NOERROR;
 }
 
+/*
+ * The value cache: the varbinds returned for GET and GETNEXT requests,
+ * sorted by their key: the mode and request OID, plus for GETNEXT
+ * whether the request OID itself may be returned (request->inclusive)
+ * and the end of the range searched (request->range_end).
+ */
+typedef struct netsnmp_value_cache_entry_s {
+    int             mode;
+    int             inclusive;  /* GETNEXT only */
+    oid            *name;       /* as requested */
+    size_t          name_len;
+    oid            *range_end;  /* GETNEXT only */
+    size_t          range_end_len;
+    netsnmp_variable_list *var; /* as returned */
+} netsnmp_value_cache_entry;
+
+typedef struct netsnmp_value_cache_s {
+    netsnmp_value_cache_entry *entries;
+    size_t          count, max;
+} netsnmp_value_cache;
+
+#define VALUE_CACHE_MAX_ENTRIES 1024
+
+/*
+ * set up the key of a request (sharing its OIDs)
+ */
+static void
+_value_cache_key(netsnmp_value_cache_entry *key, int mode,
+                 netsnmp_request_info *request)
+{
+    memset(key, 0, sizeof(*key));
+    key->mode = mode;
+    key->name = request->requestvb->name;
+    key->name_len = request->requestvb->name_length;
+    if (mode == MODE_GETNEXT) {
+        key->inclusive = request->inclusive ? 1 : 0;
+        key->range_end = request->range_end;
+        key->range_end_len = request->range_end ? request->range_end_len : 0;
+    }
+}
+
+static int
+_value_cache_compare(const netsnmp_value_cache_entry *entry,
+                     const netsnmp_value_cache_entry *key)
+{
+    int             cmp;
+
+    if (entry->mode != key->mode)
+        return entry->mode < key->mode ? -1 : 1;
+    if (entry->inclusive != key->inclusive)
+        return entry->inclusive < key->inclusive ? -1 : 1;
+    cmp = snmp_oid_compare(entry->name, entry->name_len,
+                           key->name, key->name_len);
+    if (cmp)
+        return cmp;
+    return snmp_oid_compare(entry->range_end, entry->range_end_len,
+                            key->range_end, key->range_end_len);
+}
+
+/*
+ * @return the index of the entry for this key, or where it would go
+ */
+static size_t
+_value_cache_find(netsnmp_value_cache *values,
+                  const netsnmp_value_cache_entry *key, int *found)
+{
+    size_t          lo = 0, hi = values ? values->count : 0, mid;
+    int             cmp;
+
+    *found = 0;
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        cmp = _value_cache_compare(&values->entries[mid], key);
+        if (cmp == 0) {
+            *found = 1;
+            return mid;
+        }
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void
+_value_cache_add(netsnmp_cache *cache, const netsnmp_value_cache_entry *key,
+                 netsnmp_variable_list *var)
+{
+    netsnmp_value_cache *values = (netsnmp_value_cache *)cache->magic;
+    netsnmp_value_cache_entry *entries, *entry;
+    size_t          i;
+    int             found;
+
+    if (!values) {
+        values = SNMP_MALLOC_TYPEDEF(netsnmp_value_cache);
+        if (!values)
+            return;
+        cache->magic = values;
+    }
+    i = _value_cache_find(values, key, &found);
+    if (found)
+        return;
+    if (values->count == values->max) {
+        if (values->max >= VALUE_CACHE_MAX_ENTRIES)
+            return;
+        entries = (netsnmp_value_cache_entry *)
+            realloc(values->entries,
+                    (values->max + 16) * sizeof(*values->entries));
+        if (!entries)
+            return;
+        values->entries = entries;
+        values->max += 16;
+    }
+
+    entry = &values->entries[i];
+    memmove(entry + 1, entry, (values->count - i) * sizeof(*entry));
+    *entry = *key;
+    entry->name = snmp_duplicate_objid(key->name, key->name_len);
+    if (key->range_end)
+        entry->range_end = snmp_duplicate_objid(key->range_end,
+                                                key->range_end_len);
+    entry->var = snmp_clone_varbind(var);
+    if (!entry->name || (key->range_end && !entry->range_end) ||
+        !entry->var) {
+        SNMP_FREE(entry->name);
+        SNMP_FREE(entry->range_end);
+        snmp_free_varbind(entry->var);
+        memmove(entry, entry + 1, (values->count - i) * sizeof(*entry));
+        return;
+    }
+    entry->var->next_variable = NULL;
+    values->count++;
+}
+
+static int
+_value_cache_load(netsnmp_cache *cache, void *magic)
+{
+    /*
+     * Nothing to load: the values are added as the requests come in.
+     */
+    return 0;
+}
+
+static void
+_value_cache_free(netsnmp_cache *cache, void *magic)
+{
+    netsnmp_value_cache *values = (netsnmp_value_cache *)magic;
+    size_t          i;
+
+    if (!values)
+        return;
+    for (i = 0; i < values->count; i++) {
+        free(values->entries[i].name);
+        free(values->entries[i].range_end);
+        snmp_free_varbind(values->entries[i].var);
+    }
+    free(values->entries);
+    free(values);
+    cache->magic = NULL;
+}
+
+/** returns a value cache handler that can be injected at the top of a
+ *  handler chain, keeping the values it returns for 'timeout' seconds.
+ *  The cache is listed in the nsCacheTable under 'rootoid'.
+ */
+netsnmp_mib_handler *
+netsnmp_get_value_cache_handler(int timeout, const oid * rootoid,
+                                int rootoid_len)
+{
+    netsnmp_mib_handler *ret;
+    netsnmp_cache  *cache;
+
+    ret = netsnmp_create_handler("value_cache",
+                                 netsnmp_value_cache_helper_handler);
+    if (!ret)
+        return NULL;
+    cache = netsnmp_cache_create(timeout, _value_cache_load,
+                                 _value_cache_free, rootoid, rootoid_len);
+    if (!cache) {
+        netsnmp_handler_free(ret);
+        return NULL;
+    }
+    ret->myvoid = (void *) cache;
+    netsnmp_cache_handler_owns_cache(ret);
+    return ret;
+}
+
+/*
+ * Can this request be answered from the value cache?
+ */
+static int
+_value_cache_lookup(netsnmp_cache *cache, int mode,
+                    netsnmp_request_info *requests)
+{
+    netsnmp_value_cache *values = (netsnmp_value_cache *)cache->magic;
+    netsnmp_value_cache_entry key;
+    netsnmp_request_info *request;
+    int             found;
+
+    for (request = requests; request; request = request->next) {
+        if (request->processed)
+            continue;
+        _value_cache_key(&key, mode, request);
+        _value_cache_find(values, &key, &found);
+        if (!found)
+            return 0;
+    }
+    return 1;
+}
+
+/** Implements the value cache handler */
+int
+netsnmp_value_cache_helper_handler(netsnmp_mib_handler * handler,
+                                   netsnmp_handler_registration * reginfo,
+                                   netsnmp_agent_request_info * reqinfo,
+                                   netsnmp_request_info * requests)
+{
+    netsnmp_cache  *cache = (netsnmp_cache *) handler->myvoid;
+    netsnmp_value_cache *values;
+    netsnmp_value_cache_entry key, *keys;
+    netsnmp_request_info *request;
+    netsnmp_variable_list *var;
+    int             i, n, found, ret;
+
+    if (netsnmp_ds_get_boolean(NETSNMP_DS_APPLICATION_ID,
+                               NETSNMP_DS_AGENT_NO_CACHING) ||
+        !cache || !cache->enabled) {
+        DEBUGMSGTL(("helper:value_cache", "caching disabled\n"));
+        return netsnmp_call_next_handler(handler, reginfo, reqinfo,
+                                         requests);
+    }
+
+    switch (reqinfo->mode) {
+    case MODE_GET:
+    case MODE_GETNEXT:
+        break;
+
+#ifndef NETSNMP_NO_WRITE_SUPPORT
+    case MODE_SET_COMMIT:
+        if (!(cache->flags & NETSNMP_CACHE_DONT_INVALIDATE_ON_SET))
+            netsnmp_cache_invalidate(cache);
+        NETSNMP_FALLTHROUGH;
+#endif /* NETSNMP_NO_WRITE_SUPPORT */
+    default:
+        return netsnmp_call_next_handler(handler, reginfo, reqinfo,
+                                         requests);
+    }
+
+    if (!cache->valid || netsnmp_cache_check_expired(cache))
+        _cache_load(cache);
+
+    if (cache->valid && _value_cache_lookup(cache, reqinfo->mode, requests)) {
+        /*
+         * Every value is in the cache, so there's no need
+         *   to go any further down the handler chain.
+         */
+        values = (netsnmp_value_cache *)cache->magic;
+        for (request = requests; request; request = request->next) {
+            if (request->processed)
+                continue;
+            _value_cache_key(&key, reqinfo->mode, request);
+            i = _value_cache_find(values, &key, &found);
+            var = values->entries[i].var;
+            if (reqinfo->mode == MODE_GETNEXT)
+                snmp_set_var_objid(request->requestvb, var->name,
+                                   var->name_length);
+            snmp_set_var_typed_value(request->requestvb, var->type,
+                                     var->val.string, var->val_len);
+        }
+        cache->hits++;
+        DEBUGMSGTL(("helper:value_cache", "answered from cache %p\n", cache));
+        return SNMP_ERR_NOERROR;
+    }
+    cache->misses++;
+
+    /*
+     * Remember what was asked for (a GETNEXT request will overwrite
+     *   the OID), and then let the rest of the chain answer it.
+     */
+    for (n = 0, request = requests; request; request = request->next)
+        n++;
+    keys = (netsnmp_value_cache_entry *) calloc(n, sizeof(*keys));
+    if (keys) {
+        for (i = 0, request = requests; request; request = request->next, i++) {
+            _value_cache_key(&keys[i], reqinfo->mode, request);
+            keys[i].name = snmp_duplicate_objid(keys[i].name,
+                                                keys[i].name_len);
+        }
+    }
+
+    ret = netsnmp_call_next_handler(handler, reginfo, reqinfo, requests);
+
+    if (keys) {
+        for (i = 0, request = requests; request; request = request->next, i++) {
+            var = request->requestvb;
+            if (ret == SNMP_ERR_NOERROR && keys[i].name && cache->valid &&
+                !request->delegated && !request->status &&
+                var->type != ASN_NULL && var->type != ASN_PRIV_RETRY &&
+                var->type != SNMP_NOSUCHOBJECT &&
+                var->type != SNMP_NOSUCHINSTANCE &&
+                var->type != SNMP_ENDOFMIBVIEW)
+                _value_cache_add(cache, &keys[i], var);
+            SNMP_FREE(keys[i].name);
+        }
+    }
+    SNMP_FREE(keys);
+    return ret;
+}
+
 static void
 _cache_free( netsnmp_cache *cache )
 {
@@ -72,6 +72,15 @@ typedef struct container_table_data_s {
    /* what type of key do we want? */
    char            key_type;
 
+    /*
+     * the rows in container order, taken with an iterator for answering
+     * GET-BULK repetitions, and the container sync count and size they
+     * were taken at.
+     */
+    void          **bulk_rows;
+    size_t          bulk_rows_count;
+    u_long          bulk_rows_sync;
+
 } container_table_data;
 
 /** @defgroup table_container table_container
@@ -147,6 +156,21 @@ typedef struct container_table_data_s {
  *    constraints and inserting any newly created rows into the container
  *    and the request's data list.
  *
+ *  GET-BULK (native)
+ *    If the registration modes include HANDLER_CAN_GETBULK_NATIVE and the
+ *    container uses TABLE_CONTAINER_KEY_NETSNMP_INDEX keys, then after the
+ *    sub-handlers have answered the current repetition of a GET-BULK
+ *    request, the successive rows are taken from the container starting at
+ *    the row just returned, and the sub-handlers are called again (in GET
+ *    mode) for the following varbinds of each request, until the
+ *    repetitions, the table or the registration's range run out. When
+ *    there are enough repetitions to pay for it, the rows are walked in a
+ *    sorted array taken from the container's iterator, which is kept
+ *    until the container changes; otherwise each next row is found with
+ *    CONTAINER_NEXT. Either way this saves the agent a full pass per
+ *    repetition. Requests without repetitions left cost nothing extra.
+ *    The sub-handlers must skip requests with the processed flag set.
+ *
  *  If a row is found, it will be inserted into
  *  the request's data list. The sub-handler may retrieve it by calling
  *      netsnmp_container_table_extract_context(request); *
@@ -168,6 +192,13 @@ _find_next_row(netsnmp_container *c,
                netsnmp_table_request_info *tblreq,
                void * key);
 
+static int
+_bulk_fill_rows(netsnmp_mib_handler *handler,
+                netsnmp_handler_registration *reginfo,
+                netsnmp_agent_request_info *agtreq_info,
+                netsnmp_request_info *requests,
+                container_table_data *tad);
+
 /**********************************************************************
  **********************************************************************
  *                                                                    *
@@ -292,8 +323,10 @@ netsnmp_container_table_data_free(void *p)
 {
     container_table_data *tad = p;
 
-    if (--tad->refcnt == 0)
+    if (--tad->refcnt == 0) {
+        free(tad->bulk_rows);
 	free(tad);
+    }
 }
 
 /** returns a netsnmp_mib_handler object for the table_container helper */
@@ -783,6 +816,11 @@ _container_table_handler(netsnmp_mib_handler *handler,
             agtreq_info->mode = MODE_GET;
             rc = netsnmp_call_next_handler(handler, reginfo, agtreq_info,
                                            requests);
+            if ((rc == SNMP_ERR_NOERROR) &&
+                (reginfo->modes & HANDLER_CAN_GETBULK_NATIVE) &&
+                (TABLE_CONTAINER_KEY_NETSNMP_INDEX == tad->key_type))
+                rc = _bulk_fill_rows(handler, reginfo, agtreq_info,
+                                     requests, tad);
             if (rc != SNMP_ERR_NOERROR) {
                 DEBUGMSGTL(("table_container",
                             "next handler returned %d\n", rc));
@@ -856,6 +894,305 @@ _find_next_row(netsnmp_container *c,
     return row;
 }
 
+/*
+ * processed flag for requests which are not part of the current
+ * GET-BULK fill round.
+ */
+#define TABLE_CONTAINER_BULK_SKIP 254
+
+/*
+ * Point a request at a new row.  The data lower handlers attached to it
+ * for the previous row, i.e. everything after the table helper's
+ * information and our own row and container nodes, is dropped; our own
+ * nodes are reused when they are there.
+ */
+static void
+_bulk_set_row_data(netsnmp_request_info *request, netsnmp_index *row,
+                   container_table_data *tad)
+{
+    netsnmp_data_list *node, *row_node;
+
+    for (node = request->parent_data; node; node = node->next)
+        if (0 == strcmp(node->name, TABLE_HANDLER_NAME))
+            break;
+    if (node) {
+        row_node = node->next;
+        if (row_node && row_node->next && NULL == row_node->free_func &&
+            0 == strcmp(row_node->name, TABLE_CONTAINER_ROW) &&
+            0 == strcmp(row_node->next->name, TABLE_CONTAINER_CONTAINER)) {
+            netsnmp_free_all_list_data(row_node->next->next);
+            row_node->next->next = NULL;
+            row_node->data = row;
+            return;
+        }
+        netsnmp_free_all_list_data(node->next);
+        node->next = NULL;
+    }
+    netsnmp_request_add_list_data(request,
+                                  netsnmp_create_data_list
+                                  (TABLE_CONTAINER_ROW, row, NULL));
+    netsnmp_request_add_list_data(request,
+                                  netsnmp_create_data_list
+                                  (TABLE_CONTAINER_CONTAINER,
+                                   tad->table, NULL));
+}
+
+/*
+ * Bring tad->bulk_rows up to date with the container.  Rows that are out
+ * of date are only taken again if that is cheaper than finding the next
+ * row of each of the pending repetitions with CONTAINER_NEXT, i.e. if
+ * there are more than count / log2(count) of them; otherwise they are
+ * dropped.
+ *
+ * Returns 1 if the rows were taken again (so positions into them are
+ * stale), 0 if they are current, and -1 if there are no rows to use.
+ */
+static int
+_bulk_rows_update(container_table_data *tad, size_t pending)
+{
+    netsnmp_container *c = tad->table;
+    netsnmp_iterator *it;
+    size_t          count = CONTAINER_SIZE(c), i, log2n;
+    void           *row;
+
+    if (tad->bulk_rows && tad->bulk_rows_sync == c->sync &&
+        tad->bulk_rows_count == count)
+        return 0;
+
+    SNMP_FREE(tad->bulk_rows);
+    tad->bulk_rows_count = 0;
+    if (NULL == c->get_iterator || (c->flags & CONTAINER_KEY_UNSORTED) ||
+        0 == count)
+        return -1;
+    for (log2n = 1, i = count; i > 1; i >>= 1)
+        ++log2n;
+    if (pending * log2n <= count)
+        return -1;
+    it = CONTAINER_ITERATOR(c);
+    if (NULL == it)
+        return -1;
+    tad->bulk_rows = (void **)malloc(count * sizeof(void *));
+    if (NULL == tad->bulk_rows) {
+        ITERATOR_RELEASE(it);
+        return -1;
+    }
+    for (i = 0, row = ITERATOR_FIRST(it); row && i < count;
+         row = ITERATOR_NEXT(it))
+        tad->bulk_rows[i++] = row;
+    /* resetting the iterator may have sorted the container */
+    tad->bulk_rows_sync = it->sync;
+    ITERATOR_RELEASE(it);
+    if (i != count || c->sync != tad->bulk_rows_sync) {
+        SNMP_FREE(tad->bulk_rows);
+        return -1;
+    }
+    tad->bulk_rows_count = count;
+    DEBUGMSGTL(("table_container:bulk", "took %" NETSNMP_PRIz "u rows\n",
+                count));
+    return 1;
+}
+
+/*
+ * Position of row in tad->bulk_rows, or bulk_rows_count if it is not
+ * there.
+ */
+static size_t
+_bulk_row_pos(container_table_data *tad, const void *row)
+{
+    size_t          first = 0, len = tad->bulk_rows_count, half;
+    int             result;
+
+    while (len > 0) {
+        half = len >> 1;
+        result = tad->table->compare(tad->bulk_rows[first + half], row);
+        if (result == 0)
+            return first + half;
+        if (result < 0) {
+            first += half + 1;
+            len -= half + 1;
+        } else
+            len = half;
+    }
+    return tad->bulk_rows_count;
+}
+
+/*
+ * Move a GET-BULK request on to its next varbind, filled from the row
+ * (or column) following the one that was just answered.
+ *
+ * *pos is the position of the current row in tad->bulk_rows, or
+ * (size_t)-1 if it has not been looked up yet; it is kept across the
+ * repetitions of the request so that the next row is found without a
+ * search.  Without bulk_rows the next row is found with CONTAINER_NEXT.
+ *
+ * Returns 1 if the request was moved on, 0 if it has to be left to the
+ * agent (no repetitions left, no answer, end of table or range, ...).
+ */
+static int
+_bulk_next_row(netsnmp_handler_registration *reginfo,
+               netsnmp_request_info *request, container_table_data *tad,
+               size_t *pos)
+{
+    netsnmp_table_request_info *tblreq_info;
+    netsnmp_variable_list *var = request->requestvb;
+    netsnmp_index  *row, *next;
+    oid             name[MAX_OID_LEN];
+    size_t          name_len;
+    oid             colnum;
+
+    if (request->processed || request->delegated ||
+        request->repeat <= 0 || NULL == var->next_variable)
+        return 0;
+    switch (var->type) {
+    case ASN_NULL:
+    case ASN_PRIV_RETRY:
+    case SNMP_NOSUCHOBJECT:
+    case SNMP_NOSUCHINSTANCE:
+    case SNMP_ENDOFMIBVIEW:
+        return 0;
+    }
+
+    tblreq_info = netsnmp_extract_table_info(request);
+    row = (netsnmp_index *)netsnmp_container_table_row_extract(request);
+    if (NULL == tblreq_info || NULL == row)
+        return 0;
+
+    colnum = tblreq_info->colnum;
+    if (tad->bulk_rows) {
+        if (*pos >= tad->bulk_rows_count || tad->bulk_rows[*pos] != row)
+            *pos = _bulk_row_pos(tad, row);
+        if (*pos >= tad->bulk_rows_count)
+            return 0;
+        ++*pos;
+        if (*pos < tad->bulk_rows_count)
+            next = (netsnmp_index *)tad->bulk_rows[*pos];
+        else {
+            colnum = netsnmp_table_next_column(tblreq_info);
+            if (0 == colnum)
+                return 0;
+            *pos = 0;
+            next = (netsnmp_index *)tad->bulk_rows[0];
+        }
+    } else {
+        next = (netsnmp_index *)CONTAINER_NEXT(tad->table, row);
+        if (NULL == next) {
+            colnum = netsnmp_table_next_column(tblreq_info);
+            if (0 == colnum)
+                return 0;
+            next = (netsnmp_index *)CONTAINER_FIRST(tad->table);
+            if (NULL == next)
+                return 0;
+        }
+    }
+
+    name_len = reginfo->rootoid_len + 2 + next->len;
+    if (name_len > MAX_OID_LEN)
+        return 0;
+    memcpy(name, reginfo->rootoid, reginfo->rootoid_len * sizeof(oid));
+    name[reginfo->rootoid_len] = 1;
+    name[reginfo->rootoid_len + 1] = colnum;
+    memcpy(&name[reginfo->rootoid_len + 2], next->oids,
+           next->len * sizeof(oid));
+    if (snmp_oid_compare(name, name_len, request->range_end,
+                         request->range_end_len) >= 0)
+        return 0;
+
+    /*
+     * same steps as netsnmp_bulk_to_next_fix_requests, and then
+     * _data_lookup for the new row.
+     */
+    request->repeat--;
+    request->requestvb = var->next_variable;
+    snmp_set_var_objid(request->requestvb, name, name_len);
+    snmp_set_var_typed_value(request->requestvb, ASN_NULL, NULL, 0);
+    if (2 == request->inclusive)
+        request->inclusive = 0;
+
+    tblreq_info->colnum = colnum;
+    tblreq_info->index_oid_len = next->len;
+    memcpy(tblreq_info->index_oid, next->oids, next->len * sizeof(oid));
+    netsnmp_update_variable_list_from_index(tblreq_info);
+
+    _bulk_set_row_data(request, next, tad);
+    return 1;
+}
+
+/*
+ * Number of repetitions still to be answered for the requests, which
+ * are counted in *count.
+ */
+static size_t
+_bulk_pending(netsnmp_request_info *requests, int *count)
+{
+    netsnmp_request_info *request;
+    size_t          pending = 0;
+
+    *count = 0;
+    for (request = requests; request; request = request->next) {
+        ++*count;
+        if (!request->processed && !request->delegated &&
+            request->repeat > 0 && request->requestvb->next_variable)
+            pending += request->repeat;
+    }
+    return pending;
+}
+
+/*
+ * Answer the remaining repetitions of GET-BULK requests, one round of
+ * rows per call of the sub-handlers, for as long as any request moved on.
+ */
+static int
+_bulk_fill_rows(netsnmp_mib_handler *handler,
+                netsnmp_handler_registration *reginfo,
+                netsnmp_agent_request_info *agtreq_info,
+                netsnmp_request_info *requests,
+                container_table_data *tad)
+{
+    netsnmp_request_info *request;
+    int             rc = SNMP_ERR_NOERROR, filled, i, count;
+    size_t         *pos, pending;
+
+    /*
+     * plain GETNEXTs (and GETBULKs without repetitions left) are done
+     */
+    pending = _bulk_pending(requests, &count);
+    if (0 == pending)
+        return rc;
+    pos = (size_t *)malloc(count * sizeof(size_t));
+    if (NULL == pos)
+        return rc;
+    for (i = 0; i < count; ++i)
+        pos[i] = (size_t)-1;
+
+    do {
+        /* the sub-handlers may have changed the container */
+        if (_bulk_rows_update(tad, pending) != 0)
+            for (i = 0; i < count; ++i)
+                pos[i] = (size_t)-1;
+        filled = 0;
+        for (request = requests, i = 0; request;
+             request = request->next, ++i) {
+            if (_bulk_next_row(reginfo, request, tad, &pos[i]))
+                ++filled;
+            else if (!request->processed)
+                request->processed = TABLE_CONTAINER_BULK_SKIP;
+        }
+        if (filled) {
+            DEBUGMSGTL(("table_container:bulk", "filling %d varbinds\n",
+                        filled));
+            rc = netsnmp_call_next_handler(handler, reginfo, agtreq_info,
+                                           requests);
+        }
+        for (request = requests; request; request = request->next)
+            if (TABLE_CONTAINER_BULK_SKIP == request->processed)
+                request->processed = 0;
+    } while (filled && (SNMP_ERR_NOERROR == rc) &&
+             (pending = _bulk_pending(requests, &count)) > 0);
+
+    free(pos);
+    return rc;
+}
+
 /**
  * deprecated, backwards compatability only
  *
@@ -115,31 +115,179 @@ netsnmp_init_table_dataset(void) {
  *
  * ================================== */
 
-/** deletes a single dataset table data.
- *  returns the (possibly still good) next pointer of the deleted data object.
+/*
+ * Row storage: each row is a linked list of cells, one per column.
+ * Once a row is stored in a table (and for rows created from the
+ * default row or cloned for a SET), its cells are packed into a single
+ * block, sorted by column, so that a column is found by indexing or
+ * bisecting the block instead of walking the list.  Cells added to a
+ * row afterwards are linked in front of the block.  Values small
+ * enough to fit in a cell are kept in it.
  */
-NETSNMP_STATIC_INLINE netsnmp_table_data_set_storage *
-netsnmp_table_dataset_delete_data(netsnmp_table_data_set_storage *data)
+
+/** returns non-zero if the value of a cell is kept within the cell */
+#define DATASET_VALUE_INLINE(cell) \
+    ((cell)->data.voidp == (void *) &(cell)->value)
+
+/** frees the value of a cell, unless it is kept within the cell */
+NETSNMP_STATIC_INLINE void
+_dataset_free_value(netsnmp_table_data_set_storage *data)
 {
-    netsnmp_table_data_set_storage *nextPtr = NULL;
-    if (data) {
-        nextPtr = data->next;
-        SNMP_FREE(data->data.voidp);
+    if (!DATASET_VALUE_INLINE(data))
+        free(data->data.voidp);
+    data->data.voidp = NULL;
+}
+
+/**
+ * stores a copy of value in a cell, within the cell if it fits.
+ *
+ * @return SNMPERR_SUCCESS or SNMPERR_MALLOC
+ */
+static int
+_dataset_set_value(netsnmp_table_data_set_storage *data,
+                   const void *value, size_t value_len)
+{
+    void           *p;
+
+    p = DATASET_VALUE_INLINE(data) ? NULL : data->data.voidp;
+    if (!value || !value_len) {
+        free(p);
+        data->data.voidp = NULL;
+    } else if (value_len <= sizeof(data->value)) {
+        memmove(&data->value, value, value_len);
+        free(p);
+        data->data.voidp = &data->value;
+    } else {
+        p = realloc(p, value_len);
+        if (!p)
+            return SNMPERR_MALLOC;
+        memcpy(p, value, value_len);
+        data->data.voidp = p;
     }
-    SNMP_FREE(data);
-    return nextPtr;
+    data->data_len = value_len;
+    return SNMPERR_SUCCESS;
 }
 
-/** deletes all the data from this node and beyond in the linked list */
-NETSNMP_INLINE void
-netsnmp_table_dataset_delete_all_data(netsnmp_table_data_set_storage *data)
+/**
+ * frees a list of cells, and their values if free_values is set.
+ * Blocks are freed once all their cells have been visited.
+ */
+static void
+_dataset_free_cells(netsnmp_table_data_set_storage *data, int free_values)
 {
+    netsnmp_table_data_set_storage *next, *head;
+    unsigned int    i, len;
 
     while (data) {
-        data = netsnmp_table_dataset_delete_data(data);
+        if (!data->block_len) {
+            next = data->next;
+            if (free_values)
+                _dataset_free_value(data);
+            free(data);
+            data = next;
+            continue;
+        }
+        head = (data->flags & NETSNMP_TABLE_DATA_SET_BLOCK_HEAD) ?
+            data : NULL;
+        len = data->block_len;
+        if (free_values)
+            for (i = 0; i < len; i++)
+                _dataset_free_value(&data[i]);
+        next = data[len - 1].next;
+        free(head);
+        data = next;
     }
 }
 
+static int
+_dataset_column_compare(const void *a, const void *b)
+{
+    const netsnmp_table_data_set_storage *l = a, *r = b;
+
+    return l->column < r->column ? -1 : l->column > r->column;
+}
+
+/**
+ * packs a list of cells into a single block sorted by column.  With
+ * dup set the cells and their values are copied, otherwise they are
+ * moved into the block and the old cells are freed.
+ *
+ * @return the new block, or NULL if out of memory, in which case the
+ *         list is left alone.
+ */
+static netsnmp_table_data_set_storage *
+_dataset_pack(netsnmp_table_data_set_storage *data, int dup)
+{
+    netsnmp_table_data_set_storage *block, *ptr;
+    unsigned int    i, count = 0;
+    int             sorted = 1;
+
+    for (ptr = data; ptr; ptr = ptr->next) {
+        if (ptr->next && ptr->next->column < ptr->column)
+            sorted = 0;
+        ++count;
+    }
+    if (!count)
+        return NULL;
+
+    block = (netsnmp_table_data_set_storage *)
+        calloc(count, sizeof(netsnmp_table_data_set_storage));
+    if (!block)
+        return NULL;
+    for (ptr = data, i = 0; ptr; ptr = ptr->next, i++) {
+        block[i] = *ptr;
+        /* remember inline values across the sort */
+        block[i].flags = DATASET_VALUE_INLINE(ptr);
+    }
+    if (!sorted)
+        qsort(block, count, sizeof(*block), _dataset_column_compare);
+
+    for (i = 0; i < count; i++) {
+        ptr = &block[i];
+        if (ptr->flags)
+            ptr->data.voidp = &ptr->value;
+        else if (dup && ptr->data.voidp) {
+            ptr->data.voidp = netsnmp_memdup(ptr->data.voidp, ptr->data_len);
+            if (!ptr->data.voidp) {
+                while (i-- > 0)
+                    _dataset_free_value(&block[i]);
+                free(block);
+                return NULL;
+            }
+        }
+        ptr->flags = 0;
+        ptr->block_len = count - i;
+        ptr->next = (i + 1 < count) ? &block[i + 1] : NULL;
+    }
+    block->flags = NETSNMP_TABLE_DATA_SET_BLOCK_HEAD;
+
+    if (!dup)
+        _dataset_free_cells(data, 0);
+    return block;
+}
+
+/** packs the cells of a row, unless they already form a single block */
+static void
+_dataset_pack_row(netsnmp_table_row *row)
+{
+    netsnmp_table_data_set_storage *data, *block;
+
+    data = (netsnmp_table_data_set_storage *) row->data;
+    if (!data || ((data->flags & NETSNMP_TABLE_DATA_SET_BLOCK_HEAD) &&
+                  !data[data->block_len - 1].next))
+        return;
+    block = _dataset_pack(data, 0);
+    if (block)
+        row->data = block;
+}
+
+/** deletes all the data from this node and beyond in the linked list */
+NETSNMP_INLINE void
+netsnmp_table_dataset_delete_all_data(netsnmp_table_data_set_storage *data)
+{
+    _dataset_free_cells(data, 1);
+}
+
 /** deletes all the data from this node and beyond in the linked list */
 NETSNMP_INLINE void
 netsnmp_table_dataset_delete_row(netsnmp_table_row *row)
@@ -160,6 +308,8 @@ netsnmp_table_dataset_add_row(netsnmp_table_data_set *table,
 {
     if (!table)
         return;
+    if (row)
+        _dataset_pack_row(row);
     netsnmp_table_data_add_row(table->table, row);
 }
 
@@ -171,6 +321,8 @@ netsnmp_table_dataset_replace_row(netsnmp_table_data_set *table,
 {
     if (!table)
         return;
+    if (newrow)
+        _dataset_pack_row(newrow);
     netsnmp_table_data_replace_row(table->table, origrow, newrow);
 }
 
@@ -223,6 +375,7 @@ void netsnmp_delete_table_data_set(netsnmp_table_data_set *table_set)
 
     for (ptr = table_set->default_row; ptr; ptr = next) {
         next = ptr->next;
+        _dataset_free_value(ptr);
         free(ptr);
     }
     table_set->default_row = NULL;
@@ -240,7 +393,7 @@ void netsnmp_delete_table_data_set(netsnmp_table_data_set *table_set)
 netsnmp_table_row *
 netsnmp_table_data_set_clone_row(netsnmp_table_row *row)
 {
-    netsnmp_table_data_set_storage *data, **newrowdata;
+    netsnmp_table_data_set_storage *data;
     netsnmp_table_row *newrow;
 
     if (!row)
@@ -253,25 +406,10 @@ netsnmp_table_data_set_clone_row(netsnmp_table_row *row)
     data = (netsnmp_table_data_set_storage *) row->data;
 
     if (data) {
-        for (newrowdata =
-             (netsnmp_table_data_set_storage **) &(newrow->data); data;
-             newrowdata = &((*newrowdata)->next), data = data->next) {
-
-            *newrowdata = netsnmp_memdup(data,
-                sizeof(netsnmp_table_data_set_storage));
-            if (!*newrowdata) {
-                netsnmp_table_dataset_delete_row(newrow);
-                return NULL;
-            }
-
-            if (data->data.voidp) {
-                (*newrowdata)->data.voidp =
-                    netsnmp_memdup(data->data.voidp, data->data_len);
-                if (!(*newrowdata)->data.voidp) {
-                    netsnmp_table_dataset_delete_row(newrow);
-                    return NULL;
-                }
-            }
+        newrow->data = _dataset_pack(data, 1);
+        if (!newrow->data) {
+            netsnmp_table_dataset_delete_row(newrow);
+            return NULL;
         }
     }
     return newrow;
@@ -300,6 +438,7 @@ netsnmp_table_data_set_create_row_from_defaults
             netsnmp_mark_row_column_writable(row, defrow->column, 1);
 #endif /* !NETSNMP_NO_WRITE_SUPPORT */
     }
+    _dataset_pack_row(row);
     return row;
 }
 
@@ -767,7 +906,7 @@ netsnmp_table_data_set_helper_handler(netsnmp_mib_handler *handler,
             /*
              * modify row and set new value 
              */
-            SNMP_FREE(data->data.string);
+            _dataset_free_value(data);
             data->data.string = (u_char *)
                 netsnmp_strdup_and_null(request->requestvb->val.string,
                                         request->requestvb->val_len);
@@ -1229,6 +1368,7 @@ netsnmp_config_parse_add_row(const char *token, char *line)
             netsnmp_mark_row_column_writable(row, dr->column, 1);       /* make writable */
 #endif /* !NETSNMP_NO_WRITE_SUPPORT */
     }
+    _dataset_pack_row(row);
     rc = netsnmp_table_data_add_row(tables->table_set->table, row);
     if (SNMPERR_SUCCESS != rc) {
         config_pwarn("error adding table row");
@@ -1340,9 +1480,37 @@ netsnmp_table_data_set_storage *
 netsnmp_table_data_set_find_column(netsnmp_table_data_set_storage *start,
                                    unsigned int column)
 {
-    while (start && start->column != column)
-        start = start->next;
-    return start;
+    unsigned int    lo, hi, mid;
+
+    while (start) {
+        if (!start->block_len) {
+            if (start->column == column)
+                return start;
+            start = start->next;
+            continue;
+        }
+
+        /*
+         * a block sorted by column: columns are usually contiguous, so
+         * try indexing before bisecting
+         */
+        hi = start->block_len;
+        if (column >= start->column && column - start->column < hi &&
+            start[column - start->column].column == column)
+            return &start[column - start->column];
+        lo = 0;
+        while (lo < hi) {
+            mid = (lo + hi) / 2;
+            if (start[mid].column == column)
+                return &start[mid];
+            if (start[mid].column < column)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        start = start[start->block_len - 1].next;
+    }
+    return NULL;
 }
 
 #ifndef NETSNMP_NO_WRITE_SUPPORT
@@ -1436,21 +1604,20 @@ netsnmp_set_row_column(netsnmp_table_row *row, unsigned int column,
 
     /* Return now if neither the type nor the data itself has been modified. */
     if (data->type == type && data->data_len == value_len
-        && (value == NULL || memcmp(&data->data.string, value, value_len) == 0))
+        && (value == NULL || value_len == 0 ||
+            (data->data.voidp &&
+             memcmp(data->data.string, value, value_len) == 0)))
             return SNMPERR_SUCCESS;
 
-    /* Reallocate memory and store the new value. */
-    data->data.voidp = realloc(data->data.voidp, value ? value_len : 0);
-    if (value && value_len && !data->data.voidp) {
+    /* Store the new value, reallocating memory if needed. */
+    if (_dataset_set_value(data, value, value_len) != SNMPERR_SUCCESS) {
+        _dataset_free_value(data);
         data->data_len = 0;
         data->type = SNMP_NOSUCHINSTANCE;
         snmp_log(LOG_CRIT, "no memory in netsnmp_set_row_column");
         return SNMPERR_MALLOC;
     }
-    if (value && value_len)
-        memcpy(data->data.string, value, value_len);
     data->type = type;
-    data->data_len = value_len;
     return SNMPERR_SUCCESS;
 }
 
@@ -39,6 +39,8 @@ extern netsnmp_cache *netsnmp_cache_get_head(void);
 
 #define  NSCACHE_TIMEOUT	2
 #define  NSCACHE_STATUS		3
+#define  NSCACHE_HITS		4
+#define  NSCACHE_MISSES		5
 
 #define NSCACHE_STATUS_ENABLED  1
 #define NSCACHE_STATUS_DISABLED 2
@@ -88,7 +90,7 @@ init_nsCache(void)
     }
     netsnmp_table_helper_add_indexes(table_info, ASN_PRIV_IMPLIED_OBJECT_ID, 0);
     table_info->min_column = NSCACHE_TIMEOUT;
-    table_info->max_column = NSCACHE_STATUS;
+    table_info->max_column = NSCACHE_MISSES;
 
 
     /*
@@ -273,6 +275,7 @@ handle_nsCacheTable(netsnmp_mib_handler *handler,
                 netsnmp_request_info *requests)
 {
     long status;
+    u_long counter;
     netsnmp_request_info       *request     = NULL;
     netsnmp_table_request_info *table_info  = NULL;
     netsnmp_cache              *cache_entry = NULL;
@@ -316,6 +319,19 @@ handle_nsCacheTable(netsnmp_mib_handler *handler,
                                          (u_char*)&status, sizeof(status));
 	        break;
 
+            case NSCACHE_HITS:
+            case NSCACHE_MISSES:
+                if (!cache_entry) {
+                    netsnmp_set_request_error(reqinfo, request, SNMP_NOSUCHINSTANCE);
+                    continue;
+		}
+                counter = (table_info->colnum == NSCACHE_HITS) ?
+                              cache_entry->hits : cache_entry->misses;
+                counter &= 0xffffffff;
+	        snmp_set_var_typed_value(request->requestvb, ASN_COUNTER,
+                                         (u_char*)&counter, sizeof(counter));
+	        break;
+
             default:
                 netsnmp_set_request_error(reqinfo, request, SNMP_NOSUCHOBJECT);
                 continue;
@@ -415,6 +431,7 @@ handle_nsCacheTable(netsnmp_mib_handler *handler,
                         break;
 		    case NSCACHE_STATUS_EMPTY:
                         cache_entry->free_cache(cache_entry, cache_entry->magic);
+                        cache_entry->valid = 0;
                         free(cache_entry->timestampM);
                         cache_entry->timestampM = NULL;
                         break;
@@ -322,6 +322,7 @@ nsVacmAccessTable_handler(netsnmp_mib_handler *handler,
         break;
 
     case MODE_SET_COMMIT:
+        vacm_tablesChanged();
         for (request = requests; request; request = request->next) {
             entry = (struct vacm_accessEntry *)
                 netsnmp_extract_iterator_context(request);
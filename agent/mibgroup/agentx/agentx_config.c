@@ -154,6 +154,20 @@ agentx_parse_agentx_ping_interval(const char *token, char *cptr)
     netsnmp_ds_set_int(NETSNMP_DS_APPLICATION_ID,
                        NETSNMP_DS_AGENT_AGENTX_PING_INTERVAL, x);
 }
+
+void
+agentx_parse_agentx_ring_size(const char *token, char *cptr)
+{
+    int x = atoi(cptr);
+
+    DEBUGMSGTL(("agentx/config/ring", "%s\n", cptr));
+    if (x < 0) {
+        config_perror("Invalid ring size value");
+        return;
+    }
+    netsnmp_ds_set_int(NETSNMP_DS_APPLICATION_ID,
+                       NETSNMP_DS_AGENT_AGENTX_RING_SIZE, x);
+}
 #endif                          /* USING_AGENTX_SUBAGENT_MODULE */
 
 /* ---------------------------------------------------------------------
@@ -243,6 +257,9 @@ agentx_config_init(void)
       /* ping and/or reconnect by default every 15 seconds */
       netsnmp_ds_set_int(NETSNMP_DS_APPLICATION_ID,
                          NETSNMP_DS_AGENT_AGENTX_PING_INTERVAL, 15);
+      agentx_register_config_handler("agentxRingSize",
+                                     agentx_parse_agentx_ring_size, NULL,
+                                     "BYTES (0 = use the socket)");
     }
 #endif /* USING_AGENTX_SUBAGENT_MODULE */
 }
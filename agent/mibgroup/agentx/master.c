@@ -203,6 +203,111 @@ real_init_master(void)
     DEBUGMSGTL(("agentx/master", "initializing...   DONE\n"));
 }
 
+/*
+ * GETBULK requests are sent to subagents as AgentX GetBulk PDUs: the
+ * requests without repetitions left first, as the non-repeaters, then
+ * the others, asked for as many repetitions as the most any of them
+ * has left.  Returns the requests in that order, or NULL if none has
+ * repetitions left and a GetNext will do.
+ */
+static netsnmp_request_info **
+_agentx_bulk_requests(netsnmp_request_info *requests, int *non_repeaters,
+                      int *repeaters, int *max_repetitions)
+{
+    netsnmp_request_info *request, **reqs;
+    int             n = 0, r = 0, m = 0;
+
+    for (request = requests; request; request = request->next) {
+        if (request->repeat <= 0)
+            n++;
+        else {
+            r++;
+            if (request->repeat + 1 > m)
+                m = request->repeat + 1;
+        }
+    }
+    if (r == 0)
+        return NULL;
+    reqs = (netsnmp_request_info **) malloc((n + r) * sizeof(*reqs));
+    if (!reqs)
+        return NULL;
+
+    *non_repeaters = n;
+    *repeaters = r;
+    if (max_repetitions)
+        *max_repetitions = m > 0xffff ? 0xffff : m;
+    for (request = requests, n = 0, r = *non_repeaters; request;
+         request = request->next) {
+        if (request->repeat <= 0)
+            reqs[n++] = request;
+        else
+            reqs[r++] = request;
+    }
+    return reqs;
+}
+
+static void
+_agentx_set_result(netsnmp_request_info *request,
+                   netsnmp_variable_list *var)
+{
+    DEBUGMSGTL(("agentx/master",
+                "  handle_agentx_response: processing: "));
+    DEBUGMSGOID(("agentx/master", var->name, var->name_length));
+    DEBUGMSG(("agentx/master", "\n"));
+    if (netsnmp_ds_get_boolean(NETSNMP_DS_APPLICATION_ID, NETSNMP_DS_AGENT_VERBOSE)) {
+        DEBUGMSGTL(("agentx/master", "    >> "));
+        DEBUGMSGVAR(("agentx/master", var));
+        DEBUGMSG(("agentx/master", "\n"));
+    }
+
+    /*
+     * update the oid in the original request 
+     */
+    if (var->type != SNMP_ENDOFMIBVIEW) {
+        snmp_set_var_typed_value(request->requestvb, var->type,
+                                 var->val.string, var->val_len);
+        snmp_set_var_objid(request->requestvb, var->name,
+                           var->name_length);
+    }
+}
+
+/*
+ * Spread the rows of a GetBulk response over the repetitions of the
+ * requests, in the order they were sent.  A repeater takes rows until
+ * it runs out of repetitions, leaves its range, or meets endOfMibView,
+ * which leaves it to be carried on by the next pass of the agent.
+ */
+static int
+_agentx_got_bulk(netsnmp_request_info **reqs, int n, int r,
+                 netsnmp_variable_list *vars)
+{
+    netsnmp_variable_list **vp, *var;
+    int             nvars = 0, i, j;
+
+    for (var = vars; var; var = var->next_variable)
+        nvars++;
+    if (nvars < n + r)
+        return -1;
+    vp = (netsnmp_variable_list **) malloc(nvars * sizeof(*vp));
+    if (!vp)
+        return -1;
+    for (var = vars, i = 0; var; var = var->next_variable)
+        vp[i++] = var;
+
+    for (i = 0; i < n; i++)
+        _agentx_set_result(reqs[i], vp[i]);
+    for (i = 0; i < r; i++)
+        for (j = n + i; j < nvars; j += r) {
+            if (vp[j]->type == SNMP_ENDOFMIBVIEW)
+                break;
+            _agentx_set_result(reqs[n + i], vp[j]);
+            if (!netsnmp_bulk_to_next_fix_request(reqs[n + i]))
+                break;
+        }
+    free(vp);
+    return 0;
+}
+
         /*
          * Handle the response from an AgentX subagent,
          *   merging the answers back into the original query
@@ -213,8 +318,8 @@ agentx_got_response(int operation,
                     int reqid, netsnmp_pdu *pdu, void *magic)
 {
     netsnmp_delegated_cache *cache = (netsnmp_delegated_cache *) magic;
-    int             i, ret;
-    netsnmp_request_info *requests, *request;
+    int             i, ret, n, r;
+    netsnmp_request_info *requests, *request, **reqs;
     netsnmp_variable_list *var;
     netsnmp_session *ax_session;
 
@@ -340,9 +445,21 @@ agentx_got_response(int operation,
         }
 
         ret = 0;
+        if (cache->reqinfo->mode == MODE_GETBULK &&
+            (reqs = _agentx_bulk_requests(requests, &n, &r, NULL)) != NULL) {
+            /*
+             * the varbinds of a GetBulk were sent in a different order
+             */
+            if (pdu->errindex > 0 && pdu->errindex <= n + r) {
+                netsnmp_set_request_error(cache->reqinfo,
+                                          reqs[pdu->errindex - 1], err);
+                ret = 1;
+            }
+            free(reqs);
+        }
         for (request = requests, i = 1; request;
              request = request->next, i++) {
-            if (i == pdu->errindex) {
+            if (!ret && i == pdu->errindex) {
                 /*
                  * Mark this varbind as the one generating the error.
                  * Note that the AgentX errindex may not match the
@@ -364,6 +481,23 @@ agentx_got_response(int operation,
         netsnmp_free_delegated_cache(cache);
         DEBUGMSGTL(("agentx/master", "end error branch\n"));
         return 1;
+    } else if (cache->reqinfo->mode == MODE_GETBULK &&
+               (reqs = _agentx_bulk_requests(requests, &n, &r, NULL)) != NULL) {
+        /*
+         * the answer to a GetBulk, with several rows per varbind
+         */
+        DEBUGMSGTL(("agentx/master",
+                    "agentx_got_response() beginning bulk, N=%d R=%d...\n",
+                    n, r));
+        if (_agentx_got_bulk(reqs, n, r, pdu->variables) < 0) {
+            snmp_log(LOG_ERR,
+                     "response to agentx request illegal.  bailing out.\n");
+            netsnmp_set_request_error(cache->reqinfo, requests,
+                                      SNMP_ERR_GENERR);
+        }
+        free(reqs);
+        netsnmp_handler_mark_requests_as_delegated(requests,
+                                                   REQUEST_IS_NOT_DELEGATED);
     } else if (cache->reqinfo->mode == MODE_GET ||
                cache->reqinfo->mode == MODE_GETNEXT ||
                cache->reqinfo->mode == MODE_GETBULK) {
@@ -377,25 +511,7 @@ agentx_got_response(int operation,
             /*
              * Otherwise, process successful requests
              */
-            DEBUGMSGTL(("agentx/master",
-                        "  handle_agentx_response: processing: "));
-            DEBUGMSGOID(("agentx/master", var->name, var->name_length));
-            DEBUGMSG(("agentx/master", "\n"));
-            if (netsnmp_ds_get_boolean(NETSNMP_DS_APPLICATION_ID, NETSNMP_DS_AGENT_VERBOSE)) {
-                DEBUGMSGTL(("agentx/master", "    >> "));
-                DEBUGMSGVAR(("agentx/master", var));
-                DEBUGMSG(("agentx/master", "\n"));
-            }
-
-            /*
-             * update the oid in the original request 
-             */
-            if (var->type != SNMP_ENDOFMIBVIEW) {
-                snmp_set_var_typed_value(request->requestvb, var->type,
-                                         var->val.string, var->val_len);
-                snmp_set_var_objid(request->requestvb, var->name,
-                                   var->name_length);
-            }
+            _agentx_set_result(request, var);
             request->delegated = REQUEST_IS_NOT_DELEGATED;
         }
 
@@ -446,10 +562,10 @@ agentx_master_handler(netsnmp_mib_handler *handler,
                       netsnmp_request_info *requests)
 {
     netsnmp_session *ax_session = (netsnmp_session *) handler->myvoid;
-    netsnmp_request_info *request = requests;
+    netsnmp_request_info *request = requests, **reqs = NULL;
     netsnmp_pdu    *pdu;
     void           *cb_data;
-    int             result;
+    int             result, i = 0, n, r, m;
 
     DEBUGMSGTL(("agentx/master",
                 "agentx master handler starting, mode = 0x%02x\n",
@@ -472,8 +588,17 @@ agentx_master_handler(netsnmp_mib_handler *handler,
         pdu = snmp_pdu_create(AGENTX_MSG_GETNEXT);
         break;
 
-    case MODE_GETBULK:         /* WWWXXX */
-        pdu = snmp_pdu_create(AGENTX_MSG_GETNEXT);
+    case MODE_GETBULK:
+        reqs = _agentx_bulk_requests(requests, &n, &r, &m);
+        if (reqs) {
+            pdu = snmp_pdu_create(AGENTX_MSG_GETBULK);
+            if (pdu) {
+                pdu->non_repeaters = n;
+                pdu->max_repetitions = m;
+            }
+            request = reqs[0];
+        } else
+            pdu = snmp_pdu_create(AGENTX_MSG_GETNEXT);
         break;
 
 #ifndef NETSNMP_NO_WRITE_SUPPORT
@@ -509,6 +634,7 @@ agentx_master_handler(netsnmp_mib_handler *handler,
     }
 
     if (!pdu) {
+        free(reqs);
         netsnmp_set_request_error(reqinfo, requests, SNMP_ERR_GENERR);
         return SNMP_ERR_NOERROR;
     }
@@ -594,8 +720,12 @@ agentx_master_handler(netsnmp_mib_handler *handler,
         /*
          * next... 
          */
-        request = request->next;
+        if (reqs)
+            request = ++i < n + r ? reqs[i] : NULL;
+        else
+            request = request->next;
     }
+    free(reqs);
 
     /*
      * When the master sends a CleanupSet PDU, it will never get a response
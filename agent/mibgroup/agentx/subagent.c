@@ -51,6 +51,7 @@ netsnmp_feature_child_of(agentx_subagent, agentx_all);
 netsnmp_feature_child_of(agentx_enable_subagent, agentx_subagent);
 
 netsnmp_feature_require(remove_trap_session);
+netsnmp_feature_require(snmp_split_pdu);
 
 #ifdef USING_AGENTX_SUBAGENT_MODULE
 
@@ -75,6 +76,7 @@ typedef struct _net_snmpsubagent_magic_s {
     int             original_command;
     netsnmp_session *session;
     netsnmp_variable_list *ovars;
+    long            non_repeaters;
 } ns_subagent_magic;
 
 struct agent_netsnmp_set_info {
@@ -246,15 +248,13 @@ free_set_vars(netsnmp_session * ss, netsnmp_pdu *pdu)
 static void
 send_agentx_error(netsnmp_session *session, netsnmp_pdu *pdu, int errstat, int errindex)
 {
-    pdu = snmp_clone_pdu(pdu);
+    pdu = snmp_split_pdu(pdu, 0, 0);    /* no varbinds */
     if (!pdu)
         return;
     pdu->command   = AGENTX_MSG_RESPONSE;
     pdu->version   = session->version;
     pdu->errstat   = errstat;
     pdu->errindex  = errindex;
-    snmp_free_varbind(pdu->variables);
-    pdu->variables = NULL;
 
     DEBUGMSGTL(("agentx/subagent", "Sending AgentX response error stat %d idx %d\n",
              errstat, errindex));
@@ -263,6 +263,22 @@ send_agentx_error(netsnmp_session *session, netsnmp_pdu *pdu, int errstat, int e
     }
 }
 
+/*
+ * Copy a PDU that its caller frees once we return, moving its varbinds
+ * over rather than cloning them a second time.
+ */
+static netsnmp_pdu *
+_subagent_take_pdu(netsnmp_pdu *pdu)
+{
+    netsnmp_pdu    *newpdu = snmp_split_pdu(pdu, 0, 0);
+
+    if (newpdu) {
+        newpdu->variables = pdu->variables;
+        pdu->variables = NULL;
+    }
+    return newpdu;
+}
+
 int
 handle_agentx_packet(int operation, netsnmp_session * session, int reqid,
                      netsnmp_pdu *pdu, void *magic)
@@ -383,11 +399,9 @@ handle_agentx_packet(int operation, netsnmp_session * session, int reqid,
         break;
 
     case AGENTX_MSG_GETBULK:
-        /*
-         * WWWXXX 
-         */
         DEBUGMSGTL(("agentx/subagent", "  -> getbulk\n"));
         pdu->command = SNMP_MSG_GETBULK;
+        smagic->non_repeaters = pdu->non_repeaters;
 
         /*
          * We have to save a copy of the original variable list here because
@@ -498,12 +512,12 @@ handle_agentx_packet(int operation, netsnmp_session * session, int reqid,
      */
 
     /*
-     * We have to clone the PDU here, because when we return from this
+     * We have to copy the PDU here, because when we return from this
      * callback, sess_process_packet will free(pdu), but this call also
      * free()s its argument PDU.  
      */
 
-    internal_pdu = snmp_clone_pdu(pdu);
+    internal_pdu = _subagent_take_pdu(pdu);
     if (!internal_pdu) {
         free(smagic);
         return 1;
@@ -541,19 +555,61 @@ _invalid_op_and_magic(int op, ns_subagent_magic *smagic)
     return invalid;
 }
 
+/*
+ * If the master agent requested scoping for a search range, check that
+ * the answer v to the original varbind u is within it.
+ */
+static void
+_subagent_scope(netsnmp_variable_list *u, netsnmp_variable_list *v)
+{
+    int             rc;
+
+    if (snmp_oid_compare
+        (u->val.objid, u->val_len / sizeof(oid), nullOid,
+         nullOidLen/sizeof(oid)) != 0) {
+        /*
+         * The master agent requested scoping for this variable.  
+         */
+        rc = snmp_oid_compare(v->name, v->name_length,
+                              u->val.objid,
+                              u->val_len / sizeof(oid));
+        DEBUGMSGTL(("agentx/subagent", "result "));
+        DEBUGMSGOID(("agentx/subagent", v->name, v->name_length));
+        DEBUGMSG(("agentx/subagent", " scope to "));
+        DEBUGMSGOID(("agentx/subagent",
+                     u->val.objid, u->val_len / sizeof(oid)));
+        DEBUGMSG(("agentx/subagent", " result %d\n", rc));
+
+        if (rc >= 0) {
+            /*
+             * The varbind is out of scope.  From RFC2741, p. 66: "If
+             * the subagent cannot locate an appropriate variable,
+             * v.name is set to the starting OID, and the VarBind is
+             * set to `endOfMibView'".  
+             */
+            snmp_set_var_objid(v, u->name, u->name_length);
+            snmp_set_var_typed_value(v, SNMP_ENDOFMIBVIEW, NULL, 0);
+            DEBUGMSGTL(("agentx/subagent",
+                        "scope violation -- return endOfMibView\n"));
+        }
+    } else {
+        DEBUGMSGTL(("agentx/subagent", "unscoped var\n"));
+    }
+}
+
 int
 handle_subagent_response(int op, netsnmp_session * session, int reqid,
                          netsnmp_pdu *pdu, void *magic)
 {
     ns_subagent_magic *smagic = (ns_subagent_magic *) magic;
-    netsnmp_variable_list *u = NULL, *v = NULL;
-    int             rc = 0;
+    netsnmp_variable_list *u = NULL, *v = NULL, *r;
+    long            n;
 
     if (_invalid_op_and_magic(op, magic)) {
         return 1;
     }
 
-    pdu = snmp_clone_pdu(pdu);
+    pdu = _subagent_take_pdu(pdu);
     if (!pdu)
         return 1;
     DEBUGMSGTL(("agentx/subagent",
@@ -576,46 +632,30 @@ handle_subagent_response(int op, netsnmp_session * session, int reqid,
                     "do getNext scope processing %p %p\n", smagic->ovars,
                     pdu->variables));
         for (u = smagic->ovars, v = pdu->variables; u != NULL && v != NULL;
-             u = u->next_variable, v = v->next_variable) {
-            if (snmp_oid_compare
-                (u->val.objid, u->val_len / sizeof(oid), nullOid,
-                 nullOidLen/sizeof(oid)) != 0) {
-                /*
-                 * The master agent requested scoping for this variable.  
-                 */
-                rc = snmp_oid_compare(v->name, v->name_length,
-                                      u->val.objid,
-                                      u->val_len / sizeof(oid));
-                DEBUGMSGTL(("agentx/subagent", "result "));
-                DEBUGMSGOID(("agentx/subagent", v->name, v->name_length));
-                DEBUGMSG(("agentx/subagent", " scope to "));
-                DEBUGMSGOID(("agentx/subagent",
-                             u->val.objid, u->val_len / sizeof(oid)));
-                DEBUGMSG(("agentx/subagent", " result %d\n", rc));
-
-                if (rc >= 0) {
-                    /*
-                     * The varbind is out of scope.  From RFC2741, p. 66: "If
-                     * the subagent cannot locate an appropriate variable,
-                     * v.name is set to the starting OID, and the VarBind is
-                     * set to `endOfMibView'".  
-                     */
-                    snmp_set_var_objid(v, u->name, u->name_length);
-                    snmp_set_var_typed_value(v, SNMP_ENDOFMIBVIEW, NULL, 0);
-                    DEBUGMSGTL(("agentx/subagent",
-                                "scope violation -- return endOfMibView\n"));
-                }
-            } else {
-                DEBUGMSGTL(("agentx/subagent", "unscoped var\n"));
-            }
+             u = u->next_variable, v = v->next_variable)
+            _subagent_scope(u, v);
+    } else if (smagic->original_command == AGENTX_MSG_GETBULK) {
+        /*
+         * The non-repeaters are answered once each, then come the rows
+         * of the repeaters, each row in the order of the request.
+         */
+        DEBUGMSGTL(("agentx/subagent",
+                    "do getBulk scope processing %p %p\n", smagic->ovars,
+                    pdu->variables));
+        for (u = smagic->ovars, v = pdu->variables, n = 0;
+             u != NULL && v != NULL && n < smagic->non_repeaters;
+             u = u->next_variable, v = v->next_variable, n++)
+            _subagent_scope(u, v);
+        for (r = u; v != NULL; v = v->next_variable) {
+            if (u == NULL)
+                u = r;
+            if (u == NULL)
+                break;
+            _subagent_scope(u, v);
+            u = u->next_variable;
         }
     }
 
-    /*
-     * XXXJBPN: similar for GETBULK but the varbinds can get re-ordered I
-     * think which makes it er more difficult.  
-     */
-
     if (smagic->ovars != NULL) {
         snmp_free_varbind(smagic->ovars);
     }
@@ -836,6 +876,9 @@ subagent_open_master_session(void)
     netsnmp_transport *t;
     netsnmp_session sess;
     const char *agentx_socket;
+#ifdef NETSNMP_TRANSPORT_UNIX_DOMAIN
+    int ring_size;
+#endif
 
     DEBUGMSGTL(("agentx/subagent", "opening session...\n"));
 
@@ -877,6 +920,24 @@ subagent_open_master_session(void)
         return -1;
     }
 
+#ifdef NETSNMP_TRANSPORT_UNIX_DOMAIN
+    /*
+     * Move a local connection onto shared memory if asked to.  A master
+     * agent that does not know about it makes us start over on a fresh
+     * connection.
+     */
+    ring_size = netsnmp_ds_get_int(NETSNMP_DS_APPLICATION_ID,
+                                   NETSNMP_DS_AGENT_AGENTX_RING_SIZE);
+    if (ring_size > 0 && netsnmp_unix_ring_offer(t, ring_size) < 0) {
+        DEBUGMSGTL(("agentx/subagent", "shared memory ring refused\n"));
+        t->f_close(t);
+        netsnmp_transport_free(t);
+        t = netsnmp_transport_open_client("agentx", agentx_socket);
+        if (t == NULL)
+            return -1;
+    }
+#endif
+
     main_session =
         snmp_add_full(&sess, t, NULL, agentx_parse, NULL, NULL,
                       agentx_realloc_build, agentx_check_packet, NULL);
@@ -195,28 +195,57 @@ _mteTrigger_failure( /* int error, */ const char *msg )
     return;
 }
 
-void
-mteTrigger_run( unsigned int reg, void *clientarg)
+static void _mteTrigger_sample(struct mteTrigger *entry,
+                               netsnmp_variable_list *var,
+                               netsnmp_variable_list *sysUT);
+
+    /*
+     * Retrieve the requested MIB value(s) and sysUpTime.0 through
+     *   the given internal query session.
+     */
+static int
+_mteTrigger_query(oid *valueID, size_t valueID_len, int wild,
+                  netsnmp_session *session,
+                  netsnmp_variable_list **var, netsnmp_variable_list *sysUT)
 {
-    struct mteTrigger *entry = (struct mteTrigger *)clientarg;
-    netsnmp_variable_list *var, *vtmp;
-    netsnmp_variable_list *vp1, *vp1_prev;
-    netsnmp_variable_list *vp2, *vp2_prev;
-    netsnmp_variable_list *dvar = NULL;
-    netsnmp_variable_list *dv1  = NULL, *dv2 = NULL;
-    netsnmp_variable_list sysUT_var;
-    int  cmp = 0, n, n2;
-    long value;
-    const char *reason;
+    int n;
 
-    if (!entry) {
-        snmp_alarm_unregister( reg );
-        return;
+    *var = SNMP_MALLOC_TYPEDEF( netsnmp_variable_list );
+    if (!*var) {
+        _mteTrigger_failure("failed to create mteTrigger query varbind");
+        return SNMP_ERR_GENERR;
     }
+    snmp_set_var_objid( *var, valueID, valueID_len );
+    if ( wild ) {
+        n = netsnmp_query_walk( *var, session );
+    } else {
+        n = netsnmp_query_get(  *var, session );
+    }
+    if ( n != SNMP_ERR_NOERROR ) {
+        DEBUGMSGTL(( "disman:event:trigger:monitor", "Trigger query (%s) failed: %d\n",
+                           ( wild ? "walk" : "get"), n));
+        snmp_free_varbind(*var);
+        *var = NULL;
+        return n;
+    }
+
+    /*
+     * We'll need sysUpTime.0 regardless...
+     */
+    DEBUGMSGTL(("disman:event:delta", "retrieve sysUpTime.0\n"));
+    memset( sysUT, 0, sizeof( netsnmp_variable_list ));
+    snmp_set_var_objid( sysUT, _sysUpTime_instance, _sysUpTime_inst_len );
+    netsnmp_query_get(  sysUT, session );
+    return SNMP_ERR_NOERROR;
+}
+
+static int
+_mteTrigger_skip(struct mteTrigger *entry)
+{
     if (!(entry->flags & MTE_TRIGGER_FLAG_ENABLED ) ||
         !(entry->flags & MTE_TRIGGER_FLAG_ACTIVE  ) ||
         !(entry->flags & MTE_TRIGGER_FLAG_VALID  )) {
-        return;
+        return 1;
     }
 
     {
@@ -231,33 +260,57 @@ mteTrigger_run( unsigned int reg, void *clientarg)
 	    DEBUGMSGTL(("disman:event:trigger:monitor",
 		"Skipping trigger (%s) while netsnmp_processing_set\n",
 		entry->mteTName));
-	    return;
+	    return 1;
 	}
     }
+    return 0;
+}
+
+void
+mteTrigger_run( unsigned int reg, void *clientarg)
+{
+    struct mteTrigger *entry = (struct mteTrigger *)clientarg;
+    netsnmp_variable_list *var;
+    netsnmp_variable_list sysUT_var;
+
+    if (!entry) {
+        snmp_alarm_unregister( reg );
+        return;
+    }
+    if (_mteTrigger_skip(entry))
+        return;
 
     /*
      * Retrieve the requested MIB value(s)...
      */
     DEBUGMSGTL(( "disman:event:trigger:monitor", "Running trigger (%s)\n", entry->mteTName));
-    var = (netsnmp_variable_list *)SNMP_MALLOC_TYPEDEF( netsnmp_variable_list );
-    if (!var) {
-        _mteTrigger_failure("failed to create mteTrigger query varbind");
-        return;
-    }
-    snmp_set_var_objid( var, entry->mteTriggerValueID,
-                             entry->mteTriggerValueID_len );
-    if ( entry->flags & MTE_TRIGGER_FLAG_VWILD ) {
-        n = netsnmp_query_walk( var, entry->session );
-    } else {
-        n = netsnmp_query_get(  var, entry->session );
-    }
-    if ( n != SNMP_ERR_NOERROR ) {
-        DEBUGMSGTL(( "disman:event:trigger:monitor", "Trigger query (%s) failed: %d\n",
-                           (( entry->flags & MTE_TRIGGER_FLAG_VWILD ) ? "walk" : "get"), n));
+    if (_mteTrigger_query(entry->mteTriggerValueID,
+                          entry->mteTriggerValueID_len,
+                          entry->flags & MTE_TRIGGER_FLAG_VWILD,
+                          entry->session, &var, &sysUT_var)
+            != SNMP_ERR_NOERROR) {
         _mteTrigger_failure( "failed to run mteTrigger query" );
-        snmp_free_varbind(var);
         return;
     }
+    _mteTrigger_sample(entry, var, &sysUT_var);
+}
+
+    /*
+     * Evaluate one set of sampled values against the trigger's tests,
+     *   taking over the varbind list 'var'.
+     */
+static void
+_mteTrigger_sample(struct mteTrigger *entry, netsnmp_variable_list *var,
+                   netsnmp_variable_list *sysUT)
+{
+    netsnmp_variable_list *vtmp;
+    netsnmp_variable_list *vp1, *vp1_prev;
+    netsnmp_variable_list *vp2, *vp2_prev;
+    netsnmp_variable_list *dvar = NULL;
+    netsnmp_variable_list *dv1  = NULL, *dv2 = NULL;
+    int  cmp = 0, n, n2;
+    long value;
+    const char *reason;
 
     /*
      * ... canonicalise the results (to simplify later comparisons)...
@@ -541,14 +594,6 @@ mteTrigger_run( unsigned int reg, void *clientarg)
         } /* !old_results - end of else block */
     } /* MTE_TRIGGER_EXISTENCE */
 
-    /*
-     * We'll need sysUpTime.0 regardless...
-     */
-    DEBUGMSGTL(("disman:event:delta", "retrieve sysUpTime.0\n"));
-    memset( &sysUT_var, 0, sizeof( netsnmp_variable_list ));
-    snmp_set_var_objid( &sysUT_var, _sysUpTime_instance, _sysUpTime_inst_len );
-    netsnmp_query_get(  &sysUT_var, entry->session );
-
     if (( entry->mteTriggerTest & MTE_TRIGGER_BOOLEAN   ) ||
         ( entry->mteTriggerTest & MTE_TRIGGER_THRESHOLD )) {
         /*
@@ -641,7 +686,7 @@ mteTrigger_run( unsigned int reg, void *clientarg)
             if ( !entry->old_results ) {
                 entry->old_results =  var;
                 entry->old_deltaDs = dvar;
-                entry->sysUpTime   = *sysUT_var.val.integer;
+                entry->sysUpTime   = *sysUT->val.integer;
                 return;
             }
             /*
@@ -650,14 +695,14 @@ mteTrigger_run( unsigned int reg, void *clientarg)
              *  there's no point in trying the remaining tests.
              */
 
-            if (*sysUT_var.val.integer < entry->sysUpTime) {
+            if (*sysUT->val.integer < entry->sysUpTime) {
                 DEBUGMSGTL(( "disman:event:delta",
                              "single discontinuity: (sysUT)\n"));
                 snmp_free_varbind( entry->old_results );
                 snmp_free_varbind( entry->old_deltaDs );
                 entry->old_results =  var;
                 entry->old_deltaDs = dvar;
-                entry->sysUpTime   = *sysUT_var.val.integer;
+                entry->sysUpTime   = *sysUT->val.integer;
                 return;
             }
             /*
@@ -677,7 +722,7 @@ mteTrigger_run( unsigned int reg, void *clientarg)
                 snmp_free_varbind( entry->old_deltaDs );
                 entry->old_results =  var;
                 entry->old_deltaDs = dvar;
-                entry->sysUpTime   = *sysUT_var.val.integer;
+                entry->sysUpTime   = *sysUT->val.integer;
                 return;
             }
 
@@ -1129,8 +1174,269 @@ mteTrigger_run( unsigned int reg, void *clientarg)
     if ( entry->flags & MTE_TRIGGER_FLAG_DELTA ) {
         snmp_free_varbind( entry->old_deltaDs );
         entry->old_deltaDs = dvar;
-        entry->sysUpTime   = *sysUT_var.val.integer;
+        entry->sysUpTime   = *sysUT->val.integer;
+    }
+}
+
+    /* ===================================================
+     *
+     * Sampling schedule.
+     *
+     * Triggers monitoring the same object(s), at the same frequency
+     *   and through equivalent query sessions, subscribe to a single
+     *   sample.  The object(s) are retrieved once per period, and a
+     *   copy of the results handed to each subscribed trigger.
+     *
+     * =================================================== */
+
+struct mteSample {
+    oid              mteTriggerValueID[MAX_OID_LEN];
+    size_t           mteTriggerValueID_len;
+    long             flags;      /* VWILD and CWILD */
+    char             mteTriggerContext[MTE_STR2_LEN+1];
+    u_long           mteTriggerFrequency;
+    netsnmp_session *session;
+
+    unsigned int     alarm;
+    unsigned int     first;      /* one-off run for new subscribers */
+    int              running;
+
+    struct mteTrigger **triggers;
+    int              count, max;
+    struct mteSample *next;
+};
+
+static struct mteSample *mteSamples;
+
+#define MTE_SAMPLE_FLAGS (MTE_TRIGGER_FLAG_VWILD | MTE_TRIGGER_FLAG_CWILD)
+
+static int
+_mteSample_string_cmp(const void *a, size_t a_len,
+                      const void *b, size_t b_len)
+{
+    if (a_len != b_len)
+        return 1;
+    return a_len && memcmp(a, b, a_len);
+}
+
+    /*
+     * Internal query sessions are created afresh for each trigger,
+     *   so compare the identity they query as, rather than the pointers.
+     */
+static int
+_mteSample_same_session(netsnmp_session *s1, netsnmp_session *s2)
+{
+    if (s1 == s2)
+        return 1;
+    if (!s1 || !s2)
+        return 0;
+    return s1->version       == s2->version       &&
+           s1->securityModel == s2->securityModel &&
+           s1->securityLevel == s2->securityLevel &&
+           !_mteSample_string_cmp(s1->securityName, s1->securityNameLen,
+                                  s2->securityName, s2->securityNameLen) &&
+           !_mteSample_string_cmp(s1->community,     s1->community_len,
+                                  s2->community,     s2->community_len) &&
+           !_mteSample_string_cmp(s1->contextName,   s1->contextNameLen,
+                                  s2->contextName,   s2->contextNameLen);
+}
+
+static int
+_mteSample_matches(struct mteSample *sample, struct mteTrigger *entry)
+{
+    return sample->mteTriggerFrequency == entry->mteTriggerFrequency &&
+           sample->flags == (entry->flags & MTE_SAMPLE_FLAGS) &&
+           !snmp_oid_compare(sample->mteTriggerValueID,
+                             sample->mteTriggerValueID_len,
+                             entry->mteTriggerValueID,
+                             entry->mteTriggerValueID_len) &&
+           !strcmp(sample->mteTriggerContext, entry->mteTriggerContext) &&
+           _mteSample_same_session(sample->session, entry->session);
+}
+
+static void
+_mteSample_free(struct mteSample *sample)
+{
+    struct mteSample **prev;
+
+    for (prev = &mteSamples; *prev; prev = &(*prev)->next) {
+        if (*prev == sample) {
+            *prev = sample->next;
+            break;
+        }
+    }
+    if (sample->alarm)
+        snmp_alarm_unregister( sample->alarm );
+    if (sample->first)
+        snmp_alarm_unregister( sample->first );
+    SNMP_FREE(sample->triggers);
+    SNMP_FREE(sample);
+}
+
+    /*
+     * Drop the slots of triggers that unsubscribed during a run,
+     *   and the sample itself once no trigger is left.
+     */
+static void
+_mteSample_compact(struct mteSample *sample)
+{
+    int i, j;
+
+    for (i = j = 0; i < sample->count; i++)
+        if (sample->triggers[i])
+            sample->triggers[j++] = sample->triggers[i];
+    sample->count = j;
+    if (!sample->count)
+        _mteSample_free(sample);
+}
+
+static void
+_mteSample_run( unsigned int reg, void *clientarg)
+{
+    struct mteSample *sample = (struct mteSample *)clientarg;
+    struct mteTrigger *entry;
+    netsnmp_variable_list *var, *copy;
+    netsnmp_variable_list sysUT_var;
+    int i, first = 0, wanted = 0;
+
+    if (reg && reg == sample->first) {
+        /* the one-off run only serves the triggers that are new */
+        sample->first = 0;
+        first = 1;
+    }
+    for (i = 0; i < sample->count; i++) {
+        entry = sample->triggers[i];
+        if ((!first || (entry->flags & MTE_TRIGGER_FLAG_NEW)) &&
+            !_mteTrigger_skip(entry))
+            wanted++;
+    }
+    if (!wanted)
+        return;
+
+    DEBUGMSGTL(( "disman:event:trigger:sample", "Sampling "));
+    DEBUGMSGOID(("disman:event:trigger:sample", sample->mteTriggerValueID,
+                                             sample->mteTriggerValueID_len));
+    DEBUGMSG((   "disman:event:trigger:sample", " for %d trigger(s)\n",
+                                             wanted));
+    if (_mteTrigger_query(sample->mteTriggerValueID,
+                          sample->mteTriggerValueID_len,
+                          sample->flags & MTE_TRIGGER_FLAG_VWILD,
+                          sample->session, &var, &sysUT_var)
+            != SNMP_ERR_NOERROR)
+        var = NULL;
+
+    sample->running = 1;
+    for (i = 0; i < sample->count; i++) {
+        entry = sample->triggers[i];
+        if (!entry || (first && !(entry->flags & MTE_TRIGGER_FLAG_NEW)) ||
+            _mteTrigger_skip(entry))
+            continue;
+        entry->flags &= ~MTE_TRIGGER_FLAG_NEW;
+        if (!_mteSample_matches(sample, entry)) {
+            /*
+             * The trigger has been changed since it subscribed,
+             *  so it has to be sampled on its own for now.
+             */
+            mteTrigger_run(0, entry);
+            continue;
+        }
+        if (!var) {
+            _mteTrigger_failure( "failed to run mteTrigger query" );
+            continue;
+        }
+        copy = snmp_clone_varbind(var);
+        if (!copy) {
+            _mteTrigger_failure("failed to copy mteTrigger sample");
+            continue;
+        }
+        _mteTrigger_sample(entry, copy, &sysUT_var);
+    }
+    sample->running = 0;
+    snmp_free_varbind(var);
+    _mteSample_compact(sample);
+}
+
+static void
+_mteSample_unsubscribe(struct mteTrigger *entry)
+{
+    struct mteSample *sample = entry->sample;
+    int i;
+
+    if (!sample)
+        return;
+    entry->sample = NULL;
+    entry->flags &= ~MTE_TRIGGER_FLAG_NEW;
+    for (i = 0; i < sample->count; i++)
+        if (sample->triggers[i] == entry)
+            sample->triggers[i] = NULL;
+    for (i = 0; i < sample->count; i++)
+        if (sample->triggers[i]) {
+            /* don't keep a session of a trigger that may be freed */
+            sample->session = sample->triggers[i]->session;
+            break;
+        }
+    if (!sample->running)
+        _mteSample_compact(sample);
+}
+
+static int
+_mteSample_subscribe(struct mteTrigger *entry)
+{
+    struct mteSample *sample;
+    struct mteTrigger **triggers;
+
+    for (sample = mteSamples; sample; sample = sample->next)
+        if (_mteSample_matches(sample, entry))
+            break;
+
+    if (!sample) {
+        sample = SNMP_MALLOC_TYPEDEF(struct mteSample);
+        if (!sample)
+            return -1;
+        memcpy(sample->mteTriggerValueID, entry->mteTriggerValueID,
+               entry->mteTriggerValueID_len * sizeof(oid));
+        sample->mteTriggerValueID_len = entry->mteTriggerValueID_len;
+        sample->flags = entry->flags & MTE_SAMPLE_FLAGS;
+        strlcpy(sample->mteTriggerContext, entry->mteTriggerContext,
+                sizeof(sample->mteTriggerContext));
+        sample->mteTriggerFrequency = entry->mteTriggerFrequency;
+        sample->session = entry->session;
+        sample->alarm = snmp_alarm_register(
+                           sample->mteTriggerFrequency, SA_REPEAT,
+                           _mteSample_run, sample );
+        if (!sample->alarm) {
+            SNMP_FREE(sample);
+            return -1;
+        }
+        sample->next = mteSamples;
+        mteSamples = sample;
+    }
+
+    if (sample->count == sample->max) {
+        triggers = (struct mteTrigger **)realloc(sample->triggers,
+                       (sample->max + 8) * sizeof(struct mteTrigger *));
+        if (!triggers) {
+            if (!sample->count)
+                _mteSample_free(sample);
+            return -1;
+        }
+        sample->triggers = triggers;
+        sample->max += 8;
     }
+    sample->triggers[sample->count++] = entry;
+    entry->sample = sample;
+
+    /*
+     * run ASAP for the new trigger, rather than waiting for
+     *   the next period of the sample
+     */
+    entry->flags |= MTE_TRIGGER_FLAG_NEW;
+    if (!sample->first)
+        sample->first = snmp_alarm_register(0, 0, _mteSample_run, sample);
+    DEBUGMSGTL(("disman:event:trigger:sample",
+                "Trigger (%s) sampled with %d other(s)\n",
+                entry->mteTName, sample->count - 1));
+    return 0;
 }
 
 void
@@ -1139,21 +1445,12 @@ mteTrigger_enable( struct mteTrigger *entry )
     if (!entry)
         return;
 
-    if (entry->alarm) {
-        /* XXX - or explicitly call mteTrigger_disable ?? */
-        snmp_alarm_unregister( entry->alarm );
-        entry->alarm = 0;
-    }
+    /* XXX - or explicitly call mteTrigger_disable ?? */
+    _mteSample_unsubscribe( entry );
 
     if (entry->mteTriggerFrequency) {
-        /*
-         * register once to run ASAP, and another to run
-         * at the trigger frequency
-         */
-        snmp_alarm_register(0, 0, mteTrigger_run, entry );
-        entry->alarm = snmp_alarm_register(
-                           entry->mteTriggerFrequency, SA_REPEAT,
-                           mteTrigger_run, entry );
+        if (_mteSample_subscribe( entry ) < 0)
+            _mteTrigger_failure("failed to schedule mteTrigger sampling");
     }
 }
 
@@ -1163,11 +1460,8 @@ mteTrigger_disable( struct mteTrigger *entry )
     if (!entry)
         return;
 
-    if (entry->alarm) {
-        snmp_alarm_unregister( entry->alarm );
-        entry->alarm = 0;
-        /* XXX - perhaps release any previous results */
-    }
+    _mteSample_unsubscribe( entry );
+    /* XXX - perhaps release any previous results */
 }
 
 long _mteTrigger_MaxCount = 0;
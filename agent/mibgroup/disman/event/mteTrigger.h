@@ -18,6 +18,7 @@ extern size_t _sysUpTime_inst_len;
 #define MTE_TRIGGER_FLAG_ACTIVE  0x0200  /* for mteTriggerEntryStatus      */
 #define MTE_TRIGGER_FLAG_FIXED   0x0400  /* for snmpd.conf persistence     */
 #define MTE_TRIGGER_FLAG_VALID   0x0800  /* for row creation/undo          */
+#define MTE_TRIGGER_FLAG_NEW     0x1000  /* waiting for its first sample   */
 
 
     /*
@@ -85,6 +86,8 @@ extern size_t _sysUpTime_inst_len;
 #define MTE_STR1_LEN	32
 #define MTE_STR2_LEN	255
 
+struct mteSample;
+
 /*
  * Data structure for a (combined) trigger row.  Covers delta samples,
  *   and all types (Existence, Boolean and Threshold) of trigger.
@@ -162,7 +165,7 @@ struct mteTrigger {
      *  Additional fields for operation of the Trigger tables:
      *     monitoring...
      */
-    unsigned int    alarm;
+    struct mteSample *sample;
     long            sysUpTime;
     netsnmp_variable_list *old_results;
     netsnmp_variable_list *old_deltaDs;
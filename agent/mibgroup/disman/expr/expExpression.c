@@ -8,6 +8,7 @@
 #include <net-snmp/agent/net-snmp-agent-includes.h>
 #include "disman/expr/expExpression.h"
 #include "disman/expr/expObject.h"
+#include "disman/expr/expValue.h"
 
 netsnmp_tdata *expr_table_data;
 
@@ -142,6 +143,8 @@ expExpression_removeEntry(netsnmp_tdata_row *row)
         netsnmp_tdata_remove_and_delete_row(expr_table_data, row);
     if (entry) {
         /* expExpression_disable( entry ) */
+        expValue_free( entry );
+        SNMP_FREE(entry->pidx);
         SNMP_FREE(entry);
     }
 }
@@ -199,6 +202,29 @@ expExpression_getEntry(const char *owner, const char *name )
 
 
 
+    /*
+     * Index the instances of a wildcarded expression, so that
+     *   GETNEXT requests can find the next one directly.
+     */
+static void
+_expExpression_index( struct expExpression *entry )
+{
+    netsnmp_variable_list *vp;
+    size_t n = 0;
+
+    SNMP_FREE(entry->pidx);
+    entry->pidx_len = 0;
+    for (vp = entry->pvars; vp; vp = vp->next_variable)
+        n++;
+    if (!n)
+        return;
+    entry->pidx = (netsnmp_variable_list **)calloc(n, sizeof(vp));
+    if (!entry->pidx)
+        return;
+    for (vp = entry->pvars; vp; vp = vp->next_variable)
+        entry->pidx[entry->pidx_len++] = vp;
+}
+
 /*
  *  Gather the data necessary for evaluating an expression.
  *
@@ -242,9 +268,14 @@ expExpression_getData( unsigned int reg, void *clientarg )
         return;
 
     /*
-     * XXX - may want to implement caching for on-demand evaluation
-     *       of non-regularly sampled expressions.
+     * Otherwise each on-demand evaluation takes a fresh sample, so
+     *   delta values are measured from the previous evaluation.
+     * The exception is an instance found while walking the
+     *   expValueTable, which uses the values retrieved to find it.
      */
+    if ( !reg && ( entry->flags & EXP_FLAG_SAMPLED ))
+        return;
+    entry->flags &= ~EXP_FLAG_WALK;
 
     /*
      * For a wildcarded expression, expExpressionPrefix is used
@@ -271,6 +302,7 @@ expExpression_getData( unsigned int reg, void *clientarg )
         ret = netsnmp_query_walk( var, entry->session );
         DEBUGMSGTL(("disman:expr:run", "Walk returned %d\n", ret ));
         entry->pvars = var;
+        _expExpression_index( entry );
     }
 
     /* XXX - retrieve sysUpTime.0 value, and check for discontinuity */
@@ -300,6 +332,33 @@ expExpression_getData( unsigned int reg, void *clientarg )
     }
 }
 
+/*
+ *  Gather the data for a step of an expValueTable walk.
+ *
+ *  The instances of an expression that isn't sampled regularly
+ *    are all evaluated from the same sample for the length of a
+ *    walk: a fresh one is taken when the walk reaches the first
+ *    instance, and used for the following steps for as long as
+ *    they keep coming.  Otherwise each step would retrieve (and
+ *    search) every instance again.
+ */
+void
+expExpression_getWalkData( struct expExpression *entry, int first )
+{
+    u_long now = netsnmp_get_agent_uptime();
+
+    if ( !first && ( entry->flags & EXP_FLAG_WALK ) &&
+         now - entry->walked < EXP_WALK_IDLE ) {
+        DEBUGMSGTL(("disman:expr:run", "Using walk sample from %lu (%s, %s)\n",
+                                     entry->sampled,
+                                     entry->expOwner, entry->expName));
+        entry->walked = now;
+        return;
+    }
+    expExpression_getData( 0, entry );
+    entry->sampled = entry->walked = now;
+    entry->flags  |= EXP_FLAG_WALK;
+}
 
 void
 expExpression_enable( struct expExpression *entry )
@@ -314,6 +373,11 @@ expExpression_enable( struct expExpression *entry )
         entry->alarm = 0;
     }
 
+    /*
+     * Parse the expression once, rather than on every evaluation
+     */
+    expValue_compile( entry );
+
     if (entry->expDeltaInterval) {
         entry->alarm = snmp_alarm_register(
                            entry->expDeltaInterval, SA_REPEAT,
@@ -10,6 +10,14 @@
 #define EXP_FLAG_FIXED   0x02    /* for snmpd.conf persistence   */
 #define EXP_FLAG_VALID   0x04    /* for row creation/undo        */
 #define EXP_FLAG_SYSUT   0x08    /* sysUpTime.0 discontinuity    */
+#define EXP_FLAG_SAMPLED 0x10    /* evaluate the current sample   */
+#define EXP_FLAG_WALK    0x20    /* pvars hold a walk's sample    */
+
+    /*
+     * Steps of an expValueTable walk more than this far apart
+     *   (in hundredths of a second) take a new sample
+     */
+#define EXP_WALK_IDLE    100
 
     /*
      * Standard lengths for various Expression-MIB OCTET STRING objects:
@@ -21,6 +29,8 @@
 #define EXP_STR2_LEN	255
 #define EXP_STR3_LEN	1024
 
+struct expProgram;
+
 /*
  * Data structure for an expression row.
  * Covers both expExpressionTable and expErrorTable
@@ -55,6 +65,11 @@ struct expExpression {
     unsigned int    alarm;
     netsnmp_session *session;
     netsnmp_variable_list *pvars;  /* expPrefix values */
+    netsnmp_variable_list **pidx;  /* ... in order, for GETNEXT */
+    size_t          pidx_len;
+    u_long          sampled;       /* when the walk sample was taken */
+    u_long          walked;        /* ... and last used */
+    struct expProgram *program;    /* compiled expExpression */
     long            sysUpTime;
     long            count;
     long            flags;
@@ -85,6 +100,7 @@ void                  expExpression_enable(  struct expExpression *);
 void                  expExpression_disable( struct expExpression *);
 
 void                  expExpression_getData(   unsigned int, void *);
+void                  expExpression_getWalkData(struct expExpression *, int);
 void                  expExpression_evaluate(struct expExpression *);
 long                  expExpression_getNumEntries(int);
 
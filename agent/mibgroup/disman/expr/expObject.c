@@ -115,6 +115,8 @@ expObject_removeEntry(netsnmp_tdata_row * row)
         if (entry->dvars     ) snmp_free_varbind( entry->dvars     );
         if (entry->old_dvars ) snmp_free_varbind( entry->old_dvars );
         if (entry->cvars     ) snmp_free_varbind( entry->cvars     );
+        SNMP_FREE(entry->inst);
+        SNMP_FREE(entry->old_inst);
         SNMP_FREE(entry);
     }
 }
@@ -220,7 +222,7 @@ _expObject_buildList( oid *root, size_t root_len, size_t prefix_len,
             /*
              * ... and set the OID using the template suffix
              */
-            for ( i=0; i <= vp1->name_length - prefix_len; i++)
+            for ( i=0; i < vp1->name_length - prefix_len; i++)
                 name[ root_len+i ] = vp1->name[ prefix_len+i ];
             snmp_set_var_objid( vp2, name, root_len+i );
         }
@@ -236,6 +238,57 @@ _expObject_buildList( oid *root, size_t root_len, size_t prefix_len,
 }
 
 
+    /*
+     * Index the values just retrieved by instance, keeping the previous
+     *   index as long as the previous values are kept.
+     *
+     * The wildcarded lists are all built from the same template
+     *   (the expExpressionPrefix walk) so they line up entry for entry,
+     *   in the order of the walk.
+     */
+static void
+_expObject_index( struct expObject *obj )
+{
+    netsnmp_variable_list *vp, *dp, *cp;
+    size_t i, n = 0;
+
+    if ( obj->expObjectSampleType != EXPSAMPLETYPE_ABSOLUTE ) {
+        SNMP_FREE( obj->old_inst );
+        obj->old_inst     = obj->inst;
+        obj->old_inst_len = obj->inst_len;
+        /* the conditional values are not kept */
+        for (i = 0; i < obj->old_inst_len; i++)
+            obj->old_inst[i].cvar = NULL;
+    } else
+        SNMP_FREE( obj->inst );
+    obj->inst     = NULL;
+    obj->inst_len = 0;
+
+    for (vp = obj->vars; vp; vp = vp->next_variable)
+        n++;
+    if (!n)
+        return;
+    obj->inst = (struct expObjInstance *)calloc(n, sizeof(*obj->inst));
+    if (!obj->inst)
+        return;
+
+    dp = obj->dvars;
+    cp = obj->cvars;
+    for (i = 0, vp = obj->vars; vp; vp = vp->next_variable, i++) {
+        obj->inst[i].var  = vp;
+        obj->inst[i].dvar = dp;
+        obj->inst[i].cvar = cp;
+        if (!(obj->flags & EXP_OBJ_FLAG_OWILD ))
+            break;
+        if ((obj->flags & EXP_OBJ_FLAG_DWILD ) && dp)
+            dp = dp->next_variable;
+        if ((obj->flags & EXP_OBJ_FLAG_CWILD ) && cp)
+            cp = cp->next_variable;
+    }
+    obj->inst_len = (obj->flags & EXP_OBJ_FLAG_OWILD) ? n : 1;
+}
+
+
 void
 expObject_getData( struct expExpression  *expr, struct expObject  *obj )
 {
@@ -342,4 +395,41 @@ expObject_getData( struct expExpression  *expr, struct expObject  *obj )
             snmp_free_varbind( obj->cvars );
         obj->cvars = var;
     }
+
+    _expObject_index( obj );
+}
+
+    /*
+     * Find the sampled values for a given instance of this object,
+     *   from the current sample or the previous one.
+     * Non-wildcarded objects only have the one instance.
+     */
+struct expObjInstance *
+expObject_getInstance( struct expObject *obj, int old,
+                       oid *suffix, size_t suffix_len )
+{
+    struct expObjInstance *inst = old ? obj->old_inst     : obj->inst;
+    size_t                 len  = old ? obj->old_inst_len : obj->inst_len;
+    size_t lo = 0, hi = len, mid;
+    size_t n  = obj->expObjectID_len;
+    int    cmp;
+
+    if (!len)
+        return NULL;
+    if (!(obj->flags & EXP_OBJ_FLAG_OWILD ))
+        return inst;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        cmp = snmp_oid_compare( inst[mid].var->name        + n,
+                                inst[mid].var->name_length - n,
+                                suffix, suffix_len );
+        if (cmp == 0)
+            return &inst[mid];
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return NULL;
 }
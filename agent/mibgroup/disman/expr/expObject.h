@@ -25,6 +25,15 @@
 #define EXP_STR2_LEN	255
 #define EXP_STR3_LEN	1024
 
+/*
+ * The values sampled for one instance of an expObject
+ */
+struct expObjInstance {
+    netsnmp_variable_list *var;    /* expObjectID value              */
+    netsnmp_variable_list *dvar;   /* discontinuity marker, if any   */
+    netsnmp_variable_list *cvar;   /* expObjectConditional, if any   */
+};
+
 /*
  * Data structure for an expObject row.
  */
@@ -52,6 +61,12 @@ struct expObject {
     netsnmp_variable_list *dvars, *old_dvars;
     netsnmp_variable_list *cvars, *old_cvars;
 
+    /*
+     * The current and previous samples, in instance order
+     */
+    struct expObjInstance *inst, *old_inst;
+    size_t          inst_len, old_inst_len;
+
     long            flags;
 };
 
@@ -74,4 +89,7 @@ netsnmp_tdata_row * expObject_getFirst( const char *, const char * );
 netsnmp_tdata_row * expObject_getNext(  netsnmp_tdata_row * );
 void                expObject_getData( struct expExpression *,
                                        struct expObject * );
+struct expObjInstance *
+                    expObject_getInstance( struct expObject *, int,
+                                           oid *, size_t );
 #endif                          /* EXPOBJECT_H */
@@ -21,10 +21,7 @@ void _expValue_setError( struct expExpression *exp, int reason,
                          netsnmp_variable_list *var);
 
 
-#define ASN_PRIV_OPERATOR    (ASN_PRIVATE | 0x0f)
-#define ASN_PRIV_FUNCTION    (ASN_PRIVATE | 0x0e)
-
-int ops[128];   /* mapping from operator characters to numeric
+int ops[256];   /* mapping from operator characters to numeric
                    tokens (ordered by priority). */
 
 void
@@ -56,10 +53,10 @@ DEBUGMSGTL(("disman:expr:eval", "Init expValue"));
     ops['>'+20] = EXP_OPERATOR_GREATEQ;
 
         /* "XX" operators */
-    ops['|'-30] = EXP_OPERATOR_OR;
-    ops['&'-30] = EXP_OPERATOR_AND;
-    ops['<'-30] = EXP_OPERATOR_LSHIFT;
-    ops['>'-30] = EXP_OPERATOR_RSHIFT;
+    ops['|'+128] = EXP_OPERATOR_OR;
+    ops['&'+128] = EXP_OPERATOR_AND;
+    ops['<'+128] = EXP_OPERATOR_LSHIFT;
+    ops['>'+128] = EXP_OPERATOR_RSHIFT;
 }
 
     /*
@@ -72,6 +69,7 @@ _expValue_evalParam( netsnmp_variable_list *expIdx, int param,
 {
     netsnmp_variable_list *var = NULL;
     struct expObject  *obj;
+    struct expObjInstance *inst, *old_inst = NULL;
     netsnmp_variable_list *val_var  = NULL, *oval_var = NULL;  /* values  */
     netsnmp_variable_list *dd_var   = NULL,  *odd_var = NULL;  /* deltaDs */
     netsnmp_variable_list *cond_var = NULL;               /* conditionals */
@@ -111,55 +109,23 @@ _expValue_evalParam( netsnmp_variable_list *expIdx, int param,
         return var;
     }
 
-
-    /*
-     * For a wildcarded object, search for the matching suffix.
-     */
-    val_var = obj->vars;
-    if ( obj->flags & EXP_OBJ_FLAG_OWILD ) {
-        if ( !suffix ) {
-            /*
-             * If there's no suffix to match against, throw an error.
-             * An exact expression with a wildcarded object is invalid.
-             *   XXX - Or just use first entry?
-             */
-            snmp_set_var_typed_integer( var, ASN_INTEGER, EXPERRCODE_INDEX );
-            var->type = ASN_NULL;
-            return var;
-        }
+    if (( obj->flags & EXP_OBJ_FLAG_OWILD ) && !suffix ) {
         /*
-         * Otherwise, we'll walk *all* wildcarded values in parallel.
-         * This relies on the various varbind lists being set up with
-         *   exactly the same entries.  A little extra preparation
-         *   during the data gathering simplifies things significantly!
+         * If there's no suffix to match against, throw an error.
+         * An exact expression with a wildcarded object is invalid.
+         *   XXX - Or just use first entry?
          */
-        if ( obj->expObjectSampleType != EXPSAMPLETYPE_ABSOLUTE )
-            oval_var = obj->old_vars;
-        if ( obj->flags & EXP_OBJ_FLAG_DWILD ) {
-            dd_var   = obj->dvars;
-            odd_var  = obj->old_dvars;
-        }
-        if ( obj->flags & EXP_OBJ_FLAG_CWILD )
-            cond_var = obj->cvars;
-       
-        n = obj->expObjectID_len;
-        while ( val_var ) {
-            if ( snmp_oid_compare( val_var->name+n, val_var->name_length-n,
-                                   suffix, suffix_len ))
-                break;
-            val_var = val_var->next_variable;
-            if (oval_var)
-                oval_var = oval_var->next_variable;
-            if (dd_var) {
-                dd_var   =  dd_var->next_variable;
-                odd_var  = odd_var->next_variable;
-            }
-            if (cond_var)
-                cond_var = cond_var->next_variable;
-        }
-
+        snmp_set_var_typed_integer( var, ASN_INTEGER, EXPERRCODE_INDEX );
+        var->type = ASN_NULL;
+        return var;
     }
-    if (!val_var) {
+
+    /*
+     * Look up the values sampled for this instance, both now
+     *   and (for Delta and Changed samples) the time before.
+     */
+    inst = expObject_getInstance( obj, 0, suffix, suffix_len );
+    if (!inst || !inst->var) {
         /*
          * No matching entry
          */
@@ -167,19 +133,24 @@ _expValue_evalParam( netsnmp_variable_list *expIdx, int param,
         var->type = ASN_NULL;
         return var;
     }
-        /*
-         * Set up any non-wildcarded values - some
-         *   of which may be null. That's fine.
-         */
-    if (!oval_var)
-        oval_var = obj->old_vars;
-    if (!dd_var) {
-        dd_var   = obj->dvars;
-        odd_var  = obj->old_dvars;
+    val_var  = inst->var;
+    dd_var   = inst->dvar;
+    cond_var = inst->cvar;
+    if ( obj->expObjectSampleType != EXPSAMPLETYPE_ABSOLUTE ) {
+        old_inst = expObject_getInstance( obj, 1, suffix, suffix_len );
+        if (!old_inst || !old_inst->var) {
+            /*
+             * A new instance: no delta value until the next pass
+             */
+            snmp_set_var_typed_integer( var, ASN_INTEGER,
+                                        EXPERRCODE_RESOURCE );
+            var->type = ASN_NULL;
+            return var;
+        }
+        oval_var = old_inst->var;
+        odd_var  = old_inst->dvar;
     }
-    if (!cond_var)
-        cond_var = obj->cvars;
-    
+
 
     /*
      * ... and return the appropriate value.
@@ -232,334 +203,360 @@ _expValue_evalParam( netsnmp_variable_list *expIdx, int param,
     /*
      * Utility routine to parse (and skip over) an integer constant
      */
-int
-_expParse_integer( char *start, char **end ) {
-    int n;
-    char *cp;
+long
+_expParse_integer( const char *start, const char **end ) {
+    long n = 0;
+    const char *cp;
 
-    n = atoi(start);
-    for (cp=start; *cp; cp++)
+    for (cp=start; *cp; cp++) {
         if (!isdigit(*cp & 0xFF))
             break;
+        n = n * 10 + (*cp - '0');
+    }
     *end = cp;
     return n;
 }
 
-netsnmp_variable_list *
-_expValue_evalOperator(netsnmp_variable_list *left, 
-                       netsnmp_variable_list *op, 
-                       netsnmp_variable_list *right) {
-    int n;
 
-    if (left->val.integer == NULL || right->val.integer == NULL) {
-	return right;
-    }
-    switch( *op->val.integer ) {
-    case EXP_OPERATOR_ADD:
-        n = *left->val.integer + *right->val.integer; break;
-    case EXP_OPERATOR_SUBTRACT:
-        n = *left->val.integer - *right->val.integer; break;
+    /* ===================================================
+     *
+     * Compiling an expression.
+     *
+     * The expression text is parsed once, into a sequence of
+     *   instructions (in postfix order) for a simple stack machine.
+     *   Evaluating an instance of the expression then only needs
+     *   to run through these, fetching the object parameters.
+     *
+     * =================================================== */
+
+#define EXP_CODE_PARAM     1    /* push the value of parameter $n   */
+#define EXP_CODE_CONST     2    /* push a constant value            */
+#define EXP_CODE_BINARY    3    /* apply operator n to the top two  */
+#define EXP_CODE_UNARY     4    /* apply operator n to the top one  */
+#define EXP_CODE_FUNCTION  5    /* apply a function to the top one  */
+
+#define EXP_OPERATOR_NEGATE  (EXP_OPERATOR_RSHIFT+1)  /* unary '-' */
+
+struct expCode {
+    int             code;
+    int             pos;    /* offset into the expression, for errors */
+    long            n;      /* parameter or operator */
+    netsnmp_variable_list *var;  /* constant value */
+};
+
+struct expProgram {
+    char            expression[ EXP_STR3_LEN+1 ];  /* compiled from */
+    struct expCode *code;
+    int             len, max;
+    int             depth;       /* stack needed to run the code */
+    int             error;       /* EXPERRCODE_xxx, or 0 */
+    int             error_pos;
+
+    /*
+     * operators waiting for their right hand operand,
+     *   used while compiling
+     */
+    struct expCode *ops;
+    int             nops, stack;
+};
+
+    /*
+     * Operator precedence, as in C.
+     * (The Expression MIB doesn't define this, beyond referring
+     *  to the C language for the operators themselves).
+     */
+static int
+_expOperator_priority( long op )
+{
+    switch (op) {
+    case EXP_OPERATOR_NEGATE:
+    case EXP_OPERATOR_BITNEGATE:
+    case EXP_OPERATOR_NOT:       return 11;
     case EXP_OPERATOR_MULTIPLY:
-        n = *left->val.integer * *right->val.integer; break;
     case EXP_OPERATOR_DIVIDE:
-        n = *left->val.integer / *right->val.integer; break;
-    case EXP_OPERATOR_REMAINDER:
-        n = *left->val.integer % *right->val.integer; break;
-    case EXP_OPERATOR_BITXOR:
-        n = *left->val.integer ^ *right->val.integer; break;
-    case EXP_OPERATOR_BITNEGATE:
-        n = 99; /* *left->val.integer ~ *right->val.integer; */ break;
-    case EXP_OPERATOR_BITOR:
-        n = *left->val.integer | *right->val.integer; break;
-    case EXP_OPERATOR_BITAND:
-        n = *left->val.integer & *right->val.integer; break;
-    case EXP_OPERATOR_NOT:
-        n = 99; /* *left->val.integer ! *right->val.integer; */ break;
+    case EXP_OPERATOR_REMAINDER: return 10;
+    case EXP_OPERATOR_ADD:
+    case EXP_OPERATOR_SUBTRACT:  return 9;
+    case EXP_OPERATOR_LSHIFT:
+    case EXP_OPERATOR_RSHIFT:    return 8;
     case EXP_OPERATOR_LESS:
-        n = *left->val.integer < *right->val.integer; break;
+    case EXP_OPERATOR_LESSEQ:
     case EXP_OPERATOR_GREAT:
-        n = *left->val.integer > *right->val.integer; break;
+    case EXP_OPERATOR_GREATEQ:   return 7;
     case EXP_OPERATOR_EQUAL:
-        n = *left->val.integer == *right->val.integer; break;
-    case EXP_OPERATOR_NOTEQ:
-        n = *left->val.integer != *right->val.integer; break;
-    case EXP_OPERATOR_LESSEQ:
-        n = *left->val.integer <= *right->val.integer; break;
-    case EXP_OPERATOR_GREATEQ:
-        n = *left->val.integer >= *right->val.integer; break;
-    case EXP_OPERATOR_OR:
-        n = *left->val.integer || *right->val.integer; break;
-    case EXP_OPERATOR_AND:
-        n = *left->val.integer && *right->val.integer; break;
-    case EXP_OPERATOR_LSHIFT:
-        n = *left->val.integer << *right->val.integer; break;
-    case EXP_OPERATOR_RSHIFT:
-        n = *left->val.integer >> *right->val.integer; break;
+    case EXP_OPERATOR_NOTEQ:     return 6;
+    case EXP_OPERATOR_BITAND:    return 5;
+    case EXP_OPERATOR_BITXOR:    return 4;
+    case EXP_OPERATOR_BITOR:     return 3;
+    case EXP_OPERATOR_AND:       return 2;
+    case EXP_OPERATOR_OR:        return 1;
+    }
+    return 0;
+}
+
+static int
+_expCompile_emit( struct expProgram *prog, int code, int pos, long n,
+                  netsnmp_variable_list *var )
+{
+    struct expCode *newcode;
+
+    if (prog->len == prog->max) {
+        newcode = (struct expCode *)realloc(prog->code,
+                               (prog->max + 16) * sizeof(struct expCode));
+        if (!newcode) {
+            snmp_free_var( var );
+            return -1;
+        }
+        prog->code = newcode;
+        prog->max += 16;
+    }
+    prog->code[prog->len].code = code;
+    prog->code[prog->len].pos  = pos;
+    prog->code[prog->len].n    = n;
+    prog->code[prog->len].var  = var;
+    prog->len++;
+
+    switch (code) {
+    case EXP_CODE_PARAM:
+    case EXP_CODE_CONST:
+        if (++prog->stack > prog->depth)
+            prog->depth = prog->stack;
+        break;
+    case EXP_CODE_BINARY:
+        prog->stack--;
         break;
-    default:
-        left->next_variable = NULL;
-        snmp_free_var(left);
-        right->next_variable = NULL;
-        snmp_free_var(right);
-
-        snmp_set_var_typed_integer( op, ASN_INTEGER, EXPERRCODE_OPERATOR );
-        op->type = ASN_NULL;
-        return op;
     }
+    return 0;
+}
 
-    /* XXX */
-    left->next_variable = NULL;
-    snmp_free_var(left);
-    op->next_variable = NULL;
-    snmp_free_var(op);
-    snmp_set_var_typed_integer( right, ASN_INTEGER, n );
-    return right;
+static int
+_expCompile_error( struct expProgram *prog, int error, int pos )
+{
+    DEBUGMSGTL(("disman:expr:eval", "Compile error %d at %d\n", error, pos));
+    prog->error     = error;
+    prog->error_pos = pos;
+    return -1;
 }
 
-netsnmp_variable_list *
-_expValue_evalFunction(netsnmp_variable_list *func) {
-    netsnmp_variable_list *params = func->next_variable;
-    /* XXX */
-    params->next_variable = NULL;
-    snmp_free_var(params);
-    snmp_set_var_typed_integer( func, ASN_INTEGER, 99 );
-    return func;
+    /*
+     * Emit the operators waiting on the stack, down to 'base',
+     *   that bind more tightly than one of the given priority.
+     */
+static int
+_expCompile_flush( struct expProgram *prog, int base, int priority )
+{
+    struct expCode *op;
+
+    while (prog->nops > base) {
+        op = &prog->ops[prog->nops - 1];
+        if (_expOperator_priority( op->n ) < priority)
+            break;
+        if (_expCompile_emit( prog, op->code, op->pos, op->n, NULL ) < 0)
+            return _expCompile_error( prog, EXPERRCODE_RESOURCE, op->pos );
+        prog->nops--;
+    }
+    return 0;
 }
 
-netsnmp_variable_list *_expValue_evalExpr2(netsnmp_variable_list *exprAlDente);
-netsnmp_variable_list *
-_expValue_evalExpr(  netsnmp_variable_list *expIdx,
-                     char *exprRaw, char **exprEnd,
-                     oid *suffix, size_t suffix_len )
+static void
+_expCompile_push( struct expProgram *prog, int code, int pos, long n )
 {
-    netsnmp_variable_list *exprAlDente = NULL;
-    netsnmp_variable_list *vtail = NULL;
-    char *cp1, *cp2;
-    netsnmp_variable_list *var = NULL;
-    int   i, n;
-    int   neg = 0;
-    oid   oid_buf[MAX_OID_LEN];
+    prog->ops[prog->nops].code = code;
+    prog->ops[prog->nops].pos  = pos;
+    prog->ops[prog->nops].n    = n;
+    prog->nops++;
+}
 
-    DEBUGMSGTL(("disman:expr:eval1", "Evaluating '%s'\n", exprRaw));
-    if (!expIdx || !exprRaw)
-        return NULL;
+static int
+_expCompile_const( struct expProgram *prog, int pos, u_char type,
+                   const void *val, size_t val_len )
+{
+    netsnmp_variable_list *var;
+
+    var = SNMP_MALLOC_TYPEDEF( netsnmp_variable_list );
+    if (!var || snmp_set_var_typed_value( var, type, val, val_len )) {
+        snmp_free_var( var );
+        return _expCompile_error( prog, EXPERRCODE_RESOURCE, pos );
+    }
+    if (_expCompile_emit( prog, EXP_CODE_CONST, pos, 0, var ) < 0)
+        return _expCompile_error( prog, EXPERRCODE_RESOURCE, pos );
+    return 0;
+}
 
     /*
-     * The expression is evaluated in two stages.
-     * First, we simplify ("parboil") the raw expression,
-     *   tokenizing it into a sequence of varbind values, inserting
-     *   object parameters, and (recursively) evaluating any
-     *   parenthesised sub-expressions or function arguments.
+     * Compile a (sub-)expression, up to the closing ')' or ','
+     *   (or the end of the whole expression)
      */
+static int
+_expCompile_expr( struct expProgram *prog, const char *cp, const char **end )
+{
+    const char *start = prog->expression;
+    const char *cp2;
+    int    base = prog->nops;
+    int    operand = 1;     /* expecting an operand (rather than an operator) */
+    int    function = 0;    /* a function waiting for its argument */
+    int    func_pos = 0;
+    int    pos, i;
+    long   n;
+    oid    oid_buf[MAX_OID_LEN];
+    char   str_buf[EXP_STR3_LEN+1];
+
+    while (*cp && *cp != ')' && *cp != ',') {
+        pos = cp - start;
+        if (isspace(*cp & 0xFF)) {
+            cp++;
+            continue;
+        }
+        if (function && *cp != '(')
+            return _expCompile_error( prog, EXPERRCODE_FUNCTION, func_pos );
 
-    for (cp1=exprRaw; cp1 && *cp1; ) {
-        switch (*cp1) {
+        switch (*cp) {
         case '$':
             /*
-             * Locate the appropriate instance of the specified
-             * parameter, and insert the corresponding value.
+             * Object parameter
              */
-            n   = _expParse_integer( cp1+1, &cp1 );
-            var = _expValue_evalParam( expIdx, n, suffix, suffix_len );
-            if ( var && var->type == ASN_NULL ) {
-                DEBUGMSGTL(("disman:expr:eval", "Invalid parameter '%d'\n", n));
-                /* Note position of failure in expression */
-                var->data = (void *)(cp1 - exprRaw);
-                snmp_free_var(exprAlDente);
-		*exprEnd = cp1;
-                return var;
-            } else {
-                if (vtail)
-                   vtail->next_variable = var;
-                else
-                   exprAlDente = var;
-                vtail = var;
-                var   = NULL;
-            }
+            if (!operand)
+                return _expCompile_error( prog, EXPERRCODE_SYNTAX, pos );
+            n = _expParse_integer( cp+1, &cp );
+            if (_expCompile_emit( prog, EXP_CODE_PARAM, pos, n, NULL ) < 0)
+                return _expCompile_error( prog, EXPERRCODE_RESOURCE, pos );
+            operand = 0;
             break;
+
         case '(':
             /*
-             * Recursively evaluate the sub-expression
+             * Sub-expression (or function argument)
              */
-            var = _expValue_evalExpr( expIdx, cp1+1, &cp2,
-                                      suffix, suffix_len );
-            if ( var && var->type == ASN_NULL ) {
-                /* Adjust position of failure */
-                var->data = (void *)(cp1 - exprRaw + (uintptr_t)var->data);
-                return var;
-            } else if (*cp2 != ')') {
-                snmp_free_var(exprAlDente);
+            if (!operand)
+                return _expCompile_error( prog, EXPERRCODE_SYNTAX, pos );
+            if (_expCompile_expr( prog, cp+1, &cp2 ) < 0)
+                return -1;
+            if (*cp2 != ')') {
                 DEBUGMSGTL(("disman:expr:eval", "Unbalanced parenthesis\n"));
-                snmp_set_var_typed_integer( var, ASN_INTEGER,
-                                            EXPERRCODE_PARENTHESIS );
-                var->type = ASN_NULL;
-                var->data = (void *)(cp2 - exprRaw);
-		*exprEnd = cp1;
-                return var;
-            } else {
-                if (vtail)
-                   vtail->next_variable = var;
-                else
-                   exprAlDente = var;
-                vtail = var;
-                var   = NULL;
-                cp1   = cp2+1;   /* Skip to end of sub-expression */
+                return _expCompile_error( prog, EXPERRCODE_PARENTHESIS,
+                                          cp2 - start );
+            }
+            cp = cp2+1;   /* Skip to end of sub-expression */
+            if (function) {
+                if (_expCompile_emit( prog, EXP_CODE_FUNCTION, func_pos,
+                                      0, NULL ) < 0)
+                    return _expCompile_error( prog, EXPERRCODE_RESOURCE, pos );
+                function = 0;
             }
+            operand = 0;
             break;
-        case ')':
-        case ',':
-            /*
-             * End of current (sub-)expression
-             * Note the end-position, and evaluate
-             *  the parboiled list of tokens.
-             */
-            *exprEnd = cp1;
-            var = _expValue_evalExpr2( exprAlDente );
-            return var;
 
             /* === Constants === */
-        case '.':   /* OID */
-            i = 0;
-            memset( oid_buf, 0, sizeof(oid_buf));
-            while ( cp1 && *cp1 == '.' ) {
-                n = _expParse_integer( cp1+1, &cp2 );
-OID:
-                oid_buf[i++] = n;
-                cp1 = cp2;
-            }
-            var = snmp_varlist_add_variable( &exprAlDente, NULL, 0,
-                                             ASN_OBJECT_ID,
-                                             (u_char*)oid_buf, i*sizeof(oid));
-            break;
-DIGIT:
-        case '0':
-        case '1':
-        case '2':
-        case '3':
-        case '4':
-        case '5':
-        case '6':
-        case '7':
-        case '8':
-        case '9':
-            n = _expParse_integer( cp1, &cp2 );
-            if ( cp2 && *cp2 == '.' ) {
+        case '.':
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            if (!operand)
+                return _expCompile_error( prog, EXPERRCODE_SYNTAX, pos );
+            n = _expParse_integer( cp, &cp2 );
+            if (*cp == '.' || *cp2 == '.') {
+                /* OID */
                 i = 0;
-                memset( oid_buf, 0, sizeof(oid_buf));
-                goto OID;
+                if (*cp != '.')
+                    oid_buf[i++] = n;
+                cp = cp2;
+                while (*cp == '.' && isdigit(*(cp+1) & 0xFF) &&
+                       i < MAX_OID_LEN)
+                    oid_buf[i++] = _expParse_integer( cp+1, &cp );
+                if (!i || *cp == '.')
+                    return _expCompile_error( prog, EXPERRCODE_SYNTAX,
+                                              cp - start );
+                if (_expCompile_const( prog, pos, ASN_OBJECT_ID,
+                                       oid_buf, i*sizeof(oid)) < 0)
+                    return -1;
+            } else {
+                if (_expCompile_const( prog, pos, ASN_INTEGER,
+                                       &n, sizeof(n)) < 0)
+                    return -1;
+                cp = cp2;
             }
-            if ( neg )
-                n = -n;
-            var = snmp_varlist_add_variable( &exprAlDente, NULL, 0,
-                                             ASN_INTEGER,
-                                             (u_char*)&n, sizeof(n));
-            vtail = var;
-            var   = NULL;
-            neg   = 0;
-            cp1   = cp2;
+            operand = 0;
             break;
 
         case '"':   /* String Constant */
-            for ( cp2 = cp1+1; *cp2; cp2++ ) {
-                if ( *cp2 == '"' )
-                    break;
+            if (!operand)
+                return _expCompile_error( prog, EXPERRCODE_SYNTAX, pos );
+            for ( i = 0, cp2 = cp+1; *cp2 && *cp2 != '"'; cp2++ ) {
                 if ( *cp2 == '\\' && *(cp2+1) == '"' )
                     cp2++;
+                str_buf[i++] = *cp2;
             }
             if ( *cp2 != '"' ) {
-                /*
-                 * Unterminated string
-                 */
                 DEBUGMSGTL(("disman:expr:eval", "Unterminated string\n"));
-                snmp_set_var_typed_integer( var, ASN_INTEGER,
-                                            EXPERRCODE_SYNTAX );
-                var->type = ASN_NULL;
-                var->data = (void *)(cp2 - exprRaw);
-                return var;
+                return _expCompile_error( prog, EXPERRCODE_SYNTAX,
+                                          cp2 - start );
             }
-            n = cp2 - cp1;  
-            var = snmp_varlist_add_variable( &exprAlDente, NULL, 0,
-                                             ASN_OCTET_STR,
-                                             (u_char*)cp1+1, n);
-            vtail = var;
-            var   = NULL;
+            if (_expCompile_const( prog, pos, ASN_OCTET_STR, str_buf, i) < 0)
+                return -1;
+            cp = cp2+1;
+            operand = 0;
             break;
 
-
             /* === Operators === */
         case '-':
-            /*
-             * Could be a unary minus....
-             */
-            if (!vtail || vtail->type == ASN_PRIV_OPERATOR) {
-                neg = 1;
-                goto DIGIT;
+        case '~':
+        case '!':
+            if (operand) {
+                /*
+                 * Unary operators bind to the following operand,
+                 *   so there's nothing to flush.
+                 */
+                if (*cp == '-' && isdigit(*(cp+1) & 0xFF)) {
+                    n = -_expParse_integer( cp+1, &cp );
+                    if (_expCompile_const( prog, pos, ASN_INTEGER,
+                                           &n, sizeof(n)) < 0)
+                        return -1;
+                    operand = 0;
+                    break;
+                }
+                n = (*cp == '-') ? EXP_OPERATOR_NEGATE :
+                    (*cp == '~') ? EXP_OPERATOR_BITNEGATE :
+                                   EXP_OPERATOR_NOT;
+                _expCompile_push( prog, EXP_CODE_UNARY, pos, n );
+                cp++;
+                break;
             }
-            /* 
-             * ... or a (single-character) binary operator.
-             */
+            if (*cp == '~')
+                return _expCompile_error( prog, EXPERRCODE_SYNTAX, pos );
             NETSNMP_FALLTHROUGH;
         case '+':
         case '*':
         case '/':
         case '%':
         case '^':
-        case '~':
-            if ( !vtail ) {
-                /*
-                 * Can't start an expression with a binary operator
-                 */
-                DEBUGMSGTL(("disman:expr:eval", "Initial binary operator\n"));
-                snmp_set_var_typed_integer( var, ASN_INTEGER,
-                                            EXPERRCODE_SYNTAX );
-                var->type = ASN_NULL;
-                var->data = (void *)(cp1 - exprRaw);
-		*exprEnd = cp1;
-                return var;
-            }
-            n = ops[ *cp1 & 0xFF ];
-            DEBUGMSGTL(("disman:expr:eval", "Binary operator %c (%d)\n", *cp1, n));
-            var = snmp_varlist_add_variable( &exprAlDente, NULL, 0,
-                                             ASN_INTEGER,
-                                             (u_char*)&n, sizeof(n));
-            var->type = ASN_PRIV_OPERATOR;
-            vtail = var;
-            cp1++;
-            break;
-
-            /* 
-             * Multi-character binary operators
-             */
         case '&':
         case '|':
-        case '!':
         case '>':
         case '<':
         case '=':
-            if ( !vtail ) {
+            if (operand) {
                 /*
                  * Can't start an expression with a binary operator
+                 *   (or have two in a row)
                  */
-                DEBUGMSGTL(("disman:expr:eval", "Initial binary operator\n"));
-                snmp_set_var_typed_integer( var, ASN_INTEGER,
-                                            EXPERRCODE_SYNTAX );
-                var->type = ASN_NULL;
-                var->data = (void *)(cp1 - exprRaw);
-		*exprEnd = cp1;
-                return var;
+                DEBUGMSGTL(("disman:expr:eval", "Misplaced binary operator\n"));
+                return _expCompile_error( prog, EXPERRCODE_SYNTAX, pos );
             }
-            if ( *(cp1+1) == '=' )
-                n = ops[ *cp1++ + 20];
-            else if ( *(cp1+1) == *cp1 )
-                n = ops[ *cp1++ - 30];
+            if ( strchr("&|!<>=", *cp) && *(cp+1) == '=' )
+                n = ops[ *cp++ + 20];
+            else if ( strchr("&|<>", *cp) && *(cp+1) == *cp )
+                n = ops[ *cp++ + 128];
             else
-                n = ops[ *cp1 & 0xFF ];
-            var = snmp_varlist_add_variable( &exprAlDente, NULL, 0,
-                                             ASN_INTEGER,
-                                             (u_char*)&n, sizeof(n));
-            var->type = ASN_PRIV_OPERATOR;
-            vtail = var;
-            cp1++;
+                n = ops[ *cp & 0xFF ];
+            if (!n || n == EXP_OPERATOR_NOT || n == EXP_OPERATOR_BITNEGATE) {
+                DEBUGMSGTL(("disman:expr:eval", "Unrecognised operator '%c'\n", *cp));
+                return _expCompile_error( prog, EXPERRCODE_OPERATOR, pos );
+            }
+            DEBUGMSGTL(("disman:expr:eval", "Binary operator %c (%ld)\n", *cp, n));
+            if (_expCompile_flush( prog, base, _expOperator_priority( n )) < 0)
+                return -1;
+            _expCompile_push( prog, EXP_CODE_BINARY, pos, n );
+            operand = 1;
+            cp++;
             break;
 
             /* === Functions === */
@@ -569,164 +566,247 @@ DIGIT:
         case 'm':    /* maximum/minimum      */
         case 'o':    /* oidBegins/Ends/Contains    */
         case 's':    /* sum / string{B,E,C}  */
-            var = snmp_varlist_add_variable( &exprAlDente, NULL, 0,
-                                             ASN_OCTET_STR,
-                                             (u_char*)cp1, 3 );
-                                                   /* XXX */
-            var->type = ASN_PRIV_FUNCTION;
-            vtail = var;
-            while (*cp1 >= 'a' && *cp1 <= 'z')
-              cp1++;
+            if (!operand)
+                return _expCompile_error( prog, EXPERRCODE_SYNTAX, pos );
+            function = 1;
+            func_pos = pos;
+            while (*cp >= 'a' && *cp <= 'z')
+                cp++;
             break;
 
         default:
-            if (isalpha( *cp1 & 0xFF )) {
+            if (isalpha( *cp & 0xFF )) {
                 /*
                  * Unrecognised function call ?
                  */
-                DEBUGMSGTL(("disman:expr:eval", "Unrecognised function '%s'\n", cp1));
-                snmp_set_var_typed_integer( var, ASN_INTEGER,
-                                            EXPERRCODE_FUNCTION );
-                var->type = ASN_NULL;
-                var->data = (void *)(cp1 - exprRaw);
-		*exprEnd = cp1;
-                return var;
-            }
-            else if (!isspace( *cp1 & 0xFF )) {
-                /*
-                 * Unrecognised operator ?
-                 */
-                DEBUGMSGTL(("disman:expr:eval", "Unrecognised operator '%c'\n", *cp1));
-                snmp_set_var_typed_integer( var, ASN_INTEGER,
-                                            EXPERRCODE_OPERATOR );
-                var->type = ASN_NULL;
-                var->data = (void *)(cp1 - exprRaw);
-		*exprEnd = cp1;
-                return var;
+                DEBUGMSGTL(("disman:expr:eval", "Unrecognised function '%s'\n", cp));
+                return _expCompile_error( prog, EXPERRCODE_FUNCTION, pos );
             }
-            cp1++;
-            break;
+            /*
+             * Unrecognised operator ?
+             */
+            DEBUGMSGTL(("disman:expr:eval", "Unrecognised operator '%c'\n", *cp));
+            return _expCompile_error( prog, EXPERRCODE_OPERATOR, pos );
         }
     }
 
+    *end = cp;
+    if (operand || function) {
+        /*
+         * Empty expression, or one ending with an operator
+         */
+        return _expCompile_error( prog, function ? EXPERRCODE_FUNCTION
+                                                 : EXPERRCODE_SYNTAX,
+                                  function ? func_pos : cp - start );
+    }
+    return _expCompile_flush( prog, base, 0 );
+}
+
+static void
+_expProgram_free( struct expProgram *prog )
+{
+    int i;
+
+    if (!prog)
+        return;
+    for (i = 0; i < prog->len; i++)
+        snmp_free_var( prog->code[i].var );
+    SNMP_FREE( prog->code );
+    SNMP_FREE( prog->ops );
+    SNMP_FREE( prog );
+}
+
+void
+expValue_free( struct expExpression *exp )
+{
+    if (!exp)
+        return;
+    _expProgram_free( exp->program );
+    exp->program = NULL;
+}
+
     /*
-     * ... then we evaluate the resulting simplified ("al dente")
-     *   expression, in the usual manner.
+     * Compile the expression of this entry, unless the current
+     *   text has already been compiled.  A badly formed expression
+     *   is remembered too, and reported whenever it is evaluated.
      */
-    *exprEnd = cp1;
-    var = _expValue_evalExpr2( exprAlDente );
-    DEBUGMSGTL(( "disman:expr:eval1", "Evaluated to "));
-    DEBUGMSGVAR(("disman:expr:eval1", var));
-    DEBUGMSG((   "disman:expr:eval1", "\n"));
-/*  snmp_free_var(exprAlDente); XXX - Crashes */
-    return var;
+struct expProgram *
+expValue_compile( struct expExpression *exp )
+{
+    struct expProgram *prog;
+    const char *cp;
+
+    if (!exp)
+        return NULL;
+    if (exp->program &&
+        strcmp( exp->program->expression, exp->expExpression ) == 0)
+        return exp->program;
+    expValue_free( exp );
+
+    prog = SNMP_MALLOC_TYPEDEF( struct expProgram );
+    if (!prog)
+        return NULL;
+    strlcpy( prog->expression, exp->expExpression, sizeof(prog->expression));
+    prog->ops = (struct expCode *)calloc( strlen(prog->expression)+1,
+                                          sizeof(struct expCode));
+    if (!prog->ops) {
+        SNMP_FREE( prog );
+        return NULL;
+    }
+
+    DEBUGMSGTL(("disman:expr:eval1", "Compiling '%s'\n", prog->expression));
+    if (_expCompile_expr( prog, prog->expression, &cp ) == 0 && *cp != '\0') {
+        /*
+         * When we had finished, there was a lot
+         * of bricks^Wcharacters left over....
+         */
+        _expCompile_error( prog, (*cp == ')') ? EXPERRCODE_PARENTHESIS
+                                              : EXPERRCODE_SYNTAX,
+                           cp - prog->expression );
+    }
+    SNMP_FREE( prog->ops );
+    DEBUGMSGTL(("disman:expr:eval1", "Compiled to %d instructions"
+                " (error %d)\n", prog->len, prog->error));
+    exp->program = prog;
+    return prog;
+}
+
+
+    /* ===================================================
+     *
+     * Running a compiled expression.
+     *
+     * =================================================== */
+
+static int
+_expValue_evalOperator( long op, netsnmp_variable_list *left,
+                        netsnmp_variable_list *right )
+{
+    long l, r, n;
+
+    if (right->val.integer == NULL || (left && left->val.integer == NULL))
+	return 0;
+    l = left ? *left->val.integer : 0;
+    r = *right->val.integer;
+    switch( op ) {
+    case EXP_OPERATOR_ADD:       n = l +  r; break;
+    case EXP_OPERATOR_SUBTRACT:  n = l -  r; break;
+    case EXP_OPERATOR_MULTIPLY:  n = l *  r; break;
+    case EXP_OPERATOR_DIVIDE:
+        if (!r)
+            return EXPERRCODE_DIVZERO;
+        n = l /  r; break;
+    case EXP_OPERATOR_REMAINDER:
+        if (!r)
+            return EXPERRCODE_DIVZERO;
+        n = l %  r; break;
+    case EXP_OPERATOR_BITXOR:    n = l ^  r; break;
+    case EXP_OPERATOR_BITOR:     n = l |  r; break;
+    case EXP_OPERATOR_BITAND:    n = l &  r; break;
+    case EXP_OPERATOR_LESS:      n = l <  r; break;
+    case EXP_OPERATOR_GREAT:     n = l >  r; break;
+    case EXP_OPERATOR_EQUAL:     n = l == r; break;
+    case EXP_OPERATOR_NOTEQ:     n = l != r; break;
+    case EXP_OPERATOR_LESSEQ:    n = l <= r; break;
+    case EXP_OPERATOR_GREATEQ:   n = l >= r; break;
+    case EXP_OPERATOR_OR:        n = l || r; break;
+    case EXP_OPERATOR_AND:       n = l && r; break;
+    case EXP_OPERATOR_LSHIFT:    n = l << r; break;
+    case EXP_OPERATOR_RSHIFT:    n = l >> r; break;
+    case EXP_OPERATOR_NEGATE:    n =    - r; break;
+    case EXP_OPERATOR_BITNEGATE: n =    ~ r; break;
+    case EXP_OPERATOR_NOT:       n =    ! r; break;
+    default:
+        return EXPERRCODE_OPERATOR;
+    }
+    snmp_set_var_typed_integer( right, ASN_INTEGER, n );
+    return 0;
 }
 
 netsnmp_variable_list *
-_expValue_evalExpr2( netsnmp_variable_list *exprAlD )
+_expValue_run( struct expProgram *prog, netsnmp_variable_list *expIdx,
+               oid *suffix, size_t suffix_len )
 {
-    netsnmp_variable_list *stack = NULL;
-    netsnmp_variable_list *lval, *rval, *op;
-    netsnmp_variable_list *vp, *vp1  = NULL;
-
-    DEBUGIF(( "disman:expr:eval2")) {
-        for (vp = exprAlD; vp; vp=vp->next_variable) {
-            if ( vp->type == ASN_PRIV_OPERATOR )
-                DEBUGMSGTL(( "disman:expr:eval2", "Operator %ld\n",
-                                                  *vp->val.integer));
-            else if ( vp->type == ASN_PRIV_FUNCTION )
-                DEBUGMSGTL(( "disman:expr:eval2", "Function %s\n",
-                                                   vp->val.string));
-            else {
-                DEBUGMSGTL(( "disman:expr:eval2", "Operand "));
-                DEBUGMSGVAR(("disman:expr:eval2", vp));
-                DEBUGMSG((   "disman:expr:eval2", "\n"));
-            }
-        }
+    static netsnmp_variable_list **stack;
+    static int stack_max;
+    netsnmp_variable_list **newstack;
+    netsnmp_variable_list *var = NULL;
+    struct expCode *code;
+    int sp = 0, error = 0, i;
+
+    if (prog->depth > stack_max) {
+        newstack = (netsnmp_variable_list **)realloc(stack,
+                                      prog->depth * sizeof(*stack));
+        if (!newstack)
+            return NULL;
+        stack     = newstack;
+        stack_max = prog->depth;
     }
-    
-    for (vp = exprAlD; vp; vp=vp1) {
-        vp1 = vp->next_variable;
-        if ( vp->type == ASN_PRIV_OPERATOR ) {
-            /* Must *always* follow a value */
-            if ( !stack || stack->type == ASN_PRIV_OPERATOR ) {
-                snmp_set_var_typed_integer( vp, ASN_INTEGER,
-                                            EXPERRCODE_SYNTAX );
-                vp->type = ASN_NULL;
-                snmp_free_var( stack );
-                return vp;
-            }
+
+    for (i = 0; i < prog->len && !error; i++) {
+        code = &prog->code[i];
+        switch (code->code) {
+        case EXP_CODE_PARAM:
             /*
-             * Evaluate any higher priority operators
-             *  already on the stack....
+             * Locate the appropriate instance of the specified
+             * parameter, and insert the corresponding value.
              */
-            while ( stack->next_variable &&
-                    stack->next_variable->type == ASN_PRIV_OPERATOR &&
-                  (*stack->next_variable->val.integer > *vp->val.integer)) {
-                 rval = stack;
-                 op   = stack->next_variable;
-                 lval = op->next_variable;
-                 stack = lval->next_variable;
-
-                 rval = _expValue_evalOperator( lval, op, rval );
-                 rval->next_variable = stack;
-                 stack = rval;
+            var = _expValue_evalParam( expIdx, code->n, suffix, suffix_len );
+            if (!var) {
+                error = EXPERRCODE_RESOURCE;
+                break;
             }
-            /*
-             * ... and then push this operator onto the stack.
-             */
-            vp->next_variable = stack;
-            stack = vp;
-        } else if ( vp->type == ASN_PRIV_FUNCTION ) {
-            /* Must be first, or follow an operator */
-            if ( stack && stack->type != ASN_PRIV_OPERATOR ) {
-                snmp_set_var_typed_integer( vp, ASN_INTEGER,
-                                            EXPERRCODE_SYNTAX );
-                vp->type = ASN_NULL;
-                snmp_free_var( stack );
-                return vp;
+            if (var->type == ASN_NULL) {
+                DEBUGMSGTL(("disman:expr:eval", "Invalid parameter '%ld'\n",
+                                                 code->n));
+                /* Note position of failure in expression */
+                var->data = (void *)(uintptr_t)code->pos;
+                goto done;
             }
-            /*
-             * Evaluate this function (consuming the
-             *   appropriate parameters from the token 
-             *   list), and push the result onto the stack.
-             */
-            vp = _expValue_evalFunction( vp );
-            vp1 = vp->next_variable;
-            vp->next_variable = stack;
-            stack = vp;
-        } else {
-            /* Must be first, or follow an operator */
-            if ( stack && stack->type != ASN_PRIV_OPERATOR ) {
-                snmp_set_var_typed_integer( vp, ASN_INTEGER,
-                                            EXPERRCODE_SYNTAX );
-                vp->type = ASN_NULL;
-                snmp_free_var( stack );
-                return vp;
+            stack[sp++] = var;
+            var = NULL;
+            break;
+        case EXP_CODE_CONST:
+            var = SNMP_MALLOC_TYPEDEF( netsnmp_variable_list );
+            if (!var || snmp_clone_var( code->var, var )) {
+                error = EXPERRCODE_RESOURCE;
+                break;
             }
-            /*
-             * Push this value onto the stack
-             */
-            vp->next_variable = stack;
-            stack = vp;
+            stack[sp++] = var;
+            var = NULL;
+            break;
+        case EXP_CODE_BINARY:
+            error = _expValue_evalOperator( code->n, stack[sp-2],
+                                                     stack[sp-1] );
+            snmp_free_var( stack[sp-2] );
+            stack[sp-2] = stack[sp-1];
+            sp--;
+            break;
+        case EXP_CODE_UNARY:
+            error = _expValue_evalOperator( code->n, NULL, stack[sp-1] );
+            break;
+        case EXP_CODE_FUNCTION:
+            /* XXX - functions are not implemented yet */
+            snmp_set_var_typed_integer( stack[sp-1], ASN_INTEGER, 99 );
+            break;
         }
     }
 
-    /*
-     * Now evaluate whatever's left on the stack
-     *   and return the final result.
-     */
-    while ( stack && stack->next_variable ) {
-        rval = stack;
-        op   = stack->next_variable;
-        lval = op->next_variable;
-        stack = lval->next_variable;
-
-        rval = _expValue_evalOperator( lval, op, rval );
-        rval->next_variable = stack;
-        stack = rval;
+    if (error) {
+        snmp_free_var( var );
+        var = SNMP_MALLOC_TYPEDEF( netsnmp_variable_list );
+        if (var) {
+            snmp_set_var_typed_integer( var, ASN_INTEGER, error );
+            var->type = ASN_NULL;
+            var->data = (void *)(uintptr_t)code->pos;
+        }
+    } else if (sp == 1) {
+        var = stack[--sp];
     }
-    return stack;
+done:
+    while (sp > 0)
+        snmp_free_var( stack[--sp] );
+    return var;
 }
 
 /* =============
@@ -736,15 +816,30 @@ netsnmp_variable_list *
 expValue_evaluateExpression( struct expExpression *exp,
                              oid *suffix, size_t suffix_len )
 {
-    char exprRaw[     EXP_STR3_LEN+1 ];
+    struct expProgram *prog;
     netsnmp_variable_list *var;
     netsnmp_variable_list owner_var, name_var, param_var;
     int n;
-    char *cp;
 
     if (!exp)
         return NULL;
 
+    prog = expValue_compile( exp );
+    if (!prog) {
+        _expValue_setError( exp, EXPERRCODE_RESOURCE, suffix, suffix_len, NULL );
+        return NULL;
+    }
+    if (prog->error) {
+        /*
+         * The expression couldn't be compiled
+         */
+        var = SNMP_MALLOC_TYPEDEF( netsnmp_variable_list );
+        if (var)
+            var->data = (void *)(uintptr_t)prog->error_pos;
+        _expValue_setError( exp, prog->error, suffix, suffix_len, var );
+        return NULL;
+    }
+
     /*
      * Gather data for evaluating expressions with no regular delta-value
      * sampling, i.e. expressions with sampling/delta interval of 0
@@ -770,24 +865,14 @@ expValue_evaluateExpression( struct expExpression *exp,
     owner_var.next_variable = &name_var;
     name_var.next_variable  = &param_var;
 
-    /*
-     * Make a working copy of the expression, and evaluate it.
-     */
-    memset(exprRaw, 0,                  sizeof(exprRaw));
-    memcpy(exprRaw, exp->expExpression, sizeof(exprRaw));
+    var = _expValue_run( prog, &owner_var, suffix, suffix_len );
+    DEBUGMSGTL(( "disman:expr:eval1", "Evaluated to "));
+    DEBUGMSGVAR(("disman:expr:eval1", var));
+    DEBUGMSG((   "disman:expr:eval1", "\n"));
 
-    var = _expValue_evalExpr( &owner_var, exprRaw, &cp, suffix, suffix_len );
     /*
      * Check for any problems, and record the appropriate error
      */
-    if (!cp || *cp != '\0') {
-        /*
-         * When we had finished, there was a lot
-         * of bricks^Wcharacters left over....
-         */
-        _expValue_setError( exp, EXPERRCODE_SYNTAX, suffix, suffix_len, var );
-        return NULL;
-    }
     if (!var) {
         /* Shouldn't happen */
         _expValue_setError( exp, EXPERRCODE_RESOURCE, suffix, suffix_len, NULL );
@@ -4,7 +4,11 @@
 
 #include "disman/expr/expExpression.h"
 
+struct expProgram;
+
 void              init_expValue(void);
+struct expProgram *expValue_compile( struct expExpression *exp );
+void              expValue_free(     struct expExpression *exp );
 netsnmp_variable_list *
 expValue_evaluateExpression( struct expExpression *exp,
                              oid *suffix, size_t suffix_len );
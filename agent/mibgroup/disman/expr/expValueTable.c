@@ -59,8 +59,9 @@ expValueTable_getEntry(netsnmp_variable_list * indexes,
     struct expExpression  *exp;
     netsnmp_variable_list *res, *vp, *vp2;
     oid nullInstance[] = {0, 0, 0};
+    oid inst[MAX_OID_LEN];
     int  plen;
-    size_t len;
+    size_t len, lo, hi, mid;
     unsigned int type = colnum-1; /* column object subIDs and type
                                       enumerations are off by one. */
 
@@ -108,6 +109,10 @@ expValueTable_getEntry(netsnmp_variable_list * indexes,
             return NULL;        /* Wrong type */
         }
 NEXT_EXP:
+        /*
+         * Start from the first instance of the next expression
+         */
+        indexes->next_variable->next_variable->val_len = 0;
         exp = expExpression_getNextEntry( exp->expOwner, exp->expName );
         DEBUGMSGTL(( "disman:expr:val", "using next entry (%p)\n", exp ));
     }
@@ -167,7 +172,7 @@ NEXT_EXP:
         if ( vp->val_len > 0 && vp->val.objid[0] != 0 ) {
             DEBUGMSGTL(( "disman:expr:val",
                          "non-zero next instance (%" NETSNMP_PRIo "d)\n", vp->val.objid[0]));
-            return NULL;        /* All valid instances start with .0 */
+            goto NEXT_EXP;      /* All valid instances start with .0 */
         }
         plen = exp->expPrefix_len;
         if (plen == 0 ) {
@@ -180,7 +185,7 @@ NEXT_EXP:
                 (vp->val_len == 2*sizeof(oid) &&
                       vp->val.objid[1] != 0)) {
                 DEBUGMSGTL(( "disman:expr:val", "invalid scalar next instance\n"));
-                return NULL;        /* Invalid instance */
+                goto NEXT_EXP;      /* Past the only instance */
             }
      
             /*
@@ -196,54 +201,81 @@ NEXT_EXP:
                        (u_char*)nullInstance, 3*sizeof(oid));
             res = expValue_evaluateExpression( exp, NULL, 0 );
             DEBUGMSGTL(( "disman:expr:val", "scalar next returned (%p)\n", res));
+            if ( !res )
+                goto NEXT_EXP;  /* Failed - errors are in expErrorTable */
         } else {
             /*
              * Now comes the interesting case - finding the
              *   appropriate instance of a wildcarded expression.
              */
-            if ( vp->val_len == 0 ) {
-                 if ( !exp->pvars ) {
-                     DEBUGMSGTL(( "disman:expr:val", "no instances\n"));
-                     goto NEXT_EXP;
-                 }
-                 DEBUGMSGTL(( "disman:expr:val", "using first instance\n"));
-                 vp2 = exp->pvars;
+            /*
+             * Make sure the list of instances is current
+             *   (for expressions that aren't sampled regularly),
+             *   reusing the sample taken earlier in the same walk.
+             */
+            expExpression_getWalkData(exp, vp->val_len <= sizeof(oid));
+NEXT_INST:
+            if ( !exp->pidx_len ) {
+                DEBUGMSGTL(( "disman:expr:val", "no instances\n"));
+                goto NEXT_EXP;
+            }
+            if ( vp->val_len <= sizeof(oid)) {
+                DEBUGMSGTL(( "disman:expr:val", "using first instance\n"));
+                vp2 = exp->pidx[0];
             } else {
-                 /*
-                  * Search the list of instances for the (first) greater one
-                  *   XXX - This comparison relies on the OID of the prefix
-                  *         object being the same length as the wildcarded
-                  *         parameter objects.  It ain't necessarily so.
-                  */
-                 for ( vp2 = exp->pvars; vp2; vp2 = vp2->next_variable ) {
-                     if ( snmp_oid_compare( vp2->name        + plen,
-                                            vp2->name_length - plen,
-                                            vp->name,
-                                            vp->name_length) < 0 ) {
-                         DEBUGMSGTL(( "disman:expr:val", "next instance "));
-                         DEBUGMSGOID(("disman:expr:val",  vp2->name, vp2->name_length ));
-                         DEBUGMSG((   "disman:expr:val", "\n"));
-                         break;
-                     }
-                 }
-                 if (!vp2) {
-                     DEBUGMSGTL(( "disman:expr:val", "no next instance\n"));
-                     goto NEXT_EXP;
-                 }
+                /*
+                 * Search the (sorted) instances for the first greater one,
+                 *   skipping the leading .0 of the requested instance.
+                 *   XXX - This comparison relies on the OID of the prefix
+                 *         object being the same length as the wildcarded
+                 *         parameter objects.  It ain't necessarily so.
+                 */
+                lo = 0;
+                hi = exp->pidx_len;
+                while ( lo < hi ) {
+                    mid = (lo + hi) / 2;
+                    vp2 = exp->pidx[mid];
+                    if ( snmp_oid_compare( vp2->name        + plen,
+                                           vp2->name_length - plen,
+                                           vp->val.objid    + 1,
+                                           vp->val_len/sizeof(oid) - 1) > 0 )
+                        hi = mid;
+                    else
+                        lo = mid+1;
+                }
+                if ( lo == exp->pidx_len ) {
+                    DEBUGMSGTL(( "disman:expr:val", "no next instance\n"));
+                    goto NEXT_EXP;
+                }
+                vp2 = exp->pidx[lo];
+                DEBUGMSGTL(( "disman:expr:val", "next instance "));
+                DEBUGMSGOID(("disman:expr:val",  vp2->name, vp2->name_length ));
+                DEBUGMSG((   "disman:expr:val", "\n"));
             }
             snmp_set_var_typed_value( indexes, ASN_OCTET_STR,
                        (u_char*)exp->expOwner, strlen(exp->expOwner));
             snmp_set_var_typed_value( indexes->next_variable, ASN_OCTET_STR,
                        (u_char*)exp->expName,  strlen(exp->expName));
-            if (vp2) {
-                len = vp2->name_length - exp->expPrefix_len;
-                snmp_set_var_typed_value( vp, ASN_PRIV_IMPLIED_OBJECT_ID,
-                      (u_char*)(vp2->name+exp->expPrefix_len), len);
-            } else {
-                len = 1;
-            }
-            res = expValue_evaluateExpression( exp, vp->val.objid+1, len-1);
+            /*
+             * The value instance is .0 followed by the instance
+             *   subidentifiers of the prefix object.
+             */
+            len = vp2->name_length - plen;
+            if ( len+1 > MAX_OID_LEN )
+                goto NEXT_EXP;
+            inst[0] = 0;
+            memcpy( inst+1, vp2->name+plen, len*sizeof(oid));
+            snmp_set_var_typed_value( vp, ASN_PRIV_IMPLIED_OBJECT_ID,
+                      (u_char*)inst, (len+1)*sizeof(oid));
+            /*
+             * ... using the values that were retrieved to find it.
+             */
+            exp->flags |= EXP_FLAG_SAMPLED;
+            res = expValue_evaluateExpression( exp, vp->val.objid+1, len);
+            exp->flags &= ~EXP_FLAG_SAMPLED;
             DEBUGMSGTL(( "disman:expr:val", "w/card next returned (%p)\n", res));
+            if ( !res )
+                goto NEXT_INST; /* Failed - errors are in expErrorTable */
         }
     }
     return res;
@@ -49,6 +49,7 @@ typedef struct netsnmp_fsys_info_s netsnmp_fsys_info;
 #define NETSNMP_FS_FLAG_BOOTABLE 0x08
 #define NETSNMP_FS_FLAG_REMOVE   0x10
 #define NETSNMP_FS_FLAG_UCD      0x20
+#define NETSNMP_FS_FLAG_STALE    0x40   /* statfs() did not return in time */
 
 #define NETSNMP_FS_FIND_CREATE     1   /* or use one of the type values */
 #define NETSNMP_FS_FIND_EXIST      0
@@ -6,6 +6,7 @@
 #include "hardware/fsys/hw_fsys_private.h"
 
 #include <stdio.h>
+#include <errno.h>
 #ifdef HAVE_MNTENT_H
 #include <mntent.h>
 #endif
@@ -33,6 +34,11 @@
 #include <sys/types.h>
 #include <regex.h>
 #endif
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_PTHREAD_CREATE)
+#include <pthread.h>
+#include <signal.h>
+#define NETSNMP_FSYS_ASYNC 1
+#endif
 
 #ifdef solaris2
 #define _NETSNMP_GETMNTENT_TWO_ARGS 1
@@ -182,10 +188,320 @@ _fsys_type( char *typename )
     return NETSNMP_FS_TYPE_IGNORE;
 }
 
+int (*netsnmp_fsys_statfs_hook)(const char *path, void *stat_buf);
+
+static int
+_fsys_statfs(const char *path, struct NSFS_STATFS *stat_buf)
+{
+    if (netsnmp_fsys_statfs_hook)
+        return (*netsnmp_fsys_statfs_hook)(path, stat_buf);
+#ifdef irix6
+    return NSFS_STATFS( path, stat_buf, sizeof(struct statfs), 0);
+#else
+    return NSFS_STATFS( path, stat_buf );
+#endif
+}
+
+/*
+ * copy the result of a statfs() call into a filesystem entry
+ */
+static void
+_fsys_set_stats(netsnmp_fsys_info *entry, struct NSFS_STATFS *stat_buf,
+                int rc, int err)
+{
+    char              *tmpbuf = NULL;
+
+    if ( rc < 0 ) {
+        static char logged = 0;
+
+        if (!logged &&
+            asprintf(&tmpbuf, "Cannot statfs %s", entry->path) >= 0) {
+            errno = err;
+            snmp_log_perror(tmpbuf);
+            free(tmpbuf);
+            logged = 1;
+        }
+        memset(stat_buf, 0, sizeof(*stat_buf));
+    }
+    entry->units =  stat_buf->NSFS_SIZE;
+    entry->size  =  stat_buf->f_blocks;
+    entry->used  = (stat_buf->f_blocks - stat_buf->f_bfree);
+    entry->avail =  stat_buf->f_bavail;
+    entry->inums_total = stat_buf->f_files;
+    entry->inums_avail = stat_buf->f_ffree;
+    entry->flags &= ~NETSNMP_FS_FLAG_STALE;
+    netsnmp_fsys_calculate32(entry);
+}
+
+/*
+ * seconds to wait for statfs(); 0 calls it from the agent thread
+ */
+static int _fsys_timeout = 2;
+
+#ifdef NETSNMP_FSYS_ASYNC
+/*
+ * statfs() on a remote filesystem whose server has gone away can block
+ * for minutes.  The calls are therefore made by a small pool of worker
+ * threads, and each load waits at most statfsTimeout seconds for them.
+ * A filesystem whose statfs() has not returned by then keeps its
+ * previous values and is flagged NETSNMP_FS_FLAG_STALE.  It is not
+ * queried again until the outstanding call has returned, so a hung
+ * mount delays one load, not every one of them.
+ *
+ * A worker whose call has missed a deadline no longer counts against
+ * the size of the pool, and another one is started in its place, so
+ * hung mounts cannot starve the others.  As there is never more than
+ * one call per mount outstanding, there are at most as many of these
+ * stuck workers as there are hung mounts.  Each one exits once its call
+ * returns, if the pool is full again by then.
+ *
+ * The workers only touch the job list: the filesystem container is
+ * only ever updated from the agent thread.
+ */
+#define FSYS_MAX_WORKERS     8
+#define FSYS_STALE_LOG_INTERVAL 300    /* seconds between warnings */
+
+#define FSYS_JOB_QUEUED      0
+#define FSYS_JOB_RUNNING     1
+#define FSYS_JOB_DONE        2
+
+struct fsys_job {
+    struct fsys_job    *next;
+    char                path[SNMP_MAXPATH+1];
+    int                 state;
+    int                 waited;     /* submitted by the current load */
+    int                 stuck;      /* running past a deadline */
+    time_t              queued, logged;
+    int                 rc, err;
+    struct NSFS_STATFS  stat_buf;
+};
+
+static pthread_mutex_t  _fsys_lock   = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   _fsys_queued = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t   _fsys_done   = PTHREAD_COND_INITIALIZER;
+static struct fsys_job *_fsys_jobs;
+static int              _fsys_pending, _fsys_idle, _fsys_workers;
+static int              _fsys_stuck, _fsys_max_workers = FSYS_MAX_WORKERS;
+
+static void *
+_fsys_worker(void *arg)
+{
+    struct fsys_job *job;
+    sigset_t         set;
+
+    /* leave the signals to the agent */
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    pthread_mutex_lock(&_fsys_lock);
+    for (;;) {
+        for (job = _fsys_jobs; job; job = job->next)
+            if (FSYS_JOB_QUEUED == job->state)
+                break;
+        if (!job) {
+            if (_fsys_workers - _fsys_stuck > _fsys_max_workers)
+                break;          /* statfsThreads was lowered */
+            ++_fsys_idle;
+            pthread_cond_wait(&_fsys_queued, &_fsys_lock);
+            --_fsys_idle;
+            continue;
+        }
+        job->state = FSYS_JOB_RUNNING;
+        --_fsys_pending;
+        pthread_mutex_unlock(&_fsys_lock);
+
+        /*
+         * nothing else touches a running job
+         */
+        job->rc  = _fsys_statfs(job->path, &job->stat_buf);
+        job->err = errno;
+
+        pthread_mutex_lock(&_fsys_lock);
+        job->state = FSYS_JOB_DONE;
+        pthread_cond_broadcast(&_fsys_done);
+        if (job->stuck) {
+            --_fsys_stuck;
+            if (_fsys_workers - _fsys_stuck > _fsys_max_workers)
+                break;          /* replaced while we were stuck */
+        }
+    }
+    --_fsys_workers;
+    DEBUGMSGTL(("fsys:async", "worker exits, %d left\n", _fsys_workers));
+    pthread_mutex_unlock(&_fsys_lock);
+    return NULL;
+}
+
+/*
+ * queue a statfs() of path, unless one is still outstanding.
+ * Called with _fsys_lock held.
+ */
+static void
+_fsys_submit(const char *path)
+{
+    struct fsys_job *job;
+    struct timeval   now;
+
+    for (job = _fsys_jobs; job; job = job->next)
+        if (!strcmp(job->path, path)) {
+            DEBUGMSGTL(("fsys:async", "%s still outstanding\n", path));
+            if (FSYS_JOB_QUEUED == job->state)
+                job->waited = 1;        /* might run this time */
+            return;
+        }
+
+    job = SNMP_MALLOC_TYPEDEF(struct fsys_job);
+    if (!job)
+        return;
+    netsnmp_get_monotonic_clock(&now);
+    strlcpy(job->path, path, sizeof(job->path));
+    job->state  = FSYS_JOB_QUEUED;
+    job->waited = 1;
+    job->queued = now.tv_sec;
+    job->next   = _fsys_jobs;
+    _fsys_jobs  = job;
+    ++_fsys_pending;
+}
+
+/*
+ * start as many workers as the queued jobs need, not counting the stuck
+ * ones, and signal them.  If no worker is left to take the jobs (none
+ * could be started, or all of them are stuck), run them here.
+ * Called with _fsys_lock held.
+ */
+static void
+_fsys_start(void)
+{
+    struct fsys_job *job;
+    pthread_attr_t   attr;
+    pthread_t        tid;
+    int              started = 0;
+
+    while (_fsys_pending > _fsys_idle + started &&
+           _fsys_workers - _fsys_stuck < _fsys_max_workers) {
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if (pthread_create(&tid, &attr, _fsys_worker, NULL) != 0) {
+            pthread_attr_destroy(&attr);
+            break;
+        }
+        pthread_attr_destroy(&attr);
+        ++_fsys_workers;
+        ++started;
+        DEBUGMSGTL(("fsys:async", "started worker %d (%d stuck)\n",
+                    _fsys_workers, _fsys_stuck));
+    }
+    if (_fsys_workers - _fsys_stuck <= 0) {
+        /* no free threads after all: do it ourselves */
+        DEBUGMSGTL(("fsys:async", "no free worker (%d stuck)\n",
+                    _fsys_stuck));
+        for (job = _fsys_jobs; job; job = job->next) {
+            if (FSYS_JOB_QUEUED != job->state)
+                continue;
+            job->rc    = _fsys_statfs(job->path, &job->stat_buf);
+            job->err   = errno;
+            job->state = FSYS_JOB_DONE;
+            --_fsys_pending;
+        }
+        return;
+    }
+    pthread_cond_broadcast(&_fsys_queued);
+}
+
+/*
+ * wait for the jobs submitted by this load, then copy the results of
+ * all finished jobs into their entries.  Called with _fsys_lock held.
+ */
+static void
+_fsys_collect(void)
+{
+    struct fsys_job **prev, *job;
+    netsnmp_fsys_info *entry;
+    struct timeval    now;
+    struct timespec   deadline;
+    int               waiting;
+
+    _fsys_start();
+
+    gettimeofday(&now, NULL);
+    deadline.tv_sec  = now.tv_sec + _fsys_timeout;
+    deadline.tv_nsec = now.tv_usec * 1000;
+    for (;;) {
+        waiting = 0;
+        for (job = _fsys_jobs; job; job = job->next)
+            if (job->waited && FSYS_JOB_DONE != job->state)
+                ++waiting;
+        if (!waiting ||
+            pthread_cond_timedwait(&_fsys_done, &_fsys_lock,
+                                   &deadline) == ETIMEDOUT)
+            break;
+    }
+
+    netsnmp_get_monotonic_clock(&now);
+    prev = &_fsys_jobs;
+    while ((job = *prev) != NULL) {
+        entry = netsnmp_fsys_by_path(job->path, NETSNMP_FS_FIND_EXIST);
+        if (FSYS_JOB_DONE == job->state) {
+            if (entry)
+                _fsys_set_stats(entry, &job->stat_buf, job->rc, job->err);
+            *prev = job->next;
+            free(job);
+            continue;
+        }
+        if (entry)
+            entry->flags |= NETSNMP_FS_FLAG_STALE;
+        if (FSYS_JOB_RUNNING == job->state && !job->stuck) {
+            job->stuck = 1;
+            ++_fsys_stuck;
+        }
+        if (!job->logged ||
+            now.tv_sec - job->logged >= FSYS_STALE_LOG_INTERVAL) {
+            snmp_log(LOG_WARNING, "statfs %s: no answer for %ld seconds\n",
+                     job->path, (long)(now.tv_sec - job->queued));
+            job->logged = now.tv_sec;
+        }
+        job->waited = 0;
+        prev = &job->next;
+    }
+}
+#endif /* NETSNMP_FSYS_ASYNC */
+
+static void
+_parse_statfs_timeout(const char *token, char *cptr)
+{
+    int timeout = atoi(cptr);
+
+    if (timeout < 0) {
+        config_perror("statfsTimeout must be 0 or more seconds");
+        return;
+    }
+    _fsys_timeout = timeout;
+}
+
+#ifdef NETSNMP_FSYS_ASYNC
+static void
+_parse_statfs_threads(const char *token, char *cptr)
+{
+    int threads = atoi(cptr);
+
+    if (threads < 1) {
+        config_perror("statfsThreads must be 1 or more");
+        return;
+    }
+    pthread_mutex_lock(&_fsys_lock);
+    _fsys_max_workers = threads;
+    pthread_mutex_unlock(&_fsys_lock);
+}
+#endif /* NETSNMP_FSYS_ASYNC */
+
 void
 netsnmp_fsys_arch_init( void )
 {
-    return;
+    snmpd_register_config_handler("statfsTimeout", _parse_statfs_timeout,
+                                  NULL, "seconds");
+#ifdef NETSNMP_FSYS_ASYNC
+    snmpd_register_config_handler("statfsThreads", _parse_statfs_threads,
+                                  NULL, "count");
+#endif
 }
 
 static int
@@ -239,6 +555,7 @@ netsnmp_fsys_arch_load( void )
     struct NSFS_STATFS stat_buf;
     netsnmp_fsys_info *entry;
     char              *tmpbuf = NULL;
+    int                rc;
 
     /*
      * Retrieve information about the currently mounted filesystems...
@@ -251,6 +568,10 @@ netsnmp_fsys_arch_load( void )
         return;
     }
 
+#ifdef NETSNMP_FSYS_ASYNC
+    pthread_mutex_lock(&_fsys_lock);
+#endif
+
     /*
      * ... and insert this into the filesystem container.
      */
@@ -312,29 +633,20 @@ netsnmp_fsys_arch_load( void )
         if (entry->type == NETSNMP_FS_TYPE_AUTOFS)
             continue;
 
-#ifdef irix6
-        if ( NSFS_STATFS( entry->path, &stat_buf, sizeof(struct statfs), 0) < 0 )
-#else
-        if ( NSFS_STATFS( entry->path, &stat_buf ) < 0 )
-#endif
-        {
-            static char logged = 0;
-
-            if (!logged &&
-                asprintf(&tmpbuf, "Cannot statfs %s", entry->path) >= 0) {
-                snmp_log_perror(tmpbuf);
-                free(tmpbuf);
-                logged = 1;
-            }
-            memset(&stat_buf, 0, sizeof(stat_buf));
+#ifdef NETSNMP_FSYS_ASYNC
+        if ( _fsys_timeout > 0 ) {
+            _fsys_submit( entry->path );
+            continue;
         }
-        entry->units =  stat_buf.NSFS_SIZE;
-        entry->size  =  stat_buf.f_blocks;
-        entry->used  = (stat_buf.f_blocks - stat_buf.f_bfree);
-        entry->avail =  stat_buf.f_bavail;
-        entry->inums_total = stat_buf.f_files;
-        entry->inums_avail = stat_buf.f_ffree;
-        netsnmp_fsys_calculate32(entry);
+#endif
+        rc = _fsys_statfs( entry->path, &stat_buf );
+        _fsys_set_stats( entry, &stat_buf, rc, errno );
     }
     fclose( fp );
+
+#ifdef NETSNMP_FSYS_ASYNC
+    if ( _fsys_timeout > 0 )
+        _fsys_collect();
+    pthread_mutex_unlock(&_fsys_lock);
+#endif
 }
@@ -1,2 +1,8 @@
 void netsnmp_fsys_arch_init(void);
 void netsnmp_fsys_arch_load(void);
+
+/*
+ * fsys_mntent.c: called instead of statfs() when set, so that the unit
+ * tests can simulate a hung filesystem
+ */
+extern int (*netsnmp_fsys_statfs_hook)(const char *path, void *stat_buf);
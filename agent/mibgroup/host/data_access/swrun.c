@@ -127,6 +127,7 @@ swrun_count_processes_by_regex( char *name, netsnmp_regex_ptr regexp )
 
     it = CONTAINER_ITERATOR( swrun_container );
     while ((entry = (netsnmp_swrun_entry*)ITERATOR_NEXT( it )) != NULL) {
+        netsnmp_swrun_entry_update(entry);
         /* need to assemble full command back so regexps can get full picture */
         sprintf(fullCommand, "%s %s", entry->hrSWRunPath, entry->hrSWRunParameters);
 #ifdef HAVE_PCRE2_H
@@ -162,6 +163,7 @@ swrun_count_processes_by_name( char *name )
 
     it = CONTAINER_ITERATOR( swrun_container );
     while ((entry = (netsnmp_swrun_entry*)ITERATOR_NEXT( it )) != NULL) {
+        netsnmp_swrun_entry_update(entry);
         if (0 == strcmp( entry->hrSWRunName, name ))
             i++;
     }
@@ -205,6 +207,14 @@ netsnmp_swrun_cache(void)
                            hrSWRunTable_oid, hrSWRunTable_oid_len);
         if (swrun_cache)
             swrun_cache->flags = NETSNMP_CACHE_DONT_INVALIDATE_ON_SET;
+#ifdef NETSNMP_SWRUN_INCREMENTAL
+        /*
+         * the arch code updates the container in place
+         */
+        if (swrun_cache)
+            swrun_cache->flags |= NETSNMP_CACHE_DONT_FREE_BEFORE_LOAD |
+                                  NETSNMP_CACHE_DONT_FREE_EXPIRED;
+#endif
     }
     return swrun_cache;
 }
@@ -373,6 +383,20 @@ netsnmp_swrun_entry_free(netsnmp_swrun_entry * entry)
     free(entry);
 }
 
+/**
+ * make sure the status and perf values of an entry are current, and its
+ * name, path and parameters if the process has called exec(). Some
+ * architectures only read them when they are asked for.
+ */
+void
+netsnmp_swrun_entry_update(netsnmp_swrun_entry *entry)
+{
+#ifdef NETSNMP_SWRUN_INCREMENTAL
+    if (entry && (entry->flags & NETSNMP_SWRUN_ENTRY_STALE))
+        netsnmp_arch_swrun_entry_update(entry);
+#endif
+}
+
 /**---------------------------------------------------------------------*/
 /*
  * Utility routines
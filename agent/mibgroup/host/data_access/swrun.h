@@ -38,6 +38,11 @@ config_exclude(host/hr_swrun);
     config_require(host/data_access/swrun_kinfo);
 #elif defined( linux )
     config_require(host/data_access/swrun_procfs_status);
+/*
+ * entries are kept from one load to the next, and the status and perf
+ * values only read when asked for
+ */
+#define NETSNMP_SWRUN_INCREMENTAL 1
 #elif defined( cygwin )
     config_require(host/data_access/swrun_cygwin);
 #else
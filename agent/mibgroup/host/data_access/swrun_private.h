@@ -1,3 +1,6 @@
 extern void netsnmp_arch_swrun_init(void);
 extern int netsnmp_arch_swrun_container_load(netsnmp_container* container,
                                              u_int load_flags);
+#ifdef NETSNMP_SWRUN_INCREMENTAL
+extern void netsnmp_arch_swrun_entry_update(netsnmp_swrun_entry *entry);
+#endif
@@ -29,6 +29,7 @@
 #include <net-snmp/library/container.h>
 #include <net-snmp/library/snmp_debug.h>
 #include <net-snmp/data_access/swrun.h>
+#include "swrun.h"
 #include "swrun_private.h"
 
 static long pagesize;
@@ -49,17 +50,200 @@ netsnmp_arch_swrun_init(void)
 }
 
 /* ---------------------------------------------------------------------
+ * read the values that do not change during the life of a process:
+ * name, path, parameters and type.
+ *
+ * @retval  0 : success
+ * @retval -1 : the process went away
+ */
+static int
+_load_static(netsnmp_swrun_entry *entry)
+{
+    FILE                *fp;
+    int                  pid = entry->hrSWRunIndex, ret;
+    char                 buf[BUFSIZ], buf2[BUFSIZ], *cp;
+
+    /*
+     *   Name:  process name
+     */
+    snprintf( buf2, BUFSIZ, "/proc/%d/status", pid );
+    fp = fopen( buf2, "r" );
+    if (!fp)
+        return -1; /* file (process) probably went away */
+    memset(buf, 0, sizeof(buf));
+    if (fgets( buf, BUFSIZ-1, fp ) == NULL) {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+
+    for ( cp = buf; *cp != ':'; cp++ )
+        ;
+    while (isspace(*(++cp)))	/* Skip ':' and following spaces */
+        ;
+    entry->hrSWRunName_len = snprintf(entry->hrSWRunName,
+                               sizeof(entry->hrSWRunName)-1, "%s", cp);
+    if ( '\n' == entry->hrSWRunName[ entry->hrSWRunName_len-1 ]) {
+        entry->hrSWRunName[ entry->hrSWRunName_len-1 ] = '\0';
+        entry->hrSWRunName_len--;           /* Stamp on trailing newline */
+    }
+
+    /*
+     *  Command Line:
+     *     argv[0] '\0' argv[1] '\0' ....
+     */
+    snprintf( buf2, BUFSIZ, "/proc/%d/cmdline", pid );
+    fp = fopen( buf2, "r" );
+    if (!fp)
+        return -1; /* file (process) probably went away */
+    entry->hrSWRunType = HRSWRUNTYPE_APPLICATION;
+    memset(buf, 0, sizeof(buf));
+    cp = fgets( buf, BUFSIZ-1, fp );
+    fclose(fp);
+    if (cp != NULL) {
+        /*
+         *     argv[0]   is hrSWRunPath
+         */
+        ret = snprintf(entry->hrSWRunPath, sizeof(entry->hrSWRunPath),
+                       "%s", buf);
+
+        if (ret < sizeof(entry->hrSWRunPath))
+            entry->hrSWRunPath_len = ret;
+        else
+            entry->hrSWRunPath_len = sizeof(entry->hrSWRunPath) - 1;
+
+        /*
+         * Stitch together argv[1..] to construct hrSWRunParameters
+         */
+        for (cp = buf + ret; ! (*cp == '\0' && *(cp + 1) == '\0'); cp++)
+                if (*cp == '\0')
+                        *cp = ' ';
+
+        entry->hrSWRunParameters_len
+            = sprintf(entry->hrSWRunParameters, "%.*s",
+                      (int)sizeof(entry->hrSWRunParameters) - 1,
+                      buf + ret + 1);
+    } else {
+        /* empty /proc/PID/cmdline, it's probably a kernel thread */
+        entry->hrSWRunPath_len = 0;
+        entry->hrSWRunParameters_len = 0;
+        entry->hrSWRunType = HRSWRUNTYPE_OPERATINGSYSTEM;
+    }
+
+    return 0;
+}
+
+/* ---------------------------------------------------------------------
+ * read the status, perf values and start time from /proc/PID/stat, and
+ * compare the command name in it with the cached name. A process which
+ * called exec() keeps its pid, start time and /proc inode, so this is
+ * the only sign that its name, path and parameters have to be read again.
+ *
+ * @retval  0 : success
+ * @retval  1 : success, but the command changed
+ * @retval -1 : the process went away
+ */
+static int
+_load_stat(netsnmp_swrun_entry *entry)
+{
+    FILE                *fp;
+    char                 buf[BUFSIZ], *cp, *cp1;
+    char                 state;
+    unsigned long long   utime, stime, start_time;
+    long                 rss;
+    int                  changed;
+
+    /*
+     *   {xxx} {xxx} STATUS  {xxx}*10  UTIME STIME  {xxx}*6 STARTTIME
+     *   {xxx} RSS
+     */
+    snprintf( buf, BUFSIZ, "/proc/%d/stat", (int)entry->hrSWRunIndex );
+    fp = fopen( buf, "r" );
+    if (!fp)
+        return -1; /* file (process) probably went away */
+    if (fgets( buf, BUFSIZ-1, fp ) == NULL) {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+
+    cp = buf;
+    while ( ' ' != *(cp++))    /* Skip first field */
+        ;
+    cp1 = cp;                  /* Skip second field */
+    while (*cp1) {
+        if (*cp1 == ')') cp = cp1;
+        cp1++;
+    }
+    cp1 = strchr(buf, '(');    /* the command is between '(' and ')' */
+    if (NULL == cp1 || cp <= cp1)
+        return -1;
+    cp1++;
+    changed = ((size_t)(cp - cp1) != entry->hrSWRunName_len ||
+               memcmp(cp1, entry->hrSWRunName, cp - cp1) != 0);
+    if (5 != sscanf(cp + 2, "%c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u "
+                    "%llu %llu %*d %*d %*d %*d %*d %*d %llu %*u %ld",
+                    &state, &utime, &stime, &start_time, &rss))
+        return -1;
+
+    switch (state) {
+    case 'R':  entry->hrSWRunStatus = HRSWRUNSTATUS_RUNNING;
+               break;
+    case 'S':  entry->hrSWRunStatus = HRSWRUNSTATUS_RUNNABLE;
+               break;
+    case 'D':
+    case 'T':  entry->hrSWRunStatus = HRSWRUNSTATUS_NOTRUNNABLE;
+               break;
+    case 'Z':
+    default:   entry->hrSWRunStatus = HRSWRUNSTATUS_INVALID;
+               break;
+    }
+    entry->hrSWRunPerfCPU  = (utime + stime) * 100 / sc_clk_tck;
+    entry->hrSWRunPerfMem  = rss * (pagesize/1024);  /* in kB */
+    entry->start_time = start_time;
+    entry->flags &= ~NETSNMP_SWRUN_ENTRY_STALE;
+
+    return changed;
+}
+
+static void
+_clear_seen(void *data, void *context)
+{
+    ((netsnmp_swrun_entry *)data)->flags &= ~NETSNMP_SWRUN_ENTRY_SEEN;
+}
+
+struct swrun_gone {
+    netsnmp_swrun_entry **entries;
+    size_t               count, max;
+};
+
+static void
+_find_gone(void *data, void *context)
+{
+    netsnmp_swrun_entry *entry = (netsnmp_swrun_entry *)data;
+    struct swrun_gone   *gone = (struct swrun_gone *)context;
+
+    if (!(entry->flags & NETSNMP_SWRUN_ENTRY_SEEN) && gone->count < gone->max)
+        gone->entries[gone->count++] = entry;
+}
+
+/* ---------------------------------------------------------------------
+ * The container is kept from one load to the next. Processes that are
+ * still there (same /proc/PID inode, or same start time) keep their
+ * name, path and parameters, and cost no more than their directory
+ * entry: their status and perf values, and whether they have called
+ * exec() since, are only read when they are asked for, see
+ * netsnmp_swrun_entry_update().
  */
 int
 netsnmp_arch_swrun_container_load( netsnmp_container *container, u_int flags)
 {
     DIR                 *procdir = NULL;
     struct dirent       *procentry_p;
-    FILE                *fp;
-    int                  pid, i, ret;
-    unsigned long long   cpu;
-    char                 buf[BUFSIZ], buf2[BUFSIZ], *cp, *cp1;
+    int                  pid, rc, added = 0, kept = 0;
+    struct swrun_gone    gone;
     netsnmp_swrun_entry *entry;
+    unsigned long long   start_time;
     
     procdir = opendir("/proc");
     if ( NULL == procdir ) {
@@ -67,6 +251,8 @@ netsnmp_arch_swrun_container_load( netsnmp_container *container, u_int flags)
         return -1;
     }
 
+    CONTAINER_FOR_EACH(container, _clear_seen, NULL);
+
     /*
      * Walk through the list of processes in the /proc tree
      */
@@ -75,6 +261,35 @@ netsnmp_arch_swrun_container_load( netsnmp_container *container, u_int flags)
         if ( 0 == pid )
             continue;   /* Presumably '.' or '..' */
 
+        entry = netsnmp_swrun_entry_get_by_index(container, pid);
+        if (entry) {
+            if (entry->generation == (u_long)procentry_p->d_ino) {
+                /*
+                 * same process; whether it called exec() is only
+                 * checked when it is asked for.
+                 */
+                entry->flags |= NETSNMP_SWRUN_ENTRY_SEEN |
+                                NETSNMP_SWRUN_ENTRY_STALE;
+                ++kept;
+                continue;
+            }
+            /*
+             * a new inode: either the old one was dropped from the
+             * inode cache, or this is a new process with the same pid.
+             */
+            start_time = entry->start_time;
+            rc = _load_stat(entry);
+            if ((rc >= 0) && (entry->start_time == start_time) &&
+                ((0 == rc) || (0 == _load_static(entry)))) {
+                entry->generation = procentry_p->d_ino;
+                entry->flags |= NETSNMP_SWRUN_ENTRY_SEEN;
+                ++kept;
+                continue;
+            }
+            CONTAINER_REMOVE(container, entry);
+            netsnmp_swrun_entry_free(entry);
+        }
+
         entry = netsnmp_swrun_entry_create(pid);
         if (NULL == entry)
             continue;   /* error already logged by function */
@@ -83,141 +298,61 @@ netsnmp_arch_swrun_container_load( netsnmp_container *container, u_int flags)
          * Now extract the interesting information
          *   from the various /proc{PID}/ interface files
          */
-
-        /*
-         *   Name:  process name
-         */
-        snprintf( buf2, BUFSIZ, "/proc/%d/status", pid );
-        fp = fopen( buf2, "r" );
-        if (!fp) {
-            netsnmp_swrun_entry_free(entry);
-            continue; /* file (process) probably went away */
-	}
-        memset(buf, 0, sizeof(buf));
-        if (fgets( buf, BUFSIZ-1, fp ) == NULL) {
-            fclose(fp);
+        if ((0 != _load_static(entry)) || (0 > _load_stat(entry))) {
             netsnmp_swrun_entry_free(entry);
-            continue;
-        }
-        fclose(fp);
-
-        for ( cp = buf; *cp != ':'; cp++ )
-            ;
-        while (isspace(*(++cp)))	/* Skip ':' and following spaces */
-            ;
-        entry->hrSWRunName_len = snprintf(entry->hrSWRunName,
-                                   sizeof(entry->hrSWRunName)-1, "%s", cp);
-        if ( '\n' == entry->hrSWRunName[ entry->hrSWRunName_len-1 ]) {
-            entry->hrSWRunName[ entry->hrSWRunName_len-1 ] = '\0';
-            entry->hrSWRunName_len--;           /* Stamp on trailing newline */
+            continue; /* process probably went away */
         }
+        entry->generation = procentry_p->d_ino;
+        entry->flags |= NETSNMP_SWRUN_ENTRY_SEEN;
+        CONTAINER_INSERT(container, entry);
+        ++added;
+    }
+    closedir( procdir );
 
-        /*
-         *  Command Line:
-         *     argv[0] '\0' argv[1] '\0' ....
-         */
-        snprintf( buf2, BUFSIZ, "/proc/%d/cmdline", pid );
-        fp = fopen( buf2, "r" );
-        if (!fp) {
+    /*
+     * drop the processes which have exited
+     */
+    gone.max = CONTAINER_SIZE(container) - added - kept;
+    gone.count = 0;
+    if (gone.max > 0 &&
+        NULL != (gone.entries = calloc(gone.max, sizeof(*gone.entries)))) {
+        CONTAINER_FOR_EACH(container, _find_gone, &gone);
+        while (gone.count > 0) {
+            entry = gone.entries[--gone.count];
+            CONTAINER_REMOVE(container, entry);
             netsnmp_swrun_entry_free(entry);
-            continue; /* file (process) probably went away */
         }
-        entry->hrSWRunType = HRSWRUNTYPE_APPLICATION;
-        memset(buf, 0, sizeof(buf));
-        cp = fgets( buf, BUFSIZ-1, fp );
-        fclose(fp);
-        if (cp != NULL) {
-            /*
-             *     argv[0]   is hrSWRunPath
-             */
-            ret = snprintf(entry->hrSWRunPath, sizeof(entry->hrSWRunPath),
-                           "%s", buf);
+        free(gone.entries);
+    }
 
-            if (ret < sizeof(entry->hrSWRunPath))
-                entry->hrSWRunPath_len = ret;
-            else
-                entry->hrSWRunPath_len = sizeof(entry->hrSWRunPath) - 1;
+    DEBUGMSGTL(("swrun:load:arch"," loaded %" NETSNMP_PRIz "d entries"
+                " (%d new, %d kept)\n", CONTAINER_SIZE(container), added,
+                kept));
 
-            /*
-             * Stitch together argv[1..] to construct hrSWRunParameters
-             */
-            for (cp = buf + ret; ! (*cp == '\0' && *(cp + 1) == '\0'); cp++)
-                    if (*cp == '\0')
-                            *cp = ' ';
-
-            entry->hrSWRunParameters_len
-                = sprintf(entry->hrSWRunParameters, "%.*s",
-                          (int)sizeof(entry->hrSWRunParameters) - 1,
-                          buf + ret + 1);
-        } else {
-            /* empty /proc/PID/cmdline, it's probably a kernel thread */
-            entry->hrSWRunPath_len = 0;
-            entry->hrSWRunParameters_len = 0;
-            entry->hrSWRunType = HRSWRUNTYPE_OPERATINGSYSTEM;
-        }
+    return 0;
+}
 
+/* ---------------------------------------------------------------------
+ */
+void
+netsnmp_arch_swrun_entry_update(netsnmp_swrun_entry *entry)
+{
+    unsigned long long   start_time = entry->start_time;
+    int                  rc;
+
+    rc = _load_stat(entry);
+    if (rc < 0) {
         /*
-         *   {xxx} {xxx} STATUS  {xxx}*10  UTIME STIME  {xxx}*8 RSS
+         * gone since the last load
          */
-        snprintf( buf, BUFSIZ, "/proc/%d/stat", pid );
-        fp = fopen( buf, "r" );
-        if (!fp) {
-            netsnmp_swrun_entry_free(entry);
-            continue; /* file (process) probably went away */
-	}
-        if (fgets( buf, BUFSIZ-1, fp ) == NULL) {
-            fclose(fp);
-            netsnmp_swrun_entry_free(entry);
-            continue;
-        }
-        fclose(fp);
-
-        cp = buf;
-        while ( ' ' != *(cp++))    /* Skip first field */
-            ;
-        cp1 = cp;                  /* Skip second field */
-        while (*cp1) {
-            if (*cp1 == ')') cp = cp1;
-            cp1++;
-        }
-        cp += 2;
-        
-        switch (*cp) {
-        case 'R':  entry->hrSWRunStatus = HRSWRUNSTATUS_RUNNING;
-                   break;
-        case 'S':  entry->hrSWRunStatus = HRSWRUNSTATUS_RUNNABLE;
-                   break;
-        case 'D':
-        case 'T':  entry->hrSWRunStatus = HRSWRUNSTATUS_NOTRUNNABLE;
-                   break;
-        case 'Z':
-        default:   entry->hrSWRunStatus = HRSWRUNSTATUS_INVALID;
-                   break;
-        }
-        for (i=11; i; i--) {   /* Skip STATUS + 10 fields */
-            while (' ' != *(++cp))
-                ;
-            cp++;
-        }
-        cpu  = atol( cp );                     /*  utime */
-        while ( ' ' != *(++cp))
-            ;
-        cpu += atol( cp );                     /* +stime */
-        entry->hrSWRunPerfCPU  = cpu * 100 / sc_clk_tck;
-
-        for (i=9; i; i--) {   /* Skip stime + 8 fields */
-            while (' ' != *(++cp))
-                ;
-            cp++;
-        }
-        entry->hrSWRunPerfMem  = atol( cp );       /* rss   */
-        entry->hrSWRunPerfMem *= (pagesize/1024);  /* in kB */
-        CONTAINER_INSERT(container, entry);
+        entry->hrSWRunStatus = HRSWRUNSTATUS_INVALID;
+        entry->flags &= ~NETSNMP_SWRUN_ENTRY_STALE;
+        return;
     }
-    closedir( procdir );
-
-    DEBUGMSGTL(("swrun:load:arch"," loaded %" NETSNMP_PRIz "d entries\n",
-                CONTAINER_SIZE(container)));
-
-    return 0;
+    /*
+     * a new program (exec), or a new process: read everything again
+     */
+    if (((rc > 0) || (entry->start_time != start_time)) &&
+        (0 != _load_static(entry)))
+        entry->hrSWRunStatus = HRSWRUNSTATUS_INVALID;
 }
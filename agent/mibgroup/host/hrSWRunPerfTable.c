@@ -64,6 +64,7 @@ initialize_table_hrSWRunPerfTable(void)
                  MYTABLE "\n");
         goto bail;
     }
+    reg->modes |= HANDLER_CAN_GETBULK_NATIVE;
 
     table_info = SNMP_MALLOC_TYPEDEF(netsnmp_table_registration_info);
     if (NULL == table_info) {
@@ -174,6 +175,7 @@ hrSWRunPerfTable_handler(netsnmp_mib_handler *handler,
                 continue;
             }
 
+            netsnmp_swrun_entry_update(table_entry);
             switch (table_info->colnum) {
             case COLUMN_HRSWRUNPERFCPU:
                 snmp_set_var_typed_integer(request->requestvb, ASN_INTEGER,
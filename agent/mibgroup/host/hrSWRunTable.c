@@ -76,7 +76,7 @@ initialize_table_hrSWRunTable(void)
                  MYTABLE "\n");
         goto bail;
     }
-    reg->modes |= HANDLER_CAN_NOT_CREATE;
+    reg->modes |= HANDLER_CAN_NOT_CREATE | HANDLER_CAN_GETBULK_NATIVE;
 
     table_info = SNMP_MALLOC_TYPEDEF(netsnmp_table_registration_info);
     if (NULL == table_info) {
@@ -184,6 +184,7 @@ hrSWRunTable_handler(netsnmp_mib_handler *handler,
                                            table_entry->hrSWRunIndex);
                 break;
             case COLUMN_HRSWRUNNAME:
+                netsnmp_swrun_entry_update(table_entry);
                 snmp_set_var_typed_value(request->requestvb, ASN_OCTET_STR,
                                          (u_char *) table_entry->
                                          hrSWRunName,
@@ -201,12 +202,14 @@ hrSWRunTable_handler(netsnmp_mib_handler *handler,
                     );
                 break;
             case COLUMN_HRSWRUNPATH:
+                netsnmp_swrun_entry_update(table_entry);
                 snmp_set_var_typed_value(request->requestvb, ASN_OCTET_STR,
                                          (u_char *) table_entry->
                                          hrSWRunPath,
                                          table_entry->hrSWRunPath_len);
                 break;
             case COLUMN_HRSWRUNPARAMETERS:
+                netsnmp_swrun_entry_update(table_entry);
                 snmp_set_var_typed_value(request->requestvb, ASN_OCTET_STR,
                                          (u_char *) table_entry->
                                          hrSWRunParameters,
@@ -214,10 +217,12 @@ hrSWRunTable_handler(netsnmp_mib_handler *handler,
                                          hrSWRunParameters_len);
                 break;
             case COLUMN_HRSWRUNTYPE:
+                netsnmp_swrun_entry_update(table_entry);
                 snmp_set_var_typed_integer(request->requestvb, ASN_INTEGER,
                                            table_entry->hrSWRunType);
                 break;
             case COLUMN_HRSWRUNSTATUS:
+                netsnmp_swrun_entry_update(table_entry);
                 snmp_set_var_typed_integer(request->requestvb, ASN_INTEGER,
                                            table_entry->hrSWRunStatus);
                 break;
@@ -54,6 +54,8 @@
 
 #include "snmpd.h"
 
+static void     _vacm_flush_decisions(void);
+
 /**
  * Registers the VACM token handlers for inserting rows into the vacm tables.
  * These tokens will be recognised by both 'snmpd' and 'snmptrapd'.
@@ -483,6 +485,7 @@ vacm_parse_authaccess(const char *token, char *confline)
         return;
     }
 
+    vacm_tablesChanged();
     for (i = 0; i < VACM_MAX_VIEWS; i++) {
         if (viewtypes & (1 << i)) {
             strlcpy(ap->views[i], view, sizeof(ap->views[i]));
@@ -547,6 +550,7 @@ vacm_parse_setaccess(const char *token, char *param)
         return;
     }
 
+    vacm_tablesChanged();
     strlcpy(ap->views[viewnum], viewval, sizeof(ap->views[viewnum]));
     ap->contextMatch = iprefix;
     ap->storageType = SNMP_STORAGE_PERMANENT;
@@ -620,6 +624,7 @@ void
 vacm_free_access(void)
 {
     vacm_destroyAllAccessEntries();
+    _vacm_flush_decisions();
 }
 
 void
@@ -1259,13 +1264,114 @@ vacm_check_view(netsnmp_pdu *pdu, oid * name, size_t namelen,
                                     VACM_CHECK_VIEW_CONTENTS_NO_FLAGS);
 }
 
+/*
+ * Which access entry applies to a request depends only on its security
+ * model, security name, context and security level, so the outcome of the
+ * group and access lookups is kept per combination, along with the
+ * compiled views of the access entry, until the VACM tables change.
+ */
+#define VACM_DECISION_HASH_SIZE 256
+#define VACM_DECISION_MAX       4096
+
+typedef struct vacm_decision_s {
+    struct vacm_decision_s *next;
+    int             securityModel;
+    int             securityLevel;
+    char            securityName[VACMSTRINGLEN];
+    char            contextName[VACMSTRINGLEN];
+    int             result;     /* VACM_SUCCESS, VACM_NOGROUP or VACM_NOACCESS */
+    char            groupName[VACMSTRINGLEN];
+    struct vacm_accessEntry *access;
+    vacm_compiledView *views[VACM_MAX_VIEWS];
+} vacm_decision;
+
+static vacm_decision *vacm_decisions[VACM_DECISION_HASH_SIZE];
+static vacm_decision vacm_decision_uncached;
+static int      vacm_decision_count;
+static u_int    vacm_decision_generation;
+
+static void
+_vacm_flush_decisions(void)
+{
+    vacm_decision  *d;
+    int             i;
+
+    for (i = 0; i < VACM_DECISION_HASH_SIZE; i++) {
+        while ((d = vacm_decisions[i])) {
+            vacm_decisions[i] = d->next;
+            free(d);
+        }
+    }
+    vacm_decision_count = 0;
+}
+
+static vacm_decision *
+_vacm_get_decision(int securityModel, const char *securityName,
+                   const char *contextName, int securityLevel)
+{
+    vacm_decision  *d;
+    struct vacm_groupEntry *gp;
+    const char     *cp;
+    u_int           hash = 2166136261U;
+    size_t          slen = strlen(securityName);
+
+    if (vacm_decision_generation != vacm_tablesGeneration() ||
+        vacm_decision_count >= VACM_DECISION_MAX) {
+        _vacm_flush_decisions();
+        vacm_decision_generation = vacm_tablesGeneration();
+    }
+
+    d = NULL;
+    if (slen <= VACM_MAX_STRING) {
+        for (cp = securityName; *cp; cp++)
+            hash = (hash ^ (u_char) *cp) * 16777619U;
+        for (cp = contextName; *cp; cp++)
+            hash = (hash ^ (u_char) *cp) * 16777619U;
+        hash ^= securityModel * 31 + securityLevel;
+        hash %= VACM_DECISION_HASH_SIZE;
+
+        for (d = vacm_decisions[hash]; d; d = d->next)
+            if (d->securityModel == securityModel &&
+                d->securityLevel == securityLevel &&
+                !strcmp(d->securityName, securityName) &&
+                !strcmp(d->contextName, contextName))
+                return d;
+
+        d = calloc(1, sizeof(*d));
+        if (d) {
+            d->next = vacm_decisions[hash];
+            vacm_decisions[hash] = d;
+            vacm_decision_count++;
+        }
+    }
+    if (!d) {
+        d = &vacm_decision_uncached;
+        memset(d, 0, sizeof(*d));
+    }
+
+    d->securityModel = securityModel;
+    d->securityLevel = securityLevel;
+    strlcpy(d->securityName, securityName, sizeof(d->securityName));
+    strlcpy(d->contextName, contextName, sizeof(d->contextName));
+    gp = vacm_getGroupEntry(securityModel, securityName);
+    if (gp == NULL) {
+        d->result = VACM_NOGROUP;
+        return d;
+    }
+    strlcpy(d->groupName, gp->groupName, sizeof(d->groupName));
+    d->access = vacm_getAccessEntry(gp->groupName, contextName,
+                                    securityModel, securityLevel);
+    d->result = d->access ? VACM_SUCCESS : VACM_NOACCESS;
+    return d;
+}
+
 int
 vacm_check_view_contents(netsnmp_pdu *pdu, oid * name, size_t namelen,
                          int check_subtree, int viewtype, int flags)
 {
     struct vacm_accessEntry *ap;
-    struct vacm_groupEntry *gp;
     struct vacm_viewEntry *vp;
+    vacm_decision  *decision;
 #if !defined(NETSNMP_DISABLE_SNMPV1) || !defined(NETSNMP_DISABLE_SNMPV2C)
     char            vacm_default_context[1] = "";
     const char     *contextName = vacm_default_context;
@@ -1439,15 +1545,15 @@ vacm_check_view_contents(netsnmp_pdu *pdu, oid * name, size_t namelen,
 
     DEBUGMSGTL(("mibII/vacm_vars", "vacm_in_view: sn=%s", sn));
 
-    gp = vacm_getGroupEntry(pdu->securityModel, sn);
-    if (gp == NULL) {
+    decision = _vacm_get_decision(pdu->securityModel, sn, contextNameIndex,
+                                  pdu->securityLevel);
+    if (decision->result == VACM_NOGROUP) {
         DEBUGMSG(("mibII/vacm_vars", "\n"));
         return VACM_NOGROUP;
     }
-    DEBUGMSG(("mibII/vacm_vars", ", gn=%s", gp->groupName));
+    DEBUGMSG(("mibII/vacm_vars", ", gn=%s", decision->groupName));
 
-    ap = vacm_getAccessEntry(gp->groupName, contextNameIndex,
-                             pdu->securityModel, pdu->securityLevel);
+    ap = decision->access;
     if (ap == NULL) {
         DEBUGMSG(("mibII/vacm_vars", "\n"));
         return VACM_NOACCESS;
@@ -1470,7 +1576,12 @@ vacm_check_view_contents(netsnmp_pdu *pdu, oid * name, size_t namelen,
         return vacm_checkSubtree(vn, name, namelen);
     }
 
-    vp = vacm_getViewEntry(vn, name, namelen, VACM_MODE_FIND);
+    if (decision->views[viewtype] == NULL)
+        decision->views[viewtype] = vacm_getCompiledView(vn);
+    if (decision->views[viewtype])
+        vp = vacm_compiledViewGet(decision->views[viewtype], name, namelen);
+    else
+        vp = vacm_getViewEntry(vn, name, namelen, VACM_MODE_FIND);
 
     if (vp == NULL) {
         DEBUGMSG(("mibII/vacm_vars", "\n"));
@@ -764,6 +764,8 @@ write_vacmGroupName(int action,
     struct vacm_groupEntry *geptr;
     static int      resetOnFail;
 
+    vacm_tablesChanged();
+
     if (action == RESERVE1) {
         resetOnFail = 0;
         if (var_val_type != ASN_OCTET_STR) {
@@ -852,6 +854,8 @@ write_vacmSecurityToGroupStatus(int action,
     size_t          nameLen;
     struct vacm_groupEntry *geptr;
 
+    vacm_tablesChanged();
+
     if (action == RESERVE1) {
         if (var_val_type != ASN_INTEGER) {
             return SNMP_ERR_WRONGTYPE;
@@ -1099,6 +1103,8 @@ write_vacmAccessStatus(int action,
     size_t          groupNameLen, contextPrefixLen;
     struct vacm_accessEntry *aptr = NULL;
 
+    vacm_tablesChanged();
+
     if (action == RESERVE1) {
         if (var_val_type != ASN_INTEGER) {
             return SNMP_ERR_WRONGTYPE;
@@ -1301,6 +1307,8 @@ write_vacmAccessContextMatch(int action,
     static long     long_ret;
     struct vacm_accessEntry *aptr;
 
+    vacm_tablesChanged();
+
     if (var_val_type != ASN_INTEGER) {
         DEBUGMSGTL(("mibII/vacm_vars",
                     "write to vacmAccessContextMatch not ASN_INTEGER\n"));
@@ -1339,6 +1347,8 @@ write_vacmAccessReadViewName(int action,
     struct vacm_accessEntry *aptr = NULL;
     static int      resetOnFail;
 
+    vacm_tablesChanged();
+
     if (action == RESERVE1) {
         resetOnFail = 0;
         if (var_val_type != ASN_OCTET_STR) {
@@ -1383,6 +1393,8 @@ write_vacmAccessWriteViewName(int action,
     struct vacm_accessEntry *aptr = NULL;
     static int      resetOnFail;
 
+    vacm_tablesChanged();
+
     if (action == RESERVE1) {
         resetOnFail = 0;
         if (var_val_type != ASN_OCTET_STR) {
@@ -1427,6 +1439,8 @@ write_vacmAccessNotifyViewName(int action,
     struct vacm_accessEntry *aptr = NULL;
     static int      resetOnFail;
 
+    vacm_tablesChanged();
+
     if (action == RESERVE1) {
         resetOnFail = 0;
         if (var_val_type != ASN_OCTET_STR) {
@@ -1557,6 +1571,8 @@ write_vacmViewStatus(int action,
     struct vacm_viewEntry *vptr;
     int             rc = 0;
 
+    vacm_tablesChanged();
+
     if (action == RESERVE1) {
         if (var_val_type != ASN_INTEGER) {
             return SNMP_ERR_WRONGTYPE;
@@ -1756,6 +1772,8 @@ write_vacmViewMask(int action,
     static long     length;
     struct vacm_viewEntry *vptr = NULL;
 
+    vacm_tablesChanged();
+
     if (action == RESERVE1) {
         if (var_val_type != ASN_OCTET_STR) {
             return SNMP_ERR_WRONGTYPE;
@@ -1792,6 +1810,8 @@ write_vacmViewType(int action,
     static long     oldValue;
     struct vacm_viewEntry *vptr = NULL;
 
+    vacm_tablesChanged();
+
     if (action == RESERVE1) {
         if (var_val_type != ASN_INTEGER) {
             return SNMP_ERR_WRONGTYPE;
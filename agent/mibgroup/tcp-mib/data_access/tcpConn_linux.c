@@ -12,6 +12,10 @@
 #include "tcp-mib/tcpConnectionTable/tcpConnectionTable_constants.h"
 #include "tcp-mib/data_access/tcpConn_private.h"
 #include "mibgroup/util_funcs/get_pid_from_inode.h"
+#include "mibgroup/util_funcs/inet_diag.h"
+
+#include <netinet/tcp.h>
+
 static int
 linux_states[12] = { 1, 5, 3, 4, 6, 7, 11, 1, 8, 9, 2, 10 };
 
@@ -19,6 +23,9 @@ static int _load4(netsnmp_container *container, u_int flags);
 #if defined (NETSNMP_ENABLE_IPV6)
 static int _load6(netsnmp_container *container, u_int flags);
 #endif
+#ifdef HAVE_LINUX_INET_DIAG_H
+static int _load_netlink(netsnmp_container *container, u_int flags);
+#endif
 
 /*
  * initialize arch specific storage
@@ -92,6 +99,21 @@ netsnmp_arch_tcpconn_container_load(netsnmp_container *container,
         return -1;
     }
 
+#ifdef HAVE_LINUX_INET_DIAG_H
+    if (load_flags & NETSNMP_ACCESS_TCPCONN_LOAD_NETLINK) {
+        size_t          size = CONTAINER_SIZE(container);
+
+        /*
+         * fall back to /proc if the kernel would not answer at all
+         */
+        rc = _load_netlink(container, load_flags);
+        if ((0 == rc) || (CONTAINER_SIZE(container) != size))
+            return rc;
+        DEBUGMSGTL(("access:tcpconn:container",
+                    "sock_diag failed, reading /proc\n"));
+    }
+#endif
+
     rc = _load4(container, load_flags);
 
 #if defined (NETSNMP_ENABLE_IPV6)
@@ -110,6 +132,86 @@ netsnmp_arch_tcpconn_container_load(netsnmp_container *container,
     return rc;
 }
 
+#ifdef HAVE_LINUX_INET_DIAG_H
+/**
+ * @internal
+ * add one socket record from the sock_diag dump
+ */
+static int
+_add_diag_entry(const struct inet_diag_msg *r, void *ctx)
+{
+    netsnmp_container     *container = (netsnmp_container *) ctx;
+    netsnmp_tcpconn_entry *entry;
+    u_char                 addr_len;
+
+    if (AF_INET == r->idiag_family)
+        addr_len = 4;
+    else if (AF_INET6 == r->idiag_family)
+        addr_len = 16;
+    else
+        return 0;
+
+    entry = netsnmp_access_tcpconn_entry_create();
+    if (NULL == entry)
+        return -3;
+
+    entry->loc_port = ntohs(r->id.idiag_sport);
+    entry->rmt_port = ntohs(r->id.idiag_dport);
+    entry->tcpConnState = (r->idiag_state & 0xf) < 12 ?
+        linux_states[r->idiag_state & 0xf] : 2;
+    entry->pid = netsnmp_get_pid_from_inode(r->idiag_inode);
+
+    /** already in network order, unlike the /proc text */
+    memcpy(entry->loc_addr, r->id.idiag_src, addr_len);
+    entry->loc_addr_len = addr_len;
+    memcpy(entry->rmt_addr, r->id.idiag_dst, addr_len);
+    entry->rmt_addr_len = addr_len;
+
+    entry->arbitrary_index = CONTAINER_SIZE(container) + 1;
+    if (CONTAINER_INSERT(container, entry) < 0)
+        netsnmp_access_tcpconn_entry_free(entry);
+
+    return 0;
+}
+
+/**
+ * load the connections with a sock_diag netlink dump. The listen
+ * filters are passed on to the kernel, which then only sends the
+ * sockets we want.
+ *
+ * @retval  0 no errors
+ * @retval !0 errors
+ */
+static int
+_load_netlink(netsnmp_container *container, u_int load_flags)
+{
+    u_int           states = NETSNMP_INET_DIAG_ALL_STATES;
+    int             rc;
+
+    if (load_flags & NETSNMP_ACCESS_TCPCONN_LOAD_NOLISTEN)
+        states &= ~(1 << TCP_LISTEN);
+    else if (load_flags & NETSNMP_ACCESS_TCPCONN_LOAD_ONLYLISTEN)
+        states = 1 << TCP_LISTEN;
+
+    rc = netsnmp_inet_diag_dump(AF_INET, IPPROTO_TCP, states,
+                                _add_diag_entry, container);
+#if defined (NETSNMP_ENABLE_IPV6)
+    if((0 != rc) || (load_flags & NETSNMP_ACCESS_TCPCONN_LOAD_IPV4_ONLY))
+        return rc;
+
+    /*
+     * ipv6 might not be available, so ignore -1 (dump failed)
+     */
+    rc = netsnmp_inet_diag_dump(AF_INET6, IPPROTO_TCP, states,
+                                _add_diag_entry, container);
+    if (-1 == rc)
+        rc = 0;
+#endif
+
+    return rc;
+}
+#endif /* HAVE_LINUX_INET_DIAG_H */
+
 /**
  *
  * @retval  0 no errors
@@ -40,6 +40,22 @@
  * OID: .1.3.6.1.2.1.6.20, length: 8
  */
 
+/*
+ * extra load flags, i.e. whether to read the sockets with sock_diag
+ */
+static u_int    _load_flags;
+
+static void
+_parse_tcpListenerTable_netlink(const char *token, char *line)
+{
+    int             netlink = netsnmp_ds_parse_boolean(line);
+
+    if (1 == netlink)
+        _load_flags |= NETSNMP_ACCESS_TCPCONN_LOAD_NETLINK;
+    else if (0 == netlink)
+        _load_flags &= ~NETSNMP_ACCESS_TCPCONN_LOAD_NETLINK;
+}
+
 /**
  * initialization for tcpListenerTable data access
  *
@@ -62,6 +78,9 @@ tcpListenerTable_init_data(tcpListenerTable_registration *
     /*
      * TODO:303:o: Initialize tcpListenerTable data.
      */
+    snmpd_register_config_handler("tcpListenerTable_netlink",
+                                  _parse_tcpListenerTable_netlink, NULL,
+                                  "yes|no");
 
     return MFD_SUCCESS;
 }                               /* tcpListenerTable_init_data */
@@ -238,7 +257,8 @@ tcpListenerTable_container_load(netsnmp_container *container)
 {
     netsnmp_container *raw_data =
         netsnmp_access_tcpconn_container_load(NULL,
-                                              NETSNMP_ACCESS_TCPCONN_LOAD_ONLYLISTEN);
+                                              NETSNMP_ACCESS_TCPCONN_LOAD_ONLYLISTEN |
+                                              _load_flags);
 
     DEBUGMSGTL(("verbose:tcpListenerTable:tcpListenerTable_container_load",
                 "called\n"));
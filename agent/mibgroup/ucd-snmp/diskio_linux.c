@@ -9,6 +9,8 @@
 #endif
 #include <math.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
 #include "diskio_linux.h"
 #include "diskio.h"
 #include "util_funcs/header_simple_table.h"
@@ -19,46 +21,53 @@ static void     diskio_parse_config_disks(const char *token, char *cptr);
 static int      diskio_pre_update_config(int, int, void *, void *);
 static void     diskio_free_config(void);
 
-#define DISK_INCR 2
+#define DISK_INCR 16
 
 typedef struct linux_diskio {
     int             major;
     int             minor;
-    unsigned long   blocks;
+    unsigned long long blocks;
     char            name[256];
-    unsigned long   rio;
-    unsigned long   rmerge;
-    unsigned long   rsect;
-    unsigned long   ruse;
-    unsigned long   wio;
-    unsigned long   wmerge;
-    unsigned long   wsect;
-    unsigned long   wuse;
-    unsigned long   running;
-    unsigned long   use;
-    unsigned long   aveq;
+    unsigned long long rio;
+    unsigned long long rmerge;
+    unsigned long long rsect;
+    unsigned long long ruse;
+    unsigned long long wio;
+    unsigned long long wmerge;
+    unsigned long long wsect;
+    unsigned long long wuse;
+    unsigned long long running;
+    unsigned long long use;
+    unsigned long long aveq;
 } linux_diskio;
 
-/* disk load averages */
-typedef struct linux_diskio_la {
-    unsigned long   use_prev;
-    double          la1, la5, la15;
-} linux_diskio_la;
-
 typedef struct linux_diskio_header {
     linux_diskio   *indices;
     int             length;
     int             alloc;
 } linux_diskio_header;
 
+/*
+ * disk load averages, one array per value so that they are updated for
+ * all the devices in one go.  dev remembers which device a slot belongs
+ * to, so that the averages are restarted when the list of devices
+ * changes.
+ */
 typedef struct linux_diskio_la_header {
-    linux_diskio_la *indices;
+    unsigned long long *dev;
+    unsigned long long *use_prev;
+    double         *busy;
+    double         *la1, *la5, *la15;
     int             length;
+    int             alloc;
 } linux_diskio_la_header;
 
 static linux_diskio_header head;
 static linux_diskio_la_header la_head;
 
+#define DISKIO_DEV(major, minor) \
+    (((unsigned long long)(unsigned)(major) << 32) | (unsigned)(minor))
+
 struct diskiopart {
     char            syspath[STRMAX];    /* full stat path */
     char            name[STRMAX];       /* name as provided */
@@ -71,6 +80,17 @@ static int      numdisks;
 static int      maxdisks;
 static struct diskiopart *disks;
 
+/*
+ * the configured disks sorted by device number, to pick them out of
+ * /proc/diskstats
+ */
+struct diskio_lookup {
+    unsigned long long dev;
+    int             disk;
+};
+static struct diskio_lookup *lookup;
+static int      lookup_len = -1;
+
 /* to do: make sure diskio_free_config() gets invoked upon SIGHUP. */
 static int
 diskio_pre_update_config(int major, int minor, void *serverarg,
@@ -97,15 +117,12 @@ diskio_free_config(void)
     netsnmp_ds_set_boolean(NETSNMP_DS_APPLICATION_ID,
                            NETSNMP_DS_AGENT_DISKIO_NO_MD, 0);
 
-    if (la_head.length) {
-        /*
-         * reset any usage stats, we may get different list of devices from
-         * config
-         */
-        free(la_head.indices);
-        la_head.length = 0;
-        la_head.indices = NULL;
-    }
+    /*
+     * reset any usage stats, we may get different list of devices from
+     * config
+     */
+    la_head.length = 0;
+    lookup_len = -1;
     if (numdisks > 0) {
         head.length = 0;
         numdisks = 0;
@@ -269,54 +286,270 @@ void init_diskio_linux(void)
 
 }
 
+/*
+ * read a whole /proc or /sys file into a buffer kept from one call to
+ * the next.
+ *
+ * @return the contents, NUL terminated, or NULL
+ */
+static char *
+diskio_read_file(const char *path)
+{
+    static char    *buf;
+    static size_t   size;
+    size_t          len = 0;
+    ssize_t         rc;
+    char           *newbuf;
+    int             fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    for (;;) {
+        if (len + 1 >= size) {
+            newbuf = realloc(buf, size ? 2 * size : 16384);
+            if (!newbuf) {
+                close(fd);
+                return NULL;
+            }
+            buf = newbuf;
+            size = size ? 2 * size : 16384;
+        }
+        rc = read(fd, buf + len, size - len - 1);
+        if (rc < 0 && errno == EINTR)
+            continue;
+        if (rc < 0) {
+            close(fd);
+            return NULL;
+        }
+        if (rc == 0)
+            break;
+        len += rc;
+    }
+    close(fd);
+    buf[len] = '\0';
+    return buf;
+}
+
+static unsigned long long
+diskio_parse_ull(char **cpp, int *found)
+{
+    char               *cp = *cpp;
+    unsigned long long  val = 0;
+
+    while (*cp == ' ' || *cp == '\t')
+        cp++;
+    if (*cp < '0' || *cp > '9') {
+        *cpp = cp;
+        return 0;
+    }
+    while (*cp >= '0' && *cp <= '9')
+        val = val * 10 + (*cp++ - '0');
+    *cpp = cp;
+    ++*found;
+    return val;
+}
+
+/*
+ * parse the statistics of one device: either the 11 (or more) fields of
+ * a disk, or the 4 fields of a partition on kernels before 2.6.25.
+ *
+ * @return the number of fields found
+ */
+static int
+diskio_parse_stats(char **cpp, linux_diskio *pTemp)
+{
+    int             n = 0;
+
+    pTemp->rio = diskio_parse_ull(cpp, &n);
+    pTemp->rmerge = diskio_parse_ull(cpp, &n);
+    pTemp->rsect = diskio_parse_ull(cpp, &n);
+    pTemp->ruse = diskio_parse_ull(cpp, &n);
+    if (n == 4) {
+        pTemp->wio = diskio_parse_ull(cpp, &n);
+        pTemp->wmerge = diskio_parse_ull(cpp, &n);
+        pTemp->wsect = diskio_parse_ull(cpp, &n);
+        pTemp->wuse = diskio_parse_ull(cpp, &n);
+        pTemp->running = diskio_parse_ull(cpp, &n);
+        pTemp->use = diskio_parse_ull(cpp, &n);
+        pTemp->aveq = diskio_parse_ull(cpp, &n);
+    }
+    if (n == 4) {
+        /* rio rsect wio wsect */
+        pTemp->wsect = pTemp->ruse;
+        pTemp->wio = pTemp->rsect;
+        pTemp->rsect = pTemp->rmerge;
+        pTemp->rmerge = pTemp->ruse = 0;
+        pTemp->wmerge = pTemp->wuse = 0;
+        pTemp->running = pTemp->use = pTemp->aveq = 0;
+    }
+    return n;
+}
+
+/* make room for at least count entries in head */
+static int
+diskio_reserve(int count)
+{
+    linux_diskio   *newindices;
+    int             alloc = head.alloc;
+
+    if (count <= alloc)
+        return 0;
+    while (alloc < count)
+        alloc += DISK_INCR + alloc;
+    newindices = realloc(head.indices, alloc * sizeof(linux_diskio));
+    if (!newindices)
+        return -1;
+    head.indices = newindices;
+    head.alloc = alloc;
+    return 0;
+}
+
+/* make room for one more entry in head */
+static linux_diskio *
+diskio_next_entry(void)
+{
+    if (diskio_reserve(head.length + 1) < 0)
+        return NULL;
+    return &head.indices[head.length];
+}
+
 static int
 get_sysfs_stats(void)
 {
     int             i;
-    char            buffer[1024];
+    char           *buffer;
 
     head.length = 0;
 
     for (i = 0; i < numdisks; i++) {
-        FILE *f = fopen(disks[i].syspath, "r");
-
-        if (f == NULL) {
-            DEBUGMSGTL(("ucd-snmp/diskio", "Can't open %s, skipping",
-                        disks[i].syspath));
-            continue;
-        }
+        linux_diskio   *pTemp;
 
-        if (fgets(buffer, sizeof(buffer), f) == NULL) {
+        buffer = diskio_read_file(disks[i].syspath);
+        if (buffer == NULL) {
             DEBUGMSGTL(("ucd-snmp/diskio", "Can't read %s, skipping",
                         disks[i].syspath));
-            fclose(f);
             continue;
         }
 
-        linux_diskio   *pTemp;
-        if (head.length == head.alloc) {
-            head.alloc += DISK_INCR;
-            head.indices = realloc(head.indices,
-                                   head.alloc * sizeof(linux_diskio));
-        }
-        pTemp = &head.indices[head.length];
+        pTemp = diskio_next_entry();
+        if (!pTemp)
+            break;
         pTemp->major = disks[i].major;
         pTemp->minor = disks[i].minor;
+        pTemp->blocks = 0;
         strlcpy(pTemp->name, disks[i].shortname, sizeof(pTemp->name) - 1);
-        if (sscanf (buffer,
-                    "%*[ \n\t]%lu%*[ \n\t]%lu%*[ \n\t]%lu%*[ \n\t]%lu%*[ \n\t]%lu%*[ \n\t]%lu%*[ \n\t]%lu%*[ \n\t]%lu%*[ \n\t]%lu%*[ \n\t]%lu%*[ \n\t]%lu\n",
-                    &pTemp->rio, &pTemp->rmerge, &pTemp->rsect, &pTemp->ruse,
-                    &pTemp->wio, &pTemp->wmerge, &pTemp->wsect, &pTemp->wuse,
-                    &pTemp->running, &pTemp->use, &pTemp->aveq) != 11)
-            sscanf(buffer,
-                   "%*[ \n\t]%lu%*[ \n\t]%lu%*[ \n\t]%lu%*[ \n\t]%lu\n",
-                   &pTemp->rio, &pTemp->rsect, &pTemp->wio, &pTemp->wsect);
+        diskio_parse_stats(&buffer, pTemp);
         head.length++;
-        fclose(f);
     }
     return 0;
 }
 
+static int
+diskio_lookup_compare(const void *a, const void *b)
+{
+    const struct diskio_lookup *l = a, *r = b;
+
+    return l->dev < r->dev ? -1 : l->dev > r->dev;
+}
+
+/* (re)build the sorted list of the configured disks */
+static int
+diskio_build_lookup(void)
+{
+    struct diskio_lookup *newlookup;
+    int             i;
+
+    if (lookup_len == numdisks)
+        return 0;
+    newlookup = realloc(lookup, (numdisks ? numdisks : 1) *
+                        sizeof(struct diskio_lookup));
+    if (!newlookup)
+        return -1;
+    lookup = newlookup;
+    for (i = 0; i < numdisks; i++) {
+        lookup[i].dev = DISKIO_DEV(disks[i].major, disks[i].minor);
+        lookup[i].disk = i;
+    }
+    qsort(lookup, numdisks, sizeof(struct diskio_lookup),
+          diskio_lookup_compare);
+    lookup_len = numdisks;
+    return 0;
+}
+
+/*
+ * the configured disks: pick them out of a single read of
+ * /proc/diskstats, in the order they were configured in.
+ *
+ * @return TRUE, or FALSE if /proc/diskstats could not be read
+ */
+static int
+read_proc_diskstats_configured(void)
+{
+    struct diskio_lookup key, *found;
+    linux_diskio   *pTemp;
+    char           *cp;
+    int             i, n, major, minor;
+
+    if (diskio_build_lookup() < 0)
+        return FALSE;
+    cp = diskio_read_file("/proc/diskstats");
+    if (!cp)
+        return FALSE;
+
+    /* one slot per configured disk, unused ones are dropped below */
+    if (diskio_reserve(numdisks) < 0)
+        return FALSE;
+    for (i = 0; i < numdisks; i++)
+        head.indices[i].name[0] = '\0';
+    head.length = 0;
+
+    while (*cp) {
+        n = 0;
+        major = diskio_parse_ull(&cp, &n);
+        minor = diskio_parse_ull(&cp, &n);
+        key.dev = DISKIO_DEV(major, minor);
+        found = n == 2 ? bsearch(&key, lookup, numdisks,
+                                 sizeof(struct diskio_lookup),
+                                 diskio_lookup_compare) : NULL;
+        if (found) {
+            /* the same device may be configured more than once */
+            while (found > lookup && found[-1].dev == key.dev)
+                found--;
+            pTemp = &head.indices[found->disk];
+            pTemp->major = major;
+            pTemp->minor = minor;
+            pTemp->blocks = 0;
+            while (*cp == ' ' || *cp == '\t')
+                cp++;
+            while (*cp && *cp != ' ' && *cp != '\t' && *cp != '\n')
+                cp++;
+            if (diskio_parse_stats(&cp, pTemp) >= 4) {
+                for (; found < lookup + numdisks && found->dev == key.dev;
+                     found++) {
+                    if (&head.indices[found->disk] != pTemp)
+                        head.indices[found->disk] = *pTemp;
+                    strlcpy(head.indices[found->disk].name,
+                            disks[found->disk].shortname,
+                            sizeof(pTemp->name) - 1);
+                }
+            }
+        }
+        while (*cp && *cp != '\n')
+            cp++;
+        if (*cp)
+            cp++;
+    }
+
+    for (i = 0; i < numdisks; i++)
+        if (head.indices[i].name[0]) {
+            if (i != head.length)
+                head.indices[head.length] = head.indices[i];
+            head.length++;
+        }
+    return TRUE;
+}
+
 static int
 is_excluded(const char *name)
 {
@@ -363,15 +596,12 @@ static int read_proc_partitions(void)
     while (!feof(parts)) {
         linux_diskio   *pTemp;
 
-        if (head.length == head.alloc) {
-            head.alloc += DISK_INCR;
-            head.indices = realloc(head.indices,
-                                   head.alloc * sizeof(linux_diskio));
-        }
-        pTemp = &head.indices[head.length];
+        pTemp = diskio_next_entry();
+        if (!pTemp)
+            break;
 
         rc = fscanf(parts,
-                    "%d %d %lu %255s %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu\n",
+                    "%d %d %llu %255s %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu\n",
                     &pTemp->major, &pTemp->minor, &pTemp->blocks,
                     pTemp->name, &pTemp->rio, &pTemp->rmerge,
                     &pTemp->rsect, &pTemp->ruse, &pTemp->wio,
@@ -392,49 +622,56 @@ static int read_proc_partitions(void)
     return TRUE;
 }
 
+/*
+ * all the devices, from a single read of /proc/diskstats
+ */
 static int read_proc_diskstats(void)
 {
-    FILE           *parts;
-    char            buffer[1024];
+    char           *cp, *name;
+    size_t          name_len;
+    int             n;
 
     /*
      * /proc/diskstats was introduced by Linux kernel commit 3422161186a4
      * ("[PATCH] Aggregated disk statistics") # v2.6.12.
      */
-    parts = fopen("/proc/diskstats", "r");
-    if (!parts)
+    cp = diskio_read_file("/proc/diskstats");
+    if (!cp)
         return FALSE;
 
-    while (fgets(buffer, sizeof(buffer), parts)) {
+    while (*cp) {
         linux_diskio *pTemp;
 
-        if (head.length == head.alloc) {
-            head.alloc += DISK_INCR;
-            head.indices = realloc(head.indices,
-                                   head.alloc * sizeof(linux_diskio));
-        }
-        pTemp = &head.indices[head.length];
-        sscanf(buffer, "%d %d", &pTemp->major, &pTemp->minor);
-        if (sscanf(buffer,
-                   "%d %d %s %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu\n",
-                   &pTemp->major, &pTemp->minor, pTemp->name, &pTemp->rio,
-                   &pTemp->rmerge, &pTemp->rsect, &pTemp->ruse, &pTemp->wio,
-                   &pTemp->wmerge, &pTemp->wsect, &pTemp->wuse,
-                   &pTemp->running, &pTemp->use, &pTemp->aveq) != 14 &&
-            sscanf(buffer, "%d %d %s %lu %lu %lu %lu\n", &pTemp->major,
-                   &pTemp->minor, pTemp->name, &pTemp->rio,
-                   &pTemp->rsect, &pTemp->wio, &pTemp->wsect) != 7) {
-            fclose(parts);
+        pTemp = diskio_next_entry();
+        if (!pTemp)
+            break;
+        n = 0;
+        pTemp->major = diskio_parse_ull(&cp, &n);
+        pTemp->minor = diskio_parse_ull(&cp, &n);
+        pTemp->blocks = 0;
+        while (*cp == ' ' || *cp == '\t')
+            cp++;
+        name = cp;
+        while (*cp && *cp != ' ' && *cp != '\t' && *cp != '\n')
+            cp++;
+        name_len = cp - name;
+        if (name_len >= sizeof(pTemp->name))
+            name_len = sizeof(pTemp->name) - 1;
+        memcpy(pTemp->name, name, name_len);
+        pTemp->name[name_len] = '\0';
+        if (n != 2 || !name_len || diskio_parse_stats(&cp, pTemp) < 4) {
             snmp_log(LOG_ERR,
                      "diskio.c: failed to parse /proc/diskstats\n");
             return FALSE;
         }
+        while (*cp && *cp != '\n')
+            cp++;
+        if (*cp)
+            cp++;
         if (!is_excluded(pTemp->name))
             head.length++;
     }
 
-    fclose(parts);
-
     return TRUE;
 }
 
@@ -449,20 +686,16 @@ diskio_getstats(void)
         return 0;
     }
 
-    if (!head.indices) {
-        head.alloc = DISK_INCR;
-        head.indices = malloc(head.alloc * sizeof(linux_diskio));
-    }
     head.length = 0;
 
-    memset(head.indices, 0, head.alloc * sizeof(linux_diskio));
-
     if (numdisks > 0) {
         /*
-         * 'diskio' configuration is used - go through the whitelist only and
-         * read /sys/dev/block/xxx
+         * 'diskio' configuration is used - go through the whitelist only,
+         * and only read /sys/dev/block/xxx if /proc/diskstats is missing
          */
         diskio_set_cache_time(now);
+        if (read_proc_diskstats_configured())
+            return 0;
         return get_sysfs_stats();
     }
     /* 'diskio' configuration is not used - report all devices */
@@ -477,62 +710,86 @@ diskio_getstats(void)
     return 0;
 }
 
+/* make room for the load averages of all the devices in head */
+static int
+devla_resize(void)
+{
+    int             alloc = la_head.alloc;
+
+    if (head.length <= alloc)
+        return 0;
+    while (alloc < head.length)
+        alloc += DISK_INCR + alloc;
+#define DEVLA_GROW(field) do { \
+        void *p = realloc(la_head.field, alloc * sizeof(*la_head.field)); \
+        if (!p) \
+            return -1; \
+        la_head.field = p; \
+    } while (0)
+    DEVLA_GROW(dev);
+    DEVLA_GROW(use_prev);
+    DEVLA_GROW(busy);
+    DEVLA_GROW(la1);
+    DEVLA_GROW(la5);
+    DEVLA_GROW(la15);
+#undef DEVLA_GROW
+    la_head.alloc = alloc;
+    return 0;
+}
+
 void
 devla_getstats(unsigned int regno, void *dummy)
 {
 
     static double   expon1, expon5, expon15;
-    double          busy_time, busy_percent;
-    int             idx;
+    unsigned long long dev;
+    double         *busy, *la1, *la5, *la15;
+    int             idx, n;
 
     if (diskio_getstats() == 1) {
         ERROR_MSG("can't do diskio_getstats()\n");
         return;
     }
 
-    if (!la_head.length) {
-        la_head.indices = malloc(head.length * sizeof(linux_diskio_la));
-        for (idx = 0; idx < head.length; idx++) {
-            la_head.indices[idx].la1 = la_head.indices[idx].la5 =
-                la_head.indices[idx].la15 = 0.;
-            la_head.indices[idx].use_prev = head.indices[idx].use;
-        }
-        la_head.length = head.length;
+    if (!expon1) {
         expon1 = exp(-(((double) DISKIO_SAMPLE_INTERVAL) / ((double) 60)));
         expon5 =
             exp(-(((double) DISKIO_SAMPLE_INTERVAL) / ((double) 300)));
         expon15 =
             exp(-(((double) DISKIO_SAMPLE_INTERVAL) / ((double) 900)));
-    } else if (head.length - la_head.length) {
-        la_head.indices = realloc(la_head.indices,
-                                  head.length * sizeof(linux_diskio_la));
-        for (idx = la_head.length; idx < head.length; idx++) {
-            la_head.indices[idx].la1 = la_head.indices[idx].la5 =
-                la_head.indices[idx].la15 = 0.;
-            la_head.indices[idx].use_prev = head.indices[idx].use;
-        }
-        la_head.length = head.length;
+    }
+    if (devla_resize() < 0) {
+        la_head.length = 0;
+        return;
     }
 
-    for (idx = 0; idx < head.length; idx++) {
-        busy_time = head.indices[idx].use - la_head.indices[idx].use_prev;
-        busy_percent =
-            busy_time * 100. / ((double) DISKIO_SAMPLE_INTERVAL) / 1000.;
-        la_head.indices[idx].la1 =
-            la_head.indices[idx].la1 * expon1 + busy_percent * (1. -
-                                                                expon1);
-        la_head.indices[idx].la5 =
-            la_head.indices[idx].la5 * expon5 + busy_percent * (1. -
-                                                                expon5);
-        la_head.indices[idx].la15 =
-            la_head.indices[idx].la15 * expon15 + busy_percent * (1. -
-                                                                  expon15);
-        /*
-         * fprintf(stderr, "(%d) update la1=%f la5=%f la15=%f\n",
-         * idx, la_head.indices[idx].la1, la_head.indices[idx].la5,
-         * la_head.indices[idx].la15);
-         */
-        la_head.indices[idx].use_prev = head.indices[idx].use;
+    /*
+     * busy percentage of each device since the last sample; a device
+     * that is new in its slot starts from zero
+     */
+    n = head.length;
+    for (idx = 0; idx < n; idx++) {
+        dev = DISKIO_DEV(head.indices[idx].major, head.indices[idx].minor);
+        if (idx >= la_head.length || la_head.dev[idx] != dev) {
+            la_head.dev[idx] = dev;
+            la_head.use_prev[idx] = head.indices[idx].use;
+            la_head.la1[idx] = la_head.la5[idx] = la_head.la15[idx] = 0.;
+        }
+        la_head.busy[idx] = (double) (head.indices[idx].use -
+                                      la_head.use_prev[idx]) *
+            (100. / ((double) DISKIO_SAMPLE_INTERVAL) / 1000.);
+        la_head.use_prev[idx] = head.indices[idx].use;
+    }
+    la_head.length = n;
+
+    busy = la_head.busy;
+    la1 = la_head.la1;
+    la5 = la_head.la5;
+    la15 = la_head.la15;
+    for (idx = 0; idx < n; idx++) {
+        la1[idx] = la1[idx] * expon1 + busy[idx] * (1. - expon1);
+        la5[idx] = la5[idx] * expon5 + busy[idx] * (1. - expon5);
+        la15[idx] = la15[idx] * expon15 + busy[idx] * (1. - expon15);
     }
 }
 
@@ -545,6 +802,7 @@ var_diskio(struct variable *vp,
     unsigned int    indx;
     static unsigned long long_ret;
     static struct counter64 c64_ret;
+    unsigned long long c64;
 
     if (diskio_getstats() == 1) {
         return NULL;
@@ -581,40 +839,38 @@ var_diskio(struct variable *vp,
         return (u_char *) & long_ret;
     case DISKIO_LA1:
         if (la_head.length > indx)
-            long_ret = la_head.indices[indx].la1;
+            long_ret = la_head.la1[indx];
         else
             long_ret = 0;       /* we don't have the load yet */
         return (u_char *) & long_ret;
     case DISKIO_LA5:
         if (la_head.length > indx)
-            long_ret = la_head.indices[indx].la5;
+            long_ret = la_head.la5[indx];
         else
             long_ret = 0;       /* we don't have the load yet */
         return (u_char *) & long_ret;
     case DISKIO_LA15:
         if (la_head.length > indx)
-            long_ret = la_head.indices[indx].la15;
+            long_ret = la_head.la15[indx];
         else
             long_ret = 0;
         return (u_char *) & long_ret;
     case DISKIO_BUSYTIME:
-        *var_len = sizeof(struct counter64);
-        c64_ret.low = head.indices[indx].use * 1000 & 0xffffffff;
-        c64_ret.high = head.indices[indx].use * 1000 >> 32;
-        return (u_char *) & c64_ret;
+        c64 = head.indices[indx].use * 1000;
+        break;
     case DISKIO_NREADX:
-        *var_len = sizeof(struct counter64);
-        c64_ret.low = head.indices[indx].rsect * 512 & 0xffffffff;
-        c64_ret.high = head.indices[indx].rsect >> (32 - 9);
-        return (u_char *) & c64_ret;
+        c64 = head.indices[indx].rsect * 512;
+        break;
     case DISKIO_NWRITTENX:
-        *var_len = sizeof(struct counter64);
-        c64_ret.low = head.indices[indx].wsect * 512 & 0xffffffff;
-        c64_ret.high = head.indices[indx].wsect >> (32 - 9);
-        return (u_char *) & c64_ret;
+        c64 = head.indices[indx].wsect * 512;
+        break;
     default:
         snmp_log(LOG_ERR, "don't know how to handle %d request\n",
                  vp->magic);
+        return NULL;
     }
-    return NULL;
+    *var_len = sizeof(struct counter64);
+    c64_ret.low = c64 & 0xffffffff;
+    c64_ret.high = c64 >> 32;
+    return (u_char *) & c64_ret;
 }
@@ -11,6 +11,7 @@
 
 #define DEFAULTMINIMUMSWAP 16000        /* kilobytes */
 static int minimum_swap;
+static netsnmp_cache *memory_values;    /* answers repeated polls */
 
 /** Initializes the memory module */
 void
@@ -19,14 +20,28 @@ init_memory(void)
     const oid      memory_oid[] = { 1, 3, 6, 1, 4, 1, 2021, 4 };
     const oid      memSwapError_oid[]  = { 1, 3, 6, 1, 4, 1, 2021, 4, 100 };
     const oid      memSwapErrMsg_oid[] = { 1, 3, 6, 1, 4, 1, 2021, 4, 101 };
+    netsnmp_handler_registration *reginfo;
+    netsnmp_mib_handler *handler;
 
     DEBUGMSGTL(("memory", "Initializing\n"));
 
-    netsnmp_register_scalar_group(
-        netsnmp_create_handler_registration("memory", handle_memory,
+    reginfo = netsnmp_create_handler_registration("memory", handle_memory,
                                  memory_oid, OID_LENGTH(memory_oid),
-                                             HANDLER_CAN_RONLY),
-                                 1, 27);
+                                             HANDLER_CAN_RONLY);
+    if (netsnmp_register_scalar_group(reginfo, 1, 27) == MIB_REGISTERED_OK) {
+        /*
+         * The memory scalars are polled often, and each value needs
+         *   the same (cached) memory stats, so keep the values themselves
+         *   for the default cache timeout too.
+         */
+        handler = netsnmp_get_value_cache_handler(0, memory_oid,
+                                                  OID_LENGTH(memory_oid));
+        if (handler &&
+            netsnmp_inject_handler(reginfo, handler) == SNMPERR_SUCCESS)
+            memory_values = (netsnmp_cache *)handler->myvoid;
+        else
+            netsnmp_handler_free(handler);
+    }
     netsnmp_register_scalar(
         netsnmp_create_handler_registration("memSwapError", handle_memory,
                            memSwapError_oid, OID_LENGTH(memSwapError_oid),
@@ -44,12 +59,14 @@ void
 memory_parse_config(const char *token, char *cptr)
 {
     minimum_swap = atoi(cptr);
+    netsnmp_cache_invalidate(memory_values);
 }
 
 void
 memory_free_config(void)
 {
     minimum_swap = DEFAULTMINIMUMSWAP;
+    netsnmp_cache_invalidate(memory_values);
 }
 
 int
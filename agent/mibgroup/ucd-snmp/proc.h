@@ -5,6 +5,10 @@
 #define _MIBGROUP_PROC_H
 
 config_require(util_funcs);
+#if defined(linux)
+/* count processes in the snapshot shared with hrSWRunTable */
+config_require(host/data_access/swrun);
+#endif
 
      void            init_proc(void);
 
@@ -15,12 +15,14 @@
 
 #include "udp-mib/udpEndpointTable/udpEndpointTable_constants.h"
 #include "mibgroup/util_funcs/get_pid_from_inode.h"
+#include "mibgroup/util_funcs/inet_diag.h"
 #include "udp_endpoint_private.h"
 
 #include <fcntl.h>
 #include <stdint.h>
 
 netsnmp_feature_require(text_utils);
+netsnmp_feature_require(udp_endpoint_entry_create);
 netsnmp_feature_child_of(udp_endpoint_all, libnetsnmpmibs);
 netsnmp_feature_child_of(udp_endpoint_writable, udp_endpoint_all);
 
@@ -28,6 +30,9 @@ static int _load4(netsnmp_container *container, u_int flags);
 #if defined (NETSNMP_ENABLE_IPV6)
 static int _load6(netsnmp_container *container, u_int flags);
 #endif
+#ifdef HAVE_LINUX_INET_DIAG_H
+static int _load_netlink(netsnmp_container *container, u_int flags);
+#endif
 
 /*
  * initialize arch specific storage
@@ -94,6 +99,26 @@ netsnmp_arch_udp_endpoint_container_load(netsnmp_container *container,
     /* Setup the pid_from_inode table, and fill it.*/
     netsnmp_get_pid_from_inode_init();
 
+#ifdef HAVE_LINUX_INET_DIAG_H
+    if (load_flags & NETSNMP_ACCESS_UDP_ENDPOINT_LOAD_NETLINK) {
+        size_t size = CONTAINER_SIZE(container);
+
+        /*
+         * fall back to /proc if the kernel would not answer at all
+         */
+        rc = _load_netlink(container, load_flags);
+        if ((0 == rc) || (CONTAINER_SIZE(container) != size)) {
+            if (rc < 0) {
+                u_int flags = NETSNMP_ACCESS_UDP_ENDPOINT_FREE_KEEP_CONTAINER;
+                netsnmp_access_udp_endpoint_container_free(container, flags);
+            }
+            return rc;
+        }
+        DEBUGMSGTL(("access:udp_endpoint",
+                    "sock_diag failed, reading /proc\n"));
+    }
+#endif
+
     rc = _load4(container, load_flags);
     if(rc < 0) {
         u_int flags = NETSNMP_ACCESS_UDP_ENDPOINT_FREE_KEEP_CONTAINER;
@@ -246,6 +271,82 @@ _process_line_udp_ep(netsnmp_line_info *line_info, void *mem,
     return PMLP_RC_MEMORY_USED;
 }
 
+#ifdef HAVE_LINUX_INET_DIAG_H
+/**
+ * @internal
+ * add one socket record from the sock_diag dump
+ */
+static int
+_add_diag_entry(const struct inet_diag_msg *r, void *ctx)
+{
+    netsnmp_container          *container = (netsnmp_container *) ctx;
+    netsnmp_udp_endpoint_entry *ep;
+    u_char                      addr_len;
+
+    if (AF_INET == r->idiag_family)
+        addr_len = 4;
+    else if (AF_INET6 == r->idiag_family)
+        addr_len = 16;
+    else
+        return 0;
+
+    ep = netsnmp_access_udp_endpoint_entry_create();
+    if (NULL == ep)
+        return -3;
+
+    memcpy(ep->loc_addr, r->id.idiag_src, addr_len);
+    ep->loc_addr_len = addr_len;
+    ep->loc_port = ntohs(r->id.idiag_sport);
+    memcpy(ep->rmt_addr, r->id.idiag_dst, addr_len);
+    ep->rmt_addr_len = addr_len;
+    ep->rmt_port = ntohs(r->id.idiag_dport);
+    ep->state = r->idiag_state;
+
+    /*
+     * Use inode as instance value, as the /proc loader does.
+     */
+    ep->instance = r->idiag_inode;
+    ep->pid = netsnmp_get_pid_from_inode(r->idiag_inode);
+
+    ep->index = CONTAINER_SIZE(container);
+    if (CONTAINER_INSERT(container, ep) < 0)
+        netsnmp_access_udp_endpoint_entry_free(ep);
+
+    return 0;
+}
+
+/**
+ * load the endpoints with a sock_diag netlink dump
+ *
+ * @retval  0 no errors
+ * @retval !0 errors
+ */
+static int
+_load_netlink(netsnmp_container *container, u_int load_flags)
+{
+    int rc;
+
+    rc = netsnmp_inet_diag_dump(AF_INET, IPPROTO_UDP,
+                                NETSNMP_INET_DIAG_ALL_STATES,
+                                _add_diag_entry, container);
+#if defined (NETSNMP_ENABLE_IPV6)
+    if (0 != rc)
+        return rc;
+
+    /*
+     * ipv6 might not be available, so ignore -1 (dump failed)
+     */
+    rc = netsnmp_inet_diag_dump(AF_INET6, IPPROTO_UDP,
+                                NETSNMP_INET_DIAG_ALL_STATES,
+                                _add_diag_entry, container);
+    if (-1 == rc)
+        rc = 0;
+#endif
+
+    return rc;
+}
+#endif /* HAVE_LINUX_INET_DIAG_H */
+
 /**
  *
  * @retval  0 no errors
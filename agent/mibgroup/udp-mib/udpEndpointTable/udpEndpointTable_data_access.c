@@ -42,6 +42,22 @@
  * OID: .1.3.6.1.2.1.7.7, length: 8
  */
 
+/*
+ * extra load flags, i.e. whether to read the sockets with sock_diag
+ */
+static u_int    _load_flags;
+
+static void
+_parse_udpEndpointTable_netlink(const char *token, char *line)
+{
+    int             netlink = netsnmp_ds_parse_boolean(line);
+
+    if (1 == netlink)
+        _load_flags |= NETSNMP_ACCESS_UDP_ENDPOINT_LOAD_NETLINK;
+    else if (0 == netlink)
+        _load_flags &= ~NETSNMP_ACCESS_UDP_ENDPOINT_LOAD_NETLINK;
+}
+
 /**
  * initialization for udpEndpointTable data access
  *
@@ -64,6 +80,9 @@ udpEndpointTable_init_data(udpEndpointTable_registration *
     /*
      * TODO:303:o: Initialize udpEndpointTable data.
      */
+    snmpd_register_config_handler("udpEndpointTable_netlink",
+                                  _parse_udpEndpointTable_netlink, NULL,
+                                  "yes|no");
 
     return MFD_SUCCESS;
 }                               /* udpEndpointTable_init_data */
@@ -235,7 +254,7 @@ udpEndpointTable_container_load(netsnmp_container *container)
      * set the index(es) [and data, optionally] and insert into
      * the container.
      */
-    ep_c = netsnmp_access_udp_endpoint_container_load(NULL, 0);
+    ep_c = netsnmp_access_udp_endpoint_container_load(NULL, _load_flags);
     if (NULL == ep_c)
         return MFD_RESOURCE_UNAVAILABLE;
     ep_it = CONTAINER_ITERATOR(ep_c);
@@ -0,0 +1,138 @@
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+
+#include "inet_diag.h"
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#else
+#include <strings.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#ifdef HAVE_LINUX_INET_DIAG_H
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+
+/*
+ * The kernel sends as many records per datagram as fit in the buffer
+ * it is given, up to 32k on most kernels.
+ */
+#define INET_DIAG_BUF_SIZE 65536
+
+struct inet_diag_query {
+    struct nlmsghdr     nlh;
+    struct inet_diag_req_v2 req;
+};
+
+/**
+ * dump the sockets of one address family and protocol, calling cb for
+ * each of them.
+ *
+ * @retval  0 : success
+ * @retval -1 : sock_diag is unavailable, or the dump failed
+ * @retval <0 : the value returned by cb
+ */
+int
+netsnmp_inet_diag_dump(u_char family, u_char protocol, u_int states,
+                       netsnmp_inet_diag_callback *cb, void *ctx)
+{
+    struct inet_diag_query query;
+    struct sockaddr_nl nladdr;
+    struct iovec    iov;
+    struct msghdr   msg;
+    char           *buf;
+    int             fd, rc = 0, done = 0, count = 0;
+    ssize_t         len;
+
+    fd = socket(AF_NETLINK, SOCK_DGRAM, NETLINK_SOCK_DIAG);
+    if (fd < 0) {
+        DEBUGMSGTL(("inet_diag", "netlink socket: %s\n", strerror(errno)));
+        return -1;
+    }
+    buf = malloc(INET_DIAG_BUF_SIZE);
+    if (NULL == buf) {
+        close(fd);
+        return -1;
+    }
+
+    memset(&query, 0, sizeof(query));
+    query.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(query.req));
+    query.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    query.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    query.nlh.nlmsg_seq = 1;
+    query.req.sdiag_family = family;
+    query.req.sdiag_protocol = protocol;
+    query.req.idiag_states = states;
+
+    memset(&nladdr, 0, sizeof(nladdr));
+    nladdr.nl_family = AF_NETLINK;
+    if (sendto(fd, &query, query.nlh.nlmsg_len, 0,
+               (struct sockaddr *) &nladdr, sizeof(nladdr)) < 0) {
+        DEBUGMSGTL(("inet_diag", "netlink send: %s\n", strerror(errno)));
+        free(buf);
+        close(fd);
+        return -1;
+    }
+
+    while (!done && 0 == rc) {
+        struct nlmsghdr *h;
+
+        iov.iov_base = buf;
+        iov.iov_len = INET_DIAG_BUF_SIZE;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &nladdr;
+        msg.msg_namelen = sizeof(nladdr);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        len = recvmsg(fd, &msg, 0);
+        if (len < 0) {
+            if (EINTR == errno)
+                continue;
+            DEBUGMSGTL(("inet_diag", "netlink recv: %s\n", strerror(errno)));
+            rc = -1;
+            break;
+        }
+        if (0 == len || (msg.msg_flags & MSG_TRUNC)) {
+            DEBUGMSGTL(("inet_diag", "netlink recv: short read\n"));
+            rc = -1;
+            break;
+        }
+
+        for (h = (struct nlmsghdr *) buf; NLMSG_OK(h, len);
+             h = NLMSG_NEXT(h, len)) {
+            if (NLMSG_DONE == h->nlmsg_type) {
+                done = 1;
+                break;
+            }
+            if (NLMSG_ERROR == h->nlmsg_type) {
+                struct nlmsgerr *err = (struct nlmsgerr *) NLMSG_DATA(h);
+
+                DEBUGMSGTL(("inet_diag", "netlink error %d (family %d, "
+                            "protocol %d)\n", err->error, family, protocol));
+                rc = -1;
+                break;
+            }
+            if (SOCK_DIAG_BY_FAMILY != h->nlmsg_type ||
+                h->nlmsg_len < NLMSG_LENGTH(sizeof(struct inet_diag_msg)))
+                continue;
+            ++count;
+            rc = (*cb)((const struct inet_diag_msg *) NLMSG_DATA(h), ctx);
+            if (rc < 0)
+                break;
+            rc = 0;
+        }
+    }
+
+    DEBUGMSGTL(("inet_diag", "family %d protocol %d: %d sockets (rc %d)\n",
+                family, protocol, count, rc));
+    free(buf);
+    close(fd);
+    return rc;
+}
+#endif /* HAVE_LINUX_INET_DIAG_H */
@@ -0,0 +1,32 @@
+/*
+ * util_funcs/inet_diag.h:  dump the kernel's TCP and UDP sockets over a
+ * sock_diag (INET_DIAG) netlink socket on linux.
+ */
+#ifndef NETSNMP_MIBGROUP_UTIL_FUNCS_INET_DIAG_H
+#define NETSNMP_MIBGROUP_UTIL_FUNCS_INET_DIAG_H
+
+#ifndef linux
+config_error(inet_diag is only supported on linux);
+#endif
+
+#ifdef HAVE_LINUX_INET_DIAG_H
+#include <linux/inet_diag.h>
+
+/*
+ * Called once for every socket matching the query.  A negative return
+ * value stops the dump and is returned by netsnmp_inet_diag_dump().
+ */
+typedef int (netsnmp_inet_diag_callback)(const struct inet_diag_msg *msg,
+                                         void *ctx);
+
+/*
+ * states is a mask of (1 << state) of the kernel TCP_* states; sockets
+ * in other states are filtered out by the kernel.
+ */
+int netsnmp_inet_diag_dump(u_char family, u_char protocol, u_int states,
+                           netsnmp_inet_diag_callback *cb, void *ctx);
+#endif /* HAVE_LINUX_INET_DIAG_H */
+
+#define NETSNMP_INET_DIAG_ALL_STATES    0xfff
+
+#endif /* NETSNMP_MIBGROUP_UTIL_FUNCS_INET_DIAG_H */
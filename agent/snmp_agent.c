@@ -136,6 +136,11 @@ static netsnmp_container *_pdu_stats = NULL;
 static int _pdu_stats_max = 0;
 static u_long _pdu_stats_threshold = 0;
 static u_long _pdu_stats_current_lowest = 0;
+/** GETBULK responses, those cut at msgMaxSize, and their bytes/budget */
+static u_long _pdu_stats_bulk_responses = 0;
+static u_long _pdu_stats_bulk_full = 0;
+static u_long _pdu_stats_bulk_bytes = 0;
+static u_long _pdu_stats_bulk_budget = 0;
 
 netsnmp_container *
 netsnmp_get_pdu_stats(void)
@@ -143,6 +148,25 @@ netsnmp_get_pdu_stats(void)
     return _pdu_stats;
 }
 
+/*
+ * GETBULK packing: the number of responses, how many of them were cut
+ * at the message size limit, and the total encoded size and limit of
+ * those that were.  bytes / budget is the average fill ratio.
+ */
+void
+netsnmp_get_pdu_stats_getbulk(u_long *responses, u_long *full,
+                              u_long *bytes, u_long *budget)
+{
+    if (responses)
+        *responses = _pdu_stats_bulk_responses;
+    if (full)
+        *full = _pdu_stats_bulk_full;
+    if (bytes)
+        *bytes = _pdu_stats_bulk_bytes;
+    if (budget)
+        *budget = _pdu_stats_bulk_budget;
+}
+
 int _pdu_stats_compare(const void *p, const void *q)
 {
     const netsnmp_pdu_stats *lhs = p, *rhs = q;
@@ -2531,17 +2555,17 @@ check_acm(netsnmp_agent_session *asp, u_char type)
     int             i, j, k;
     netsnmp_request_info *request;
     int             ret = 0;
-    netsnmp_variable_list *vb, *vb2, *vbc;
-    int             earliest = 0;
+    netsnmp_variable_list *vb, *vb2;
 
     for (i = 0; i <= asp->treecache_num; i++) {
         for (request = asp->treecache[i].requests_begin;
              request; request = request->next) {
             /*
-             * for each request, run it through in_a_view() 
+             * for each request, run it through in_a_view().  A GETBULK
+             * handler may have answered several repetitions in one pass,
+             * so check every varbind of the request.
              */
-            earliest = 0;
-            for(j = request->repeat, vb = request->requestvb_start;
+            for(j = request->orig_repeat, vb = request->requestvb_start;
                 vb && j > -1;
                 j--, vb = vb->next_variable) {
                 if (vb->type != ASN_NULL &&
@@ -2555,33 +2579,27 @@ check_acm(netsnmp_agent_session *asp, u_char type)
                      */
                     if (view != VACM_SUCCESS) {
                         ret++;
-                        if (request->repeat < request->orig_repeat) {
-                            /* basically this means a GETBULK */
-                            request->repeat++;
-                            if (!earliest) {
-                                request->requestvb = vb;
-                                earliest = 1;
-                            }
-
-                            /* ugh.  if a whole now exists, we need to
-                               move the contents up the chain and fill
-                               in at the end else we won't end up
-                               lexographically sorted properly */
-                            if (j > -1 && vb->next_variable &&
-                                vb->next_variable->type != ASN_NULL &&
-                                vb->next_variable->type != ASN_PRIV_RETRY) {
-                                for(k = j, vbc = vb, vb2 = vb->next_variable;
-                                    k > -2 && vbc && vb2;
-                                    k--, vbc = vb2, vb2 = vb2->next_variable) {
-                                    /* clone next into the current */
-                                    snmp_clone_var(vb2, vbc);
-                                    vbc->next_variable = vb2;
-                                }
-                            }
-                        }
                         snmp_set_var_typed_value(vb, type, NULL, 0);
                         if (ASN_PRIV_RETRY == type)
                             request->inclusive = 0;
+                        if (request->repeat < request->orig_repeat) {
+                            /*
+                             * basically this means a GETBULK.  Carry on
+                             * from this varbind, and drop any answers
+                             * after it, so that the results stay
+                             * lexicographically sorted.
+                             */
+                            request->repeat = j;
+                            request->requestvb = vb;
+                            for (k = j, vb2 = vb->next_variable;
+                                 k > 0 && vb2;
+                                 k--, vb2 = vb2->next_variable) {
+                                vb2->name_length = 0;
+                                snmp_set_var_typed_value(vb2, ASN_NULL,
+                                                         NULL, 0);
+                            }
+                            break;
+                        }
                     }
                 }
             }
@@ -3417,19 +3435,250 @@ check_getnext_results(netsnmp_agent_session *asp)
     return count;
 }
 
+/*
+ * GETBULK response packing.
+ *
+ * The varbinds of a GETBULK response are accounted for in the order they
+ * will be sent (non-repeaters, then the repetitions row by row, see
+ * _reorder_getbulk), adding the exact size each one will be encoded to.
+ * As soon as one would take the message over msgMaxSize it is marked
+ * ASN_PRIV_STOP and gathering stops, so the response is built once,
+ * already the right size.
+ */
+typedef struct bulk_repeater_s {
+    size_t          eom_len;    /* size of endOfMibView after last value */
+    int             ended;
+} bulk_repeater;
+
+typedef struct bulk_fill_s {
+    int             n, r, repeats;
+    int             pos;        /* varbinds accounted for, in send order */
+    int             total;      /* varbinds in the response */
+    int             fwd;        /* forward encoding */
+    int             row_ended;  /* every repeater so far in this row */
+    size_t          vbl_len;    /* their encoded size */
+    netsnmp_variable_list *nonrep;
+    bulk_repeater  *rep;
+} bulk_fill;
+
+/* Encoded size of a constructed type holding 'len' bytes. */
+static size_t
+_bulk_seq_len(const bulk_fill *bf, size_t len)
+{
+    if (bf->fwd && len <= 0xffff)
+        return 4 + len;         /* asn_build_sequence() */
+    return asn_header_len(len) + len;
+}
+
+static size_t
+_bulk_vb_len(const bulk_fill *bf, const oid *name, size_t name_len,
+             u_char type, const u_char *val, size_t val_len)
+{
+    size_t          len;
+
+    len = snmp_var_op_len(name, name_len, type, val, val_len);
+    if (0 == len)               /* can't be encoded; assume the worst */
+        len = 12 + name_len * 5 + val_len;
+    if (bf->fwd)
+        len += 2;
+    return len;
+}
+
+/*
+ * Size of the response message carrying 'vbl_len' bytes of varbinds.
+ * Exact for community based versions.  For SNMPv3 the security
+ * parameters are only known when the message is built, so this is an
+ * upper bound assuming the largest USM digest and salt and the most
+ * privacy padding.
+ */
+static size_t
+_bulk_message_len(netsnmp_agent_session *asp, const bulk_fill *bf,
+                  size_t vbl_len)
+{
+    netsnmp_pdu    *pdu = asp->pdu;
+    size_t          len, sec;
+
+    /* request-id, error-status (0) and error-index (0) */
+    len = 2 + asn_int_len(pdu->reqid) + 3 + 3 +
+        _bulk_seq_len(bf, vbl_len);
+    len = _bulk_seq_len(bf, len);
+
+    if (pdu->version != SNMP_VERSION_3)
+        return _bulk_seq_len(bf, 3 + asn_header_len(pdu->community_len) +
+                             pdu->community_len + len);
+
+    /* scopedPDU, then encrypted with up to 7 bytes of padding */
+    len = _bulk_seq_len(bf, asn_header_len(pdu->contextEngineIDLen) +
+                        pdu->contextEngineIDLen +
+                        asn_header_len(pdu->contextNameLen) +
+                        pdu->contextNameLen + len);
+    if (pdu->securityLevel == SNMP_SEC_LEVEL_AUTHPRIV)
+        len = 4 + 7 + len;
+
+    /* usmSecurityParameters: digest up to 48, salt up to 16 bytes */
+    sec = _bulk_seq_len(bf, asn_header_len(pdu->securityEngineIDLen) +
+                        pdu->securityEngineIDLen + 6 + 6 +
+                        asn_header_len(pdu->securityNameLen) +
+                        pdu->securityNameLen + 2 + 48 + 2 + 16);
+    sec += asn_header_len(sec);
+
+    /* msgVersion, msgGlobalData */
+    return _bulk_seq_len(bf, 3 + _bulk_seq_len(bf, 6 + 6 + 3 + 3) +
+                         sec + len);
+}
+
+static int
+_bulk_fill_init(netsnmp_agent_session *asp, bulk_fill *bf)
+{
+    netsnmp_variable_list *orig;
+    int             i;
+
+    memset(bf, 0, sizeof(*bf));
+    if (asp->pdu->command != SNMP_MSG_GETBULK)
+        return 0;
+
+    bf->fwd = !netsnmp_ds_get_boolean(NETSNMP_DS_LIBRARY_ID,
+                                      NETSNMP_DS_LIB_REVERSE_ENCODE);
+    bf->n = (asp->pdu->errstat < asp->vbcount) ? asp->pdu->errstat :
+        asp->vbcount;
+    bf->r = asp->bulkcache ? asp->vbcount - bf->n : 0;
+    bf->repeats = asp->pdu->errindex;
+    bf->nonrep = asp->pdu->variables;
+    bf->row_ended = 1;
+    if (bf->r <= 0 || bf->repeats <= 0) {
+        bf->r = 0;
+        bf->total = bf->n;
+        return 1;
+    }
+    bf->total = bf->n + bf->r * bf->repeats;
+
+    bf->rep = (bulk_repeater *) calloc(bf->r, sizeof(bulk_repeater));
+    if (NULL == bf->rep)
+        return 0;
+    /*
+     * Before any value, endOfMibView carries the requested name, the
+     * same way _reorder_getbulk picks it.
+     */
+    for (i = 0, orig = asp->orig_pdu->variables; i < bf->r;
+         i++, orig = orig ? orig->next_variable : NULL) {
+        if (orig)
+            bf->rep[i].eom_len = _bulk_vb_len(bf, orig->name,
+                                              orig->name_length,
+                                              SNMP_ENDOFMIBVIEW, NULL, 0);
+        else
+            bf->rep[i].eom_len = _bulk_vb_len(bf, NULL, 0,
+                                              SNMP_ENDOFMIBVIEW, NULL, 0);
+    }
+    return 1;
+}
+
+/*
+ * Account for the varbinds that are known, in send order.  Until 'final'
+ * the first one that still has to be looked up stops the count; once
+ * processing is done, anything left unfilled becomes endOfMibView.
+ * Returns 1 if the message is full: the first varbind that doesn't fit
+ * is marked ASN_PRIV_STOP.
+ */
+static int
+_bulk_fill_update(netsnmp_agent_session *asp, bulk_fill *bf, int final)
+{
+    static const oid stop_name[] = { 0, 0 };
+    netsnmp_variable_list *vb;
+    bulk_repeater  *rep;
+    size_t          len;
+    int             i, unknown;
+
+    for (; bf->pos < bf->total; bf->pos++) {
+        if (bf->pos < bf->n) {
+            vb = bf->nonrep;
+            if (NULL == vb)
+                break;
+            rep = NULL;
+        } else {
+            i = (bf->pos - bf->n) % bf->r;
+            vb = asp->bulkcache[i * bf->repeats + (bf->pos - bf->n) / bf->r];
+            rep = &bf->rep[i];
+        }
+        unknown = (vb->type == ASN_PRIV_RETRY) || (vb->type == ASN_NULL);
+        if (unknown && !final && !(rep && rep->ended))
+            return 0;
+
+        if (rep && (rep->ended || unknown ||
+                    vb->type == SNMP_ENDOFMIBVIEW)) {
+            rep->ended = 1;
+            len = rep->eom_len;
+        } else {
+            bf->row_ended = 0;
+            len = _bulk_vb_len(bf, vb->name, vb->name_length, vb->type,
+                               vb->val.string, vb->val_len);
+            if (rep)
+                rep->eom_len = _bulk_vb_len(bf, vb->name, vb->name_length,
+                                            SNMP_ENDOFMIBVIEW, NULL, 0);
+        }
+
+        if (_bulk_message_len(asp, bf, bf->vbl_len + len) >
+            (size_t) asp->pdu->msgMaxSize) {
+            DEBUGMSGTL(("results", "response full after %d varbinds, "
+                        "%" NETSNMP_PRIz "u bytes; stop gathering\n",
+                        bf->pos, _bulk_message_len(asp, bf, bf->vbl_len)));
+            /* keep _reorder_getbulk from turning it into endOfMibView */
+            if (0 == vb->name_length)
+                snmp_set_var_objid(vb, stop_name, OID_LENGTH(stop_name));
+            vb->type = ASN_PRIV_STOP;
+            return 1;
+        }
+        bf->vbl_len += len;
+        if (bf->pos < bf->n)
+            bf->nonrep = vb->next_variable;
+        else if (rep == &bf->rep[bf->r - 1]) {
+            /* a row of endOfMibView ends the response */
+            if (bf->row_ended)
+                bf->total = bf->pos + 1;
+            bf->row_ended = 1;
+        }
+    }
+    return 0;
+}
+
+static void
+_bulk_fill_done(netsnmp_agent_session *asp, bulk_fill *bf, int full)
+{
+    size_t          len = _bulk_message_len(asp, bf, bf->vbl_len);
+
+    DEBUGMSGTL(("stats:pdu:getbulk", "%d varbinds, %" NETSNMP_PRIz
+                "u of %ld bytes%s\n", bf->pos, len, asp->pdu->msgMaxSize,
+                full ? " (full)" : ""));
+#ifndef NETSNMP_NO_PDU_STATS
+    ++_pdu_stats_bulk_responses;
+    if (full) {
+        ++_pdu_stats_bulk_full;
+        _pdu_stats_bulk_bytes += len;
+        _pdu_stats_bulk_budget += asp->pdu->msgMaxSize;
+    }
+    if (_pdu_stats_bulk_budget)
+        DEBUGMSGTL(("stats:pdu",
+                    "getbulk: %lu responses, %lu full, average fill %.1f%%\n",
+                    _pdu_stats_bulk_responses, _pdu_stats_bulk_full,
+                    100.0 * _pdu_stats_bulk_bytes / _pdu_stats_bulk_budget));
+#endif /* NETSNMP_NO_PDU_STATS */
+    SNMP_FREE(bf->rep);
+}
+
 /** repeatedly calls getnext handlers looking for an answer till all
    requests are satisfied.  It's expected that one pass has been made
    before entering this function */
 int
 handle_getnext_loop(netsnmp_agent_session *asp)
 {
-    int             status, rough_size, count = 0, total, val_len;
-    netsnmp_variable_list *var_ptr, *last_var = NULL;
+    int             status, count = 0, total, full = 0, bulk;
+    netsnmp_variable_list *var_ptr;
+    bulk_fill       bf;
 
     if (NULL == asp || NULL == asp->pdu)
         return SNMP_ERR_GENERR;
 
     total = count_varbinds(asp->pdu->variables);
+    bulk = _bulk_fill_init(asp, &bf);
 
     /*
      * loop 
@@ -3440,6 +3689,7 @@ handle_getnext_loop(netsnmp_agent_session *asp)
          * bail for now if anything is delegated. 
          */
         if (netsnmp_check_for_delegated(asp)) {
+            SNMP_FREE(bf.rep);
             return SNMP_ERR_NOERROR;
         }
 
@@ -3457,7 +3707,7 @@ handle_getnext_loop(netsnmp_agent_session *asp)
              */
             break;
 
-        count = rough_size = 0;
+        count = 0;
         DEBUGMSGTL(("results:intermediate",
                     "getnext results, before next pass:\n"));
         for (var_ptr = asp->pdu->variables; var_ptr; 
@@ -3472,51 +3722,32 @@ handle_getnext_loop(netsnmp_agent_session *asp)
                 DEBUGMSGVAR(("results:intermediate", var_ptr));
                 DEBUGMSG(("results:intermediate", "\n"));
             }
-            /*
-             * make a very rough guesstimate of the encoded varbind size by
-             * adding the name and val lengths. If these rough sizes add up
-             * to more than the msgMaxSize, stop gathering new varbinds.
-             *
-             * [Increasing the accuracy of this estimate would allow us to
-             * do better at filling packets and collecting fewer varbinds that
-             * we'll later have to trim. This is left as an exercise for the
-             * reader.]
-             */
-            rough_size += var_ptr->name_length;
-            /** sizeof(oid) is 8 on 64bit systems :-( Hardcode for 4 */
-            if (var_ptr->type == ASN_OBJECT_ID && sizeof(long) == 8)
-                val_len = (var_ptr->val_len / 2);
-            else
-                val_len = var_ptr->val_len;
-
-            DEBUGMSGTL(("results:intermediate", "\t+ %" NETSNMP_PRIz "d %d = %d\n",
-                        var_ptr->name_length, val_len, rough_size));
-            if (rough_size > asp->pdu->msgMaxSize) {
-                DEBUGMSGTL(("results",
-                            "estimating packet too big; stop gathering\n"));
-                asp->pdu->flags |= UCD_MSG_FLAG_BULK_TOOBIG |
-                    UCD_MSG_FLAG_FORWARD_ENCODE;
-                var_ptr->type = ASN_PRIV_STOP;
-                if (NULL != last_var)
-                    last_var->next_variable = NULL;
-                break;
-            }
-            last_var = var_ptr;
         }
-        if (rough_size > asp->pdu->msgMaxSize)
+
+        /*
+         * stop gathering once the response is full
+         */
+        if (bulk && (full = _bulk_fill_update(asp, &bf, 0)))
             break;
 
         netsnmp_reassign_requests(asp);
         status = handle_var_requests(asp);
         if (status != SNMP_ERR_NOERROR) {
+            SNMP_FREE(bf.rep);
             return status;      /* should never really happen */
         }
     }
     DEBUGMSGTL(("results:summary", "gathered %d/%d varbinds\n", count,
                 total));
     if (!netsnmp_running) {
+        SNMP_FREE(bf.rep);
         return SNMP_ERR_GENERR;
     }
+    if (bulk) {
+        if (!full)
+            full = _bulk_fill_update(asp, &bf, 1);
+        _bulk_fill_done(asp, &bf, full);
+    }
     return SNMP_ERR_NOERROR;
 }
 
@@ -45,6 +45,7 @@
 #endif
 #include <stdio.h>
 #include <ctype.h>
+#include <errno.h>
 #ifdef TIME_WITH_SYS_TIME
 # include <sys/time.h>
 # include <time.h>
@@ -64,8 +65,19 @@
 #ifdef HAVE_ARPA_INET_H
 #include <arpa/inet.h>
 #endif
+#ifdef HAVE_INTTYPES_H
+#include <inttypes.h>
+#endif
 
 #include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/library/large_fd_set.h>
+
+#ifndef PRIu64
+#define PRIu64 "llu"
+#endif
+#ifndef PRId64
+#define PRId64 "lld"
+#endif
 
 #define MAX_DESCRIPTOR 64
 #define MAX_ARGS 256
@@ -100,6 +112,8 @@ int             deltat = 0, timestamp = 0, fileout = 0, dosum =
 int             keepSeconds = 0, peaks = 0;
 int             tableForm = 0;
 int             varbindsPerPacket = 60;
+int             rateMode = 0;
+const char     *hostFile = NULL;
 
 static void     processFileArgs(char *fileName);
 
@@ -107,7 +121,7 @@ void
 usage(void)
 {
     fprintf(stderr,
-            "Usage: snmpdelta [-Cf] [-CF commandFile] [-Cl] [-CL SumFileName]\n\t[-Cs] [-Ck] [-Ct] [-CS] [-Cv vars/pkt] [-Cp period]\n\t[-CP peaks] ");
+            "Usage: snmpdelta [-Cf] [-CF commandFile] [-Cl] [-CL SumFileName]\n\t[-Cs] [-Ck] [-Ct] [-CS] [-Cv vars/pkt] [-Cp period]\n\t[-CP peaks] [-CR] [-CH hostFile] ");
     snmp_parse_args_usage(stderr);
     fprintf(stderr, " oid [oid ...]\n");
     snmp_parse_args_descriptions(stderr);
@@ -125,6 +139,8 @@ usage(void)
     fprintf(stderr, "  -Ct\t\tget timing from agent\n");
     fprintf(stderr, "  -CT\t\tprint output in tabular form\n");
     fprintf(stderr, "  -CL sumfile\tspecifies the sum file name\n");
+    fprintf(stderr, "  -CR\t\twalk the OIDs and print rates of all instances\n");
+    fprintf(stderr, "  -CH hostfile\talso poll the agents listed in hostfile (implies -CR)\n");
 }
 
 static void
@@ -174,6 +190,13 @@ optProc(int argc, char *const *argv, int opt)
             case 'T':
                 tableForm = 1;
                 break;
+            case 'R':
+                rateMode = 1;
+                break;
+            case 'H':
+                hostFile = argv[optind++];
+                rateMode = 1;
+                break;
             default:
                 fprintf(stderr, "Bad -C options: %c\n", opt);
                 exit(1);
@@ -370,6 +393,681 @@ wait_for_period(int period)
 oid             sysUpTimeOid[9] = { 1, 3, 6, 1, 2, 1, 1, 3, 0 };
 size_t          sysUpTimeLen = 9;
 
+/*
+ * Rate mode (-CR/-CH).  Every OID is walked as a table column (or scalar
+ * object) on every agent with GETBULK, and a line
+ *
+ *   <time> <agent> <object> <instance> <status> <delta> <seconds> <rate>
+ *
+ * is printed for each instance and period.  The state of an instance is
+ * kept in a deltaSeries, in an array sorted by instance per column and
+ * agent.  The time base is the agent's sysUpTime, and Counter32 wraps,
+ * agent restarts and IF-MIB counter discontinuities are detected.
+ */
+#define RATE_F_PREV     0x01    /* series has a previous sample */
+#define RATE_F_SEEN     0x02    /* series was seen during this poll */
+
+struct deltaSeries {
+    uint64_t        prev;       /* value at the previous poll */
+    uint64_t        cur;        /* value at this poll */
+    u_int           index;      /* offset of the instance in the pool */
+    u_char          index_len;  /* number of sub-identifiers of it */
+    u_char          type;
+    u_char          flags;
+};
+
+struct deltaColumn {
+    oid             name[MAX_OID_LEN];
+    size_t          name_len;
+    char            descriptor[MAX_DESCRIPTOR];
+    int             discontinuity;  /* column to check, or -1 */
+    int             hidden;         /* only walked for other columns */
+};
+
+struct deltaWalk {
+    struct deltaSeries *series;
+    size_t          nseries, maxseries;
+    oid            *pool;       /* instance sub-identifiers */
+    size_t          pool_len, pool_max;
+    size_t          cursor;     /* series expected next in this walk */
+    oid             last[MAX_OID_LEN];
+    size_t          last_len;
+    int             done;
+};
+
+struct deltaHost {
+    char           *name;
+    netsnmp_session *ss;
+    struct deltaWalk *walks;    /* one per column */
+    int            *reqcols;    /* columns in the outstanding request */
+    int             nreqcols;
+    int             first;      /* outstanding request starts the poll */
+    int             busy;
+    int             have_uptime;
+    u_long          uptime_prev, uptime_cur;
+    struct timeval  polled;
+};
+
+static struct deltaColumn *rateColumns;
+static int      rateNumColumns;
+static struct deltaHost *rateHosts;
+static int      rateNumHosts;
+static int      rateOutstanding;
+
+static oid      sysUpTimeObj[] = { 1, 3, 6, 1, 2, 1, 1, 3 };
+static oid      ifEntryOid[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1 };
+static oid      ifXEntryOid[] = { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1 };
+static oid      ifCounterDiscontinuityTimeOid[] =
+    { 1, 3, 6, 1, 2, 1, 31, 1, 1, 1, 19 };
+
+static int      rate_send(struct deltaHost *host);
+
+static int
+rate_add_column(const oid *name, size_t name_len, int hidden)
+{
+    struct deltaColumn *col, *cols;
+    struct varInfo  vi;
+
+    cols = realloc(rateColumns, (rateNumColumns + 1) * sizeof(*cols));
+    if (cols == NULL)
+        return -1;
+    rateColumns = cols;
+    col = &cols[rateNumColumns];
+    memset(col, 0, sizeof(*col));
+    memcpy(col->name, name, name_len * sizeof(oid));
+    col->name_len = name_len;
+    col->discontinuity = -1;
+    col->hidden = hidden;
+    vi.info_oid = col->name;
+    vi.oidlen = col->name_len;
+    strlcpy(col->descriptor, "?", sizeof(col->descriptor));
+    sprint_descriptor(col->descriptor, &vi);
+    return rateNumColumns++;
+}
+
+static int
+rate_is_if_counter(const oid *name, size_t name_len)
+{
+    return (name_len == OID_LENGTH(ifEntryOid) + 1 &&
+            snmp_oidsubtree_compare(ifEntryOid, OID_LENGTH(ifEntryOid),
+                                    name, name_len) == 0) ||
+        (name_len == OID_LENGTH(ifXEntryOid) + 1 &&
+         snmp_oidsubtree_compare(ifXEntryOid, OID_LENGTH(ifXEntryOid),
+                                 name, name_len) == 0);
+}
+
+/*
+ * Parse the OIDs into columns.  Counters of ifEntry and ifXEntry get
+ * ifCounterDiscontinuityTime walked along as a hidden column, which is
+ * added after all visible ones so that it is updated last.
+ */
+static int
+rate_setup_columns(void)
+{
+    oid             name[MAX_OID_LEN];
+    size_t          name_len;
+    int             i, disc = -1, need_disc = 0;
+
+    for (i = 0; i < current_name; i++) {
+        name_len = MAX_OID_LEN;
+        if (snmp_parse_oid(varinfo[i].name, name, &name_len) == NULL) {
+            snmp_perror(varinfo[i].name);
+            return -1;
+        }
+        if (rate_add_column(name, name_len, 0) < 0)
+            return -1;
+        if (rate_is_if_counter(name, name_len))
+            need_disc = 1;
+    }
+    if (need_disc) {
+        disc = rate_add_column(ifCounterDiscontinuityTimeOid,
+                               OID_LENGTH(ifCounterDiscontinuityTimeOid),
+                               1);
+        if (disc < 0)
+            return -1;
+    }
+    for (i = 0; i < rateNumColumns; i++) {
+        struct deltaColumn *col = &rateColumns[i];
+
+        if (!col->hidden && rate_is_if_counter(col->name, col->name_len))
+            col->discontinuity = disc;
+    }
+    return 0;
+}
+
+static int
+rate_add_host(netsnmp_session *session, const char *name)
+{
+    struct deltaHost *host, *hosts;
+    char           *peername;
+
+    hosts = realloc(rateHosts, (rateNumHosts + 1) * sizeof(*hosts));
+    if (hosts == NULL)
+        return -1;
+    rateHosts = hosts;
+    host = &hosts[rateNumHosts];
+    memset(host, 0, sizeof(*host));
+    host->name = strdup(name);
+    host->walks = calloc(rateNumColumns, sizeof(*host->walks));
+    host->reqcols = calloc(rateNumColumns, sizeof(*host->reqcols));
+    if (host->name == NULL || host->walks == NULL || host->reqcols == NULL)
+        return -1;
+
+    peername = session->peername;
+    session->peername = host->name;
+    host->ss = snmp_open(session);
+    session->peername = peername;
+    if (host->ss == NULL) {
+        snmp_sess_perror("snmpdelta", session);
+        return -1;
+    }
+    rateNumHosts++;
+    return 0;
+}
+
+/*
+ * Read additional agents, one per line, in the same syntax as the
+ * AGENT argument.  Blank lines and lines starting with '#' are skipped.
+ */
+static int
+rate_read_hosts(netsnmp_session *session, const char *fileName)
+{
+    FILE           *fp;
+    char            buf[260], *cp, *end;
+    int             rc = 0;
+
+    fp = fopen(fileName, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Couldn't open %s\n", fileName);
+        return -1;
+    }
+    while (rc == 0 && fgets(buf, sizeof(buf), fp)) {
+        for (cp = buf; isspace((unsigned char)*cp); cp++);
+        for (end = cp + strlen(cp);
+             end > cp && isspace((unsigned char)end[-1]); end--);
+        *end = '\0';
+        if (*cp == '\0' || *cp == '#')
+            continue;
+        rc = rate_add_host(session, cp);
+    }
+    fclose(fp);
+    return rc;
+}
+
+/*
+ * Find the series of an instance.  Walks return the instances in order,
+ * so the series after the previous hit is tried before searching.
+ * Returns the series, or NULL with *pos set to the insertion point.
+ */
+static struct deltaSeries *
+rate_find(struct deltaWalk *walk, const oid *index, size_t index_len,
+          size_t *pos)
+{
+    size_t          lo = 0, hi = walk->nseries, mid;
+    int             cmp;
+
+    if (walk->cursor < walk->nseries) {
+        struct deltaSeries *s = &walk->series[walk->cursor];
+
+        cmp = snmp_oid_compare(walk->pool + s->index, s->index_len,
+                               index, index_len);
+        if (cmp == 0) {
+            *pos = walk->cursor;
+            return s;
+        }
+        if (cmp < 0)
+            lo = walk->cursor + 1;
+        else
+            hi = walk->cursor;
+    }
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        cmp = snmp_oid_compare(walk->pool + walk->series[mid].index,
+                               walk->series[mid].index_len,
+                               index, index_len);
+        if (cmp == 0) {
+            *pos = mid;
+            return &walk->series[mid];
+        }
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *pos = lo;
+    return NULL;
+}
+
+static int
+rate_store(struct deltaWalk *walk, const oid *index, size_t index_len,
+           u_char type, uint64_t value)
+{
+    struct deltaSeries *s;
+    size_t          pos;
+
+    s = rate_find(walk, index, index_len, &pos);
+    if (s == NULL) {
+        if (walk->nseries == walk->maxseries) {
+            size_t          n = walk->maxseries ? 2 * walk->maxseries : 16;
+
+            s = realloc(walk->series, n * sizeof(*s));
+            if (s == NULL)
+                return -1;
+            walk->series = s;
+            walk->maxseries = n;
+        }
+        if (walk->pool_len + index_len > walk->pool_max) {
+            size_t          n = walk->pool_max ? 2 * walk->pool_max : 64;
+            oid            *pool;
+
+            while (n < walk->pool_len + index_len)
+                n *= 2;
+            pool = realloc(walk->pool, n * sizeof(oid));
+            if (pool == NULL)
+                return -1;
+            walk->pool = pool;
+            walk->pool_max = n;
+        }
+        s = &walk->series[pos];
+        memmove(s + 1, s, (walk->nseries - pos) * sizeof(*s));
+        walk->nseries++;
+        memset(s, 0, sizeof(*s));
+        s->index = walk->pool_len;
+        s->index_len = index_len;
+        memcpy(walk->pool + walk->pool_len, index, index_len * sizeof(oid));
+        walk->pool_len += index_len;
+    }
+    s->cur = value;
+    s->type = type;
+    s->flags |= RATE_F_SEEN;
+    walk->cursor = pos + 1;
+    return 0;
+}
+
+/*
+ * Drop the series that disappeared from the agent.  The instance pool
+ * is rebuilt at the same time, so it does not grow without bound.
+ */
+static void
+rate_compact(struct deltaWalk *walk)
+{
+    oid            *pool;
+    size_t          i, n, len = 0;
+
+    for (i = n = 0; i < walk->nseries; i++)
+        if (walk->series[i].flags & RATE_F_SEEN)
+            len += walk->series[i].index_len;
+    if (len == walk->pool_len)
+        return;
+    pool = malloc((len ? len : 1) * sizeof(oid));
+    if (pool == NULL)
+        return;
+    for (i = n = len = 0; i < walk->nseries; i++) {
+        struct deltaSeries *s = &walk->series[i];
+
+        if (!(s->flags & RATE_F_SEEN))
+            continue;
+        memcpy(pool + len, walk->pool + s->index, s->index_len * sizeof(oid));
+        s->index = len;
+        len += s->index_len;
+        walk->series[n++] = *s;
+    }
+    free(walk->pool);
+    walk->pool = pool;
+    walk->pool_len = walk->pool_max = len;
+    walk->nseries = n;
+}
+
+static void
+rate_print(struct deltaHost *host, struct deltaColumn *col,
+           struct deltaWalk *walk, struct deltaSeries *s,
+           const char *status, const char *delta, double seconds,
+           const char *rate)
+{
+    char            index[MAX_OID_LEN * 11 + 1], *cp = index;
+    size_t          i;
+
+    *cp = '\0';
+    for (i = 0; i < s->index_len; i++)
+        cp += snprintf(cp, index + sizeof(index) - cp, "%s%" NETSNMP_PRIo "u",
+                       i ? "." : "", walk->pool[s->index + i]);
+    printf("%ld.%03ld %s %s %s %s %s %.2f %s\n",
+           (long) host->polled.tv_sec, (long) host->polled.tv_usec / 1000,
+           host->name, col->descriptor, s->index_len ? index : "-", status,
+           delta, seconds, rate);
+}
+
+/*
+ * The poll of an agent completed: compute and print the rates and make
+ * the current samples the previous ones.
+ */
+static void
+rate_finish(struct deltaHost *host)
+{
+    struct deltaColumn *col;
+    struct deltaWalk *walk;
+    struct deltaSeries *s, *ds;
+    double          seconds = 0;
+    int             restarted = 0, c;
+    size_t          i, pos;
+    char            delta[32], rate[32];
+
+    host->busy = 0;
+    if (host->have_uptime) {
+        if (host->uptime_cur < host->uptime_prev)
+            restarted = 1;
+        else
+            seconds = (host->uptime_cur - host->uptime_prev) / 100.0;
+    }
+
+    for (c = 0; c < rateNumColumns; c++) {
+        col = &rateColumns[c];
+        walk = &host->walks[c];
+        rate_compact(walk);
+        for (i = 0; i < walk->nseries; i++) {
+            const char     *status = "ok";
+            uint64_t        d;
+
+            s = &walk->series[i];
+            if (col->hidden || !(s->flags & RATE_F_PREV) ||
+                !host->have_uptime)
+                goto next;
+            ds = NULL;
+            if (col->discontinuity >= 0)
+                ds = rate_find(&host->walks[col->discontinuity],
+                               walk->pool + s->index, s->index_len, &pos);
+            if (restarted ||
+                (ds && (ds->flags & RATE_F_PREV) && ds->cur != ds->prev) ||
+                (s->type == ASN_COUNTER64 && s->cur < s->prev)) {
+                rate_print(host, col, walk, s, "reset", "-", seconds, "-");
+                goto next;
+            }
+            if (s->type == ASN_COUNTER) {
+                d = (s->cur - s->prev) & 0xffffffffUL;
+                if (s->cur < s->prev)
+                    status = "wrap";
+                snprintf(delta, sizeof(delta), "%" PRIu64, d);
+            } else if (s->type == ASN_COUNTER64) {
+                d = s->cur - s->prev;
+                snprintf(delta, sizeof(delta), "%" PRIu64, d);
+            } else {
+                d = s->cur - s->prev;
+                snprintf(delta, sizeof(delta), "%" PRId64, (int64_t) d);
+            }
+            if (seconds > 0)
+                snprintf(rate, sizeof(rate), "%.2f",
+                         (s->type == ASN_COUNTER ||
+                          s->type == ASN_COUNTER64 ? (double) d :
+                          (double) (int64_t) d) / seconds);
+            else
+                strlcpy(rate, "-", sizeof(rate));
+            rate_print(host, col, walk, s, status, delta, seconds, rate);
+          next:
+            s->prev = s->cur;
+            s->flags = RATE_F_PREV;
+        }
+    }
+    host->uptime_prev = host->uptime_cur;
+    host->have_uptime = 1;
+    fflush(stdout);
+}
+
+static void
+rate_abort(struct deltaHost *host)
+{
+    int             c;
+    size_t          i;
+
+    host->busy = 0;
+    for (c = 0; c < rateNumColumns; c++)
+        for (i = 0; i < host->walks[c].nseries; i++)
+            host->walks[c].series[i].flags &= ~RATE_F_SEEN;
+}
+
+static int
+rate_value(netsnmp_variable_list *vars, uint64_t *value)
+{
+    switch (vars->type) {
+    case ASN_INTEGER:
+        *value = (uint64_t) (int64_t) *vars->val.integer;
+        return 0;
+    case ASN_COUNTER:
+    case ASN_GAUGE:
+    case ASN_TIMETICKS:
+    case ASN_UINTEGER:
+        *value = (u_long) *vars->val.integer & 0xffffffffUL;
+        return 0;
+    case ASN_COUNTER64:
+        *value = ((uint64_t) vars->val.counter64->high << 32) |
+            vars->val.counter64->low;
+        return 0;
+    }
+    return -1;
+}
+
+static void
+rate_response(struct deltaHost *host, netsnmp_pdu *response)
+{
+    netsnmp_variable_list *vars;
+    struct deltaColumn *col;
+    struct deltaWalk *walk;
+    uint64_t        value;
+    int             i, errindex = response->errindex;
+
+    if (response->errstat != SNMP_ERR_NOERROR) {
+        /*
+         * SNMPv1 agents report the end of the MIB view as noSuchName
+         */
+        if (response->errstat == SNMP_ERR_NOSUCHNAME &&
+            (errindex -= host->first) > 0 && errindex <= host->nreqcols) {
+            host->walks[host->reqcols[errindex - 1]].done = 1;
+            if (rate_send(host) < 0)
+                rate_abort(host);
+            return;
+        }
+        fprintf(stderr, "%s: Error in packet: %s\n", host->name,
+                snmp_errstring(response->errstat));
+        rate_abort(host);
+        return;
+    }
+
+    vars = response->variables;
+    if (host->first) {
+        if (vars == NULL || vars->type != ASN_TIMETICKS) {
+            fprintf(stderr, "%s: Missing sysUpTime in reply\n", host->name);
+            rate_abort(host);
+            return;
+        }
+        host->uptime_cur = *vars->val.integer;
+        vars = vars->next_variable;
+        host->first = 0;
+    }
+
+    for (i = 0; vars; vars = vars->next_variable, i++) {
+        col = &rateColumns[host->reqcols[i % host->nreqcols]];
+        walk = &host->walks[host->reqcols[i % host->nreqcols]];
+        if (walk->done)
+            continue;
+        if (vars->type == SNMP_ENDOFMIBVIEW ||
+            vars->type == SNMP_NOSUCHOBJECT ||
+            vars->type == SNMP_NOSUCHINSTANCE ||
+            vars->name_length <= col->name_len ||
+            snmp_oidsubtree_compare(col->name, col->name_len,
+                                    vars->name, vars->name_length) != 0) {
+            walk->done = 1;
+            continue;
+        }
+        if (snmp_oid_compare(vars->name, vars->name_length,
+                             walk->last, walk->last_len) <= 0) {
+            fprintf(stderr, "%s: OID not increasing: ", host->name);
+            fprint_objid(stderr, vars->name, vars->name_length);
+            walk->done = 1;
+            continue;
+        }
+        memcpy(walk->last, vars->name, vars->name_length * sizeof(oid));
+        walk->last_len = vars->name_length;
+        if (rate_value(vars, &value) == 0 &&
+            rate_store(walk, vars->name + col->name_len,
+                       vars->name_length - col->name_len, vars->type,
+                       value) < 0) {
+            fprintf(stderr, "%s: out of memory\n", host->name);
+            rate_abort(host);
+            return;
+        }
+    }
+
+    if (rate_send(host) < 0)
+        rate_abort(host);
+}
+
+static int
+rate_callback(int operation, netsnmp_session *sp, int reqid,
+              netsnmp_pdu *pdu, void *magic)
+{
+    struct deltaHost *host = magic;
+
+    rateOutstanding--;
+    switch (operation) {
+    case NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE:
+        rate_response(host, pdu);
+        break;
+    case NETSNMP_CALLBACK_OP_TIMED_OUT:
+        fprintf(stderr, "Timeout: No Response from %s\n", host->name);
+        rate_abort(host);
+        break;
+    default:
+        rate_abort(host);
+        break;
+    }
+    return 1;
+}
+
+/*
+ * Request the next instances of all unfinished columns of an agent, or
+ * complete its poll when there are none.  Returns -1 on error.
+ */
+static int
+rate_send(struct deltaHost *host)
+{
+    netsnmp_pdu    *pdu;
+    int             c, reps;
+
+    host->nreqcols = 0;
+    for (c = 0; c < rateNumColumns; c++)
+        if (!host->walks[c].done)
+            host->reqcols[host->nreqcols++] = c;
+    if (host->nreqcols == 0) {
+        rate_finish(host);
+        return 0;
+    }
+
+    if (host->ss->version == SNMP_VERSION_1) {
+        pdu = snmp_pdu_create(SNMP_MSG_GETNEXT);
+    } else {
+        pdu = snmp_pdu_create(SNMP_MSG_GETBULK);
+        reps = (varbindsPerPacket - host->first) / host->nreqcols;
+        pdu->non_repeaters = host->first;
+        pdu->max_repetitions = reps > 0 ? reps : 1;
+    }
+    if (host->first)
+        snmp_add_null_var(pdu, sysUpTimeObj, OID_LENGTH(sysUpTimeObj));
+    for (c = 0; c < host->nreqcols; c++) {
+        struct deltaWalk *walk = &host->walks[host->reqcols[c]];
+
+        snmp_add_null_var(pdu, walk->last, walk->last_len);
+    }
+
+    if (snmp_async_send(host->ss, pdu, rate_callback, host) == 0) {
+        snmp_sess_perror("snmpdelta", host->ss);
+        snmp_free_pdu(pdu);
+        return -1;
+    }
+    rateOutstanding++;
+    return 0;
+}
+
+static void
+rate_start(struct deltaHost *host)
+{
+    struct deltaWalk *walk;
+    int             c;
+
+    for (c = 0; c < rateNumColumns; c++) {
+        walk = &host->walks[c];
+        memcpy(walk->last, rateColumns[c].name,
+               rateColumns[c].name_len * sizeof(oid));
+        walk->last_len = rateColumns[c].name_len;
+        walk->cursor = 0;
+        walk->done = 0;
+    }
+    gettimeofday(&host->polled, NULL);
+    host->first = 1;
+    host->busy = 1;
+    if (rate_send(host) < 0)
+        rate_abort(host);
+}
+
+/*
+ * Poll all agents concurrently and wait until every poll completed or
+ * timed out.
+ */
+static void
+rate_poll(void)
+{
+    netsnmp_large_fd_set fdset;
+    struct timeval  timeout, *tvp;
+    int             i, numfds, block, count;
+
+    for (i = 0; i < rateNumHosts; i++)
+        rate_start(&rateHosts[i]);
+
+    netsnmp_large_fd_set_init(&fdset, FD_SETSIZE);
+    while (rateOutstanding > 0) {
+        numfds = 0;
+        block = 1;
+        tvp = &timeout;
+        timerclear(tvp);
+        NETSNMP_LARGE_FD_ZERO(&fdset);
+        snmp_select_info2(&numfds, &fdset, tvp, &block);
+        if (block)
+            tvp = NULL;
+        count = netsnmp_large_fd_set_select(numfds, &fdset, NULL, NULL, tvp);
+        if (count > 0)
+            snmp_read2(&fdset);
+        else if (count == 0)
+            snmp_timeout();
+        else if (errno != EINTR) {
+            snmp_log_perror("select");
+            break;
+        }
+    }
+    netsnmp_large_fd_set_cleanup(&fdset);
+}
+
+/*
+ * Only returns if the setup failed.
+ */
+static int
+rate_main(netsnmp_session *session)
+{
+    if (tableForm || peaks || dosum || fileout || printmax) {
+        fprintf(stderr,
+                "-CT, -CP, -CS, -Cl and -Cm are not supported with -CR\n");
+        return 1;
+    }
+    if (rate_setup_columns() < 0 ||
+        rate_add_host(session, session->peername) < 0 ||
+        (hostFile && rate_read_hosts(session, hostFile) < 0))
+        return 1;
+
+    wait_for_period(period);
+    while (1) {
+        rate_poll();
+        wait_for_period(period);
+    }
+    return 0;
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -432,6 +1130,11 @@ main(int argc, char *argv[])
         goto out;
     }
 
+    if (rateMode) {
+        exit_code = rate_main(&session);
+        goto out;
+    }
+
     if (dosum) {
 	if (current_name >= MAX_ARGS) {
 	    fprintf(stderr, "Too many variables specified (max %d)\n",
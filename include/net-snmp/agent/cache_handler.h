@@ -67,6 +67,12 @@ extern          "C" {
         oid *rootoid;
         int  rootoid_len;
 
+        /*
+         * Requests answered from the cache, and those which
+         *   needed it to be (re)loaded.
+         */
+        u_long   hits;
+        u_long   misses;
     };
 
 
@@ -109,6 +115,16 @@ extern          "C" {
 
     unsigned int netsnmp_cache_timer_start(netsnmp_cache *cache);
     void netsnmp_cache_timer_stop(netsnmp_cache *cache);
+    void netsnmp_cache_invalidate(netsnmp_cache *cache);
+
+    /*
+     * The value cache keeps the varbinds returned by the rest of the
+     * handler chain, and answers repeated GET/GETNEXT requests from them.
+     */
+    netsnmp_mib_handler *netsnmp_get_value_cache_handler(int timeout,
+                                                         const oid *rootoid,
+                                                         int rootoid_len);
+    Netsnmp_Node_Handler netsnmp_value_cache_helper_handler;
 
 /*
  * Flags affecting cache handler operation
@@ -78,4 +78,7 @@
 #define NETSNMP_DS_AGENT_AVG_BULKVARBINDSIZE 15 /* avg varbind size estimate */
 #define NETSNMP_DS_AGENT_PDU_STATS_MAX       16 /* size of top N array*/
 #define NETSNMP_DS_AGENT_PDU_STATS_THRESHOLD 17 /* minimum threshold time */
+#define NETSNMP_DS_AGENT_INFORM_MAX_INFLIGHT 18 /* outstanding INFORMs/sink */
+#define NETSNMP_DS_AGENT_INFORM_QUEUE_LENGTH 19 /* queued INFORMs per sink */
+#define NETSNMP_DS_AGENT_AGENTX_RING_SIZE   20 /* shared memory ring bytes */
 #endif
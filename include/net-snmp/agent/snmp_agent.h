@@ -341,6 +341,8 @@ extern          "C" {
     } netsnmp_pdu_stats;
 
     netsnmp_container * netsnmp_get_pdu_stats(void);
+    void netsnmp_get_pdu_stats_getbulk(u_long *responses, u_long *full,
+                                       u_long *bytes, u_long *budget);
 
 #endif /* NETSNMP_NO_PDU_STATS */
 
@@ -61,8 +61,29 @@ extern          "C" {
         u_long          data_len;
 
         struct netsnmp_table_data_set_storage_s *next;
+
+        /*
+         * values that fit are kept here, with data.voidp pointing to
+         * it, rather than in an allocation of their own.
+         */
+        union {
+            long            integer;
+            struct counter64 counter64;
+            u_char          string[sizeof(struct counter64)];
+        } value;
+
+        /*
+         * the cells of a row stored in a table are allocated together,
+         * sorted by column.  block_len is the number of cells from this
+         * one to the end of its block, or 0 for a cell allocated on its
+         * own.
+         */
+        unsigned int    block_len;
+        u_char          flags;
     } netsnmp_table_data_set_storage;
 
+#define NETSNMP_TABLE_DATA_SET_BLOCK_HEAD   0x01
+
     typedef struct netsnmp_table_data_set_s {
         netsnmp_table_data *table;
         netsnmp_table_data_set_storage *default_row;
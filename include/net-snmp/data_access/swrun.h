@@ -51,9 +51,21 @@ extern "C" {
          */
         int32_t         hrSWRunPerfCPU;
         int32_t         hrSWRunPerfMem;
+
+        /*
+         * for architectures that keep entries from one load to the next:
+         * tell a reused index from the same process, and whether the
+         * status and perf values need to be read again.
+         */
+        u_long          generation;
+        unsigned long long start_time;
+        u_char          flags;
         
     } netsnmp_swrun_entry;
 
+#define NETSNMP_SWRUN_ENTRY_SEEN        0x01
+#define NETSNMP_SWRUN_ENTRY_STALE       0x02
+
     /*
      * enums for column hrSWRunType
      */
@@ -82,8 +94,12 @@ extern "C" {
 
     netsnmp_swrun_entry *
     netsnmp_swrun_entry_create(int32_t swIndex);
+    netsnmp_swrun_entry *
+    netsnmp_swrun_entry_get_by_index(netsnmp_container *container,
+                                     oid index);
 
     void netsnmp_swrun_entry_free(netsnmp_swrun_entry *entry);
+    void netsnmp_swrun_entry_update(netsnmp_swrun_entry *entry);
 
     int  swrun_count_processes( int include_kthreads );
     int  swrun_max_processes(   void );
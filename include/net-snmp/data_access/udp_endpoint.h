@@ -64,6 +64,7 @@ extern          "C" {
     netsnmp_access_udp_endpoint_container_load(netsnmp_container* c,
                                           u_int load_flags);
 #define NETSNMP_ACCESS_UDP_ENDPOINT_LOAD_NOFLAGS               0x0000
+#define NETSNMP_ACCESS_UDP_ENDPOINT_LOAD_NETLINK               0x0001
 
     void netsnmp_access_udp_endpoint_container_free(netsnmp_container *c,
                                                u_int free_flags);
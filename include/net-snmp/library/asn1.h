@@ -282,6 +282,24 @@ SOFTWARE.
     u_char         *asn_parse_double(u_char *, size_t *, u_char *,
                                      double *, size_t);
 
+    /*
+     * Encoded sizes, without encoding anything.  asn_header_len() is the
+     * size of the type and length octets for 'length' bytes of contents;
+     * the others give the size of the contents only.
+     */
+    NETSNMP_IMPORT
+    size_t          asn_header_len(size_t length);
+    NETSNMP_IMPORT
+    size_t          asn_int_len(long value);
+    NETSNMP_IMPORT
+    size_t          asn_unsigned_int_len(u_long value);
+    NETSNMP_IMPORT
+    size_t          asn_unsigned_int64_len(const struct counter64 *cp);
+    NETSNMP_IMPORT
+    size_t          asn_signed_int64_len(const struct counter64 *cp);
+    NETSNMP_IMPORT
+    size_t          asn_objid_len(const oid *objid, size_t objidlength);
+
 #ifdef NETSNMP_USE_REVERSE_ASNENCODING
 
     /*
@@ -106,6 +106,7 @@ extern          "C" {
 #define NETSNMP_DS_LIB_FILTER_SOURCE       46 /* filter pkt by source IP */
 #define NETSNMP_DS_LIB_ADD_FORWARDER_INFO  47 /* add info about forwarder to SNMP packets */
 #define NETSNMP_DS_LIB_SSH_AGENT           48 /* enable ssh agent forwarding */
+#define NETSNMP_DS_LIB_TLS_DISABLE_RESUMPTION 49 /* no (D)TLS session resumption */
 #define NETSNMP_DS_LIB_MAX_BOOL_ID         64 /* match NETSNMP_DS_MAX_SUBIDS */
 
     /*
@@ -131,6 +132,9 @@ extern          "C" {
 #define NETSNMP_DS_LIB_RETRIES             15
 #define NETSNMP_DS_LIB_MSG_SEND_MAX        16 /* global max response size */
 #define NETSNMP_DS_LIB_FILTER_TYPE         17 /* 0=NONE, 1=whitelist, -1=blacklist */
+#define NETSNMP_DS_LIB_DTLS_MAX_CONNECTIONS 18 /* cached DTLS peers, 0=no limit */
+#define NETSNMP_DS_LIB_DTLS_IDLE_TIMEOUT   19 /* seconds, 0=none */
+#define NETSNMP_DS_LIB_ENGINETIME_EXPIRY   20 /* seconds, 0=never */
 #define NETSNMP_DS_LIB_MAX_INT_ID          64 /* match NETSNMP_DS_MAX_SUBIDS */
     
     /*
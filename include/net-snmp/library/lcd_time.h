@@ -18,7 +18,7 @@ extern          "C" {
     /*
      * Macros and definitions.
      */
-#define ETIMELIST_SIZE	23
+#define ETIMELIST_SIZE	32      /* initial number of lists; a power of two */
 
 
 
@@ -42,6 +42,11 @@ extern          "C" {
 #ifdef LCD_TIME_SYNC_OPT
         u_int           authenticatedFlag;
 #endif
+        time_t          lastUsed;
+        /*
+         * Timestamp made when the record was last looked up or updated,
+         * * for expiring idle records.
+         */
         struct enginetime_struct *next;
     } enginetime   , *Enginetime;
 
@@ -352,6 +352,9 @@ SOFTWARE.
     NETSNMP_IMPORT
     u_char         *snmp_build_var_op(u_char *, const oid *, size_t *, u_char,
                                       size_t, const void *, size_t *);
+    NETSNMP_IMPORT
+    size_t          snmp_var_op_len(const oid *, size_t, u_char,
+                                    const u_char *, size_t);
 
 
 #ifdef NETSNMP_USE_REVERSE_ASNENCODING
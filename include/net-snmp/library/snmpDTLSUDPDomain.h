@@ -22,6 +22,13 @@ NETSNMP_IMPORT size_t netsnmpDTLSUDPDomain_len;
 netsnmp_transport *
 netsnmp_dtlsudp_transport(const struct netsnmp_ep *ep, int local);
 
+/*
+ * Number of peer connections cached, and of those evicted so far.
+ */
+
+void            netsnmp_dtlsudp_cache_stats(size_t *connections,
+                                            u_long *evictions);
+
 
 /*
  * Register any configuration tokens specific to the agent.  
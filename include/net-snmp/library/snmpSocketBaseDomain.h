@@ -15,6 +15,8 @@ extern          "C" {
  * Prototypes
  */
     int netsnmp_socketbase_close(netsnmp_transport *t);
+    int netsnmp_socketbase_sendv(netsnmp_transport *t,
+                                 const struct iovec *iov, int iovcnt);
     int netsnmp_sock_buffer_set(int s, int optname, int local, int size);
     int netsnmp_set_non_blocking_mode(int sock, int non_blocking_mode);
 
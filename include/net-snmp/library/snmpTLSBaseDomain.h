@@ -48,6 +48,8 @@ extern          "C" {
        char                      *their_fingerprint;
        char                      *their_hostname;
        char                      *trust_cert;
+       char                      *session_key;
+       size_t                     session_key_len;
     } _netsnmpTLSBaseData;
 
 #define VRFY_PARENT_WAS_OK 1
@@ -75,6 +77,10 @@ extern          "C" {
     int netsnmp_tlsbase_session_init(struct netsnmp_transport_s *,
                                      struct snmp_session *sess);
     int tls_get_verify_info_index(void);
+    void netsnmp_tlsbase_resume_session(SSL *ssl,
+                                        _netsnmpTLSBaseData *tlsdata,
+                                        const void *peer, size_t peer_len);
+    void netsnmp_tlsbase_session_stats(u_long *resumed, u_long *full);
 
     void netsnmp_tlsbase_free_tlsdata(_netsnmpTLSBaseData *tlsbase);
 #ifdef __cplusplus
@@ -54,6 +54,9 @@ void        netsnmp_udp_com2Sec_free(com2SecEntry *e);
 
 int         netsnmp_udp_com2SecList_remove(com2SecEntry *e);
 
+NETSNMP_IMPORT
+void        netsnmp_udp_com2SecList_free(void);
+
 /*
  * Register any configuration tokens specific to the agent.  
  */
@@ -57,6 +57,8 @@ void            netsnmp_udp6_agent_config_tokens_register(void);
 NETSNMP_IMPORT
 void            netsnmp_udp6_parse_security(const char *token,
                                             char *param);
+NETSNMP_IMPORT
+void            netsnmp_udp6_com2Sec6List_free(void);
 
 NETSNMP_IMPORT
 int             netsnmp_udp6_getSecName(void *opaque, int olength,
@@ -38,6 +38,7 @@ int netsnmp_unix_getSecName(void *opaque, int olength,
                             const char *community,
                             size_t community_len, const char **secName,
                             const char **contextName);
+int netsnmp_unix_ring_offer(netsnmp_transport *t, size_t size);
 
 
 /*
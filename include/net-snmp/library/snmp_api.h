@@ -102,6 +102,10 @@ typedef struct request_list {
     struct snmp_session *session;
     netsnmp_pdu    *pdu;    /* The pdu for this request
 			     * (saved so it can be retransmitted */
+    struct request_list *prev_request;
+    struct request_list *next_reqid;     /* request id hash chain */
+    struct request_list *next_msgid;     /* message id hash chain */
+    size_t          timeout_index;       /* position in the timeout heap */
 } netsnmp_request_list;
 #endif                          /* SNMP_NEED_REQUEST_LIST */
 
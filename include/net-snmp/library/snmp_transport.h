@@ -131,6 +131,7 @@ typedef struct netsnmp_tdomain_spec_s {
 /*  Structure which defines the transport-independent API.  */
 
 struct snmp_session;
+struct iovec; /* forward decl */
 
 typedef struct netsnmp_transport_s {
     /*  The transport domain object identifier.  */
@@ -218,6 +219,12 @@ typedef struct netsnmp_transport_s {
     void           (*f_get_taddr)(struct netsnmp_transport_s *t,
                                   void **addr, size_t *addr_len);
 
+    /*  Optional callback for stream transports to send several messages
+        with one gather write; returns the number of bytes sent, fewer
+        than asked for if a non-blocking socket is full, or -1 */
+    int            (*f_sendv)(struct netsnmp_transport_s *,
+                              const struct iovec *, int);
+
 } netsnmp_transport;
 
 typedef struct netsnmp_transport_list_s {
@@ -261,6 +268,10 @@ char *netsnmp_transport_peer_string(netsnmp_transport *t, const void *data,
 
 int netsnmp_transport_send(netsnmp_transport *t, const void *data, int len,
                            void **opaque, int *olength);
+void netsnmp_transport_log_send(netsnmp_transport *t, const void *data,
+                                int len, void **opaque, int *olength);
+int netsnmp_transport_sendv(netsnmp_transport *t, const struct iovec *iov,
+                            int iovcnt);
 int netsnmp_transport_recv(netsnmp_transport *t, void *data, int len,
                            void **opaque, int *olength);
 
@@ -359,6 +370,34 @@ netsnmp_transport_open_server(const char* application, const char* str);
 netsnmp_transport*
 netsnmp_transport_open(const char* application, const char* str, int local);
 
+/*
+ * Binary tries over address prefixes (IPv4 or IPv6 networks), for
+ * longest prefix matching without formatting addresses.  Keys are in
+ * network byte order.
+ */
+
+#define NETSNMP_PREFIX_TRIE_MAX_BITS 128
+
+typedef struct netsnmp_prefix_trie_s netsnmp_prefix_trie;
+
+NETSNMP_IMPORT
+netsnmp_prefix_trie *netsnmp_prefix_trie_create(void);
+NETSNMP_IMPORT
+int     netsnmp_prefix_trie_insert(netsnmp_prefix_trie *trie,
+                                   const u_char *key, int bits, void *data);
+NETSNMP_IMPORT
+void   *netsnmp_prefix_trie_lookup(const netsnmp_prefix_trie *trie,
+                                   const u_char *addr, int bits);
+NETSNMP_IMPORT
+int     netsnmp_prefix_trie_matches(const netsnmp_prefix_trie *trie,
+                                    const u_char *addr, int bits,
+                                    void **matches, int max);
+NETSNMP_IMPORT
+size_t  netsnmp_prefix_trie_count(const netsnmp_prefix_trie *trie);
+NETSNMP_IMPORT
+void    netsnmp_prefix_trie_free(netsnmp_prefix_trie *trie,
+                                 void (*free_data)(void *));
+
 typedef struct netsnmp_transport_config_s {
    char *key;
    char *value;
@@ -383,6 +422,12 @@ int netsnmp_transport_filter_remove(const char *addrtxt);
 NETSNMP_IMPORT
 int netsnmp_transport_filter_check(const char *addrtxt);
 
+NETSNMP_IMPORT
+int netsnmp_transport_filter_check_addr(const struct sockaddr *sa);
+
+NETSNMP_IMPORT
+long netsnmp_transport_filter_hits(const char *addrtxt);
+
 NETSNMP_IMPORT
 void netsnmp_transport_filter_cleanup(void);
 
@@ -152,6 +152,22 @@ extern          "C" {
      * Returns NULL if that entry does not exist.
      */
 
+    /*
+     * Compiled views, for quick repeated lookups.  They are only valid
+     * until the next call to vacm_tablesChanged(), which must follow any
+     * change to the group, access or view tables.
+     */
+    typedef struct vacm_compiledView_s vacm_compiledView;
+    NETSNMP_IMPORT
+    void            vacm_tablesChanged(void);
+    NETSNMP_IMPORT
+    u_int           vacm_tablesGeneration(void);
+    NETSNMP_IMPORT
+    vacm_compiledView *vacm_getCompiledView(const char *);
+    NETSNMP_IMPORT
+    struct vacm_viewEntry *vacm_compiledViewGet(vacm_compiledView *,
+                                                const oid *, size_t);
+
     NETSNMP_IMPORT
     int vacm_checkSubtree(const char *, oid *, size_t);
 
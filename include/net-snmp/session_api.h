@@ -249,6 +249,15 @@ extern          "C" {
     int             snmp_sess_async_send(struct session_list *, netsnmp_pdu *,
                                          netsnmp_callback, void *);
     NETSNMP_IMPORT
+    int             snmp_sess_build_packet(struct session_list *,
+                                           netsnmp_pdu *, u_char **,
+                                           size_t *);
+    NETSNMP_IMPORT
+    int             snmp_sess_async_send_packet(struct session_list *,
+                                                netsnmp_pdu *,
+                                                const u_char *, size_t,
+                                                netsnmp_callback, void *);
+    NETSNMP_IMPORT
     int             snmp_sess_select_info(struct session_list *, int *, fd_set *,
                                           struct timeval *, int *);
     NETSNMP_IMPORT
@@ -285,6 +285,19 @@ typedef struct netsnmp_trap_stats_s {
 
     u_long   timeouts;
     u_long   sent_last_timeout;
+
+    /*
+     * INFORM flow control: requests awaiting a response and INFORMs
+     * waiting in a ring of inform_queue_size entries for a free slot.
+     */
+    u_long   inform_inflight;
+    u_long   inform_queue_drops;
+    u_long   inform_drops_logged;
+    u_long   inform_drop_last_log;
+    u_int    inform_queue_len;
+    u_int    inform_queue_head;
+    u_int    inform_queue_size;
+    netsnmp_pdu **inform_queue;
 } netsnmp_trap_stats;
 #endif /* NETSNMP_NO_TRAP_STATS */
 
@@ -128,11 +128,20 @@ static char* __av_elem_pv _((AV * av, I32 key, char *dflt));
 #define FAIL_ON_NULL_IID 0x01
 #define NO_FLAGS 0x00
 
+/* Buffers of a packed bulkwalk() result, see SNMP::PackedVarList. */
+#define PACKED_OIDS		0	/* uint32 sub-identifiers of all OIDs */
+#define PACKED_OID_OFFSETS	1	/* uint32 end offsets into OIDS       */
+#define PACKED_TYPES		2	/* one ASN.1 type byte per varbind    */
+#define PACKED_VALUES		3	/* raw value bytes of all varbinds    */
+#define PACKED_VALUE_OFFSETS	4	/* uint32 end offsets into VALUES     */
+#define PACKED_NBUFS		5
+
 /* Structures used by snmp_bulkwalk method to track requested OID's/subtrees. */
 typedef struct bulktbl {
    oid	req_oid[MAX_OID_LEN];	/* The OID originally requested.    */
    oid	last_oid[MAX_OID_LEN];	/* Last-seen OID under this branch. */
    AV	*vars;			/* Array of Varbinds for this OID.  */
+   SV	*packed[PACKED_NBUFS];	/* Packed varbinds, if walk packed. */
    size_t req_len;		/* Length of requested OID.         */
    size_t last_len;		/* Length of last-seen OID.         */
    char norepeat;		/* Is this a non-repeater OID?      */
@@ -158,6 +167,7 @@ typedef struct walk_context {
    int		pkts_exch;	/* Number of packet exchanges with agent.   */
    int		oid_total;	/* Total number of OIDs received this walk. */
    int		oid_saved;	/* Total number of OIDs saved as results.   */
+   int		packed;		/* Return SNMP::PackedVarList's, not Varbinds */
 } walk_context;
 
 /* Prototypes for bulkwalk support functions. */
@@ -165,6 +175,12 @@ static netsnmp_pdu *_bulkwalk_send_pdu _((walk_context *context));
 static int _bulkwalk_done     _((walk_context *context));
 static int _bulkwalk_recv_pdu _((walk_context *context, netsnmp_pdu *pdu));
 static int _bulkwalk_finish   _((walk_context *context, int okay));
+static int _bulkwalk_pack_init _((bulktbl *bt_entry));
+static void _bulkwalk_pack    _((bulktbl *bt_entry,
+				     netsnmp_variable_list *vars));
+static SV *_bulkwalk_packed_list _((walk_context *context,
+				     bulktbl *bt_entry));
+static void _bulkwalk_free_results _((walk_context *context));
 static int _bulkwalk_async_cb _((int op, SnmpSession *ss, int reqid,
 				     netsnmp_pdu *pdu, void *context_ptr));
 
@@ -2105,6 +2121,15 @@ _bulkwalk_recv_pdu(walk_context *context, netsnmp_pdu *pdu)
 
       }
 
+      /* For a packed walk, just append the raw variable to the buffers for
+      ** this request.  Translation is left to SNMP::PackedVarList.
+      */
+      if (context->packed) {
+	 _bulkwalk_pack(expect, vars);
+	 context->oid_saved ++;
+	 continue;
+      }
+
       /* Create a new Varbind and populate it with the parsed information
       ** returned by the agent.  This Varbind is then pushed onto the arrays
       ** maintained for each request OID in the context.  These varbinds are
@@ -2201,6 +2226,153 @@ _bulkwalk_recv_pdu(walk_context *context, netsnmp_pdu *pdu)
 
 }
 
+/* Create the packed buffers of a bulkwalk request.  The offset arrays
+** start out holding the start offset of the first variable.
+**
+** Returns 0 on success, or -1 if a buffer could not be created.
+*/
+static int
+_bulkwalk_pack_init(bulktbl *bt_entry)
+{
+   uint32_t	zero = 0;
+   int		i;
+
+   for (i = 0; i < PACKED_NBUFS; i++) {
+      if ((bt_entry->packed[i] = newSVpvn("", 0)) == NULL)
+	 return -1;
+   }
+   sv_catpvn(bt_entry->packed[PACKED_OID_OFFSETS], (char *)&zero, sizeof(zero));
+   sv_catpvn(bt_entry->packed[PACKED_VALUE_OFFSETS], (char *)&zero, sizeof(zero));
+   return 0;
+}
+
+/* Append a variable to the packed buffers of a bulkwalk request.  The
+** layout matches the one used by the Python bindings: integers are stored
+** as native 64-bit values, floats as doubles, OBJECT IDENTIFIER values as
+** uint32 sub-identifiers and everything else as the raw value bytes.
+*/
+static void
+_bulkwalk_pack(bulktbl *bt_entry, netsnmp_variable_list *vars)
+{
+   SV		**buf = bt_entry->packed;
+   const void	*val = NULL;
+   size_t	val_len = 0;
+   char		type = vars->type;
+   int64_t	i64;
+   uint64_t	u64;
+   double	d;
+   uint32_t	subid;
+   uint32_t	offset;
+   size_t	i;
+
+   switch (vars->type) {
+   case ASN_INTEGER:
+      i64 = *vars->val.integer;
+      val = &i64;
+      val_len = sizeof(i64);
+      break;
+   case ASN_COUNTER:
+   case ASN_GAUGE:
+   case ASN_TIMETICKS:
+   case ASN_UINTEGER:
+      u64 = (u_long)*vars->val.integer & 0xffffffffUL;
+      val = &u64;
+      val_len = sizeof(u64);
+      break;
+   case ASN_COUNTER64:
+#ifdef OPAQUE_SPECIAL_TYPES
+   case ASN_OPAQUE_COUNTER64:
+   case ASN_OPAQUE_U64:
+   case ASN_OPAQUE_I64:
+#endif
+      u64 = ((uint64_t)vars->val.counter64->high << 32) |
+	 vars->val.counter64->low;
+      val = &u64;
+      val_len = sizeof(u64);
+      break;
+#ifdef OPAQUE_SPECIAL_TYPES
+   case ASN_OPAQUE_FLOAT:
+      d = *vars->val.floatVal;
+      val = &d;
+      val_len = sizeof(d);
+      break;
+   case ASN_OPAQUE_DOUBLE:
+      d = *vars->val.doubleVal;
+      val = &d;
+      val_len = sizeof(d);
+      break;
+#endif
+   case ASN_OBJECT_ID:
+      for (i = 0; i < vars->val_len / sizeof(oid); i++) {
+	 subid = vars->val.objid[i];
+	 sv_catpvn(buf[PACKED_VALUES], (char *)&subid, sizeof(subid));
+      }
+      break;
+   case ASN_NULL:
+      break;
+   default:
+      val = vars->val.string;
+      val_len = vars->val_len;
+      break;
+   }
+
+   for (i = 0; i < vars->name_length; i++) {
+      subid = vars->name[i];
+      sv_catpvn(buf[PACKED_OIDS], (char *)&subid, sizeof(subid));
+   }
+   offset = SvCUR(buf[PACKED_OIDS]) / sizeof(subid);
+   sv_catpvn(buf[PACKED_OID_OFFSETS], (char *)&offset, sizeof(offset));
+   sv_catpvn(buf[PACKED_TYPES], &type, 1);
+   if (val_len)
+      sv_catpvn(buf[PACKED_VALUES], (const char *)val, val_len);
+   offset = SvCUR(buf[PACKED_VALUES]);
+   sv_catpvn(buf[PACKED_VALUE_OFFSETS], (char *)&offset, sizeof(offset));
+}
+
+/* Wrap the packed buffers of a bulkwalk request in a new, blessed
+** SNMP::PackedVarList hash.  The buffers are handed over to the hash.
+*/
+static SV *
+_bulkwalk_packed_list(walk_context *context, bulktbl *bt_entry)
+{
+   static const char *keys[PACKED_NBUFS] = {
+      "oids", "oid_offsets", "types", "values", "value_offsets"
+   };
+   HV		*hv = newHV();
+   SV		*rv;
+   int		i;
+
+   for (i = 0; i < PACKED_NBUFS; i++) {
+      hv_store(hv, keys[i], strlen(keys[i]), bt_entry->packed[i], 0);
+      bt_entry->packed[i] = NULL;
+   }
+   hv_store(hv, "session", 7, newSVsv(context->sess_ref), 0);
+
+   rv = newRV_noinc((SV *)hv);
+   sv_bless(rv, gv_stashpv("SNMP::PackedVarList", GV_ADD));
+   return rv;
+}
+
+/* Release the per-request result storage of a bulkwalk context. */
+static void
+_bulkwalk_free_results(walk_context *context)
+{
+   bulktbl	*bt_entry;
+   int		i, j;
+
+   if (context->req_oids == NULL)
+      return;
+   for (i = 0, bt_entry = context->req_oids; i < context->nreq_oids;
+	i++, bt_entry++) {
+      for (j = 0; j < PACKED_NBUFS; j++) {
+	 if (bt_entry->packed[j]) {
+	    SvREFCNT_dec(bt_entry->packed[j]);
+	    bt_entry->packed[j] = NULL;
+	 }
+      }
+   }
+}
+
 /* Once the bulkwalk has completed, extend the stack and push references to
 ** each of the arrays of SNMP::Varbind's onto the stack.  Return the number
 ** of arrays pushed on the stack.  The caller should return to Perl, or call
@@ -2306,8 +2478,13 @@ _bulkwalk_finish(walk_context *context, int okay)
 	  }
 
 	  /* Get a reference to the varlist, and push it onto array or stack */
-	  rv = newRV_noinc((SV *)bt_entry->vars);
-	  sv_bless(rv, gv_stashpv("SNMP::VarList",0));
+	  if (context->packed) {
+	     rv = _bulkwalk_packed_list(context, bt_entry);
+	     SvREFCNT_dec((SV *)bt_entry->vars);
+	  } else {
+	     rv = newRV_noinc((SV *)bt_entry->vars);
+	     sv_bless(rv, gv_stashpv("SNMP::VarList",0));
+	  }
 
 	  if (async)
 	     av_push(ary, rv);
@@ -2355,6 +2532,7 @@ _bulkwalk_finish(walk_context *context, int okay)
        __call_callback(perl_cb, G_DISCARD);
    }
    sv_2mortal(context->sess_ref);
+   _bulkwalk_free_results(context);
 
    /* Free the allocated space for the request states and return number of
    ** variables found.  Remove the context from the valid context list.
@@ -3937,12 +4115,13 @@ done:
 	}
 
 void
-snmp_bulkwalk(sess_ref, nonrepeaters, maxrepetitions, varlist_ref,perl_callback)
+snmp_bulkwalk(sess_ref, nonrepeaters, maxrepetitions, varlist_ref,perl_callback,packed=0)
         SV *	sess_ref
 	int nonrepeaters
 	int maxrepetitions
         SV *	varlist_ref
         SV *	perl_callback
+	int packed
 	PPCODE:
 	{
            AV *varlist;
@@ -4014,6 +4193,7 @@ snmp_bulkwalk(sess_ref, nonrepeaters, maxrepetitions, varlist_ref,perl_callback)
 	   context->pkts_exch   = 0;		/* Packets exchanged in walk */
 	   context->oid_total   = 0;		/* OID's received during walk */
 	   context->oid_saved   = 0;		/* OID's saved as results */
+	   context->packed      = packed;	/* PackedVarList results */
 
 	   if (SvIV(*hv_fetch((HV*)SvRV(sess_ref),"UseLongNames", 12, 1)))
 	      context->getlabel_f |= USE_LONG_NAMES;
@@ -4122,6 +4302,12 @@ snmp_bulkwalk(sess_ref, nonrepeaters, maxrepetitions, varlist_ref,perl_callback)
 		 sv_setiv(*err_num_svp, SNMPERR_MALLOC);
 		 goto err;
 	      }
+	      if (packed && _bulkwalk_pack_init(bt_entry) < 0) {
+		 sv_setpv(*err_str_svp, "newSVpvn() failed: ");
+		 sv_catpv(*err_str_svp, strerror(errno));
+		 sv_setiv(*err_num_svp, SNMPERR_MALLOC);
+		 goto err;
+	      }
 	      DBPRT(1,(DBOUT "%s\n", __snprint_oid(oid_arr, oid_arr_len)));
 	      context->nreq_oids ++;
 	   }
@@ -4231,6 +4417,7 @@ snmp_bulkwalk(sess_ref, nonrepeaters, maxrepetitions, varlist_ref,perl_callback)
 	         bt_entry = context->req_oids;
 	         for (i = 0; i < context->nreq_oids; i++, bt_entry++)
 		    av_clear(bt_entry->vars);
+	         _bulkwalk_free_results(context);
 	      }
 	      if (context->req_oids)
 	         Safefree(context->req_oids);
@@ -4243,6 +4430,90 @@ snmp_bulkwalk(sess_ref, nonrepeaters, maxrepetitions, varlist_ref,perl_callback)
 	}
 
 
+void
+snmp_translate_packed(sess_ref, oids, asn_type)
+        SV *	sess_ref
+        SV *	oids
+	int	asn_type
+	PPCODE:
+	{
+	   /* Translate one OID of an SNMP::PackedVarList into the tag, iid
+	   ** and type that bulkwalk() would have put into its Varbind.
+	   */
+	   oid oid_arr[MAX_OID_LEN];
+	   size_t oid_arr_len;
+	   STRLEN oids_len;
+	   const char *oids_buf = SvPV(oids, oids_len);
+	   uint32_t subid;
+	   struct tree *tp;
+	   char str_buf[STR_BUF_SIZE], *str_bufp = str_buf;
+	   size_t str_buf_len = sizeof(str_buf);
+	   size_t out_len = 0;
+	   int buf_over = 0;
+	   char type_str[MAX_TYPE_NAME_LEN];
+	   char *label;
+	   char *iid;
+	   int getlabel_flag = NO_FLAGS;
+	   int type;
+	   int old_numeric, old_printfull, old_format;
+
+	   if (!SvROK(sess_ref))
+	      XSRETURN_EMPTY;
+	   if (SvIV(*hv_fetch((HV*)SvRV(sess_ref),"UseLongNames", 12, 1)))
+	      getlabel_flag |= USE_LONG_NAMES;
+	   if (SvIV(*hv_fetch((HV*)SvRV(sess_ref),"UseNumeric", 10, 1)))
+	      getlabel_flag |= USE_NUMERIC_OIDS;
+
+	   oid_arr_len = oids_len / sizeof(subid);
+	   if (oid_arr_len > MAX_OID_LEN)
+	      oid_arr_len = MAX_OID_LEN;
+	   for (out_len = 0; out_len < oid_arr_len; out_len++) {
+	      Copy(oids_buf + out_len * sizeof(subid), &subid, 1, uint32_t);
+	      oid_arr[out_len] = subid;
+	   }
+
+	   old_numeric   = netsnmp_ds_get_boolean(NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_PRINT_NUMERIC_OIDS);
+	   old_printfull = netsnmp_ds_get_boolean(NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_PRINT_FULL_OID);
+	   old_format = netsnmp_ds_get_int(NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_OID_OUTPUT_FORMAT);
+	   if (getlabel_flag & USE_NUMERIC_OIDS) {
+	      netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_PRINT_NUMERIC_OIDS, 1);
+	      netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_PRINT_FULL_OID, 1);
+	      netsnmp_ds_set_int(NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_OID_OUTPUT_FORMAT, NETSNMP_OID_OUTPUT_NUMERIC);
+	   }
+
+	   *str_buf = '.';
+	   *(str_buf+1) = '\0';
+	   out_len = 0;
+	   tp = netsnmp_sprint_realloc_objid_tree((u_char**)&str_bufp, &str_buf_len,
+						  &out_len, 0, &buf_over,
+						  oid_arr, oid_arr_len);
+	   str_buf[sizeof(str_buf)-1] = '\0';
+
+	   if (getlabel_flag & USE_NUMERIC_OIDS) {
+	      netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_PRINT_NUMERIC_OIDS, old_numeric);
+	      netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_PRINT_FULL_OID, old_printfull);
+	      netsnmp_ds_set_int(NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_OID_OUTPUT_FORMAT, old_format);
+	   }
+
+	   if (__is_leaf(tp)) {
+	      type = tp->type;
+	   } else {
+	      getlabel_flag |= NON_LEAF_NAME;
+	      type = __translate_asn_type(asn_type);
+	   }
+	   if (__get_label_iid(str_buf, &label, &iid, getlabel_flag) == FAILURE) {
+	      label = str_buf;
+	      iid = label + strlen(label);
+	   }
+	   __get_type_str(type, type_str);
+
+	   EXTEND(sp, 3);
+	   PUSHs(sv_2mortal(newSVpv(label, strlen(label))));
+	   PUSHs(sv_2mortal(newSVpv(iid, strlen(iid))));
+	   PUSHs(sv_2mortal(newSVpv(type_str, strlen(type_str))));
+	}
+
+
 void
 snmp_trapV1(sess_ref,enterprise,agent,generic,specific,uptime,varlist_ref)
         SV *	sess_ref
@@ -7,7 +7,7 @@ use warnings;
 use Cwd qw(abs_path);
 use Test;
 
-BEGIN { plan test => ($^O =~ /win32/i) ? 43 : 64; }
+BEGIN { plan test => ($^O =~ /win32/i) ? 49 : 70; }
 
 use SNMP;
 
@@ -207,6 +207,17 @@ else {
   ok(0);
 }
 
+###############################################################################
+print("# Attempt to use the packed bulkwalk method\n");
+print("# test 4\n");
+@list = $s1->bulkwalk_packed(0, 256, $vars);
+ok($s1->{ErrorNum} == 0);
+ok(scalar @list == $expect);
+ok($list[0]->count == $ifaces);
+ok($list[1]->count == $ifaces);
+ok($list[1]->varbind(0)->tag, ".1.3.6.1.2.1.2.2.1.5");	# ifSpeed OID.
+ok($list[1]->value(0) =~ m/^\d+$/);		# Unpacked as a number.
+
 ######################################################################
 #  Asynchronous Bulkwalk Methods
 ######################################################################
@@ -1,5 +1,9 @@
 from __future__ import print_function
+import asyncio
 import re
+import select
+import sys
+from array import array
 from sys import stderr
 import netsnmp
 import netsnmp.client_intf
@@ -216,6 +220,47 @@ class Session(object):
         res = netsnmp.client_intf.walk(self, varlist)
         return res
 
+    def bulkwalk(self, varlist, maxrepetitions=25):
+        self._clear_error()
+        walk = _BulkWalk(self, varlist)
+        while walk.active:
+            sent = netsnmp.client_intf.async_send(
+                self, *walk.next_request(maxrepetitions))
+            walk.sent(sent)
+            if sent is not None:
+                walk.receive(self._wait(sent))
+        return walk.finish(varlist)
+
+    def bulkwalk_packed(self, varlist, maxrepetitions=25):
+        self._clear_error()
+        buffers = netsnmp.client_intf.bulkwalk_packed(self, maxrepetitions,
+                                                      varlist)
+        if buffers is None:
+            return None
+        return PackedVarList(self, *buffers)
+
+    def _wait(self, sent):
+        """Block until the request submitted by async_send() completes."""
+        reqid = sent[0]
+        fd = netsnmp.client_intf.async_fd(self)
+        completions = []
+        while True:
+            for completion in completions:
+                if completion[0] == reqid:
+                    return completion
+            completions, timeout = netsnmp.client_intf.async_timeout(self)
+            if any(completion[0] == reqid for completion in completions):
+                continue
+            if timeout is None:
+                return None
+            readable = select.select([fd], [], [], timeout)[0]
+            if readable:
+                completions = netsnmp.client_intf.async_read(self)
+
+    def _update_errors(self, completion):
+        if completion is not None:
+            self.ErrorStr, self.ErrorNum, self.ErrorInd = completion[1:4]
+
     def __del__(self):
         res = netsnmp.client_intf.delete_session(self)
         return res
@@ -223,6 +268,285 @@ class Session(object):
     def __str__(self):
         return obj_to_str(self)
 
+_EXCEPTION_TYPES = ('ENDOFMIBVIEW', 'NOSUCHOBJECT', 'NOSUCHINSTANCE')
+
+
+class _BulkWalk(object):
+    """State of a walk of one or more subtrees using GETBULK requests.
+
+    Each varbind of the VarList is walked independently; a subtree is
+    finished when the agent returns an OID outside of it, an exception
+    value or an OID that does not increase.  SNMPv1 sessions fall back to
+    GETNEXT.
+    """
+    def __init__(self, sess, varlist):
+        self.sess = sess
+        self.varlist = varlist
+        self.roots = None
+        self.last = None
+        self.active = list(range(len(varlist)))
+        self.varbinds = []
+        self.vals = []
+
+    def next_request(self, maxrepetitions):
+        """Return the async_send() arguments for the next request."""
+        if self.roots is None:
+            request = self.varlist
+        else:
+            request = VarList(*[Varbind('.' + '.'.join(map(str, self.last[i])))
+                                for i in self.active])
+        if self.sess.Version == 1:
+            return 'getnext', 0, 0, request
+        return 'getbulk', 0, maxrepetitions, request
+
+    def sent(self, sent):
+        if sent is None:
+            self.active = []
+        elif self.roots is None:
+            self.roots = sent[1]
+            self.last = list(sent[1])
+
+    def receive(self, completion):
+        self.sess._update_errors(completion)
+        if completion is None or completion[1] or not completion[4]:
+            self.active = []
+            return
+        varbinds, oids, vals = completion[4:7]
+        columns = self.active
+        done = set()
+        for k, varbind in enumerate(varbinds):
+            column = columns[k % len(columns)]
+            if column in done:
+                continue
+            root = self.roots[column]
+            name = oids[k]
+            if (varbind.type in _EXCEPTION_TYPES or
+                    name[:len(root)] != root or name <= self.last[column]):
+                done.add(column)
+                continue
+            self.varbinds.append(varbind)
+            self.vals.append(vals[k])
+            self.last[column] = name
+        self.active = [column for column in columns if column not in done]
+
+    def finish(self, varlist):
+        if isinstance(varlist, VarList):
+            del varlist.varbinds[:]
+            varlist.varbinds.extend(self.varbinds)
+        return tuple(self.vals)
+
+
+# ASN.1 types as stored in PackedVarList.types
+_ASN_SIGNED = (0x02, 0x7a)                      # INTEGER, Opaque Integer64
+_ASN_UNSIGNED = (0x41, 0x42, 0x43, 0x47,        # Counter32, Gauge32,
+                 0x46, 0x76, 0x7b)              # TimeTicks, UInteger32,
+                                                # Counter64, Opaque U64
+_ASN_FLOAT = (0x78, 0x79)                       # Opaque Float and Double
+_ASN_OBJECT_ID = 0x06
+_ASN_EMPTY = (0x05, 0x80, 0x81, 0x82)           # NULL and exceptions
+
+
+class PackedVarList(object):
+    """The result of Session.bulkwalk_packed().
+
+    The varbinds are stored in flat buffers instead of as Varbind objects
+    and are exposed as memoryviews:
+
+        oids          - the sub-identifiers of all OIDs (format 'I')
+        oid_offsets   - len(self) + 1 offsets into oids (format 'I')
+        types         - the ASN.1 type of each varbind (format 'B')
+        values        - the raw value bytes of all varbinds (format 'B')
+        value_offsets - len(self) + 1 offsets into values (format 'I')
+
+    Integers are stored as native 64-bit integers, OBJECT IDENTIFIER
+    values as 'I' sub-identifiers and floats as native doubles.
+    Translation into symbolic names only happens when varbind() or
+    indexing is used.
+    """
+    def __init__(self, sess, oids, oid_offsets, types, values,
+                 value_offsets):
+        self.sess = sess
+        self.oids = memoryview(oids).cast('I')
+        self.oid_offsets = memoryview(oid_offsets).cast('I')
+        self.types = memoryview(types)
+        self.values = memoryview(values)
+        self.value_offsets = memoryview(value_offsets).cast('I')
+
+    def __len__(self):
+        return len(self.types)
+
+    def __getitem__(self, index):
+        if index < 0:
+            index += len(self)
+        if not 0 <= index < len(self):
+            raise IndexError(index)
+        return self.varbind(index)
+
+    def oid(self, index):
+        """Return the OID of a varbind as a tuple of integers."""
+        return tuple(self.oids[self.oid_offsets[index]:
+                               self.oid_offsets[index + 1]])
+
+    def raw_value(self, index):
+        """Return the raw value bytes of a varbind as a memoryview."""
+        return self.values[self.value_offsets[index]:
+                           self.value_offsets[index + 1]]
+
+    def value(self, index):
+        """Return the value of a varbind as a Python object."""
+        asn_type = self.types[index]
+        raw = self.raw_value(index)
+        if asn_type in _ASN_SIGNED:
+            return int.from_bytes(raw, sys.byteorder, signed=True)
+        if asn_type in _ASN_UNSIGNED:
+            return int.from_bytes(raw, sys.byteorder)
+        if asn_type in _ASN_FLOAT:
+            return raw.cast('d')[0]
+        if asn_type == _ASN_OBJECT_ID:
+            return '.' + '.'.join(map(str, array('I', raw.tobytes())))
+        if asn_type in _ASN_EMPTY:
+            return None
+        return raw.tobytes()
+
+    def varbind(self, index):
+        """Translate a varbind into a Varbind object."""
+        tag, iid, type_str = netsnmp.client_intf.translate_packed(
+            self.sess, self.oid(index), self.types[index])
+        val = self.value(index)
+        if isinstance(val, bytes):
+            try:
+                val = val.decode()
+            except UnicodeDecodeError:
+                pass
+        return Varbind(tag, iid, val, type_str)
+
+
+class AsyncSession(Session):
+    """A Session whose requests are driven by an asyncio event loop.
+
+    Any number of requests may be outstanding at once.  Replies are read
+    when the session socket becomes readable and retransmissions and
+    timeouts are handled from loop timers, so a single thread can poll
+    many agents concurrently.  The methods are coroutines with the same
+    arguments and results as those of Session.
+    """
+    def __init__(self, loop=None, **args):
+        Session.__init__(self, **args)
+        self._loop = loop
+        self._futures = {}
+        self._fd = -1
+        self._timer = None
+
+    def _submit(self, pdu_type, nonrepeaters, maxrepetitions, varlist):
+        if self._loop is None:
+            self._loop = asyncio.get_event_loop()
+        future = self._loop.create_future()
+        sent = netsnmp.client_intf.async_send(self, pdu_type, nonrepeaters,
+                                              maxrepetitions, varlist)
+        if sent is None:
+            future.set_result(None)
+            return None, future
+        self._futures[sent[0]] = future
+        if self._fd < 0:
+            self._fd = netsnmp.client_intf.async_fd(self)
+            self._loop.add_reader(self._fd, self._on_readable)
+        self._schedule()
+        return sent, future
+
+    def _dispatch(self, completions):
+        for completion in completions:
+            future = self._futures.pop(completion[0], None)
+            if future is not None and not future.done():
+                future.set_result(completion)
+        if not self._futures and self._fd >= 0:
+            self._loop.remove_reader(self._fd)
+            self._fd = -1
+
+    def _on_readable(self):
+        self._dispatch(netsnmp.client_intf.async_read(self))
+        self._schedule()
+
+    def _schedule(self):
+        if self._timer is not None:
+            self._timer.cancel()
+            self._timer = None
+        completions, timeout = netsnmp.client_intf.async_timeout(self)
+        self._dispatch(completions)
+        if timeout is not None and self._futures:
+            self._timer = self._loop.call_later(timeout, self._on_timer)
+
+    def _on_timer(self):
+        self._timer = None
+        self._schedule()
+
+    async def _request(self, pdu_type, nonrepeaters, maxrepetitions, varlist):
+        self._clear_error()
+        future = self._submit(pdu_type, nonrepeaters, maxrepetitions,
+                              varlist)[1]
+        completion = await future
+        self._update_errors(completion)
+        return completion
+
+    async def get(self, varlist):
+        return await self._getnext_or_get('get', varlist)
+
+    async def getnext(self, varlist):
+        return await self._getnext_or_get('getnext', varlist)
+
+    async def _getnext_or_get(self, pdu_type, varlist):
+        completion = await self._request(pdu_type, 0, 0, varlist)
+        vals = [None] * len(varlist)
+        if completion is None:
+            return tuple(vals)
+        err_ind = completion[3] if completion[2] else 0
+        for i, varbind in enumerate(completion[4][:len(varlist)]):
+            if err_ind >= 1 and i >= err_ind - 1:
+                continue
+            if isinstance(varlist[i], Varbind):
+                varlist[i].__dict__.update(varbind.__dict__)
+            vals[i] = completion[6][i]
+        return tuple(vals)
+
+    async def getbulk(self, nonrepeaters, maxrepetitions, varlist):
+        if self.Version == 1:
+            return None
+        completion = await self._request('getbulk', nonrepeaters,
+                                         maxrepetitions, varlist)
+        if completion is None or not completion[4]:
+            return ()
+        if isinstance(varlist, VarList):
+            del varlist.varbinds[:]
+            varlist.varbinds.extend(completion[4])
+        return tuple(completion[6])
+
+    async def walk(self, varlist, maxrepetitions=25):
+        self._clear_error()
+        walk = _BulkWalk(self, varlist)
+        while walk.active:
+            sent, future = self._submit(*walk.next_request(maxrepetitions))
+            walk.sent(sent)
+            if sent is not None:
+                walk.receive(await future)
+        return walk.finish(varlist)
+
+    bulkwalk = walk
+
+    def close(self):
+        """Cancel the outstanding requests and close the session."""
+        if self._timer is not None:
+            self._timer.cancel()
+            self._timer = None
+        if self._fd >= 0:
+            self._loop.remove_reader(self._fd)
+            self._fd = -1
+        netsnmp.client_intf.delete_session(self)
+        self.sess_ptr = 0
+        for future in self._futures.values():
+            if not future.done():
+                future.cancel()
+        self._futures.clear()
+
+
 def snmpget(*args, **kargs):
     sess = Session(**kargs)
     var_list = VarList()
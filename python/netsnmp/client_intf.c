@@ -10,6 +10,7 @@ typedef int Py_ssize_t;
 
 #include <net-snmp/net-snmp-config.h>
 #include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/library/large_fd_set.h>
 #include <sys/types.h>
 #include <arpa/inet.h>
 #include <errno.h>
@@ -1293,11 +1294,105 @@ netsnmp_create_session_tunneled(PyObject *self, PyObject *args)
   return ss ? PyLong_FromVoidPtr(ss) : NULL;
 }
 
+/*
+ * Asynchronous request support.
+ *
+ * Requests are submitted with snmp_sess_async_send(). Their completions
+ * (responses, timeouts and send failures) are queued on the session by
+ * __py_netsnmp_async_cb() while the library reads packets or processes
+ * timeouts with the GIL released, and are turned into Python objects
+ * afterwards. The queue lives in the myvoid member of the library's copy
+ * of the session. A session must only be driven from one thread at a time.
+ */
+struct py_netsnmp_completion {
+    struct py_netsnmp_completion *next;
+    int             reqid;
+    int             err_num;
+    int             err_ind;
+    long            errstat;
+    netsnmp_variable_list *vars;
+};
+
+struct py_netsnmp_async_state {
+    struct py_netsnmp_completion *head;
+    struct py_netsnmp_completion **tail;
+};
+
+static int
+__py_netsnmp_async_cb(int op, netsnmp_session *sp, int reqid,
+                      netsnmp_pdu *pdu, void *magic)
+{
+    struct py_netsnmp_async_state *state = magic;
+    struct py_netsnmp_completion *c;
+
+    if (op == NETSNMP_CALLBACK_OP_RESEND)
+        return 1;
+
+    c = calloc(1, sizeof(*c));
+    if (!c)
+        return 1;
+    c->reqid = reqid;
+
+    switch (op) {
+    case NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE:
+        c->errstat = pdu->errstat;
+        c->err_num = pdu->errstat;
+        c->err_ind = pdu->errindex;
+        /* take over the decoded varbinds; the library frees the PDU */
+        c->vars = pdu->variables;
+        pdu->variables = NULL;
+        break;
+    case NETSNMP_CALLBACK_OP_TIMED_OUT:
+        c->err_ind = SNMPERR_TIMEOUT;
+        break;
+    default:
+        c->err_num = sp->s_errno;
+        c->err_ind = sp->s_snmp_errno ? sp->s_snmp_errno : SNMPERR_GENERR;
+        break;
+    }
+
+    *state->tail = c;
+    state->tail = &c->next;
+    return 1;
+}
+
+static struct py_netsnmp_async_state *
+__py_netsnmp_async_state(struct session_list *ss, int create)
+{
+    netsnmp_session *sp = ss ? snmp_sess_session(ss) : NULL;
+    struct py_netsnmp_async_state *state;
+
+    if (!sp)
+        return NULL;
+    state = sp->myvoid;
+    if (!state && create) {
+        state = calloc(1, sizeof(*state));
+        if (state) {
+            state->tail = &state->head;
+            sp->myvoid = state;
+        }
+    }
+    return state;
+}
+
+static void
+__py_netsnmp_free_completions(struct py_netsnmp_completion *c)
+{
+    struct py_netsnmp_completion *next;
+
+    for (; c; c = next) {
+        next = c->next;
+        snmp_free_varbind(c->vars);
+        free(c);
+    }
+}
+
 static PyObject *
 netsnmp_delete_session(PyObject *self, PyObject *args)
 {
   PyObject *session;
   struct session_list *ss;
+  struct py_netsnmp_async_state *state;
 
   if (!PyArg_ParseTuple(args, "O", &session)) {
     return NULL;
@@ -1305,7 +1400,12 @@ netsnmp_delete_session(PyObject *self, PyObject *args)
 
   ss = py_netsnmp_attr_void_ptr(session, "sess_ptr");
 
+  state = __py_netsnmp_async_state(ss, 0);
   snmp_sess_close(ss);
+  if (state) {
+    __py_netsnmp_free_completions(state->head);
+    free(state);
+  }
   return (Py_BuildValue(""));
 }
 
@@ -2105,6 +2205,810 @@ netsnmp_getbulk(PyObject *self, PyObject *args)
   return (val_tuple ? val_tuple : Py_BuildValue(""));
 }
 
+static PyObject *
+__py_netsnmp_oid_tuple(const oid *name, size_t name_len)
+{
+    PyObject *t = PyTuple_New(name_len);
+    size_t i;
+
+    for (i = 0; t && i < name_len; i++)
+        PyTuple_SET_ITEM(t, i, PyLong_FromUnsignedLong(name[i]));
+    return t;
+}
+
+/*
+ * Convert the queued completions of session @ss into a list of
+ * (reqid, ErrorStr, ErrorNum, ErrorInd, varbinds, oids, values) tuples and
+ * empty the queue. varbinds holds Varbind objects, oids the numeric OID of
+ * each varbind as a tuple and values the value of each varbind as returned
+ * by get().
+ */
+static PyObject *
+__py_netsnmp_drain_completions(PyObject *session, struct session_list *ss)
+{
+    struct py_netsnmp_async_state *state = __py_netsnmp_async_state(ss, 0);
+    struct py_netsnmp_completion *head, *c;
+    netsnmp_variable_list *vars;
+    PyObject *result, *varbinds, *oids, *vals, *varbind, *item;
+    int getlabel_flag = NO_FLAGS;
+    int sprintval_flag = USE_BASIC;
+    int old_format;
+    int varbind_ind;
+    int len;
+    char *str_buf = NULL;
+    const char *err_str;
+
+    result = PyList_New(0);
+    if (!result || !state || !state->head)
+        return result;
+
+    head = state->head;
+    state->head = NULL;
+    state->tail = &state->head;
+
+    if (py_netsnmp_attr_long(session, "UseEnums"))
+      sprintval_flag = USE_ENUMS;
+    if (py_netsnmp_attr_long(session, "UseSprintValue"))
+      sprintval_flag = USE_SPRINT_VALUE;
+
+    old_format = netsnmp_ds_get_int(NETSNMP_DS_LIBRARY_ID,
+                                    NETSNMP_DS_LIB_OID_OUTPUT_FORMAT);
+    if (py_netsnmp_attr_long(session, "UseLongNames")) {
+      getlabel_flag |= USE_LONG_NAMES;
+      netsnmp_ds_set_int(NETSNMP_DS_LIBRARY_ID,
+                         NETSNMP_DS_LIB_OID_OUTPUT_FORMAT,
+                         NETSNMP_OID_OUTPUT_FULL);
+    }
+    if (py_netsnmp_attr_long(session, "UseNumeric")) {
+      getlabel_flag |= USE_LONG_NAMES;
+      getlabel_flag |= USE_NUMERIC_OIDS;
+      netsnmp_ds_set_int(NETSNMP_DS_LIBRARY_ID,
+                         NETSNMP_DS_LIB_OID_OUTPUT_FORMAT,
+                         NETSNMP_OID_OUTPUT_NUMERIC);
+    }
+
+    for (c = head; c; c = c->next) {
+        varbinds = PyList_New(0);
+        oids = PyList_New(0);
+        vals = PyList_New(0);
+        if (!varbinds || !oids || !vals) {
+            Py_XDECREF(varbinds);
+            Py_XDECREF(oids);
+            Py_XDECREF(vals);
+            break;
+        }
+        for (vars = c->vars, varbind_ind = 0; vars;
+             vars = vars->next_variable, varbind_ind++) {
+            int type;
+
+            varbind = py_netsnmp_construct_varbind();
+            if (!varbind)
+                break;
+            type = build_python_varbind(varbind, vars, varbind_ind,
+                                        sprintval_flag, &len, &str_buf,
+                                        getlabel_flag);
+            PyList_Append(varbinds, varbind);
+            Py_DECREF(varbind);
+
+            if (type == TYPE_OTHER || type == SNMP_ENDOFMIBVIEW ||
+                type == SNMP_NOSUCHOBJECT || type == SNMP_NOSUCHINSTANCE)
+                item = Py_BuildValue("");
+            else
+                item = Py_BuildValue(is_hex(str_buf, len) ? "y#" : "s#",
+                                     str_buf, len);
+            if (!item)
+                break;
+            PyList_Append(vals, item);
+            Py_DECREF(item);
+
+            item = __py_netsnmp_oid_tuple(vars->name, vars->name_length);
+            if (!item)
+                break;
+            PyList_Append(oids, item);
+            Py_DECREF(item);
+        }
+
+        if (c->errstat)
+            err_str = snmp_errstring((int)c->errstat);
+        else if (c->err_ind)
+            err_str = snmp_api_errstring(c->err_ind);
+        else
+            err_str = "";
+        item = Py_BuildValue("(isiiNNN)", c->reqid, err_str, c->err_num,
+                             c->err_ind, varbinds, oids, vals);
+        if (item) {
+            PyList_Append(result, item);
+            Py_DECREF(item);
+        }
+    }
+
+    netsnmp_ds_set_int(NETSNMP_DS_LIBRARY_ID,
+                       NETSNMP_DS_LIB_OID_OUTPUT_FORMAT,
+                       old_format);
+
+    __py_netsnmp_free_completions(head);
+    if (str_buf != NULL)
+        netsnmp_free(str_buf);
+
+    if (PyErr_Occurred()) {
+        Py_DECREF(result);
+        return NULL;
+    }
+    return result;
+}
+
+static PyObject *
+netsnmp_async_fd(PyObject *self, PyObject *args)
+{
+  PyObject *session;
+  struct session_list *ss;
+  netsnmp_transport *transport;
+
+  if (!PyArg_ParseTuple(args, "O", &session))
+    return NULL;
+
+  ss = py_netsnmp_attr_void_ptr(session, "sess_ptr");
+  transport = ss ? snmp_sess_transport(ss) : NULL;
+
+  return PyLong_FromLong(transport ? transport->sock : -1);
+}
+
+static PyObject *
+netsnmp_async_send(PyObject *self, PyObject *args)
+{
+  PyObject *session;
+  PyObject *varlist;
+  PyObject *varlist_iter;
+  PyObject *varbind;
+  PyObject *oids = NULL;
+  PyObject *item;
+  PyObject *ret = NULL;
+  struct session_list *ss;
+  struct py_netsnmp_async_state *state;
+  netsnmp_pdu *pdu;
+  const char *pdu_type;
+  int nonrepeaters;
+  int maxrepetitions;
+  oid *oid_arr;
+  size_t oid_arr_len;
+  const char *tag;
+  const char *iid;
+  int best_guess;
+  int reqid;
+  int verbose = py_netsnmp_verbose();
+
+  if (!PyArg_ParseTuple(args, "OsiiO", &session, &pdu_type, &nonrepeaters,
+                        &maxrepetitions, &varlist))
+    return NULL;
+
+  ss = py_netsnmp_attr_void_ptr(session, "sess_ptr");
+  state = __py_netsnmp_async_state(ss, 1);
+  if (!state) {
+    __py_netsnmp_update_session_errors(session, (char *)
+                                       snmp_api_errstring(SNMPERR_BAD_SESSION),
+                                       0, SNMPERR_BAD_SESSION);
+    return Py_BuildValue("");
+  }
+
+  if (strcmp(pdu_type, "get") == 0) {
+    pdu = snmp_pdu_create(SNMP_MSG_GET);
+  } else if (strcmp(pdu_type, "getnext") == 0) {
+    pdu = snmp_pdu_create(SNMP_MSG_GETNEXT);
+  } else if (strcmp(pdu_type, "getbulk") == 0) {
+    pdu = snmp_pdu_create(SNMP_MSG_GETBULK);
+    pdu->errstat = nonrepeaters;
+    pdu->errindex = maxrepetitions;
+  } else {
+    PyErr_Format(PyExc_ValueError, "unsupported request type '%s'", pdu_type);
+    return NULL;
+  }
+
+  oid_arr = calloc(MAX_OID_LEN, sizeof(oid));
+  oids = PyList_New(0);
+  if (!pdu || !oid_arr || !oids)
+    goto done;
+
+  best_guess = (int)py_netsnmp_attr_long(session, "BestGuess");
+
+  varlist_iter = PyObject_GetIter(varlist);
+  while (varlist_iter && (varbind = PyIter_Next(varlist_iter))) {
+    tag = NULL;
+    oid_arr_len = MAX_OID_LEN;
+    if (py_netsnmp_attr_string(varbind, "tag", &tag, NULL) < 0 ||
+        py_netsnmp_attr_string(varbind, "iid", &iid, NULL) < 0) {
+      oid_arr_len = 0;
+    } else {
+      __tag2oid(tag, iid, oid_arr, &oid_arr_len, NULL, best_guess);
+    }
+    Py_DECREF(varbind);
+
+    if (!oid_arr_len) {
+      if (verbose)
+        printf("error: async_send: unknown object ID (%s)",
+               (tag ? tag : "<null>"));
+      Py_DECREF(varlist_iter);
+      goto done;
+    }
+    snmp_add_null_var(pdu, oid_arr, oid_arr_len);
+    item = __py_netsnmp_oid_tuple(oid_arr, oid_arr_len);
+    if (!item) {
+      Py_DECREF(varlist_iter);
+      goto done;
+    }
+    PyList_Append(oids, item);
+    Py_DECREF(item);
+  }
+  Py_XDECREF(varlist_iter);
+
+  if (PyErr_Occurred())
+    goto done;
+
+  reqid = snmp_sess_async_send(ss, pdu, __py_netsnmp_async_cb, state);
+  if (reqid == 0) {
+    char *err_str = NULL;
+    int err_num, err_ind;
+
+    snmp_sess_error(ss, &err_num, &err_ind, &err_str);
+    __py_netsnmp_update_session_errors(session, err_str, err_num, err_ind);
+    free(err_str);
+    ret = Py_BuildValue("");
+    goto done;
+  }
+  pdu = NULL;   /* owned by the library now */
+
+  ret = Py_BuildValue("(iO)", reqid, oids);
+
+ done:
+  if (pdu)
+    snmp_free_pdu(pdu);
+  Py_XDECREF(oids);
+  free(oid_arr);
+  return ret;
+}
+
+static PyObject *
+netsnmp_async_read(PyObject *self, PyObject *args)
+{
+  PyObject *session;
+  struct session_list *ss;
+  netsnmp_transport *transport;
+  netsnmp_large_fd_set fdset;
+
+  if (!PyArg_ParseTuple(args, "O", &session))
+    return NULL;
+
+  ss = py_netsnmp_attr_void_ptr(session, "sess_ptr");
+  transport = ss ? snmp_sess_transport(ss) : NULL;
+
+  if (transport && transport->sock >= 0) {
+    netsnmp_large_fd_set_init(&fdset, transport->sock + 1);
+    NETSNMP_LARGE_FD_SET(transport->sock, &fdset);
+    /* receive and BER-decode the pending packets without the GIL */
+    Py_BEGIN_ALLOW_THREADS
+    snmp_sess_read2(ss, &fdset);
+    Py_END_ALLOW_THREADS
+    netsnmp_large_fd_set_cleanup(&fdset);
+  }
+
+  return __py_netsnmp_drain_completions(session, ss);
+}
+
+static PyObject *
+netsnmp_async_timeout(PyObject *self, PyObject *args)
+{
+  PyObject *session;
+  PyObject *completions;
+  struct session_list *ss;
+  netsnmp_large_fd_set fdset;
+  struct timeval timeout = { 0, 0 };
+  int numfds = 0;
+  int block = 1;
+
+  if (!PyArg_ParseTuple(args, "O", &session))
+    return NULL;
+
+  ss = py_netsnmp_attr_void_ptr(session, "sess_ptr");
+  if (ss) {
+    snmp_sess_timeout(ss);
+    netsnmp_large_fd_set_init(&fdset, FD_SETSIZE);
+    snmp_sess_select_info2_flags(ss, &numfds, &fdset, &timeout, &block,
+                                 NETSNMP_SELECT_NOALARMS);
+    netsnmp_large_fd_set_cleanup(&fdset);
+  }
+
+  completions = __py_netsnmp_drain_completions(session, ss);
+  if (!completions)
+    return NULL;
+  if (block)
+    return Py_BuildValue("(NO)", completions, Py_None);
+  return Py_BuildValue("(Nd)", completions,
+                       timeout.tv_sec + timeout.tv_usec / 1e6);
+}
+
+/*
+ * Packed walk results.
+ *
+ * Instead of creating a Varbind object per returned variable,
+ * bulkwalk_packed() appends each variable to five flat buffers:
+ *
+ *   oids          - the sub-identifiers of all names as native uint32_t
+ *   oid_offsets   - n + 1 uint32_t offsets into oids, in sub-identifiers
+ *   types         - the ASN.1 type of each variable, one byte each
+ *   values        - the raw values of all variables
+ *   value_offsets - n + 1 uint32_t offsets into values, in bytes
+ *
+ * Integer types are stored as native 64-bit integers (signed for INTEGER
+ * and Integer64, unsigned otherwise), OBJECT IDENTIFIER values as
+ * uint32_t sub-identifiers and Float/Double as native doubles. Strings,
+ * IpAddress and other types are stored as received. NULL and exception
+ * values are empty. The Perl module uses the same layout.
+ */
+struct py_netsnmp_packbuf {
+    PyObject       *obj;        /* bytes object the buffer lives in */
+    u_char         *buf;
+    size_t          len;
+    size_t          size;
+};
+
+/*
+ * The buffers are bytes objects from the start, so that the result is
+ * handed to Python as is.  Growing one needs the GIL; save is where the
+ * thread state is kept while the GIL is released, or NULL if it is held.
+ */
+struct py_netsnmp_packed {
+    struct py_netsnmp_packbuf oids;
+    struct py_netsnmp_packbuf oid_offsets;
+    struct py_netsnmp_packbuf types;
+    struct py_netsnmp_packbuf values;
+    struct py_netsnmp_packbuf value_offsets;
+    PyThreadState **save;
+};
+
+static int
+__packbuf_append(struct py_netsnmp_packed *p, struct py_netsnmp_packbuf *pb,
+                 const void *data, size_t len)
+{
+    if (pb->len + len > pb->size) {
+        size_t size = pb->size ? pb->size : 4096;
+        int rc;
+
+        while (size < pb->len + len)
+            size *= 2;
+        if (p->save)
+            PyEval_RestoreThread(*p->save);
+        if (pb->obj)
+            rc = _PyBytes_Resize(&pb->obj, size);
+        else
+            rc = (pb->obj = PyBytes_FromStringAndSize(NULL, size)) ? 0 : -1;
+        if (rc < 0)
+            PyErr_Clear();      /* reported as SNMPERR_MALLOC */
+        else
+            pb->buf = (u_char *)PyBytes_AS_STRING(pb->obj);
+        if (p->save)
+            *p->save = PyEval_SaveThread();
+        if (rc < 0) {
+            pb->buf = NULL;
+            pb->len = pb->size = 0;
+            return -1;
+        }
+        pb->size = size;
+    }
+    memcpy(pb->buf + pb->len, data, len);
+    pb->len += len;
+    return 0;
+}
+
+static int
+__packbuf_append_oid(struct py_netsnmp_packed *p,
+                     struct py_netsnmp_packbuf *pb, const oid *name,
+                     size_t name_len)
+{
+    uint32_t subid;
+    size_t i;
+
+    for (i = 0; i < name_len; i++) {
+        subid = name[i];
+        if (__packbuf_append(p, pb, &subid, sizeof(subid)) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/*
+ * Cut the buffer down to its contents and return its bytes object,
+ * or NULL with an exception set. Needs the GIL.
+ */
+static PyObject *
+__packbuf_finish(struct py_netsnmp_packbuf *pb)
+{
+    PyObject *obj = pb->obj;
+
+    pb->obj = NULL;
+    if (!obj)
+        return PyBytes_FromStringAndSize(NULL, 0);
+    if (_PyBytes_Resize(&obj, pb->len) < 0)
+        return NULL;
+    return obj;
+}
+
+static void
+__packed_free(struct py_netsnmp_packed *p)
+{
+    Py_XDECREF(p->oids.obj);
+    Py_XDECREF(p->oid_offsets.obj);
+    Py_XDECREF(p->types.obj);
+    Py_XDECREF(p->values.obj);
+    Py_XDECREF(p->value_offsets.obj);
+}
+
+/*
+ * Append @vars to the packed buffers @p. May be called without the GIL.
+ */
+static int
+__pack_varbind(struct py_netsnmp_packed *p, const netsnmp_variable_list *vars)
+{
+    const void *val = NULL;
+    size_t val_len = 0;
+    u_char type = vars->type;
+    int64_t i64;
+    uint64_t u64;
+    double d;
+    uint32_t offset;
+
+    switch (vars->type) {
+    case ASN_INTEGER:
+        i64 = *vars->val.integer;
+        val = &i64;
+        val_len = sizeof(i64);
+        break;
+    case ASN_COUNTER:
+    case ASN_GAUGE:
+    case ASN_TIMETICKS:
+    case ASN_UINTEGER:
+        u64 = (u_long)*vars->val.integer & 0xffffffffUL;
+        val = &u64;
+        val_len = sizeof(u64);
+        break;
+    case ASN_COUNTER64:
+#ifdef OPAQUE_SPECIAL_TYPES
+    case ASN_OPAQUE_COUNTER64:
+    case ASN_OPAQUE_U64:
+    case ASN_OPAQUE_I64:
+#endif
+        u64 = ((uint64_t)vars->val.counter64->high << 32) |
+            vars->val.counter64->low;
+        val = &u64;
+        val_len = sizeof(u64);
+        break;
+#ifdef OPAQUE_SPECIAL_TYPES
+    case ASN_OPAQUE_FLOAT:
+        d = *vars->val.floatVal;
+        val = &d;
+        val_len = sizeof(d);
+        break;
+    case ASN_OPAQUE_DOUBLE:
+        d = *vars->val.doubleVal;
+        val = &d;
+        val_len = sizeof(d);
+        break;
+#endif
+    case ASN_OBJECT_ID:
+    case ASN_NULL:
+    case SNMP_NOSUCHOBJECT:
+    case SNMP_NOSUCHINSTANCE:
+    case SNMP_ENDOFMIBVIEW:
+        break;
+    default:
+        val = vars->val.string;
+        val_len = vars->val_len;
+        break;
+    }
+
+    if (__packbuf_append_oid(p, &p->oids, vars->name,
+                             vars->name_length) < 0)
+        return -1;
+    offset = p->oids.len / sizeof(uint32_t);
+    if (__packbuf_append(p, &p->oid_offsets, &offset, sizeof(offset)) < 0 ||
+        __packbuf_append(p, &p->types, &type, 1) < 0)
+        return -1;
+    if (vars->type == ASN_OBJECT_ID) {
+        if (__packbuf_append_oid(p, &p->values, vars->val.objid,
+                                 vars->val_len / sizeof(oid)) < 0)
+            return -1;
+    } else if (val_len && __packbuf_append(p, &p->values, val, val_len) < 0) {
+        return -1;
+    }
+    offset = p->values.len;
+    return __packbuf_append(p, &p->value_offsets, &offset, sizeof(offset));
+}
+
+static PyObject *
+netsnmp_bulkwalk_packed(PyObject *self, PyObject *args)
+{
+  PyObject *session;
+  PyObject *varlist;
+  PyObject *varlist_iter;
+  PyObject *varbind;
+  PyObject *ret = NULL;
+  PyObject *bufs[5];
+  PyThreadState *save;
+  struct session_list *ss;
+  netsnmp_session *sp;
+  netsnmp_pdu *pdu, *response = NULL;
+  netsnmp_variable_list *vars;
+  struct py_netsnmp_packed packed;
+  int maxrepetitions;
+  int varlist_len = 0;
+  int varlist_ind;
+  int nactive, ncols, col, k;
+  int *cols = NULL;
+  char *done = NULL;
+  oid **roots = NULL;
+  oid **last = NULL;
+  size_t *root_len = NULL;
+  size_t *last_len = NULL;
+  const char *tag;
+  const char *iid;
+  int best_guess;
+  int status;
+  int err_ind = 0;
+  int err_num = 0;
+  char *err_str = NULL;
+  uint32_t zero = 0;
+  int verbose = py_netsnmp_verbose();
+
+  if (!PyArg_ParseTuple(args, "OiO", &session, &maxrepetitions, &varlist))
+    return NULL;
+
+  memset(&packed, 0, sizeof(packed));
+  ss = py_netsnmp_attr_void_ptr(session, "sess_ptr");
+  sp = ss ? snmp_sess_session(ss) : NULL;
+  if (!sp) {
+    __py_netsnmp_update_session_errors(session, (char *)
+                                       snmp_api_errstring(SNMPERR_BAD_SESSION),
+                                       0, SNMPERR_BAD_SESSION);
+    return Py_BuildValue("");
+  }
+  best_guess = (int)py_netsnmp_attr_long(session, "BestGuess");
+
+  varlist_len = PySequence_Length(varlist);
+  if (varlist_len < 0)
+    return NULL;
+  if (varlist_len == 0)
+    goto done;
+  cols = calloc(varlist_len, sizeof(*cols));
+  done = calloc(varlist_len, sizeof(*done));
+  roots = calloc(varlist_len, sizeof(*roots));
+  last = calloc(varlist_len, sizeof(*last));
+  root_len = calloc(varlist_len, sizeof(*root_len));
+  last_len = calloc(varlist_len, sizeof(*last_len));
+  if (!cols || !done || !roots || !last || !root_len || !last_len) {
+    PyErr_NoMemory();
+    goto done;
+  }
+
+  varlist_iter = PyObject_GetIter(varlist);
+  varlist_ind = 0;
+  while (varlist_iter && varlist_ind < varlist_len &&
+         (varbind = PyIter_Next(varlist_iter))) {
+    tag = NULL;
+    roots[varlist_ind] = calloc(MAX_OID_LEN, sizeof(oid));
+    last[varlist_ind] = calloc(MAX_OID_LEN, sizeof(oid));
+    root_len[varlist_ind] = MAX_OID_LEN;
+    if (!roots[varlist_ind] || !last[varlist_ind] ||
+        py_netsnmp_attr_string(varbind, "tag", &tag, NULL) < 0 ||
+        py_netsnmp_attr_string(varbind, "iid", &iid, NULL) < 0)
+      root_len[varlist_ind] = 0;
+    else
+      __tag2oid(tag, iid, roots[varlist_ind], &root_len[varlist_ind], NULL,
+                best_guess);
+    Py_DECREF(varbind);
+
+    if (!root_len[varlist_ind]) {
+      if (verbose)
+        printf("error: bulkwalk_packed: unknown object ID (%s)",
+               (tag ? tag : "<null>"));
+      Py_DECREF(varlist_iter);
+      goto done;
+    }
+    memcpy(last[varlist_ind], roots[varlist_ind],
+           root_len[varlist_ind] * sizeof(oid));
+    last_len[varlist_ind] = root_len[varlist_ind];
+    varlist_ind++;
+  }
+  Py_XDECREF(varlist_iter);
+  if (PyErr_Occurred())
+    goto done;
+
+  if (__packbuf_append(&packed, &packed.oid_offsets, &zero,
+                       sizeof(zero)) < 0 ||
+      __packbuf_append(&packed, &packed.value_offsets, &zero,
+                       sizeof(zero)) < 0) {
+    PyErr_NoMemory();
+    goto done;
+  }
+
+  /* request, decode and pack without the GIL */
+  save = PyEval_SaveThread();
+  packed.save = &save;
+  nactive = varlist_len;
+  while (nactive) {
+    pdu = snmp_pdu_create(sp->version == SNMP_VERSION_1 ? SNMP_MSG_GETNEXT :
+                          SNMP_MSG_GETBULK);
+    if (pdu->command == SNMP_MSG_GETBULK) {
+      pdu->errstat = 0;
+      pdu->errindex = maxrepetitions;
+    }
+    for (col = 0, ncols = 0; col < varlist_len; col++) {
+      if (done[col])
+        continue;
+      snmp_add_null_var(pdu, last[col], last_len[col]);
+      cols[ncols++] = col;
+    }
+
+    status = snmp_sess_synch_response(ss, pdu, &response);
+    if (status != STAT_SUCCESS || !response) {
+      snmp_sess_error(ss, &err_num, &err_ind, &err_str);
+      break;
+    }
+    if (response->errstat != SNMP_ERR_NOERROR) {
+      err_str = strdup(snmp_errstring((int)response->errstat));
+      err_num = (int)response->errstat;
+      err_ind = (int)response->errindex;
+      break;
+    }
+    if (!response->variables)
+      break;
+
+    for (vars = response->variables, k = 0; vars;
+         vars = vars->next_variable, k++) {
+      col = cols[k % ncols];
+      if (done[col])
+        continue;
+      if (vars->type == SNMP_ENDOFMIBVIEW ||
+          vars->type == SNMP_NOSUCHOBJECT ||
+          vars->type == SNMP_NOSUCHINSTANCE ||
+          vars->name_length < root_len[col] ||
+          memcmp(vars->name, roots[col], root_len[col] * sizeof(oid)) ||
+          snmp_oid_compare(vars->name, vars->name_length, last[col],
+                           last_len[col]) <= 0) {
+        done[col] = 1;
+        nactive--;
+        continue;
+      }
+      if (__pack_varbind(&packed, vars) < 0) {
+        err_str = strdup(snmp_api_errstring(SNMPERR_MALLOC));
+        err_ind = SNMPERR_MALLOC;
+        nactive = 0;
+        break;
+      }
+      memcpy(last[col], vars->name, vars->name_length * sizeof(oid));
+      last_len[col] = vars->name_length;
+    }
+    snmp_free_pdu(response);
+    response = NULL;
+  }
+  if (response)
+    snmp_free_pdu(response);
+  packed.save = NULL;
+  PyEval_RestoreThread(save);
+
+  __py_netsnmp_update_session_errors(session, err_str ? err_str : "",
+                                     err_num, err_ind);
+
+  /* hand the buffers over as they are */
+  bufs[0] = __packbuf_finish(&packed.oids);
+  bufs[1] = __packbuf_finish(&packed.oid_offsets);
+  bufs[2] = __packbuf_finish(&packed.types);
+  bufs[3] = __packbuf_finish(&packed.values);
+  bufs[4] = __packbuf_finish(&packed.value_offsets);
+  if (bufs[0] && bufs[1] && bufs[2] && bufs[3] && bufs[4])
+    ret = Py_BuildValue("(NNNNN)", bufs[0], bufs[1], bufs[2], bufs[3],
+                        bufs[4]);
+  else
+    for (k = 0; k < 5; k++)
+      Py_XDECREF(bufs[k]);
+
+ done:
+  for (varlist_ind = 0; roots && varlist_ind < varlist_len; varlist_ind++) {
+    free(roots[varlist_ind]);
+    free(last[varlist_ind]);
+  }
+  free(cols);
+  free(done);
+  free(roots);
+  free(last);
+  free(root_len);
+  free(last_len);
+  free(err_str);
+  __packed_free(&packed);
+  if (!ret && !PyErr_Occurred())
+    ret = Py_BuildValue("");
+  return ret;
+}
+
+/*
+ * Translate a numeric OID into the (tag, iid, type) triple of a Varbind,
+ * honouring the UseLongNames and UseNumeric session settings. Used to
+ * translate packed results on demand.
+ */
+static PyObject *
+netsnmp_translate_packed(PyObject *self, PyObject *args)
+{
+  PyObject *session;
+  PyObject *oid_tuple;
+  PyObject *ret = NULL;
+  oid name[MAX_OID_LEN];
+  size_t name_len;
+  int asn_type;
+  struct tree *tp;
+  int type;
+  int getlabel_flag = NO_FLAGS;
+  int old_format;
+  char *str_buf = NULL;
+  size_t str_buf_len = STR_BUF_SIZE;
+  size_t out_len = 0;
+  int buf_over = 0;
+  char type_str[MAX_TYPE_NAME_LEN];
+  const char *tag;
+  const char *iid;
+  Py_ssize_t i;
+
+  if (!PyArg_ParseTuple(args, "OO!i", &session, &PyTuple_Type, &oid_tuple,
+                        &asn_type))
+    return NULL;
+
+  name_len = PyTuple_GET_SIZE(oid_tuple);
+  if (name_len > MAX_OID_LEN) {
+    PyErr_SetString(PyExc_ValueError, "OID too long");
+    return NULL;
+  }
+  for (i = 0; i < (Py_ssize_t)name_len; i++) {
+    name[i] = PyLong_AsUnsignedLong(PyTuple_GET_ITEM(oid_tuple, i));
+    if (PyErr_Occurred())
+      return NULL;
+  }
+
+  old_format = netsnmp_ds_get_int(NETSNMP_DS_LIBRARY_ID,
+                                  NETSNMP_DS_LIB_OID_OUTPUT_FORMAT);
+  if (py_netsnmp_attr_long(session, "UseLongNames")) {
+    getlabel_flag |= USE_LONG_NAMES;
+    netsnmp_ds_set_int(NETSNMP_DS_LIBRARY_ID,
+                       NETSNMP_DS_LIB_OID_OUTPUT_FORMAT,
+                       NETSNMP_OID_OUTPUT_FULL);
+  }
+  if (py_netsnmp_attr_long(session, "UseNumeric")) {
+    getlabel_flag |= USE_LONG_NAMES;
+    getlabel_flag |= USE_NUMERIC_OIDS;
+    netsnmp_ds_set_int(NETSNMP_DS_LIBRARY_ID,
+                       NETSNMP_DS_LIB_OID_OUTPUT_FORMAT,
+                       NETSNMP_OID_OUTPUT_NUMERIC);
+  }
+
+  str_buf = netsnmp_malloc(str_buf_len);
+  if (str_buf) {
+    strcpy(str_buf, ".");
+    tp = netsnmp_sprint_realloc_objid_tree((u_char **)&str_buf, &str_buf_len,
+                                           &out_len, 1, &buf_over,
+                                           name, name_len);
+    if (__is_leaf(tp)) {
+      type = tp->type ? tp->type : tp->parent->type;
+    } else {
+      getlabel_flag |= NON_LEAF_NAME;
+      type = __translate_asn_type(asn_type);
+    }
+    __get_label_iid(str_buf, &tag, &iid, getlabel_flag);
+    __get_type_str(type, type_str);
+    ret = Py_BuildValue("(sss)", tag ? tag : "", iid ? iid : "", type_str);
+    netsnmp_free(str_buf);
+  }
+
+  netsnmp_ds_set_int(NETSNMP_DS_LIBRARY_ID,
+                     NETSNMP_DS_LIB_OID_OUTPUT_FORMAT,
+                     old_format);
+  return ret ? ret : PyErr_NoMemory();
+}
+
 static PyObject *
 netsnmp_set(PyObject *self, PyObject *args)
 {
@@ -2267,6 +3171,18 @@ static PyMethodDef ClientMethods[] = {
    "perform an SNMP SET operation."},
   {"walk",  netsnmp_walk, METH_VARARGS,
    "perform an SNMP WALK operation."},
+  {"bulkwalk_packed",  netsnmp_bulkwalk_packed, METH_VARARGS,
+   "perform a GETBULK walk and return the results as packed buffers."},
+  {"translate_packed",  netsnmp_translate_packed, METH_VARARGS,
+   "translate a numeric OID of a packed result into tag, iid and type."},
+  {"async_fd",  netsnmp_async_fd, METH_VARARGS,
+   "return the socket of a session for use with an event loop."},
+  {"async_send",  netsnmp_async_send, METH_VARARGS,
+   "submit an SNMP GET, GETNEXT or GETBULK without waiting for the reply."},
+  {"async_read",  netsnmp_async_read, METH_VARARGS,
+   "read pending replies and return the completed requests."},
+  {"async_timeout",  netsnmp_async_timeout, METH_VARARGS,
+   "process request timeouts and return the completed requests."},
   {NULL, NULL, 0, NULL}        /* Sentinel */
 };
 
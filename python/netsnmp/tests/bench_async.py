@@ -0,0 +1,118 @@
+""" Compares polling many agents with Session and with AsyncSession.
+
+Usage: python bench_async.py [--agents N] [--rounds N] [--snmpd PATH]
+                             [--base-port PORT]
+
+When --snmpd is given, N agents are started on consecutive UDP ports on
+127.0.0.1 starting at --base-port and stopped again afterwards; otherwise
+the agents are expected to be running already.  Each round fetches a few
+scalars from every agent and walks its ifTable.
+"""
+
+from __future__ import print_function
+import argparse
+import asyncio
+import os
+import shutil
+import subprocess
+import tempfile
+import time
+import netsnmp
+
+SCALARS = ('sysDescr.0', 'sysUpTime.0', 'sysName.0')
+TABLE = 'ifTable'
+
+
+def dest(port):
+    return dict(Version=2, DestHost='127.0.0.1:%d' % port,
+                Community='public', Timeout=1000000, Retries=1)
+
+
+def start_agents(snmpd, ports):
+    tmpdir = tempfile.mkdtemp(prefix='netsnmp-bench-')
+    conf = os.path.join(tmpdir, 'bench.conf')
+    with open(conf, 'w') as f:
+        f.write('rocommunity public 127.0.0.1\n')
+    procs = []
+    for port in ports:
+        # the agents must not share a persistent directory
+        persistent_dir = os.path.join(tmpdir, str(port))
+        os.mkdir(persistent_dir)
+        procs.append(subprocess.Popen(
+            [snmpd, '-f', '-r', '-C', '-I-smux', '-Lf', os.devnull,
+             '-c', conf, '--persistentDir=' + persistent_dir,
+             'udp:127.0.0.1:%d' % port]))
+    for port in ports:
+        sess = netsnmp.Session(**dest(port))
+        deadline = time.time() + 30
+        while (sess.get(netsnmp.VarList(netsnmp.Varbind(SCALARS[0]))) ==
+               (None,) and time.time() < deadline):
+            time.sleep(0.5)
+    return tmpdir, procs
+
+
+def poll_sync(ports, rounds):
+    sessions = [netsnmp.Session(**dest(port)) for port in ports]
+    count = 0
+    for _ in range(rounds):
+        for sess in sessions:
+            vals = sess.get(netsnmp.VarList(*[netsnmp.Varbind(s)
+                                              for s in SCALARS]))
+            count += len(vals)
+            count += len(sess.walk(netsnmp.VarList(netsnmp.Varbind(TABLE))))
+    return count
+
+
+def poll_async(ports, rounds):
+    async def poll(sess):
+        vals = await sess.get(netsnmp.VarList(*[netsnmp.Varbind(s)
+                                                for s in SCALARS]))
+        rows = await sess.walk(netsnmp.VarList(netsnmp.Varbind(TABLE)))
+        return len(vals) + len(rows)
+
+    async def main():
+        sessions = [netsnmp.AsyncSession(**dest(port)) for port in ports]
+        count = 0
+        for _ in range(rounds):
+            count += sum(await asyncio.gather(*[poll(s) for s in sessions]))
+        for sess in sessions:
+            sess.close()
+        return count
+
+    return asyncio.run(main())
+
+
+def run(name, func, ports, rounds):
+    start = time.time()
+    count = func(ports, rounds)
+    elapsed = time.time() - start
+    print('%-6s %4d agents %4d rounds: %8d varbinds in %7.3f s'
+          ' (%9.0f varbinds/s)' % (name, len(ports), rounds, count, elapsed,
+                                   count / elapsed if elapsed else 0))
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--agents', type=int, default=16)
+    parser.add_argument('--rounds', type=int, default=10)
+    parser.add_argument('--snmpd')
+    parser.add_argument('--base-port', type=int, default=11161)
+    args = parser.parse_args()
+
+    ports = list(range(args.base_port, args.base_port + args.agents))
+    tmpdir, procs = None, []
+    if args.snmpd:
+        tmpdir, procs = start_agents(args.snmpd, ports)
+    try:
+        run('sync', poll_sync, ports, args.rounds)
+        run('async', poll_async, ports, args.rounds)
+    finally:
+        for proc in procs:
+            proc.terminate()
+            proc.wait()
+        if tmpdir:
+            shutil.rmtree(tmpdir, ignore_errors=True)
+
+
+if __name__ == '__main__':
+    main()
@@ -1,6 +1,7 @@
 """ Runs all unit tests for the netsnmp package.   """
 # Copyright (c) 2006 Andy Gross.  See LICENSE.txt for details.
 
+import asyncio
 import os
 import unittest
 import netsnmp
@@ -600,5 +601,159 @@ class HexStringSet(unittest.TestCase):
         print("second SNMP set result:", res)
         self.assertEqual(res, 0)
 
+def _names(varlist):
+    return [(var.tag, var.iid) for var in varlist]
+
+def _values(varlist):
+    return [(var.tag, var.iid, var.val, var.type) for var in varlist]
+
+class BulkWalkTests(unittest.TestCase):
+    """Session.bulkwalk() must return what a GETNEXT walk returns"""
+    def test_v2c_bulkwalk(self):
+        sess = setup_v2()
+        ref = netsnmp.VarList(netsnmp.Varbind('system'))
+        sess.walk(ref)
+        self.assertTrue(len(ref) > 0)
+
+        # small repetition counts take several requests per subtree
+        for maxrepetitions in (1, 3, 25):
+            varlist = netsnmp.VarList(netsnmp.Varbind('system'))
+            vals = sess.bulkwalk(varlist, maxrepetitions)
+            self.assertEqual(len(vals), len(varlist))
+            self.assertEqual(_names(varlist), _names(ref))
+
+    def test_v2c_bulkwalk_columns(self):
+        sess = setup_v2()
+        columns = ('sysORID', 'sysORDescr')
+        ref = []
+        for column in columns:
+            varlist = netsnmp.VarList(netsnmp.Varbind(column))
+            sess.walk(varlist)
+            ref.extend(_values(varlist))
+        self.assertTrue(len(ref) > 0)
+
+        varlist = netsnmp.VarList(*[netsnmp.Varbind(c) for c in columns])
+        sess.bulkwalk(varlist, 4)
+        self.assertEqual(sorted(_values(varlist)), sorted(ref))
+
+    def test_v1_bulkwalk(self):
+        sess = setup_v1()
+        ref = netsnmp.VarList(netsnmp.Varbind('sysORDescr'))
+        sess.walk(ref)
+        varlist = netsnmp.VarList(netsnmp.Varbind('sysORDescr'))
+        sess.bulkwalk(varlist)
+        self.assertEqual(_values(varlist), _values(ref))
+
+class PackedBulkWalkTests(unittest.TestCase):
+    """Session.bulkwalk_packed() must decode to what snmpwalk returns"""
+    # columns whose values do not change between two walks
+    columns = ('sysORID', 'sysORDescr', 'sysORUpTime',
+               'ifIndex', 'ifDescr', 'ifType', 'ifMtu')
+
+    def _check(self, packed, columns):
+        ref = []
+        for column in columns:
+            ref.extend(netsnmp.snmpwalk(netsnmp.Varbind(column),
+                                        **snmp_dest(Version=2)))
+        self.assertTrue(len(ref) > 0)
+        self.assertEqual(len(packed), len(ref))
+
+        # the packed columns are interleaved, snmpwalk returns them in turn
+        order = sorted(range(len(packed)), key=packed.oid)
+        vals = []
+        for i in order:
+            val = packed.value(i)
+            if isinstance(val, bytes):
+                val = val.decode()
+            vals.append(str(val))
+        self.assertEqual(vals, list(ref))
+
+        # and the translated varbinds name the right instances
+        var = packed[order[0]]
+        self.assertEqual(var.tag, columns[0])
+        self.assertEqual(vals[0], var.val)
+
+    def test_v2c_bulkwalk_packed(self):
+        sess = netsnmp.Session(**snmp_dest(Version=2))
+        for maxrepetitions in (1, 3, 25):
+            varlist = netsnmp.VarList(*[netsnmp.Varbind(c)
+                                        for c in self.columns])
+            packed = sess.bulkwalk_packed(varlist, maxrepetitions)
+            self.assertEqual(sess.ErrorNum, 0)
+            self._check(packed, self.columns)
+
+    def test_v1_bulkwalk_packed(self):
+        sess = netsnmp.Session(**snmp_dest())
+        varlist = netsnmp.VarList(netsnmp.Varbind('sysORDescr'))
+        self._check(sess.bulkwalk_packed(varlist), ('sysORDescr',))
+
+    def test_bulkwalk_packed_bad_varlist(self):
+        sess = netsnmp.Session(**snmp_dest(Version=2))
+        # an error, not a SystemError about a result with an exception set
+        self.assertRaises(TypeError, sess.bulkwalk_packed, 42)
+
+class AsyncTests(unittest.TestCase):
+    """AsyncSession must return what Session returns"""
+    def _session(self, **kwargs):
+        return netsnmp.AsyncSession(**snmp_dest(Version=2, **kwargs))
+
+    def test_async_get(self):
+        ref = netsnmp.VarList(netsnmp.Varbind('sysDescr', '0'),
+                              netsnmp.Varbind('sysContact', '0'))
+        netsnmp.Session(**snmp_dest(Version=2)).get(ref)
+
+        async def run():
+            sess = self._session()
+            varlist = netsnmp.VarList(netsnmp.Varbind('sysDescr', '0'),
+                                      netsnmp.Varbind('sysContact', '0'))
+            vals = await sess.get(varlist)
+            sess.close()
+            return vals, varlist
+        vals, varlist = asyncio.run(run())
+        self.assertEqual(vals, tuple(var.val for var in ref))
+        self.assertEqual(_values(varlist), _values(ref))
+
+    def test_async_concurrent(self):
+        async def run():
+            sess = self._session()
+            varlists = [netsnmp.VarList(netsnmp.Varbind('sysDescr', '0'))
+                        for i in range(20)]
+            results = await asyncio.gather(*[sess.get(varlist)
+                                             for varlist in varlists])
+            sess.close()
+            return results
+        results = asyncio.run(run())
+        self.assertEqual(len(results), 20)
+        self.assertEqual(len(set(results)), 1)
+        self.assertIsNotNone(results[0][0])
+
+    def test_async_walk(self):
+        ref = netsnmp.VarList(netsnmp.Varbind('sysORTable'))
+        netsnmp.Session(**snmp_dest(Version=2)).walk(ref)
+        self.assertTrue(len(ref) > 0)
+
+        async def run():
+            sess = self._session()
+            varlist = netsnmp.VarList(netsnmp.Varbind('sysORTable'))
+            await sess.walk(varlist, 5)
+            sess.close()
+            return varlist
+        self.assertEqual(_values(asyncio.run(run())), _values(ref))
+
+    def test_async_timeout(self):
+        async def run():
+            # nothing listens on the discard port
+            sess = netsnmp.AsyncSession(Version=2, Community='public',
+                                        DestHost='localhost:9',
+                                        Timeout=100000, Retries=1)
+            vals = await sess.get(netsnmp.VarList(
+                netsnmp.Varbind('sysDescr', '0')))
+            sess.close()
+            return vals, sess.ErrorInd
+        vals, errind = asyncio.run(run())
+        self.assertEqual(vals, (None,))
+        # SNMPERR_TIMEOUT, as reported by the synchronous calls
+        self.assertEqual(errind, -24)
+
 if __name__ == '__main__':
     unittest.main()
@@ -2803,6 +2803,174 @@ asn_build_double(u_char * data,
 #endif                          /* NETSNMP_WITH_OPAQUE_SPECIAL_TYPES */
 
 
+/**
+ * @internal
+ * returns the number of type and length octets that
+ * asn_realloc_rbuild_header() writes for an object with
+ * 'length' bytes of contents.
+ *
+ * @param length  IN - length of the contents
+ *
+ * @return number of header bytes
+ */
+size_t
+asn_header_len(size_t length)
+{
+    size_t          len = 2;
+
+    if (length <= 0x7f)
+        return len;
+    for (; length; length >>= 8)
+        len++;
+    return len;
+}
+
+/**
+ * @internal
+ * returns the number of content bytes that asn_realloc_rbuild_int()
+ * writes for 'value'.
+ *
+ * @param value   IN - value to encode
+ *
+ * @return number of content bytes
+ */
+size_t
+asn_int_len(long value)
+{
+    long            testvalue;
+    size_t          len = 1;
+
+    if (value > INT32_MAX)
+        value &= 0xffffffff;
+    else if (value < INT32_MIN)
+        value = 0 - (value & 0xffffffff);
+    testvalue = (value < 0) ? -1 : 0;
+
+    while ((value >> 7) != testvalue) {
+        len++;
+        value >>= 8;
+    }
+    return len;
+}
+
+/**
+ * @internal
+ * returns the number of content bytes that
+ * asn_realloc_rbuild_unsigned_int() writes for 'value'.
+ *
+ * @param value   IN - value to encode
+ *
+ * @return number of content bytes
+ */
+size_t
+asn_unsigned_int_len(u_long value)
+{
+    size_t          len = 1;
+
+    value &= 0xffffffff;
+    while (value >> 7) {
+        len++;
+        value >>= 8;
+    }
+    return len;
+}
+
+/**
+ * @internal
+ * returns the number of content bytes that
+ * asn_realloc_rbuild_unsigned_int64() writes for a counter64, without
+ * the Opaque wrapping used for ASN_OPAQUE_COUNTER64 and ASN_OPAQUE_U64.
+ *
+ * @param cp      IN - value to encode
+ *
+ * @return number of content bytes
+ */
+size_t
+asn_unsigned_int64_len(const struct counter64 *cp)
+{
+    u_long          low = cp->low & 0xffffffff, high = cp->high & 0xffffffff;
+    u_long          top;
+    size_t          len = 1;
+
+    if (high) {
+        len = 5;
+        for (top = high; top >> 8; top >>= 8)
+            len++;
+    } else {
+        for (top = low; top >> 8; top >>= 8)
+            len++;
+    }
+    if (top & 0x80)
+        len++;
+    return len;
+}
+
+/**
+ * @internal
+ * returns the number of content bytes that
+ * asn_realloc_rbuild_signed_int64() writes for a counter64, without
+ * the Opaque wrapping.
+ *
+ * @param cp      IN - value to encode
+ *
+ * @return number of content bytes
+ */
+size_t
+asn_signed_int64_len(const struct counter64 *cp)
+{
+    int32_t         low = cp->low, high = cp->high;
+    int32_t         testvalue = (high & 0x80000000) ? -1 : 0;
+    u_char          top = (u_char) low;
+    size_t          len = 1;
+
+    low >>= 8;
+    while (low != testvalue && len < 4) {
+        top = (u_char) low;
+        low >>= 8;
+        len++;
+    }
+    if (high != testvalue) {
+        len = 5;
+        top = (u_char) high;
+        for (high >>= 8; high != testvalue; high >>= 8) {
+            top = (u_char) high;
+            len++;
+        }
+    }
+    if ((top & 0x80) != (testvalue & 0x80))
+        len++;
+    return len;
+}
+
+/**
+ * @internal
+ * returns the number of content bytes that asn_realloc_rbuild_objid()
+ * writes for an object identifier.
+ *
+ * @param objid       IN - pointer to the object id
+ * @param objidlength IN - number of sub-identifiers
+ *
+ * @return number of content bytes
+ */
+size_t
+asn_objid_len(const oid *objid, size_t objidlength)
+{
+    uint32_t        subid;
+    size_t          i, len;
+
+    if (objidlength < 2)
+        return 1;
+
+    subid = objid[0] * 40 + objid[1];
+    for (len = 1; subid >>= 7; len++)
+        ;
+    for (i = 2; i < objidlength; i++)
+        for (subid = objid[i], len++; subid >>= 7; len++)
+            ;
+    return len;
+}
+
+
 /**
  * @internal
  * This function increases the size of the buffer pointed to by *pkt, which
@@ -1,8 +1,9 @@
 /*
  * lcd_time.c
  *
- * XXX  Should etimelist entries with <0,0> time tuples be timed out?
- * XXX  Need a routine to free the memory?  (Perhaps at shutdown?)
+ * Records of remote engines that stay idle for longer than the
+ * engineTimeExpiry setting are dropped; without it they are kept until
+ * free_etimelist() is called at shutdown.
  */
 
 #include <net-snmp/net-snmp-config.h>
@@ -42,14 +43,12 @@
 
 #include <net-snmp/library/snmp_api.h>
 #include <net-snmp/library/callback.h>
+#include <net-snmp/library/default_store.h>
 #include <net-snmp/library/snmp_secmod.h>
 #include <net-snmp/library/snmpusm.h>
 #include <net-snmp/library/lcd_time.h>
-#include <net-snmp/library/scapi.h>
 #include <net-snmp/library/snmpv3.h>
 
-#include <net-snmp/library/transform_oids.h>
-
 netsnmp_feature_child_of(usm_support, libnetsnmp);
 netsnmp_feature_child_of(usm_lcd_time, usm_support);
 
@@ -59,9 +58,87 @@ netsnmp_feature_child_of(usm_lcd_time, usm_support);
  * Global static hashlist to contain Enginetime entries.
  *
  * New records are prepended to the appropriate list at the hash index.
+ * The table starts out with ETIMELIST_SIZE lists and doubles whenever
+ * there are more records than lists.
  */
-static Enginetime etimelist[ETIMELIST_SIZE];
+static Enginetime *etimelist;
+static u_int    etimelist_size;
+static u_int    etimelist_count;
+static time_t   etimelist_expired;
 
+static u_int
+_engineID_hash(const u_char * engineID, u_int engineID_len)
+{
+    u_int           hash = 2166136261U;     /* FNV-1a */
+
+    while (engineID_len--)
+        hash = (hash ^ *engineID++) * 16777619U;
+    return hash;
+}
+
+static int
+_etimelist_resize(u_int size)
+{
+    Enginetime     *list, e, next;
+    u_int           i, iindex;
+
+    list = calloc(size, sizeof(*list));
+    if (!list)
+        return SNMPERR_GENERR;
+    for (i = 0; i < etimelist_size; i++) {
+        for (e = etimelist[i]; e; e = next) {
+            next = e->next;
+            iindex = _engineID_hash(e->engineID, e->engineID_len) & (size - 1);
+            e->next = list[iindex];
+            list[iindex] = e;
+        }
+    }
+    free(etimelist);
+    etimelist = list;
+    etimelist_size = size;
+    DEBUGMSGTL(("lcd_time", "%u lists for %u engines\n", etimelist_size,
+                etimelist_count));
+    return SNMPERR_SUCCESS;
+}
+
+/*
+ * Drops the records of remote engines that have been neither looked up
+ * nor updated for engineTimeExpiry seconds.  Runs at most once per
+ * expiry period, so records go after one to two periods of idleness.
+ */
+static void
+_etimelist_expire(time_t now)
+{
+    int             expiry = netsnmp_ds_get_int(NETSNMP_DS_LIBRARY_ID,
+                                                NETSNMP_DS_LIB_ENGINETIME_EXPIRY);
+    u_char          localID[SNMP_MAX_ENG_SIZE];
+    size_t          localID_len;
+    Enginetime     *ep, e;
+    u_int           i, expired = 0;
+
+    if (expiry <= 0 || now - etimelist_expired < expiry)
+        return;
+    etimelist_expired = now;
+
+    localID_len = snmpv3_get_engineID(localID, sizeof(localID));
+    for (i = 0; i < etimelist_size; i++) {
+        for (ep = &etimelist[i]; (e = *ep);) {
+            if (now - e->lastUsed >= expiry &&
+                !(e->engineID_len == localID_len &&
+                  !memcmp(e->engineID, localID, localID_len))) {
+                *ep = e->next;
+                SNMP_FREE(e->engineID);
+                SNMP_FREE(e);
+                etimelist_count--;
+                expired++;
+            } else
+                ep = &e->next;
+        }
+    }
+    if (expired)
+        DEBUGMSGTL(("lcd_time", "expired %u engines, %u left\n", expired,
+                    etimelist_count));
+}
 
 
 
@@ -123,13 +200,14 @@ get_enginetime(const u_char * engineID,
     if (!(e = search_enginetime_list(engineID, engineID_len))) {
         QUITFUN(SNMPERR_GENERR, get_enginetime_quit);
     }
+    e->lastUsed = snmpv3_local_snmpEngineTime();
 #ifdef LCD_TIME_SYNC_OPT
     if (!authenticated || e->authenticatedFlag) {
 #endif
         *engine_time = e->engineTime;
         *engineboot = e->engineBoot;
 
-       timediff = (int) (snmpv3_local_snmpEngineTime() - e->lastReceivedEngineTime);
+       timediff = (int) (e->lastUsed - e->lastReceivedEngineTime);
 
 #ifdef LCD_TIME_SYNC_OPT
     }
@@ -219,13 +297,14 @@ get_enginetime_ex(u_char * engineID,
     if (!(e = search_enginetime_list(engineID, engineID_len))) {
         QUITFUN(SNMPERR_GENERR, get_enginetime_ex_quit);
     }
+    e->lastUsed = snmpv3_local_snmpEngineTime();
 #ifdef LCD_TIME_SYNC_OPT
     if (!authenticated || e->authenticatedFlag) {
 #endif
         *last_engine_time = *engine_time = e->engineTime;
         *engineboot = e->engineBoot;
 
-       timediff = (int) (snmpv3_local_snmpEngineTime() - e->lastReceivedEngineTime);
+       timediff = (int) (e->lastUsed - e->lastReceivedEngineTime);
 
 #ifdef LCD_TIME_SYNC_OPT
     }
@@ -259,22 +338,25 @@ get_enginetime_ex(u_char * engineID,
 
 void free_enginetime(unsigned char *engineID, size_t engineID_len)
 {
-    Enginetime      e = NULL;
+    Enginetime     *ep, e;
     int             rval = 0;
 
+    if (!etimelist)
+        return;
     rval = hash_engineID(engineID, engineID_len);
     if (rval < 0)
 	return;
 
-    e = etimelist[rval];
-
-    while (e != NULL) {
-	etimelist[rval] = e->next;
-	SNMP_FREE(e->engineID);
-	SNMP_FREE(e);
-	e = etimelist[rval];
+    for (ep = &etimelist[rval]; (e = *ep); ep = &e->next) {
+        if (e->engineID_len == engineID_len &&
+            !memcmp(e->engineID, engineID, engineID_len)) {
+            *ep = e->next;
+            SNMP_FREE(e->engineID);
+            SNMP_FREE(e);
+            etimelist_count--;
+            break;
+        }
     }
-
 }
 
 /*******************************************************************-o-****
@@ -297,7 +379,7 @@ void free_etimelist(void)
      Enginetime e = NULL;
      Enginetime nextE = NULL;
 
-     for( ; index < ETIMELIST_SIZE; ++index)
+     for( ; index < (int) etimelist_size; ++index)
      {
            e = etimelist[index];
 
@@ -308,9 +390,10 @@ void free_etimelist(void)
                  SNMP_FREE(e);
                  e = nextE;
            }
-
-           etimelist[index] = NULL;
      }
+     SNMP_FREE(etimelist);
+     etimelist_size = etimelist_count = 0;
+     etimelist_expired = 0;
      return;
 }
 
@@ -344,6 +427,7 @@ set_enginetime(const u_char * engineID,
 {
     int             rval = SNMPERR_SUCCESS, iindex;
     Enginetime      e = NULL;
+    time_t          now;
 
 
 
@@ -359,21 +443,34 @@ set_enginetime(const u_char * engineID,
      * Store the given <engine_time, engineboot> tuple in the record
      * for engineID.  Create a new record if necessary.
      */
+    now = snmpv3_local_snmpEngineTime();
     if (!(e = search_enginetime_list(engineID, engineID_len))) {
+        _etimelist_expire(now);
+        if (etimelist_count >= etimelist_size &&
+            _etimelist_resize(etimelist_size ? etimelist_size * 2 :
+                              ETIMELIST_SIZE) != SNMPERR_SUCCESS &&
+            !etimelist) {
+            QUITFUN(SNMPERR_GENERR, set_enginetime_quit);
+        }
         if ((iindex = hash_engineID(engineID, engineID_len)) < 0) {
             QUITFUN(SNMPERR_GENERR, set_enginetime_quit);
         }
 
         e = calloc(1, sizeof(*e));
+        if (!e) {
+            QUITFUN(SNMPERR_GENERR, set_enginetime_quit);
+        }
+        e->engineID = netsnmp_memdup(engineID, engineID_len);
+        if (!e->engineID) {
+            QUITFUN(SNMPERR_GENERR, set_enginetime_quit);
+        }
+        e->engineID_len = engineID_len;
 
         e->next = etimelist[iindex];
         etimelist[iindex] = e;
-
-        e->engineID = calloc(1, engineID_len);
-        memcpy(e->engineID, engineID, engineID_len);
-
-        e->engineID_len = engineID_len;
+        etimelist_count++;
     }
+    e->lastUsed = now;
 #ifdef LCD_TIME_SYNC_OPT
     if (authenticated || !e->authenticatedFlag) {
         e->authenticatedFlag = authenticated;
@@ -382,7 +479,7 @@ set_enginetime(const u_char * engineID,
 #endif
         e->engineTime = engine_time;
         e->engineBoot = engineboot;
-        e->lastReceivedEngineTime = snmpv3_local_snmpEngineTime();
+        e->lastReceivedEngineTime = now;
     }
 
     e = NULL;                   /* Indicates a successful update. */
@@ -436,6 +533,9 @@ search_enginetime_list(const u_char * engineID, u_int engineID_len)
     /*
      * Find the entry for engineID if there be one.
      */
+    if (!etimelist) {
+        QUITFUN(SNMPERR_GENERR, search_enginetime_list_quit);
+    }
     rval = hash_engineID(engineID, engineID_len);
     if (rval < 0) {
         QUITFUN(SNMPERR_GENERR, search_enginetime_list_quit);
@@ -467,63 +567,25 @@ search_enginetime_list(const u_char * engineID, u_int engineID_len)
  *	 engineID_len
  *      
  * Returns:
- *	>0			etimelist index for this engineID.
+ *	>=0			etimelist index for this engineID.
  *	SNMPERR_GENERR		Error.
  *	
  * 
- * Use a cheap hash to build an index into the etimelist.  Method is 
- * to hash the engineID, then split the hash into u_int's and add them up
- * and modulo the size of the list.
- *
+ * Hash the engineID with FNV-1a into an index into the etimelist at its
+ * current size.  Indices change when the list is resized.
  */
 int
 hash_engineID(const u_char * engineID, u_int engineID_len)
 {
-    int             rval = SNMPERR_GENERR;
-    size_t          buf_len = SNMP_MAXBUF;
-    u_int           additive = 0;
-    u_char         *bufp, buf[SNMP_MAXBUF];
-    void           *context = NULL;
-
-
-
     /*
      * Sanity check.
      */
     if (!engineID || (engineID_len <= 0)) {
-        QUITFUN(SNMPERR_GENERR, hash_engineID_quit);
-    }
-
-
-    /*
-     * Hash engineID into a list index.
-     */
-#ifndef NETSNMP_DISABLE_MD5
-    rval = sc_hash(usmHMACMD5AuthProtocol,
-                   OID_LENGTH(usmHMACMD5AuthProtocol),
-                   engineID, engineID_len, buf, &buf_len);
-    if (rval == SNMPERR_SC_NOT_CONFIGURED) {
-        /* fall back to sha1 */
-        rval = sc_hash(usmHMACSHA1AuthProtocol,
-                   OID_LENGTH(usmHMACSHA1AuthProtocol),
-                   engineID, engineID_len, buf, &buf_len);
-    }
-#else
-    rval = sc_hash(usmHMACSHA1AuthProtocol,
-                   OID_LENGTH(usmHMACSHA1AuthProtocol),
-                   engineID, engineID_len, buf, &buf_len);
-#endif
-    QUITFUN(rval, hash_engineID_quit);
-
-    for (bufp = buf; (bufp - buf) < (int) buf_len; bufp += 4) {
-        additive += (u_int) * bufp;
+        return SNMPERR_GENERR;
     }
 
-  hash_engineID_quit:
-    SNMP_FREE(context);
-    memset(buf, 0, SNMP_MAXBUF);
-
-    return (rval < 0) ? rval : (int)(additive % ETIMELIST_SIZE);
+    return (int) (_engineID_hash(engineID, engineID_len) &
+                  ((etimelist_size ? etimelist_size : ETIMELIST_SIZE) - 1));
 
 }                               /* end hash_engineID() */
 
@@ -584,7 +646,7 @@ dump_etimelist(void)
 
     DEBUGMSGTL(("dump_etimelist", "\n"));
 
-    while (++iindex < ETIMELIST_SIZE) {
+    while (++iindex < (int) etimelist_size) {
         DEBUGMSG(("dump_etimelist", "[%d]", iindex));
 
         count = 0;
@@ -448,3 +448,94 @@ snmp_realloc_rbuild_var_op(u_char ** pkt, size_t * pkt_len,
 }
 
 #endif                          /* NETSNMP_USE_REVERSE_ASNENCODING */
+
+/*
+ * Returns the number of bytes snmp_realloc_rbuild_var_op() produces for a
+ * varbind, or 0 if the type cannot be encoded.  Nothing is encoded; this
+ * lets callers fill a message of a given size without building it first.
+ */
+size_t
+snmp_var_op_len(const oid * var_name, size_t var_name_len,
+                u_char var_val_type, const u_char * var_val,
+                size_t var_val_len)
+{
+    size_t          len;
+
+    switch (var_val_type) {
+    case ASN_INTEGER:
+        if (var_val_len != sizeof(long))
+            return 0;
+        len = asn_int_len(*(const long *) var_val);
+        break;
+
+    case ASN_GAUGE:
+    case ASN_COUNTER:
+    case ASN_TIMETICKS:
+    case ASN_UINTEGER:
+        if (var_val_len != sizeof(u_long))
+            return 0;
+        len = asn_unsigned_int_len(*(const u_long *) var_val);
+        break;
+
+    case ASN_COUNTER64:
+        if (var_val_len != sizeof(struct counter64))
+            return 0;
+        len = asn_unsigned_int64_len((const struct counter64 *) var_val);
+        break;
+
+    case ASN_OCTET_STR:
+    case ASN_IPADDRESS:
+    case ASN_OPAQUE:
+    case ASN_NSAP:
+    case ASN_BIT_STR:
+        len = var_val_len;
+        break;
+
+    case ASN_OBJECT_ID:
+        len = asn_objid_len((const oid *) var_val, var_val_len / sizeof(oid));
+        break;
+
+    case ASN_NULL:
+    case SNMP_NOSUCHOBJECT:
+    case SNMP_NOSUCHINSTANCE:
+    case SNMP_ENDOFMIBVIEW:
+        len = 0;
+        break;
+
+#ifdef NETSNMP_WITH_OPAQUE_SPECIAL_TYPES
+    /*
+     * These are wrapped in an Opaque: tag1, type and length octets, then
+     * the value.
+     */
+    case ASN_OPAQUE_COUNTER64:
+    case ASN_OPAQUE_U64:
+        if (var_val_len != sizeof(struct counter64))
+            return 0;
+        len = 3 + asn_unsigned_int64_len((const struct counter64 *) var_val);
+        break;
+
+    case ASN_OPAQUE_I64:
+        if (var_val_len != sizeof(struct counter64))
+            return 0;
+        len = 3 + asn_signed_int64_len((const struct counter64 *) var_val);
+        break;
+
+    case ASN_OPAQUE_FLOAT:
+        len = 3 + sizeof(float);
+        break;
+
+    case ASN_OPAQUE_DOUBLE:
+        len = 3 + sizeof(double);
+        break;
+#endif                          /* NETSNMP_WITH_OPAQUE_SPECIAL_TYPES */
+
+    default:
+        return 0;
+    }
+    len += asn_header_len(len);
+
+    len += asn_objid_len(var_name, var_name_len);
+    len += asn_header_len(asn_objid_len(var_name, var_name_len));
+
+    return len + asn_header_len(len);
+}
@@ -90,6 +90,9 @@ SOFTWARE.
 #ifdef HAVE_SYS_UN_H
 #include <sys/un.h>
 #endif
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
 #ifdef HAVE_NETDB_H
 #include <netdb.h>
 #endif
@@ -125,6 +128,8 @@ SOFTWARE.
 #include <net-snmp/library/container.h>
 #include <net-snmp/library/snmp_secmod.h>
 #include <net-snmp/library/large_fd_set.h>
+#include <net-snmp/library/fd_event_manager.h>
+#include <net-snmp/library/snmpSocketBaseDomain.h>
 #ifdef NETSNMP_SECMOD_USM
 #include <net-snmp/library/snmpusm.h>
 #endif
@@ -146,6 +151,9 @@ netsnmp_feature_child_of(statistics, libnetsnmp);
 netsnmp_feature_child_of(snmp_api, libnetsnmp);
 netsnmp_feature_child_of(oid_is_subtree, snmp_api);
 netsnmp_feature_child_of(snmpv3_probe_contextEngineID_rfc5343, snmp_api);
+#ifdef HAVE_SYS_UIO_H
+netsnmp_feature_require(fd_event_manager);
+#endif
 
 static void     _init_snmp(void);
 
@@ -172,6 +180,26 @@ static int      _snmp_store_needed = 0;
 #define NETSNMP_STREAM_QUEUE_LEN  5
 #endif
 
+/*
+ * Stream sessions read into a buffer that is kept while a peer sends
+ * several packets in a row.  The partial packet at its end is only moved
+ * to the start when fewer than NETSNMP_STREAM_MIN_READ bytes are left.
+ */
+#define NETSNMP_STREAM_MIN_READ   (SNMP_MAX_RCV_MSG_SIZE / 4)
+
+#ifdef HAVE_SYS_UIO_H
+/*
+ * Responses to packets read together from a stream are queued and sent
+ * with one gather write.  Connections accepted from a listening stream
+ * are non-blocking and queue all their output: what the socket does not
+ * take stays queued, and is sent when the descriptor becomes writable.
+ * Once NETSNMP_STREAM_WQ_HIGH bytes are queued, no more of that
+ * connection's input is read or parsed until the queue drains, so a peer
+ * that does not read its answers only holds up itself.
+ */
+#define NETSNMP_STREAM_WQ_HIGH    SNMP_MAX_RCV_MSG_SIZE
+#endif
+
 #ifndef BSD4_3
 #define BSD4_2
 #endif
@@ -209,6 +237,7 @@ struct snmp_internal_session {
                                         void *, size_t);
 
     u_char       *packet;      /* curr rcv packet data (may be incomplete) */
+    size_t        packet_start; /* offset of the unprocessed data */
     size_t        packet_len;  /* length of data received so far */
     size_t        packet_size; /* size of buffer for packet data */
 
@@ -216,6 +245,34 @@ struct snmp_internal_session {
     size_t        obuf_size;    /* size of buffer for packet data */
     u_char       *opacket;      /* send packet data (within obuf) */
     size_t        opacket_len;  /* length of data */
+    u_char       *sbuf;         /* spare send buffer, kept between sends */
+    size_t        sbuf_size;
+#ifdef HAVE_SYS_UIO_H
+    int           corked;       /* queue responses instead of sending */
+    int           wq_async;     /* non-blocking, all output is queued */
+    int           wq_len;       /* queued messages ... */
+    int           wq_alloc;
+    size_t        wq_bytes;     /* ... and the bytes not yet sent */
+    struct iovec *wq;
+    u_char      **wq_buf;       /* buffers of the queued messages */
+    size_t       *wq_size;
+    int           wq_wait;      /* wq_fd is registered for writing */
+    int           wq_fd;
+    int           rq_stalled;   /* input left unparsed while wq is full */
+    void         *rq_opaque;    /* ... and the transport data it came with */
+    int           rq_olength;
+#endif
+
+    /*
+     * Outstanding requests, also indexed by request id and message id
+     * and kept in a heap ordered on expiry time.
+     */
+    netsnmp_request_list **reqid_hash;
+    netsnmp_request_list **msgid_hash;
+    size_t        hash_size;     /* buckets in each table, a power of 2 */
+    netsnmp_request_list **timeouts;
+    size_t        timeouts_len;  /* number of outstanding requests */
+    size_t        timeouts_size;
 };
 
 /*
@@ -346,11 +403,16 @@ static int      snmpv3_build(u_char ** pkt, size_t * pkt_len,
                              netsnmp_pdu *pdu);
 static int      snmp_parse_version(u_char *, size_t);
 static int      snmp_resend_request(struct session_list *slp,
-                                    netsnmp_request_list *orp,
                                     netsnmp_request_list *rp,
                                     int incr_retries);
+static int      add_request(struct snmp_internal_session *isp,
+                            netsnmp_request_list *rp);
 static void     register_default_handlers(void);
 static struct session_list *snmp_sess_copy(netsnmp_session * pss);
+#ifdef HAVE_SYS_UIO_H
+static void     _sess_drop_queue(struct snmp_internal_session *isp);
+static void     _sess_writable(int fd, void *data);
+#endif
 
 /*
  * return configured max message size for outgoing packets
@@ -1984,6 +2046,16 @@ void netsnmp_cleanup_session(netsnmp_session *s)
     free(s->securityPrivLocalKey);
     free(s->paramName);
 #ifndef NETSNMP_NO_TRAP_STATS
+    if (s->trap_stats) {
+        netsnmp_trap_stats *ts = s->trap_stats;
+
+        for (; ts->inform_queue_len > 0; --ts->inform_queue_len) {
+            snmp_free_pdu(ts->inform_queue[ts->inform_queue_head]);
+            ts->inform_queue_head =
+                (ts->inform_queue_head + 1) % ts->inform_queue_size;
+        }
+        free(ts->inform_queue);
+    }
     free(s->trap_stats);
 #endif /* NETSNMP_NO_TRAP_STATS */
     usm_free_user(s->sessUser);
@@ -2042,6 +2114,14 @@ snmp_sess_close(struct session_list *slp)
         netsnmp_request_list *rp, *orp;
 
         SNMP_FREE(isp->packet);
+        SNMP_FREE(isp->obuf);
+        SNMP_FREE(isp->sbuf);
+#ifdef HAVE_SYS_UIO_H
+        _sess_drop_queue(isp);
+        SNMP_FREE(isp->wq);
+        SNMP_FREE(isp->wq_buf);
+        SNMP_FREE(isp->wq_size);
+#endif
 
         /*
          * Free each element in the input request list.  
@@ -2058,6 +2138,9 @@ snmp_sess_close(struct session_list *slp)
             snmp_free_pdu(orp->pdu);
             free(orp);
         }
+        free(isp->reqid_hash);
+        free(isp->msgid_hash);
+        free(isp->timeouts);
 
         free(isp);
     }
@@ -5061,6 +5144,172 @@ netsnmp_build_packet(struct snmp_internal_session *isp, netsnmp_session *sp,
     return result;
 }
 
+/*
+ * Done with the packet in obuf: keep the buffer for the next send on this
+ * session, unless it grew beyond what a message normally needs.
+ */
+static void
+_sess_release_obuf(struct snmp_internal_session *isp)
+{
+    if (isp->sbuf == NULL && isp->obuf_size <= SNMP_MAX_RCV_MSG_SIZE) {
+        isp->sbuf = isp->obuf;
+        isp->sbuf_size = isp->obuf_size;
+        isp->obuf = NULL;
+    } else
+        SNMP_FREE(isp->obuf);
+    isp->opacket = NULL; /* opacket was in obuf, so no free needed */
+    isp->opacket_len = 0;
+}
+
+#ifdef HAVE_SYS_UIO_H
+/*
+ * Waits for the socket of a stream session to become writable while
+ * output is queued, or input is left to parse once the queue drains.
+ */
+static void
+_sess_wait_writable(struct session_list *slp)
+{
+    struct snmp_internal_session *isp = slp->internal;
+    int             wait = isp->wq_len > 0 || isp->rq_stalled;
+
+    if (wait && !isp->wq_wait && slp->transport->sock >= 0) {
+        if (register_writefd(slp->transport->sock, _sess_writable,
+                             slp) != FD_REGISTERED_OK)
+            return;
+        isp->wq_fd = slp->transport->sock;
+        isp->wq_wait = 1;
+    } else if (!wait && isp->wq_wait) {
+        unregister_writefd(isp->wq_fd);
+        isp->wq_wait = 0;
+    }
+}
+
+/*
+ * Frees the messages queued on a stream session, sent or not.
+ */
+static void
+_sess_drop_queue(struct snmp_internal_session *isp)
+{
+    while (isp->wq_len > 0)
+        free(isp->wq_buf[--isp->wq_len]);
+    isp->wq_bytes = 0;
+    isp->rq_stalled = 0;
+    SNMP_FREE(isp->rq_opaque);
+    isp->rq_olength = 0;
+    if (isp->wq_wait) {
+        unregister_writefd(isp->wq_fd);
+        isp->wq_wait = 0;
+    }
+}
+
+/*
+ * Sends the messages queued on a stream session, with a single gather
+ * write where the transport supports that.  On a non-blocking socket
+ * what it does not take stays queued, to be sent once it is writable.
+ *
+ * Returns the number of bytes sent, or a negative value on error.
+ */
+static int
+_sess_flush_queue(struct session_list *slp)
+{
+    struct snmp_internal_session *isp = slp->internal;
+    size_t          n;
+    int             rc, i;
+
+    if (isp->wq_len == 0)
+        return 0;
+
+    DEBUGMSGTL(("sess_async_send", "sending %d queued messages, %"
+                NETSNMP_PRIz "u bytes\n", isp->wq_len, isp->wq_bytes));
+    rc = netsnmp_transport_sendv(slp->transport, isp->wq, isp->wq_len);
+    if (rc < 0) {
+        slp->session->s_snmp_errno = SNMPERR_BAD_SENDTO;
+        slp->session->s_errno = errno;
+        while (isp->wq_len > 0)
+            free(isp->wq_buf[--isp->wq_len]);
+        isp->wq_bytes = 0;
+        _sess_wait_writable(slp);
+        return rc;
+    }
+
+    /* keep the first sent buffer for the next message */
+    for (n = rc, i = 0; i < isp->wq_len && n >= isp->wq[i].iov_len; i++) {
+        n -= isp->wq[i].iov_len;
+        if (isp->sbuf == NULL && isp->wq_size[i] <= SNMP_MAX_RCV_MSG_SIZE) {
+            isp->sbuf = isp->wq_buf[i];
+            isp->sbuf_size = isp->wq_size[i];
+        } else
+            free(isp->wq_buf[i]);
+    }
+    if (i < isp->wq_len) {
+        isp->wq[i].iov_base = (u_char *) isp->wq[i].iov_base + n;
+        isp->wq[i].iov_len -= n;
+    }
+    isp->wq_len -= i;
+    if (i > 0 && isp->wq_len > 0) {
+        memmove(isp->wq, isp->wq + i, isp->wq_len * sizeof(*isp->wq));
+        memmove(isp->wq_buf, isp->wq_buf + i,
+                isp->wq_len * sizeof(*isp->wq_buf));
+        memmove(isp->wq_size, isp->wq_size + i,
+                isp->wq_len * sizeof(*isp->wq_size));
+    }
+    isp->wq_bytes -= rc;
+    if (isp->wq_len > 0)
+        DEBUGMSGTL(("sess_async_send", "%d messages, %" NETSNMP_PRIz
+                    "u bytes left queued on fd %d\n", isp->wq_len,
+                    isp->wq_bytes, slp->transport->sock));
+    _sess_wait_writable(slp);
+    return rc;
+}
+
+/*
+ * Queues the packet in obuf, to be sent by _sess_flush_queue() together
+ * with the answers to the other packets read from the stream, or once
+ * the socket takes it.
+ */
+static int
+_sess_queue_obuf(struct session_list *slp, netsnmp_pdu *pdu)
+{
+    struct snmp_internal_session *isp = slp->internal;
+    int             i = isp->wq_len;
+
+    if (i == isp->wq_alloc) {
+        int             n = i ? 2 * i : 8;
+        struct iovec   *wq;
+        u_char        **wq_buf;
+        size_t         *wq_size;
+
+        wq = realloc(isp->wq, n * sizeof(*wq));
+        if (wq == NULL)
+            return -1;
+        isp->wq = wq;
+        wq_buf = realloc(isp->wq_buf, n * sizeof(*wq_buf));
+        if (wq_buf == NULL)
+            return -1;
+        isp->wq_buf = wq_buf;
+        wq_size = realloc(isp->wq_size, n * sizeof(*wq_size));
+        if (wq_size == NULL)
+            return -1;
+        isp->wq_size = wq_size;
+        isp->wq_alloc = n;
+    }
+
+    netsnmp_transport_log_send(slp->transport, isp->opacket,
+                               isp->opacket_len, &(pdu->transport_data),
+                               &(pdu->transport_data_length));
+    isp->wq[i].iov_base = isp->opacket;
+    isp->wq[i].iov_len = isp->opacket_len;
+    isp->wq_buf[i] = isp->obuf;
+    isp->wq_size[i] = isp->obuf_size;
+    isp->wq_bytes += isp->opacket_len;
+    isp->wq_len++;
+    isp->obuf = NULL;
+    isp->opacket = NULL;
+    isp->opacket_len = 0;
+    return 0;
+}
+#endif /* HAVE_SYS_UIO_H */
+
 int
 _build_initial_pdu_packet(struct session_list *slp, netsnmp_pdu *pdu, int bulk)
 {
@@ -5168,11 +5417,18 @@ _build_initial_pdu_packet(struct session_list *slp, netsnmp_pdu *pdu, int bulk)
     netsnmp_assert(pdu->msgMaxSize > 0);
 
     /*
-     * allocate initial packet buffer. Buffer will be grown as needed
-     * while building the packet.
+     * allocate initial packet buffer, or reuse the one kept from the last
+     * send. Buffer will be grown as needed while building the packet.
      */
-    pktbuf_len = SNMP_MIN_MAX_LEN;
-    if ((pktbuf = (u_char *)malloc(pktbuf_len)) == NULL) {
+    if (isp->sbuf) {
+        pktbuf = isp->sbuf;
+        pktbuf_len = isp->sbuf_size;
+        isp->sbuf = NULL;
+    } else {
+        pktbuf_len = SNMP_MIN_MAX_LEN;
+        pktbuf = (u_char *)malloc(pktbuf_len);
+    }
+    if (pktbuf == NULL) {
         DEBUGMSGTL(("sess_async_send",
                     "couldn't malloc initial packet buffer\n"));
         session->s_snmp_errno = SNMPERR_MALLOC;
@@ -5407,13 +5663,33 @@ _sess_async_send(struct session_list *slp,
 
     DEBUGMSGTL(("sess_process_packet", "sending message id#%ld reqid#%ld len %"
                 NETSNMP_PRIz "u\n", pdu->msgid, pdu->reqid, isp->opacket_len));
+#ifdef HAVE_SYS_UIO_H
+    if ((isp->corked || isp->wq_async) && isp->obuf &&
+        transport->f_sendv != NULL) {
+        /* requests are not held back for the rest of the answers */
+        result = _sess_queue_obuf(slp, pdu);
+        if (result < 0)
+            _sess_release_obuf(isp);
+        else if (!isp->corked ||
+                 (pdu->flags & UCD_MSG_FLAG_EXPECT_RESPONSE))
+            result = _sess_flush_queue(slp);
+    } else {
+        /* keep the order of the messages on a stream */
+        result = _sess_flush_queue(slp);
+        if (result >= 0)
+            result = netsnmp_transport_send(transport, isp->opacket,
+                                            isp->opacket_len,
+                                            &(pdu->transport_data),
+                                            &(pdu->transport_data_length));
+        _sess_release_obuf(isp);
+    }
+#else
     result = netsnmp_transport_send(transport, isp->opacket, isp->opacket_len,
                                     &(pdu->transport_data),
                                     &(pdu->transport_data_length));
 
-    SNMP_FREE(isp->obuf);
-    isp->opacket = NULL; /* opacket was in obuf, so no free needed */
-    isp->opacket_len = 0;
+    _sess_release_obuf(isp);
+#endif
 
     if (result < 0) {
         session->s_snmp_errno = SNMPERR_BAD_SENDTO;
@@ -5473,16 +5749,13 @@ _sess_async_send(struct session_list *slp,
          * XX lock should be per session ! 
          */
         snmp_res_lock(MT_LIBRARY_ID, MT_LIB_SESSION);
-        if (isp->requestsEnd) {
-            rp->next_request = isp->requestsEnd->next_request;
-            isp->requestsEnd->next_request = rp;
-            isp->requestsEnd = rp;
-        } else {
-            rp->next_request = isp->requests;
-            isp->requests = rp;
-            isp->requestsEnd = rp;
-        }
+        result = add_request(isp, rp);
         snmp_res_unlock(MT_LIBRARY_ID, MT_LIB_SESSION);
+        if (result < 0) {
+            free(rp);
+            session->s_snmp_errno = SNMPERR_MALLOC;
+            return 0;
+        }
     } else {
         /*
          * No response expected...  
@@ -5533,6 +5806,83 @@ snmp_sess_async_send(struct session_list *slp,
 }
 
 
+/**
+ * Encode a PDU the way snmp_sess_async_send() would, without sending it.
+ * Together with snmp_sess_async_send_packet() this allows a PDU that is
+ * sent unchanged to several sessions to be encoded only once.
+ *
+ * @param[in]  slp     Session pointer.
+ * @param[in]  pdu     PDU to encode. Its version and community are filled
+ *                     in from the session as when sending.
+ * @param[out] pkt     Encoded packet. Must be freed by the caller.
+ * @param[out] pkt_len Length of the encoded packet.
+ *
+ * @return SNMPERR_SUCCESS or an SNMPERR_ code. Sessions with their own
+ * build hooks (e.g. AgentX) are refused with SNMPERR_GENERR.
+ */
+int
+snmp_sess_build_packet(struct session_list *slp, netsnmp_pdu *pdu,
+                       u_char **pkt, size_t *pkt_len)
+{
+    struct snmp_internal_session *isp;
+    int             result;
+
+    if (slp == NULL || slp->session == NULL || slp->internal == NULL)
+        return SNMPERR_BAD_SESSION;
+    isp = slp->internal;
+    if (isp->hook_build || isp->hook_realloc_build || isp->opacket)
+        return SNMPERR_GENERR;
+
+    result = _build_initial_pdu_packet(slp, pdu, 0);
+    if (result != SNMPERR_SUCCESS || isp->opacket == NULL)
+        return result != SNMPERR_SUCCESS ? result : SNMPERR_GENERR;
+
+    *pkt = netsnmp_memdup(isp->opacket, isp->opacket_len);
+    *pkt_len = isp->opacket_len;
+    _sess_release_obuf(isp);
+    return *pkt ? SNMPERR_SUCCESS : SNMPERR_MALLOC;
+}
+
+/**
+ * Send a PDU for which no response is expected (e.g. a trap) using a
+ * packet encoded earlier by snmp_sess_build_packet(), possibly for
+ * another session with the same version and security parameters.
+ *
+ * @return As for snmp_sess_async_send(). @p pkt is not consumed.
+ */
+int
+snmp_sess_async_send_packet(struct session_list *slp, netsnmp_pdu *pdu,
+                            const u_char *pkt, size_t pkt_len,
+                            snmp_callback callback, void *cb_data)
+{
+    struct snmp_internal_session *isp;
+
+    if (slp == NULL || slp->session == NULL || slp->internal == NULL) {
+        snmp_errno = SNMPERR_BAD_SESSION;       /*MTCRITICAL_RESOURCE */
+        return 0;
+    }
+    isp = slp->internal;
+    if (isp->hook_build || isp->hook_realloc_build || isp->opacket ||
+        (pdu->command != SNMP_MSG_TRAP && pdu->command != SNMP_MSG_TRAP2)) {
+        slp->session->s_snmp_errno = SNMPERR_GENERR;
+        SET_SNMP_ERROR(SNMPERR_GENERR);
+        return 0;
+    }
+    isp->obuf = netsnmp_memdup(pkt, pkt_len);
+    if (isp->obuf == NULL) {
+        slp->session->s_snmp_errno = SNMPERR_MALLOC;
+        SET_SNMP_ERROR(SNMPERR_MALLOC);
+        return 0;
+    }
+    isp->obuf_size = pkt_len;
+    isp->opacket = isp->obuf;
+    isp->opacket_len = pkt_len;
+    pdu->flags &= ~UCD_MSG_FLAG_EXPECT_RESPONSE;
+
+    return snmp_sess_async_send(slp, pdu, callback, cb_data);
+}
+
+
 /*
  * Frees the variable and any malloc'd data associated with it.
  */
@@ -5637,7 +5987,7 @@ _sess_process_packet_parse_pdu(struct session_list *slp, netsnmp_session * sp,
 {
   netsnmp_pdu    *pdu;
   int             ret = 0;
-  int             dump = 0, filter = 0;
+  int             dump = 0, filter = 0, filtered = 0;
 
   debug_indent_reset();
 
@@ -5650,9 +6000,19 @@ _sess_process_packet_parse_pdu(struct session_list *slp, netsnmp_session * sp,
 #ifndef NETSNMP_FEATURE_REMOVE_FILTER_SOURCE
   filter = netsnmp_ds_get_int(NETSNMP_DS_LIBRARY_ID,
                                   NETSNMP_DS_LIB_FILTER_TYPE);
+  if (filter) {
+      /*
+       * UDP and TCP keep the source address first in their transport
+       * data; check it directly if the filter allows that.
+       */
+      filtered = -1;
+      if (opaque && (olength == sizeof(netsnmp_indexed_addr_pair) ||
+                     olength == sizeof(netsnmp_addr_pair)))
+          filtered = netsnmp_transport_filter_check_addr(
+              &((netsnmp_indexed_addr_pair *) opaque)->remote_addr.sa);
+  }
 #endif
-  if (dump || filter) {
-      int filtered = 0;
+  if (dump || filtered < 0) {
       char *addrtxt = netsnmp_transport_peer_string(transport, opaque, olength);
       snmp_log(LOG_DEBUG, "\nReceived %d byte packet from %s\n",
                length, addrtxt);
@@ -5661,9 +6021,9 @@ _sess_process_packet_parse_pdu(struct session_list *slp, netsnmp_session * sp,
           xdump(packetptr, length, "");
 
 #ifndef NETSNMP_FEATURE_REMOVE_FILTER_SOURCE
-      if (filter) {
+      if (filtered < 0) {
           char *sourceaddr = NULL, *c = strchr(addrtxt, '[');
-          const char *dropstr = NULL;
+          filtered = 0;
           if (c) {
               sourceaddr = ++c;
               c = strchr(sourceaddr, ']');
@@ -5678,23 +6038,33 @@ _sess_process_packet_parse_pdu(struct session_list *slp, netsnmp_session * sp,
                           addrtxt));
               filtered = 1;
           }
-          if ((filter == -1) && filtered)
-              dropstr = "matched blacklist";
-          else if ((filter == 1) && !filtered)
-              dropstr = "didn't match whitelist";
-          if (dropstr) {
+      }
+#endif
+
+      SNMP_FREE(addrtxt);
+  }
+
+#ifndef NETSNMP_FEATURE_REMOVE_FILTER_SOURCE
+  if (filter) {
+      const char *dropstr = NULL;
+      if ((filter == -1) && filtered)
+          dropstr = "matched blacklist";
+      else if ((filter == 1) && !filtered)
+          dropstr = "didn't match whitelist";
+      if (dropstr) {
+          DEBUGIF("sess_process_packet:filter") {
+              char *addrtxt = netsnmp_transport_peer_string(transport, opaque,
+                                                            olength);
               DEBUGMSGTL(("sess_process_packet:filter",
                           "packet from %s %s\n",
-                          sourceaddr ? sourceaddr : "UNKNOWN", dropstr));
-              SNMP_FREE(opaque);
+                          addrtxt ? addrtxt : "UNKNOWN", dropstr));
               SNMP_FREE(addrtxt);
-              return NULL;
           }
+          SNMP_FREE(opaque);
+          return NULL;
       }
-#endif
-
-      SNMP_FREE(addrtxt);
   }
+#endif
 
   /*
    * Do transport-level filtering (e.g. IP-address based allow/deny).  
@@ -5754,17 +6124,218 @@ _sess_process_packet_parse_pdu(struct session_list *slp, netsnmp_session * sp,
   return pdu;
 }
 
-/* Remove request @rp from session @isp. @orp is the request before @rp. */
+/*
+ * Outstanding request index.  Besides the list in send order, requests
+ * are chained in two hash tables so that a response is matched by its
+ * request id (or message id for SNMPv3) without walking the list, and
+ * kept in a binary min-heap on expireM so that timeout processing only
+ * looks at requests that have expired.
+ */
+#define REQUEST_HASH_MIN_SIZE 16
+
+static size_t
+request_hash(long id, size_t size)
+{
+    u_long          h = (u_long) id;
+
+    return (h ^ (h >> 16)) & (size - 1);
+}
+
+static void
+request_reqid_link(struct snmp_internal_session *isp, netsnmp_request_list *rp)
+{
+    size_t          h = request_hash(rp->request_id, isp->hash_size);
+
+    rp->next_reqid = isp->reqid_hash[h];
+    isp->reqid_hash[h] = rp;
+}
+
+static void
+request_msgid_link(struct snmp_internal_session *isp, netsnmp_request_list *rp)
+{
+    size_t          h = request_hash(rp->message_id, isp->hash_size);
+
+    rp->next_msgid = isp->msgid_hash[h];
+    isp->msgid_hash[h] = rp;
+}
+
+static void
+request_msgid_unlink(struct snmp_internal_session *isp,
+                     netsnmp_request_list *rp)
+{
+    netsnmp_request_list **pp;
+
+    pp = &isp->msgid_hash[request_hash(rp->message_id, isp->hash_size)];
+    for (; *pp; pp = &(*pp)->next_msgid)
+        if (*pp == rp) {
+            *pp = rp->next_msgid;
+            break;
+        }
+    rp->next_msgid = NULL;
+}
+
+static void
+request_reqid_unlink(struct snmp_internal_session *isp,
+                     netsnmp_request_list *rp)
+{
+    netsnmp_request_list **pp;
+
+    pp = &isp->reqid_hash[request_hash(rp->request_id, isp->hash_size)];
+    for (; *pp; pp = &(*pp)->next_reqid)
+        if (*pp == rp) {
+            *pp = rp->next_reqid;
+            break;
+        }
+    rp->next_reqid = NULL;
+}
+
+static int
+request_hash_resize(struct snmp_internal_session *isp, size_t size)
+{
+    netsnmp_request_list **reqid_hash, **msgid_hash, *rp;
+
+    reqid_hash = calloc(size, sizeof(*reqid_hash));
+    msgid_hash = calloc(size, sizeof(*msgid_hash));
+    if (!reqid_hash || !msgid_hash) {
+        free(reqid_hash);
+        free(msgid_hash);
+        return -1;
+    }
+    free(isp->reqid_hash);
+    free(isp->msgid_hash);
+    isp->reqid_hash = reqid_hash;
+    isp->msgid_hash = msgid_hash;
+    isp->hash_size = size;
+    for (rp = isp->requests; rp; rp = rp->next_request) {
+        request_reqid_link(isp, rp);
+        request_msgid_link(isp, rp);
+    }
+    return 0;
+}
+
+static void
+request_heap_set(struct snmp_internal_session *isp, size_t i,
+                 netsnmp_request_list *rp)
+{
+    isp->timeouts[i] = rp;
+    rp->timeout_index = i;
+}
+
+static void
+request_heap_up(struct snmp_internal_session *isp, size_t i)
+{
+    netsnmp_request_list *rp = isp->timeouts[i];
+    size_t          parent;
+
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        if (!timercmp(&rp->expireM, &isp->timeouts[parent]->expireM, <))
+            break;
+        request_heap_set(isp, i, isp->timeouts[parent]);
+        i = parent;
+    }
+    request_heap_set(isp, i, rp);
+}
+
+static void
+request_heap_down(struct snmp_internal_session *isp, size_t i)
+{
+    netsnmp_request_list *rp = isp->timeouts[i];
+    size_t          child;
+
+    for (;;) {
+        child = 2 * i + 1;
+        if (child >= isp->timeouts_len)
+            break;
+        if (child + 1 < isp->timeouts_len &&
+            timercmp(&isp->timeouts[child + 1]->expireM,
+                     &isp->timeouts[child]->expireM, <))
+            child++;
+        if (!timercmp(&isp->timeouts[child]->expireM, &rp->expireM, <))
+            break;
+        request_heap_set(isp, i, isp->timeouts[child]);
+        i = child;
+    }
+    request_heap_set(isp, i, rp);
+}
+
+/* Re-position @rp in the timeout heap after its expireM changed. */
+static void
+request_expiry_changed(struct snmp_internal_session *isp,
+                       netsnmp_request_list *rp)
+{
+    request_heap_up(isp, rp->timeout_index);
+    request_heap_down(isp, rp->timeout_index);
+}
+
+/* Give @rp a new message id, keeping the message id hash up to date. */
+static void
+request_set_msgid(struct snmp_internal_session *isp,
+                  netsnmp_request_list *rp, long msgid)
+{
+    request_msgid_unlink(isp, rp);
+    rp->message_id = msgid;
+    request_msgid_link(isp, rp);
+}
+
+/* Add request @rp to the end of the outstanding requests of @isp. */
+static int
+add_request(struct snmp_internal_session *isp, netsnmp_request_list *rp)
+{
+    if (isp->timeouts_len == isp->timeouts_size) {
+        size_t          size = isp->timeouts_size ?
+            2 * isp->timeouts_size : REQUEST_HASH_MIN_SIZE;
+        netsnmp_request_list **timeouts;
+
+        timeouts = realloc(isp->timeouts, size * sizeof(*timeouts));
+        if (!timeouts)
+            return -1;
+        isp->timeouts = timeouts;
+        isp->timeouts_size = size;
+    }
+    if (isp->timeouts_len >= isp->hash_size &&
+        request_hash_resize(isp, isp->hash_size ?
+                            2 * isp->hash_size : REQUEST_HASH_MIN_SIZE) < 0)
+        return -1;
+
+    rp->next_request = NULL;
+    rp->prev_request = isp->requestsEnd;
+    if (isp->requestsEnd)
+        isp->requestsEnd->next_request = rp;
+    else
+        isp->requests = rp;
+    isp->requestsEnd = rp;
+
+    request_reqid_link(isp, rp);
+    request_msgid_link(isp, rp);
+    request_heap_set(isp, isp->timeouts_len++, rp);
+    request_heap_up(isp, rp->timeout_index);
+    return 0;
+}
+
+/* Remove request @rp from session @isp and free its PDU. */
 static void
-remove_request(struct snmp_internal_session *isp,
-               netsnmp_request_list *orp, netsnmp_request_list *rp)
+remove_request(struct snmp_internal_session *isp, netsnmp_request_list *rp)
 {
-    if (orp)
-        orp->next_request = rp->next_request;
+    netsnmp_request_list *last;
+
+    if (rp->prev_request)
+        rp->prev_request->next_request = rp->next_request;
     else
         isp->requests = rp->next_request;
-    if (isp->requestsEnd == rp)
-        isp->requestsEnd = orp;
+    if (rp->next_request)
+        rp->next_request->prev_request = rp->prev_request;
+    else
+        isp->requestsEnd = rp->prev_request;
+
+    request_reqid_unlink(isp, rp);
+    request_msgid_unlink(isp, rp);
+
+    last = isp->timeouts[--isp->timeouts_len];
+    if (last != rp) {
+        request_heap_set(isp, rp->timeout_index, last);
+        request_expiry_changed(isp, last);
+    }
     snmp_free_pdu(rp->pdu);
 }
 
@@ -5776,8 +6347,9 @@ _sess_process_packet_handle_pdu(struct session_list *slp, netsnmp_session * sp,
                                 struct snmp_internal_session *isp,
                                 netsnmp_transport *transport, netsnmp_pdu *pdu)
 {
-  netsnmp_request_list *rp, *orp = NULL;
+  netsnmp_request_list *rp;
   int             handled = 0;
+  int             by_msgid = (pdu->version == SNMP_VERSION_3);
 
   if (pdu->flags & UCD_MSG_FLAG_RESPONSE_PDU) {
     /*
@@ -5785,7 +6357,13 @@ _sess_process_packet_handle_pdu(struct session_list *slp, netsnmp_session * sp,
      */
     free_securityStateRef(pdu);
 
-    for (rp = isp->requests; rp; orp = rp, rp = rp->next_request) {
+    if (isp->hash_size == 0)
+      rp = NULL;
+    else if (by_msgid)
+      rp = isp->msgid_hash[request_hash(pdu->msgid, isp->hash_size)];
+    else
+      rp = isp->reqid_hash[request_hash(pdu->reqid, isp->hash_size)];
+    for (; rp; rp = by_msgid ? rp->next_msgid : rp->next_reqid) {
       snmp_callback   callback;
       void           *magic;
 
@@ -5839,7 +6417,7 @@ _sess_process_packet_handle_pdu(struct session_list *slp, netsnmp_session * sp,
 	     * * inifinite resend                      
 	     */
 	    if (rp->retries <= sp->retries) {
-	      snmp_resend_request(slp, orp, rp, TRUE);
+	      snmp_resend_request(slp, rp, TRUE);
 	      break;
 	    } else {
 	      /* We're done with retries, so no longer waiting for a response */
@@ -5900,7 +6478,7 @@ _sess_process_packet_handle_pdu(struct session_list *slp, netsnmp_session * sp,
 	/*
 	 * Successful, so delete request.  
 	 */
-	remove_request(isp, orp, rp);
+	remove_request(isp, rp);
 	free(rp);
 	/*
 	 * There shouldn't be any more requests with the same reqid.  
@@ -6089,6 +6667,11 @@ _sess_read_accept(struct session_list *slp)
                          isp->hook_create_pdu);
 
     if (nslp != NULL) {
+#ifdef HAVE_SYS_UIO_H
+        if (new_transport->f_sendv != NULL &&
+            netsnmp_set_non_blocking_mode(data_sock, TRUE) == 0)
+            nslp->internal->wq_async = 1;
+#endif
         snmp_session_insert(nslp);
         /** Tell the new session about its existence if possible. */
         DEBUGMSGTL(("sess_read",
@@ -6169,6 +6752,231 @@ _sess_read_dgram_packet(struct session_list *slp, netsnmp_large_fd_set * fdset,
     return 0;
 }
 
+/*
+ * Parses the complete packets read from a stream into isp->packet, and
+ * sends the answers.  Stops early, leaving the rest of the input for
+ * _sess_writable() to parse, while too much output is queued.  filled
+ * says that the last read filled the buffer.
+ *
+ * Takes over opaque; returns 0 if success, -1 if the connection was
+ * dropped.
+ */
+static int
+_sess_read_stream(struct session_list *slp, void *opaque, int olength,
+                  int filled)
+{
+    netsnmp_session *sp = slp->session;
+    struct snmp_internal_session *isp = slp->internal;
+    netsnmp_transport *transport = slp->transport;
+    u_char         *pptr = isp->packet + isp->packet_start;
+    void           *ocopy = NULL;
+    size_t          pdulen;
+    int             rc = 0;
+
+#ifdef HAVE_SYS_UIO_H
+    /*
+     * Queue the answers to the packets processed in this loop, and
+     * send them all at once afterwards.
+     */
+    isp->corked = transport->f_sendv != NULL;
+#endif
+
+    while (isp->packet_len > 0) {
+
+#ifdef HAVE_SYS_UIO_H
+        if (isp->wq_bytes >= NETSNMP_STREAM_WQ_HIGH)
+            _sess_flush_queue(slp);
+        if (isp->wq_bytes >= NETSNMP_STREAM_WQ_HIGH) {
+            /*
+             * The peer is not reading its answers: parse the rest when
+             * it has taken them.
+             */
+            DEBUGMSGTL(("sess_read", "fd %d stalled, %" NETSNMP_PRIz
+                        "u bytes queued\n", transport->sock, isp->wq_bytes));
+            isp->rq_stalled = 1;
+            SNMP_FREE(isp->rq_opaque);
+            isp->rq_opaque = opaque;
+            isp->rq_olength = olength;
+            opaque = NULL;
+            break;
+        }
+#endif
+
+        /*
+         * Get the total data length we're expecting (and need to wait
+         * for).
+         */
+        if (isp->check_packet) {
+            pdulen = isp->check_packet(pptr, isp->packet_len);
+        } else {
+            pdulen = asn_check_packet(pptr, isp->packet_len);
+        }
+
+        DEBUGMSGTL(("sess_read",
+                    "  loop packet_len %" NETSNMP_PRIz "u, PDU length %"
+                    NETSNMP_PRIz "u\n", isp->packet_len, pdulen));
+
+        if (pdulen > SNMP_MAX_PACKET_LEN) {
+            /*
+             * Illegal length, drop the connection.  
+             */
+            snmp_log(LOG_ERR, 
+                     "Received broken packet. Closing session.\n");
+#ifdef HAVE_SYS_UIO_H
+            isp->corked = 0;
+            _sess_flush_queue(slp);
+            _sess_drop_queue(isp);
+#endif
+            if (sp->callback != NULL) {
+                DEBUGMSGTL(("sess_read",
+                            "perform callback with op=DISCONNECT\n"));
+                (void)sp->callback(NETSNMP_CALLBACK_OP_DISCONNECT,
+                                   sp, 0, NULL, sp->callback_magic);
+            }
+            DEBUGMSGTL(("sess_read", "fd %d closed\n", transport->sock));
+            transport->f_close(transport);
+            SNMP_FREE(opaque);
+            /** XXX-rks: why no SNMP_FREE(isp->packet); ?? */
+            return -1;
+        }
+
+        if (pdulen > isp->packet_len || pdulen == 0) {
+            /*
+             * We don't have a complete packet yet.  It stays where it
+             * is until more data has arrived.
+             */
+            DEBUGMSGTL(("sess_read",
+                        "pkt not complete (need %" NETSNMP_PRIz "u got %"
+                        NETSNMP_PRIz "u so far)\n", pdulen,
+                        isp->packet_len));
+            break; /* opaque freed for us outside of loop. */
+        }
+
+        /*  We have *at least* one complete packet in the buffer now.  If
+            we have possibly more than one packet, we must copy the opaque
+            pointer because we may need to reuse it for a later packet.  */
+
+        if (pdulen < isp->packet_len) {
+            if (olength > 0 && opaque != NULL) {
+                ocopy = malloc(olength);
+                if (ocopy != NULL) {
+                    memcpy(ocopy, opaque, olength);
+                }
+            }
+        } else if (pdulen == isp->packet_len) {
+            /*  Common case -- exactly one packet.  No need to copy the
+                opaque pointer.  */
+            ocopy = opaque;
+            opaque = NULL;
+        }
+
+        if ((rc = _sess_process_packet(slp, sp, isp, transport,
+                                       ocopy, ocopy?olength:0, pptr,
+                                       pdulen))) {
+            /*
+             * Something went wrong while processing this packet -- set the
+             * errno.  
+             */
+            if (sp->s_snmp_errno != 0) {
+                SET_SNMP_ERROR(sp->s_snmp_errno);
+            }
+        }
+
+        /*  ocopy has been free()d by _sess_process_packet by this point,
+            so set it to NULL.  */
+
+        ocopy = NULL;
+
+        /*  Step past the packet we've just dealt with.  */
+
+        pptr += pdulen;
+        isp->packet_start += pdulen;
+        isp->packet_len -= pdulen;
+    }
+
+    /*  If we had more than one packet, then we were working with copies
+        of the opaque pointer, so we still need to free() the opaque
+        pointer itself.  */
+
+    SNMP_FREE(opaque);
+
+#ifdef HAVE_SYS_UIO_H
+    isp->corked = 0;
+    _sess_flush_queue(slp);
+    if (isp->rq_stalled)
+        return rc;
+#endif
+
+    if (isp->packet_len >= SNMP_MAX_PACKET_LEN) {
+        /*
+         * Obviously this should never happen!  
+         */
+        snmp_log(LOG_ERR,
+                 "too large packet_len = %" NETSNMP_PRIz
+                 "u, dropping connection %d\n",
+                 isp->packet_len, transport->sock);
+#ifdef HAVE_SYS_UIO_H
+        _sess_drop_queue(isp);
+#endif
+        transport->f_close(transport);
+        /** XXX-rks: why no SNMP_FREE(isp->packet); ?? */
+        return -1;
+    } else if (isp->packet_len == 0) {
+        /*
+         * This is good: it means the packet buffer contained an integral
+         * number of PDUs, so we don't have to save any data for next
+         * time.  Unless the read filled the buffer, which means that
+         * the peer is sending more right away, we can free() the buffer
+         * now to keep the memory footprint down.
+         */
+        isp->packet_start = 0;
+        if (!filled || isp->packet_size > SNMP_MAX_RCV_MSG_SIZE) {
+            SNMP_FREE(isp->packet);
+            isp->packet_size = 0;
+        }
+        return rc;
+    }
+
+    /*
+     * If we get here, then there is a partial packet of length
+     * isp->packet_len bytes starting at pptr left over.  It is moved
+     * to the start of the buffer only when the buffer runs out of
+     * room, see above.
+     */
+    DEBUGMSGTL(("sess_read", "end: %" NETSNMP_PRIz "u bytes left at "
+                "offset %" NETSNMP_PRIz "u of %" NETSNMP_PRIz "u\n",
+                isp->packet_len, isp->packet_start, isp->packet_size));
+    return rc;
+}
+
+#ifdef HAVE_SYS_UIO_H
+/*
+ * Called when the socket of a stream session with queued output becomes
+ * writable: sends what it takes, and parses the input left over once the
+ * queue is short enough again.
+ */
+static void
+_sess_writable(int fd, void *data)
+{
+    struct session_list *slp = (struct session_list *) data;
+    struct snmp_internal_session *isp = slp->internal;
+    void           *opaque;
+    int             olength;
+
+    DEBUGMSGTL(("sess_async_send", "fd %d writable\n", fd));
+    if (_sess_flush_queue(slp) < 0 || !isp->rq_stalled ||
+        isp->wq_bytes >= NETSNMP_STREAM_WQ_HIGH)
+        return;
+
+    opaque = isp->rq_opaque;
+    olength = isp->rq_olength;
+    isp->rq_opaque = NULL;
+    isp->rq_olength = 0;
+    isp->rq_stalled = 0;
+    _sess_read_stream(slp, opaque, olength, 0);
+}
+#endif /* HAVE_SYS_UIO_H */
+
 /*
  * Same as snmp_read, but works just one session. 
  * returns 0 if success, -1 if fail 
@@ -6181,7 +6989,7 @@ _sess_read(struct session_list *slp, netsnmp_large_fd_set * fdset)
     netsnmp_session *sp = slp ? slp->session : NULL;
     struct snmp_internal_session *isp = slp ? slp->internal : NULL;
     netsnmp_transport *transport = slp ? slp->transport : NULL;
-    size_t          pdulen = 0, rxbuf_len = SNMP_MAX_RCV_MSG_SIZE;
+    size_t          rxbuf_len = SNMP_MAX_RCV_MSG_SIZE;
     u_char         *rxbuf = NULL;
     int             length = 0, olength = 0, rc = 0;
     void           *opaque = NULL;
@@ -6233,6 +7041,14 @@ _sess_read(struct session_list *slp, netsnmp_large_fd_set * fdset)
 
     /** stream transport */
 
+#ifdef HAVE_SYS_UIO_H
+    if (isp->rq_stalled) {
+        DEBUGMSGTL(("sess_read", "not reading %d while its output is "
+                    "queued\n", transport->sock));
+        return 0;
+    }
+#endif
+
         if (isp->packet == NULL) {
             /*
              * We have no saved packet.  Allocate one.  
@@ -6242,37 +7058,48 @@ _sess_read(struct session_list *slp, netsnmp_large_fd_set * fdset)
                             "u bytes for rxbuf\n", rxbuf_len));
                 return 0;
             } else {
-                rxbuf = isp->packet;
                 isp->packet_size = rxbuf_len;
+                isp->packet_start = 0;
                 isp->packet_len = 0;
             }
-        } else {
+        } else if (isp->packet_len == 0) {
+            isp->packet_start = 0;
+        } else if (isp->packet_size - isp->packet_start - isp->packet_len <
+                   NETSNMP_STREAM_MIN_READ) {
             /*
-             * We have saved a partial packet from last time.  Extend that, if
-             * necessary, and receive new data after the old data.  
+             * We have saved a partial packet from last time, and there is
+             * little room left after it.  Move it to the start of the
+             * buffer, and extend that if the packet still doesn't leave
+             * enough room (doubling it, so that large packets are not
+             * copied over and over again).
              */
-            u_char         *newbuf;
+            if (isp->packet_start > 0) {
+                memmove(isp->packet, isp->packet + isp->packet_start,
+                        isp->packet_len);
+                DEBUGMSGTL(("sess_read", "memmove(%p, %p, %" NETSNMP_PRIz
+                            "u)\n", isp->packet,
+                            isp->packet + isp->packet_start,
+                            isp->packet_len));
+                isp->packet_start = 0;
+            }
+            if (isp->packet_size - isp->packet_len < NETSNMP_STREAM_MIN_READ) {
+                u_char         *newbuf;
 
-            if (isp->packet_size < isp->packet_len + rxbuf_len) {
-                newbuf =
-                    (u_char *) realloc(isp->packet,
-                                       isp->packet_len + rxbuf_len);
+                newbuf = (u_char *) realloc(isp->packet,
+                                            2 * isp->packet_size);
                 if (newbuf == NULL) {
                     DEBUGMSGTL(("sess_read",
                                 "can't malloc %" NETSNMP_PRIz
-                                "u more for rxbuf (%" NETSNMP_PRIz "u tot)\n",
-                                rxbuf_len, isp->packet_len + rxbuf_len));
+                                "u bytes for rxbuf\n",
+                                2 * isp->packet_size));
                     return 0;
-                } else {
-                    isp->packet = newbuf;
-                    isp->packet_size = isp->packet_len + rxbuf_len;
-                    rxbuf = isp->packet + isp->packet_len;
                 }
-            } else {
-                rxbuf = isp->packet + isp->packet_len;
-                rxbuf_len = isp->packet_size - isp->packet_len;
+                isp->packet = newbuf;
+                isp->packet_size *= 2;
             }
         }
+        rxbuf = isp->packet + isp->packet_start + isp->packet_len;
+        rxbuf_len = isp->packet_size - isp->packet_start - isp->packet_len;
 
     length = netsnmp_transport_recv(transport, rxbuf, rxbuf_len, &opaque,
                                     &olength);
@@ -6304,171 +7131,18 @@ _sess_read(struct session_list *slp, netsnmp_large_fd_set * fdset)
          * Close socket and mark session for deletion.  
          */
         DEBUGMSGTL(("sess_read", "fd %d closed\n", transport->sock));
+#ifdef HAVE_SYS_UIO_H
+        _sess_drop_queue(isp);
+#endif
         transport->f_close(transport);
         SNMP_FREE(isp->packet);
         SNMP_FREE(opaque);
         return -1;
     }
 
-    {
-        u_char *pptr = isp->packet;
-	void *ocopy = NULL;
-
-        isp->packet_len += length;
-
-        while (isp->packet_len > 0) {
-
-            /*
-             * Get the total data length we're expecting (and need to wait
-             * for).
-             */
-            if (isp->check_packet) {
-                pdulen = isp->check_packet(pptr, isp->packet_len);
-            } else {
-                pdulen = asn_check_packet(pptr, isp->packet_len);
-            }
-
-            DEBUGMSGTL(("sess_read",
-                        "  loop packet_len %" NETSNMP_PRIz "u, PDU length %"
-                        NETSNMP_PRIz "u\n", isp->packet_len, pdulen));
-
-            if (pdulen > SNMP_MAX_PACKET_LEN) {
-                /*
-                 * Illegal length, drop the connection.  
-                 */
-                snmp_log(LOG_ERR, 
-			 "Received broken packet. Closing session.\n");
-		if (sp->callback != NULL) {
-		  DEBUGMSGTL(("sess_read",
-			      "perform callback with op=DISCONNECT\n"));
-		  (void)sp->callback(NETSNMP_CALLBACK_OP_DISCONNECT,
-				     sp, 0, NULL, sp->callback_magic);
-		}
-		DEBUGMSGTL(("sess_read", "fd %d closed\n", transport->sock));
-                transport->f_close(transport);
-                SNMP_FREE(opaque);
-                /** XXX-rks: why no SNMP_FREE(isp->packet); ?? */
-                return -1;
-            }
-
-            if (pdulen > isp->packet_len || pdulen == 0) {
-                /*
-                 * We don't have a complete packet yet.  If we've already
-                 * processed a packet, break out so we'll shift this packet
-                 * to the start of the buffer. If we're already at the
-                 * start, simply return and wait for more data to arrive.
-                 */
-                DEBUGMSGTL(("sess_read",
-                            "pkt not complete (need %" NETSNMP_PRIz "u got %"
-                            NETSNMP_PRIz "u so far)\n", pdulen,
-                            isp->packet_len));
-
-                if (pptr != isp->packet)
-                    break; /* opaque freed for us outside of loop. */
-
-                SNMP_FREE(opaque);
-                return 0;
-            }
-
-            /*  We have *at least* one complete packet in the buffer now.  If
-		we have possibly more than one packet, we must copy the opaque
-		pointer because we may need to reuse it for a later packet.  */
-
-	    if (pdulen < isp->packet_len) {
-		if (olength > 0 && opaque != NULL) {
-		    ocopy = malloc(olength);
-		    if (ocopy != NULL) {
-			memcpy(ocopy, opaque, olength);
-		    }
-		}
-	    } else if (pdulen == isp->packet_len) {
-		/*  Common case -- exactly one packet.  No need to copy the
-		    opaque pointer.  */
-		ocopy = opaque;
-		opaque = NULL;
-	    }
-
-            if ((rc = _sess_process_packet(slp, sp, isp, transport,
-                                           ocopy, ocopy?olength:0, pptr,
-                                           pdulen))) {
-                /*
-                 * Something went wrong while processing this packet -- set the
-                 * errno.  
-                 */
-                if (sp->s_snmp_errno != 0) {
-                    SET_SNMP_ERROR(sp->s_snmp_errno);
-                }
-            }
-
-	    /*  ocopy has been free()d by _sess_process_packet by this point,
-		so set it to NULL.  */
-
-	    ocopy = NULL;
-
-	    /*  Step past the packet we've just dealt with.  */
-
-            pptr += pdulen;
-            isp->packet_len -= pdulen;
-        }
-
-	/*  If we had more than one packet, then we were working with copies
-	    of the opaque pointer, so we still need to free() the opaque
-	    pointer itself.  */
-
-	SNMP_FREE(opaque);
-
-        if (isp->packet_len >= SNMP_MAX_PACKET_LEN) {
-            /*
-             * Obviously this should never happen!  
-             */
-            snmp_log(LOG_ERR,
-                     "too large packet_len = %" NETSNMP_PRIz
-                     "u, dropping connection %d\n",
-                     isp->packet_len, transport->sock);
-            transport->f_close(transport);
-            /** XXX-rks: why no SNMP_FREE(isp->packet); ?? */
-            return -1;
-        } else if (isp->packet_len == 0) {
-            /*
-             * This is good: it means the packet buffer contained an integral
-             * number of PDUs, so we don't have to save any data for next
-             * time.  We can free() the buffer now to keep the memory
-             * footprint down.
-             */
-            SNMP_FREE(isp->packet);
-            isp->packet_size = 0;
-            isp->packet_len = 0;
-            return rc;
-        }
-
-        /*
-         * If we get here, then there is a partial packet of length
-         * isp->packet_len bytes starting at pptr left over.  Move that to the
-         * start of the buffer, and then realloc() the buffer down to size to
-         * reduce the memory footprint.  
-         */
-
-        memmove(isp->packet, pptr, isp->packet_len);
-        DEBUGMSGTL(("sess_read",
-                    "end: memmove(%p, %p, %" NETSNMP_PRIz "u); realloc(%p, %"
-                    NETSNMP_PRIz "u)\n",
-                    isp->packet, pptr, isp->packet_len,
-		    isp->packet, isp->packet_len));
-
-        if ((rxbuf = (u_char *)realloc(isp->packet, isp->packet_len)) == NULL) {
-            /*
-             * I don't see why this should ever fail, but it's not a big deal.
-             */
-            DEBUGMSGTL(("sess_read", "realloc() failed\n"));
-        } else {
-            DEBUGMSGTL(("sess_read", "realloc() okay, old buffer %p, new %p\n",
-                        isp->packet, rxbuf));
-            isp->packet = rxbuf;
-            isp->packet_size = isp->packet_len;
-        }
-    }
-
-    return rc;
+    isp->packet_len += length;
+    return _sess_read_stream(slp, opaque, olength,
+                             (size_t) length == rxbuf_len);
 }
 
 
@@ -6670,20 +7344,24 @@ snmp_sess_select_info2_flags(struct session_list *sessp, int *numfds,
             *numfds = (slp->transport->sock + 1);
         }
 
+#ifdef HAVE_SYS_UIO_H
+        if (slp->internal != NULL && slp->internal->rq_stalled)
+            DEBUGMSG(("sess_select", "(stalled) "));
+        else
+#endif
         NETSNMP_LARGE_FD_SET(slp->transport->sock, fdset);
         if (slp->internal != NULL && slp->internal->requests) {
             /*
              * Found another session with outstanding requests.  
              */
             requests++;
-            for (rp = slp->internal->requests; rp; rp = rp->next_request) {
-                if (!timerisset(&earliest)
-                    || (timerisset(&rp->expireM)
-                        && timercmp(&rp->expireM, &earliest, <))) {
-                    earliest = rp->expireM;
-                    DEBUGMSG(("verbose:sess_select","(to in %d.%06d sec) ",
-                               (int)earliest.tv_sec, (int)earliest.tv_usec));
-                }
+            rp = slp->internal->timeouts[0];
+            if (!timerisset(&earliest)
+                || (timerisset(&rp->expireM)
+                    && timercmp(&rp->expireM, &earliest, <))) {
+                earliest = rp->expireM;
+                DEBUGMSG(("verbose:sess_select","(to in %d.%06d sec) ",
+                           (int)earliest.tv_sec, (int)earliest.tv_usec));
             }
         }
 
@@ -6766,8 +7444,8 @@ snmp_timeout(void)
 }
 
 static int
-snmp_resend_request(struct session_list *slp, netsnmp_request_list *orp,
-                    netsnmp_request_list *rp, int incr_retries)
+snmp_resend_request(struct session_list *slp, netsnmp_request_list *rp,
+                    int incr_retries)
 {
     struct snmp_internal_session *isp;
     netsnmp_session *sp;
@@ -6785,7 +7463,11 @@ snmp_resend_request(struct session_list *slp, netsnmp_request_list *orp,
         return 0;
     }
 
-    if ((pktbuf = (u_char *)malloc(2048)) == NULL) {
+    if (isp->sbuf) {
+        pktbuf = isp->sbuf;
+        pktbuf_len = isp->sbuf_size;
+        isp->sbuf = NULL;
+    } else if ((pktbuf = (u_char *)malloc(2048)) == NULL) {
         DEBUGMSGTL(("sess_resend",
                     "couldn't malloc initial packet buffer\n"));
         return 0;
@@ -6800,7 +7482,8 @@ snmp_resend_request(struct session_list *slp, netsnmp_request_list *orp,
     /*
      * Always increment msgId for resent messages.  
      */
-    rp->pdu->msgid = rp->message_id = snmp_get_next_msgid();
+    rp->pdu->msgid = snmp_get_next_msgid();
+    request_set_msgid(isp, rp, rp->pdu->msgid);
 
     result = netsnmp_build_packet(isp, sp, rp->pdu, &pktbuf, &pktbuf_len,
                                   &packet, &length);
@@ -6821,14 +7504,16 @@ snmp_resend_request(struct session_list *slp, netsnmp_request_list *orp,
                                     &(rp->pdu->transport_data_length));
 
     /*
-     * We are finished with the local packet buffer, if we allocated one (due
-     * to there being no saved packet).  
+     * We are finished with the local packet buffer; keep it for the next
+     * send, as for snmp_sess_async_send().
      */
 
-    if (pktbuf != NULL) {
+    if (isp->sbuf == NULL && pktbuf_len <= SNMP_MAX_RCV_MSG_SIZE) {
+        isp->sbuf = pktbuf;
+        isp->sbuf_size = pktbuf_len;
+    } else
         SNMP_FREE(pktbuf);
-        packet = NULL;
-    }
+    packet = NULL;
 
     if (result < 0) {
         sp->s_snmp_errno = SNMPERR_BAD_SENDTO;
@@ -6837,7 +7522,8 @@ snmp_resend_request(struct session_list *slp, netsnmp_request_list *orp,
         if (rp->callback) {
             rp->callback(NETSNMP_CALLBACK_OP_SEND_FAILED, sp,
                          rp->pdu->reqid, rp->pdu, rp->cb_data);
-            remove_request(isp, orp, rp);
+            remove_request(isp, rp);
+            free(rp);
 	}
         return -1;
     } else {
@@ -6848,6 +7534,7 @@ snmp_resend_request(struct session_list *slp, netsnmp_request_list *orp,
         tv.tv_sec += tv.tv_usec / 1000000L;
         tv.tv_usec %= 1000000L;
         rp->expireM = tv;
+        request_expiry_changed(isp, rp);
         if (rp->callback)
             rp->callback(NETSNMP_CALLBACK_OP_RESEND, sp,
                          rp->pdu->reqid, rp->pdu, rp->cb_data);
@@ -6862,7 +7549,7 @@ snmp_sess_timeout(struct session_list *slp)
 {
     netsnmp_session *sp;
     struct snmp_internal_session *isp;
-    netsnmp_request_list *rp, *orp = NULL, *freeme = NULL;
+    netsnmp_request_list *rp;
     struct timeval  now;
     snmp_callback   callback;
     void           *magic;
@@ -6878,60 +7565,49 @@ snmp_sess_timeout(struct session_list *slp)
     netsnmp_get_monotonic_clock(&now);
 
     /*
-     * For each request outstanding, check to see if it has expired.
+     * Handle the expired requests, earliest first.
      */
-    for (rp = isp->requests; rp; rp = rp->next_request) {
-        if (freeme != NULL) {
+    while (isp->timeouts_len > 0 &&
+           timercmp(&(rp = isp->timeouts[0])->expireM, &now, <)) {
+        if ((sptr = find_sec_mod(rp->pdu->securityModel)) != NULL &&
+            sptr->pdu_timeout != NULL) {
             /*
-             * frees rp's after the for loop goes on to the next_request 
+             * call security model if it needs to know about this 
              */
-            free(freeme);
-            freeme = NULL;
+            (*sptr->pdu_timeout) (rp->pdu);
         }
 
-        if ((timercmp(&rp->expireM, &now, <))) {
-            if ((sptr = find_sec_mod(rp->pdu->securityModel)) != NULL &&
-                sptr->pdu_timeout != NULL) {
-                /*
-                 * call security model if it needs to know about this 
-                 */
-                (*sptr->pdu_timeout) (rp->pdu);
+        /*
+         * this timer has expired 
+         */
+        if (rp->retries >= sp->retries) {
+            if (rp->callback) {
+                callback = rp->callback;
+                magic = rp->cb_data;
+            } else {
+                callback = sp->callback;
+                magic = sp->callback_magic;
             }
 
             /*
-             * this timer has expired 
+             * No more chances, delete this entry 
              */
-            if (rp->retries >= sp->retries) {
-                if (rp->callback) {
-                    callback = rp->callback;
-                    magic = rp->cb_data;
-                } else {
-                    callback = sp->callback;
-                    magic = sp->callback_magic;
-                }
-
-                /*
-                 * No more chances, delete this entry 
-                 */
-                if (callback) {
-                    callback(NETSNMP_CALLBACK_OP_TIMED_OUT, sp,
-                             rp->pdu->reqid, rp->pdu, magic);
-                }
-                remove_request(isp, orp, rp);
-                freeme = rp;
-                continue;       /* don't update orp below */
-            } else {
-                if (snmp_resend_request(slp, orp, rp, TRUE)) {
-                    break;
-                }
+            if (callback) {
+                callback(NETSNMP_CALLBACK_OP_TIMED_OUT, sp,
+                         rp->pdu->reqid, rp->pdu, magic);
+            }
+            remove_request(isp, rp);
+            free(rp);
+        } else {
+            if (snmp_resend_request(slp, rp, TRUE)) {
+                break;
+            }
+            if (isp->timeouts_len > 0 && isp->timeouts[0] == rp &&
+                timercmp(&rp->expireM, &now, <)) {
+                /* could not be resent; try again next time */
+                break;
             }
         }
-        orp = rp;
-    }
-
-    if (freeme != NULL) {
-        free(freeme);
-        freeme = NULL;
     }
 }
 
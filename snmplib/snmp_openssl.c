@@ -682,6 +682,41 @@ netsnmp_openssl_cert_get_fingerprint(X509 *ocert, int alg)
     return result;
 }
 
+/*
+ * A session resumed from a ticket only remembers the peer certificate,
+ * not the chain it was sent with.  Rebuild the chain from our own
+ * certificate store.
+ */
+static STACK_OF(X509) *
+_cert_chain_from_store(SSL *ssl, X509 *ocert)
+{
+    X509_STORE_CTX        *store_ctx;
+    STACK_OF(X509)        *ochain = NULL;
+    X509                  *leaf;
+
+    store_ctx = X509_STORE_CTX_new();
+    if (NULL == store_ctx)
+        return NULL;
+    if (X509_STORE_CTX_init(store_ctx,
+                            SSL_CTX_get_cert_store(SSL_get_SSL_CTX(ssl)),
+                            ocert, NULL) == 1) {
+        /* the chain is wanted even if some of it can't be verified */
+        (void) X509_verify_cert(store_ctx);
+        ochain = X509_STORE_CTX_get1_chain(store_ctx);
+    }
+    X509_STORE_CTX_free(store_ctx);
+
+    /* the peer certificate itself is handled by the caller */
+    if (ochain && sk_X509_num(ochain) > 0 &&
+        X509_cmp(sk_X509_value(ochain, 0), ocert) == 0) {
+        leaf = sk_X509_shift(ochain);
+        X509_free(leaf);
+    }
+    DEBUGMSGT(("ssl:cert:chain", "rebuilt a chain of %d certs\n",
+               ochain ? sk_X509_num(ochain) : 0));
+    return ochain;
+}
+
 /**
  * get container of netsnmp_cert_map structures from an ssl connection
  * certificate chain.
@@ -690,7 +725,7 @@ netsnmp_container *
 netsnmp_openssl_get_cert_chain(SSL *ssl)
 {
     X509                  *ocert, *ocert_tmp;
-    STACK_OF(X509)        *ochain;
+    STACK_OF(X509)        *ochain, *rebuilt = NULL;
     char                  *fingerprint;
     netsnmp_container     *chain_map;
     netsnmp_cert_map      *cert_map;
@@ -737,6 +772,8 @@ netsnmp_openssl_get_cert_chain(SSL *ssl)
 
     /** check for a chain to a CA */
     ochain = SSL_get_peer_cert_chain(ssl);
+    if ((!ochain || sk_X509_num(ochain) == 0) && SSL_session_reused(ssl))
+        ochain = rebuilt = _cert_chain_from_store(ssl, ocert);
     sk_num_res = sk_X509_num(ochain);
     if (!ochain || sk_num_res == 0) {
         DEBUGMSGT(("ssl:cert:chain", "peer has no cert chain\n"));
@@ -768,6 +805,8 @@ netsnmp_openssl_get_cert_chain(SSL *ssl)
         if (i < sk_num_res)
             CONTAINER_FREE_ALL(chain_map, NULL);
     } /* got peer chain */
+    if (rebuilt)
+        sk_X509_pop_free(rebuilt, X509_free);
 
     DEBUGMSGT(("ssl:cert:chain", "found %" NETSNMP_PRIz "u certs in chain\n",
                CONTAINER_SIZE(chain_map)));
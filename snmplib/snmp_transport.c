@@ -27,6 +27,19 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+#ifdef HAVE_NETINET_IN_H
+#include <netinet/in.h>
+#endif
+#ifdef HAVE_ARPA_INET_H
+#include <arpa/inet.h>
+#endif
+
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
 
 #include <net-snmp/output_api.h>
 #include <net-snmp/utilities.h>
@@ -77,6 +90,8 @@
 #include <net-snmp/library/snmp_service.h>
 #include <net-snmp/library/read_config.h>
 
+#include "inet_pton.h"
+
 netsnmp_feature_child_of(transport_all, libnetsnmp);
 
 netsnmp_feature_child_of(tdomain_support, transport_all);
@@ -210,6 +225,7 @@ netsnmp_transport_copy(const netsnmp_transport *t)
     n->f_accept = t->f_accept;
     n->f_recv = t->f_recv;
     n->f_send = t->f_send;
+    n->f_sendv = t->f_sendv;
     n->f_close = t->f_close;
     n->f_copy = t->f_copy;
     n->f_config = t->f_config;
@@ -270,7 +286,295 @@ netsnmp_transport_peer_string(netsnmp_transport *t, const void *data, int len)
     return str;
 }
 
+/*
+ * Address prefix tries
+ *
+ * A path compressed binary trie over address prefixes of up to
+ * NETSNMP_PREFIX_TRIE_MAX_BITS bits, most significant bit first.  Each
+ * node holds the prefix it stands for; the data pointer is set for
+ * prefixes that were inserted and NULL for the branch nodes created when
+ * two prefixes diverge, so there are fewer than two nodes per prefix.
+ */
+
+typedef struct netsnmp_prefix_node_s {
+    struct netsnmp_prefix_node_s *child[2];
+    void           *data;
+    u_char          prefix[NETSNMP_PREFIX_TRIE_MAX_BITS / 8];
+    u_short         bits;
+} netsnmp_prefix_node;
+
+struct netsnmp_prefix_trie_s {
+    netsnmp_prefix_node *root;
+    size_t          count;
+};
+
+#define PREFIX_BIT(key, i) (((key)[(i) >> 3] >> (7 - ((i) & 7))) & 1)
+
+/* number of leading bits, up to max, that a and b have in common */
+static int
+_prefix_common(const u_char *a, const u_char *b, int max)
+{
+    int             i = 0;
+    u_char          diff;
+
+    for (; i + 8 <= max && a[i >> 3] == b[i >> 3]; i += 8)
+        ;
+    if (i >= max)
+        return max;
+    for (diff = a[i >> 3] ^ b[i >> 3]; i < max && !(diff & 0x80);
+         diff <<= 1, i++)
+        ;
+    return i;
+}
+
+static netsnmp_prefix_node *
+_prefix_node_new(const u_char *key, int bits, void *data)
+{
+    netsnmp_prefix_node *node = SNMP_MALLOC_TYPEDEF(netsnmp_prefix_node);
+
+    if (!node)
+        return NULL;
+    memcpy(node->prefix, key, (bits + 7) / 8);
+    if (bits % 8)
+        node->prefix[bits / 8] &= 0xff << (8 - bits % 8);
+    node->bits = bits;
+    node->data = data;
+    return node;
+}
+
+netsnmp_prefix_trie *
+netsnmp_prefix_trie_create(void)
+{
+    return SNMP_MALLOC_TYPEDEF(netsnmp_prefix_trie);
+}
+
+/*
+ * Inserts data under the first bits bits of key.
+ *
+ * Returns 0 on success, 1 if there already is data for that prefix (which
+ * is left in place) or -1 on failure.
+ */
+int
+netsnmp_prefix_trie_insert(netsnmp_prefix_trie *trie, const u_char *key,
+                           int bits, void *data)
+{
+    netsnmp_prefix_node **np, *node, *branch;
+    int             common;
+
+    if (!trie || !key || !data || bits < 0 ||
+        bits > NETSNMP_PREFIX_TRIE_MAX_BITS)
+        return -1;
+
+    for (np = &trie->root; (node = *np);
+         np = &node->child[PREFIX_BIT(key, node->bits)]) {
+        common = _prefix_common(node->prefix, key,
+                                node->bits < bits ? node->bits : bits);
+        if (common < node->bits) {
+            /* the prefixes diverge (or key ends) above this node */
+            branch = _prefix_node_new(key, common, NULL);
+            if (!branch)
+                return -1;
+            branch->child[PREFIX_BIT(node->prefix, common)] = node;
+            if (common == bits) {
+                branch->data = data;
+            } else {
+                branch->child[PREFIX_BIT(key, common)] =
+                    _prefix_node_new(key, bits, data);
+                if (!branch->child[PREFIX_BIT(key, common)]) {
+                    free(branch);
+                    return -1;
+                }
+            }
+            *np = branch;
+            trie->count++;
+            return 0;
+        }
+        if (node->bits == bits) {
+            if (node->data)
+                return 1;
+            node->data = data;
+            trie->count++;
+            return 0;
+        }
+    }
+    *np = _prefix_node_new(key, bits, data);
+    if (!*np)
+        return -1;
+    trie->count++;
+    return 0;
+}
+
+/*
+ * Stores the data of all prefixes of the first bits bits of addr in
+ * matches, shortest prefix first, and returns how many there were (at
+ * most max).
+ */
+int
+netsnmp_prefix_trie_matches(const netsnmp_prefix_trie *trie,
+                            const u_char *addr, int bits,
+                            void **matches, int max)
+{
+    const netsnmp_prefix_node *node;
+    int             n = 0;
+
+    if (!trie)
+        return 0;
+    for (node = trie->root; node && n < max && node->bits <= bits;
+         node = node->child[PREFIX_BIT(addr, node->bits)]) {
+        if (_prefix_common(node->prefix, addr, node->bits) < node->bits)
+            break;
+        if (node->data)
+            matches[n++] = node->data;
+        if (node->bits == bits)
+            break;
+    }
+    return n;
+}
+
+/*
+ * Returns the data of the longest prefix of addr in the trie, or NULL.
+ */
+void *
+netsnmp_prefix_trie_lookup(const netsnmp_prefix_trie *trie,
+                           const u_char *addr, int bits)
+{
+    const netsnmp_prefix_node *node;
+    void           *data = NULL;
+
+    if (!trie)
+        return NULL;
+    for (node = trie->root; node && node->bits <= bits;
+         node = node->child[PREFIX_BIT(addr, node->bits)]) {
+        if (_prefix_common(node->prefix, addr, node->bits) < node->bits)
+            break;
+        if (node->data)
+            data = node->data;
+        if (node->bits == bits)
+            break;
+    }
+    return data;
+}
+
+size_t
+netsnmp_prefix_trie_count(const netsnmp_prefix_trie *trie)
+{
+    return trie ? trie->count : 0;
+}
+
+static void
+_prefix_node_free(netsnmp_prefix_node *node, void (*free_data)(void *))
+{
+    if (!node)
+        return;
+    _prefix_node_free(node->child[0], free_data);
+    _prefix_node_free(node->child[1], free_data);
+    if (node->data && free_data)
+        free_data(node->data);
+    free(node);
+}
+
+/*
+ * Frees the trie, calling free_data (if not NULL) for each data pointer.
+ */
+void
+netsnmp_prefix_trie_free(netsnmp_prefix_trie *trie,
+                         void (*free_data)(void *))
+{
+    if (!trie)
+        return;
+    _prefix_node_free(trie->root, free_data);
+    free(trie);
+}
+
 #if !defined(NETSNMP_FEATURE_REMOVE_FILTER_SOURCE)
+/*
+ * Source filter entries that are IPv4 or IPv6 addresses or networks
+ * (ADDRESS[/PREFIXLEN]) are kept in prefix tries, so that packets can
+ * be checked on their source address without formatting it.  Anything
+ * else is kept as a string, to be compared with the formatted address.
+ */
+
+typedef struct netsnmp_transport_filter_rule_s {
+    struct netsnmp_transport_filter_rule_s *next;
+    char           *text;
+    u_long          hits;
+} netsnmp_transport_filter_rule;
+
+static netsnmp_transport_filter_rule *filter_rules = NULL;
+static netsnmp_prefix_trie *filter_trie4 = NULL;
+#ifdef NETSNMP_ENABLE_IPV6
+static netsnmp_prefix_trie *filter_trie6 = NULL;
+#endif
+
+/*
+ * Parses ADDRESS[/PREFIXLEN] into the trie it goes in.
+ *
+ * Returns 0 on success, 1 if addrtxt isn't an address and -1 if the
+ * prefix length is not valid or doesn't match the address.
+ */
+static int
+_transport_filter_parse(const char *addrtxt, netsnmp_prefix_trie ***triep,
+                        u_char *addr, int *bits)
+{
+    char            buf[64], *slash, *end;
+    int             maxbits, i;
+    long            len;
+
+    if (strlen(addrtxt) >= sizeof(buf))
+        return 1;
+    strcpy(buf, addrtxt);
+    slash = strchr(buf, '/');
+    if (slash)
+        *slash++ = '\0';
+    if (inet_pton(AF_INET, buf, addr) == 1) {
+        *triep = &filter_trie4;
+        maxbits = 32;
+#ifdef NETSNMP_ENABLE_IPV6
+    } else if (inet_pton(AF_INET6, buf, addr) == 1) {
+        *triep = &filter_trie6;
+        maxbits = 128;
+#endif
+    } else
+        return 1;
+
+    *bits = maxbits;
+    if (slash) {
+        len = strtol(slash, &end, 10);
+        if (end == slash || *end || len < 0 || len > maxbits)
+            return -1;
+        *bits = len;
+    }
+    for (i = *bits; i < maxbits; i++)
+        if (addr[i / 8] & (0x80 >> (i % 8)))
+            return -1;
+    return 0;
+}
+
+static int
+_transport_filter_insert(netsnmp_transport_filter_rule *rule)
+{
+    netsnmp_prefix_trie **triep;
+    u_char          addr[16];
+    int             bits;
+
+    if (_transport_filter_parse(rule->text, &triep, addr, &bits) != 0)
+        return -1;
+    if (!*triep && !(*triep = netsnmp_prefix_trie_create()))
+        return -1;
+    return netsnmp_prefix_trie_insert(*triep, addr, bits, rule);
+}
+
+static void
+_transport_filter_tries_free(void)
+{
+    netsnmp_prefix_trie_free(filter_trie4, NULL);
+    filter_trie4 = NULL;
+#ifdef NETSNMP_ENABLE_IPV6
+    netsnmp_prefix_trie_free(filter_trie6, NULL);
+    filter_trie6 = NULL;
+#endif
+}
+
 static int _transport_filter_init(void)
 {
     if (filtered)
@@ -290,8 +594,41 @@ static int _transport_filter_init(void)
 int
 netsnmp_transport_filter_add(const char *addrtxt)
 {
+    netsnmp_transport_filter_rule *rule;
+    netsnmp_prefix_trie **triep;
+    u_char          addr[16];
+    int             bits, rc;
     char *tmp;
 
+    rc = _transport_filter_parse(addrtxt, &triep, addr, &bits);
+    if (rc < 0) {
+        snmp_log(LOG_ERR,"netsnmp_transport_filter_add %s: bad prefix\n",
+                 addrtxt);
+        return -1;
+    }
+    if (rc == 0) {
+        rule = SNMP_MALLOC_TYPEDEF(netsnmp_transport_filter_rule);
+        if (rule)
+            rule->text = strdup(addrtxt);
+        if (!rule || !rule->text) {
+            snmp_log(LOG_ERR,"netsnmp_transport_filter_add strdup failed\n");
+            if (rule)
+                free(rule);
+            return -1;
+        }
+        rc = _transport_filter_insert(rule);
+        if (rc != 0) {
+            /* already there, or out of memory */
+            free(rule->text);
+            free(rule);
+            return rc < 0 ? -1 : 0;
+        }
+        rule->next = filter_rules;
+        filter_rules = rule;
+        DEBUGMSGTL(("transport:filter", "added prefix %s\n", addrtxt));
+        return 0;
+    }
+
     /*
      * create the container, if needed
      */
@@ -311,9 +648,21 @@ netsnmp_transport_filter_add(const char *addrtxt)
 int
 netsnmp_transport_filter_remove(const char *addrtxt)
 {
-    /*
-     * create the container, if needed
-     */
+    netsnmp_transport_filter_rule **prev, *rule;
+
+    for (prev = &filter_rules; (rule = *prev); prev = &rule->next) {
+        if (strcmp(rule->text, addrtxt) == 0) {
+            /* the tries can't remove entries; rebuild them */
+            *prev = rule->next;
+            free(rule->text);
+            free(rule);
+            _transport_filter_tries_free();
+            for (rule = filter_rules; rule; rule = rule->next)
+                _transport_filter_insert(rule);
+            return 0;
+        }
+    }
+
     if (NULL == filtered)
         return -1;
     return CONTAINER_REMOVE(filtered, addrtxt);
@@ -323,15 +672,83 @@ netsnmp_transport_filter_remove(const char *addrtxt)
  * netsnmp_transport_filter_check
  *
  * returns 1 if the specified address string is in the filter list
+ * or is an address within one of the networks in it
  */
 int
 netsnmp_transport_filter_check(const char *addrtxt)
 {
-    char *addr;
-    if (NULL == filtered)
+    netsnmp_transport_filter_rule *rule;
+    netsnmp_prefix_trie **triep;
+    u_char          addr[16];
+    int             bits;
+    char *found;
+
+    if (filtered) {
+        found = CONTAINER_FIND(filtered, addrtxt);
+        if (found)
+            return 1;
+    }
+    if (!filter_rules ||
+        _transport_filter_parse(addrtxt, &triep, addr, &bits) != 0)
         return 0;
-    addr = CONTAINER_FIND(filtered, addrtxt);
-    return addr ? 1 : 0;
+    rule = netsnmp_prefix_trie_lookup(*triep, addr, bits);
+    if (!rule)
+        return 0;
+    rule->hits++;
+    return 1;
+}
+
+/*
+ * netsnmp_transport_filter_check_addr
+ *
+ * returns 1 if the IPv4 or IPv6 address sa is within one of the
+ * networks in the filter list, 0 if it isn't and -1 if it can only be
+ * checked with netsnmp_transport_filter_check() on its string form.
+ */
+int
+netsnmp_transport_filter_check_addr(const struct sockaddr *sa)
+{
+    netsnmp_transport_filter_rule *rule;
+
+    if (!sa || (filtered && CONTAINER_SIZE(filtered)))
+        return -1;
+    switch (sa->sa_family) {
+    case AF_INET:
+        rule = netsnmp_prefix_trie_lookup(filter_trie4, (const u_char *)
+                                          &((const struct sockaddr_in *)
+                                            sa)->sin_addr, 32);
+        break;
+#ifdef NETSNMP_ENABLE_IPV6
+    case AF_INET6:
+        rule = netsnmp_prefix_trie_lookup(filter_trie6, (const u_char *)
+                                          &((const struct sockaddr_in6 *)
+                                            sa)->sin6_addr, 128);
+        break;
+#endif
+    default:
+        return -1;
+    }
+    if (!rule)
+        return 0;
+    rule->hits++;
+    return 1;
+}
+
+/*
+ * netsnmp_transport_filter_hits
+ *
+ * returns the number of packets whose source address matched the
+ * address or network entry addrtxt, or -1 if there is no such entry
+ */
+long
+netsnmp_transport_filter_hits(const char *addrtxt)
+{
+    netsnmp_transport_filter_rule *rule;
+
+    for (rule = filter_rules; rule; rule = rule->next)
+        if (strcmp(rule->text, addrtxt) == 0)
+            return rule->hits;
+    return -1;
 }
 
 void
@@ -364,6 +781,17 @@ netsnmp_transport_parse_filter(const char *word, char *cptr)
 void
 netsnmp_transport_filter_cleanup(void)
 {
+    netsnmp_transport_filter_rule *rule;
+
+    while ((rule = filter_rules)) {
+        DEBUGMSGTL(("transport:filter", "%s matched %lu packets\n",
+                    rule->text, rule->hits));
+        filter_rules = rule->next;
+        free(rule->text);
+        free(rule);
+    }
+    _transport_filter_tries_free();
+
     if (NULL == filtered)
         return;
     CONTAINER_CLEAR(filtered, filtered->free_item, NULL);
@@ -395,17 +823,16 @@ netsnmp_sockaddr_size(const struct sockaddr *sa)
 }
 #endif /* NETSNMP_FEATURE_REMOVE_SOCKADDR_SIZE */
     
-int
-netsnmp_transport_send(netsnmp_transport *t, const void *packet, int length,
-                       void **opaque, int *olength)
+/*
+ * Does the packet dump and debugging output for a message that is sent,
+ * or queued to be sent with netsnmp_transport_sendv().
+ */
+void
+netsnmp_transport_log_send(netsnmp_transport *t, const void *packet,
+                           int length, void **opaque, int *olength)
 {
     int dumpPacket, debugLength;
 
-    if ((NULL == t) || (NULL == t->f_send)) {
-        DEBUGMSGTL(("transport:pkt:send", "NULL transport or send function\n"));
-        return SNMPERR_GENERR;
-    }
-
     dumpPacket = netsnmp_ds_get_boolean(NETSNMP_DS_LIBRARY_ID,
                                         NETSNMP_DS_LIB_DUMP_PACKET);
     debugLength = (SNMPERR_SUCCESS ==
@@ -425,10 +852,57 @@ netsnmp_transport_send(netsnmp_transport *t, const void *packet, int length,
     }
     if (dumpPacket)
         xdump(packet, length, "");
+}
+
+int
+netsnmp_transport_send(netsnmp_transport *t, const void *packet, int length,
+                       void **opaque, int *olength)
+{
+    if ((NULL == t) || (NULL == t->f_send)) {
+        DEBUGMSGTL(("transport:pkt:send", "NULL transport or send function\n"));
+        return SNMPERR_GENERR;
+    }
+
+    netsnmp_transport_log_send(t, packet, length, opaque, olength);
 
     return t->f_send(t, packet, length, opaque, olength);
 }
 
+#ifdef HAVE_SYS_UIO_H
+/*
+ * Sends iovcnt messages over a stream transport, with a single gather
+ * write if the transport supports it.  The caller does the packet dumps
+ * and debugging output, with netsnmp_transport_log_send(), as a message
+ * may be sent in several parts.
+ *
+ * Returns the number of bytes sent, which is less than the total on a
+ * non-blocking socket that is full, or a negative value on error.
+ */
+int
+netsnmp_transport_sendv(netsnmp_transport *t, const struct iovec *iov,
+                        int iovcnt)
+{
+    int i, rc, total = 0;
+
+    if ((NULL == t) || (NULL == t->f_send)) {
+        DEBUGMSGTL(("transport:pkt:send", "NULL transport or send function\n"));
+        return SNMPERR_GENERR;
+    }
+
+    if (NULL == t->f_sendv) {
+        for (i = 0; i < iovcnt; i++) {
+            rc = t->f_send(t, iov[i].iov_base, iov[i].iov_len, NULL, NULL);
+            if (rc < 0)
+                return rc;
+            total += rc;
+        }
+        return total;
+    }
+
+    return t->f_sendv(t, iov, iovcnt);
+}
+#endif /* HAVE_SYS_UIO_H */
+
 int
 netsnmp_transport_recv(netsnmp_transport *t, void *packet, int length,
                        void **opaque, int *olength)
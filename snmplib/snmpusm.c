@@ -5236,6 +5236,9 @@ init_usm(void)
                             " (AES support not available)"
 #endif
                            );
+    netsnmp_ds_register_config(ASN_INTEGER, "snmp", "engineTimeExpiry",
+                               NETSNMP_DS_LIBRARY_ID,
+                               NETSNMP_DS_LIB_ENGINETIME_EXPIRY);
 
     /*
      * Free stuff at shutdown time
@@ -105,8 +105,12 @@ typedef struct bio_cache_s {
    BIO *read_bio;  /* OpenSSL will read its incoming SSL packets from here */
    BIO *write_bio; /* OpenSSL will write its outgoing SSL packets to here */
    netsnmp_sockaddr_storage sas;
+   int sock;       /* our socket the peer talks to */
    u_int flags;
-   struct bio_cache_s *next;
+   struct bio_cache_s *next;   /* all connections, most recently used first */
+   struct bio_cache_s *prev;
+   struct bio_cache_s *hnext;  /* next in the same hash bucket */
+   time_t last_used;
    int msgnum;
    char *write_cache;
    size_t write_cache_len;
@@ -118,7 +122,19 @@ typedef struct bio_cache_s {
 #define NETSNMP_BIO_CONNECTED          0x0002 /* received decoded data */
 #define NETSNMP_BIO_DISCONNECTED       0x0004 /* peer shutdown */
 
+/*
+ * The connections are kept in a list ordered on last use, for eviction,
+ * and in a hash table on the peer address, for lookups.  Client sessions
+ * to the same peer share a hash bucket and differ in their socket.
+ */
+#define BIO_CACHE_HASH_MIN_SIZE 64
+
 static bio_cache *biocache = NULL;
+static bio_cache *biocache_last = NULL;
+static bio_cache **biocache_hash = NULL;
+static size_t biocache_hash_size = 0;   /* a power of 2 */
+static size_t biocache_count = 0;
+static u_long biocache_evictions = 0;
 
 static int openssl_addr_index = 0;
 
@@ -131,63 +147,186 @@ static int netsnmp_dtls_gen_cookie(SSL *ssl, unsigned char *cookie,
                                    unsigned int *cookie_len);
 #endif
 
+static time_t
+_bio_cache_now(void)
+{
+    struct timeval  now;
+
+    netsnmp_get_monotonic_clock(&now);
+    return now.tv_sec;
+}
+
+/* FNV-1a over the port and the address */
+static size_t
+_bio_cache_hash(const netsnmp_sockaddr_storage *addr)
+{
+    const u_char   *p, *end;
+    uint32_t        h = 2166136261U;
+
+    if (addr->sa.sa_family == AF_INET) {
+        p = (const u_char *) &addr->sin.sin_port;
+        h = (h ^ p[0]) * 16777619U;
+        h = (h ^ p[1]) * 16777619U;
+        p = (const u_char *) &addr->sin.sin_addr;
+        end = p + sizeof(addr->sin.sin_addr);
+    }
+#ifdef NETSNMP_TRANSPORT_UDPIPV6_DOMAIN
+    else if (addr->sa.sa_family == AF_INET6) {
+        p = (const u_char *) &addr->sin6.sin6_port;
+        h = (h ^ p[0]) * 16777619U;
+        h = (h ^ p[1]) * 16777619U;
+        p = addr->sin6.sin6_addr.s6_addr;
+        end = p + sizeof(addr->sin6.sin6_addr.s6_addr);
+    }
+#endif
+    else
+        return 0;
+    for (; p < end; p++)
+        h = (h ^ *p) * 16777619U;
+    return h & (biocache_hash_size - 1);
+}
+
+static int
+_bio_cache_same_addr(const netsnmp_sockaddr_storage *a,
+                     const netsnmp_sockaddr_storage *b)
+{
+    if (a->sa.sa_family != b->sa.sa_family)
+        return 0;
+
+    if (a->sa.sa_family == AF_INET)
+        return a->sin.sin_addr.s_addr == b->sin.sin_addr.s_addr &&
+            a->sin.sin_port == b->sin.sin_port;
+#ifdef NETSNMP_TRANSPORT_UDPIPV6_DOMAIN
+    if (a->sa.sa_family == AF_INET6)
+        return a->sin6.sin6_port == b->sin6.sin6_port &&
+            a->sin6.sin6_scope_id == b->sin6.sin6_scope_id &&
+            memcmp(a->sin6.sin6_addr.s6_addr, b->sin6.sin6_addr.s6_addr,
+                   sizeof(a->sin6.sin6_addr.s6_addr)) == 0;
+#endif
+    return 1;
+}
+
+/* move a connection to the front of the list */
+static void
+_bio_cache_touch(bio_cache *cachep)
+{
+    cachep->last_used = _bio_cache_now();
+    if (cachep == biocache)
+        return;
+
+    cachep->prev->next = cachep->next;
+    if (cachep->next)
+        cachep->next->prev = cachep->prev;
+    else
+        biocache_last = cachep->prev;
+
+    cachep->prev = NULL;
+    cachep->next = biocache;
+    biocache->prev = cachep;
+    biocache = cachep;
+}
+
+static int
+_bio_cache_resize(size_t size)
+{
+    bio_cache **hash, *cachep;
+
+    hash = calloc(size, sizeof(*hash));
+    if (!hash)
+        return -1;
+    free(biocache_hash);
+    biocache_hash = hash;
+    biocache_hash_size = size;
+    for (cachep = biocache; cachep; cachep = cachep->next) {
+        size_t h = _bio_cache_hash(&cachep->sas);
+
+        cachep->hnext = hash[h];
+        hash[h] = cachep;
+    }
+    DEBUGMSGTL(("dtlsudp:bio_cache", "%" NETSNMP_PRIz "u hash buckets for %"
+                NETSNMP_PRIz "u connections\n", size, biocache_count));
+    return 0;
+}
+
 /* this stores remote connections in a list to search through */
-/* XXX: optimize for searching */
 /* XXX: handle state issues for new connections to reduce DOS issues */
 /*      (TLS should do this, but openssl can't do more than one ctx per sock */
-/* XXX: put a timer on the cache for expirary purposes */
-static bio_cache *find_bio_cache(const netsnmp_sockaddr_storage *from_addr)
+static bio_cache *find_bio_cache(int sock,
+                                 const netsnmp_sockaddr_storage *from_addr)
 {
     bio_cache *cachep = NULL;
-    
-    for (cachep = biocache; cachep; cachep = cachep->next) {
 
-        if (cachep->sas.sa.sa_family != from_addr->sa.sa_family)
-            continue;
+    if (!biocache_hash)
+        return NULL;
 
-        if ((from_addr->sa.sa_family == AF_INET) &&
-            ((cachep->sas.sin.sin_addr.s_addr !=
-              from_addr->sin.sin_addr.s_addr) ||
-             (cachep->sas.sin.sin_port != from_addr->sin.sin_port)))
-                continue;
-#ifdef NETSNMP_TRANSPORT_UDPIPV6_DOMAIN
-        else if ((from_addr->sa.sa_family == AF_INET6) &&
-                 ((cachep->sas.sin6.sin6_port != from_addr->sin6.sin6_port) ||
-                  (cachep->sas.sin6.sin6_scope_id !=
-                   from_addr->sin6.sin6_scope_id) ||
-                  (memcmp(cachep->sas.sin6.sin6_addr.s6_addr,
-                          from_addr->sin6.sin6_addr.s6_addr,
-                          sizeof(from_addr->sin6.sin6_addr.s6_addr)) != 0)))
-            continue;
-#endif
-        /* found an existing connection */
-        break;
-    }
+    for (cachep = biocache_hash[_bio_cache_hash(from_addr)]; cachep;
+         cachep = cachep->hnext)
+        if (cachep->sock == sock &&
+            _bio_cache_same_addr(&cachep->sas, from_addr))
+            break;
+
+    /* found an existing connection */
+    if (cachep)
+        _bio_cache_touch(cachep);
     return cachep;
 }
 
+/* adds a new cache entry, with its address set, as the most recently
+   used one. */
+static int add_bio_cache(bio_cache *thiscache)
+{
+    size_t h;
+
+    if (biocache_count >= biocache_hash_size &&
+        _bio_cache_resize(biocache_hash_size ?
+                          2 * biocache_hash_size : BIO_CACHE_HASH_MIN_SIZE) &&
+        !biocache_hash)
+        return SNMPERR_MALLOC;
+
+    h = _bio_cache_hash(&thiscache->sas);
+    thiscache->hnext = biocache_hash[h];
+    biocache_hash[h] = thiscache;
+
+    thiscache->last_used = _bio_cache_now();
+    thiscache->prev = NULL;
+    thiscache->next = biocache;
+    if (biocache)
+        biocache->prev = thiscache;
+    else
+        biocache_last = thiscache;
+    biocache = thiscache;
+    biocache_count++;
+    return SNMPERR_SUCCESS;
+}
+
 /* removes a single cache entry and returns SUCCESS on finding and
    removing it. */
 static int remove_bio_cache(bio_cache *thiscache)
 {
-    bio_cache *cachep = NULL, *prevcache = NULL;
-
-    cachep = biocache;
-    while (cachep) {
-        if (cachep == thiscache) {
-
-            /* remove it from the list */
-            if (NULL == prevcache) {
-                /* at the first cache in the list */
-                biocache = thiscache->next;
-            } else {
-                prevcache->next = thiscache->next;
-            }
+    bio_cache **cachepp;
 
-            return SNMPERR_SUCCESS;
-        }
-        prevcache = cachep;
-        cachep = cachep->next;
+    if (!biocache_hash)
+        return SNMPERR_GENERR;
+
+    for (cachepp = &biocache_hash[_bio_cache_hash(&thiscache->sas)];
+         *cachepp; cachepp = &(*cachepp)->hnext) {
+        if (*cachepp != thiscache)
+            continue;
+
+        /* remove it from the hash bucket and the list */
+        *cachepp = thiscache->hnext;
+        if (thiscache->prev)
+            thiscache->prev->next = thiscache->next;
+        else
+            biocache = thiscache->next;
+        if (thiscache->next)
+            thiscache->next->prev = thiscache->prev;
+        else
+            biocache_last = thiscache->prev;
+        thiscache->next = thiscache->prev = thiscache->hnext = NULL;
+        biocache_count--;
+
+        return SNMPERR_SUCCESS;
     }
     return SNMPERR_GENERR;
 }
@@ -210,6 +349,57 @@ static void remove_and_free_bio_cache(bio_cache *cachep)
     /** no debug, remove_bio_cache does it */
     remove_bio_cache(cachep);
     free_bio_cache(cachep);
+    free(cachep);
+}
+
+/*
+ * Drops the least recently used server side connections that have been
+ * idle for longer than dtlsIdleTimeout seconds, or that exceed the
+ * dtlsMaxConnections limit, to make room for a new one.  Client side
+ * connections belong to their transport and are left alone, as are
+ * connections with data still waiting to go out.
+ */
+static void
+expire_bio_cache(void)
+{
+    bio_cache *cachep, *prevp;
+    int     max = netsnmp_ds_get_int(NETSNMP_DS_LIBRARY_ID,
+                                     NETSNMP_DS_LIB_DTLS_MAX_CONNECTIONS);
+    int     idle = netsnmp_ds_get_int(NETSNMP_DS_LIBRARY_ID,
+                                      NETSNMP_DS_LIB_DTLS_IDLE_TIMEOUT);
+    time_t  now = _bio_cache_now();
+
+    if (max <= 0 && idle <= 0)
+        return;
+
+    for (cachep = biocache_last; cachep; cachep = prevp) {
+        prevp = cachep->prev;
+        if ((max <= 0 || biocache_count < (size_t)max) &&
+            (idle <= 0 || now - cachep->last_used < idle))
+            break;
+        if (cachep->write_cache ||
+            (cachep->tlsdata &&
+             (cachep->tlsdata->flags & NETSNMP_TLSBASE_IS_CLIENT)))
+            continue;
+
+        DEBUGMSGTL(("dtlsudp:bio_cache", "evicting %p, idle for %ld s\n",
+                    cachep, (long)(now - cachep->last_used)));
+        remove_and_free_bio_cache(cachep);
+        biocache_evictions++;
+    }
+}
+
+/**
+ * Returns the number of DTLS connections currently cached and the
+ * number evicted so far by dtlsMaxConnections or dtlsIdleTimeout.
+ */
+void
+netsnmp_dtlsudp_cache_stats(size_t *connections, u_long *evictions)
+{
+    if (connections)
+        *connections = biocache_count;
+    if (evictions)
+        *evictions = biocache_evictions;
 }
 
 
@@ -293,8 +483,6 @@ start_new_cached_connection(netsnmp_transport *t,
     }
     
     DEBUGMSGTL(("dtlsudp", "starting a new connection\n"));
-    cachep->next = biocache;
-    biocache = cachep;
 
     if (remote_addr->sa.sa_family == AF_INET)
         memcpy(&cachep->sas.sin, &remote_addr->sin, sizeof(remote_addr->sin));
@@ -302,8 +490,20 @@ start_new_cached_connection(netsnmp_transport *t,
     else if (remote_addr->sa.sa_family == AF_INET6)
         memcpy(&cachep->sas.sin6, &remote_addr->sin6, sizeof(remote_addr->sin6));
 #endif
-    else
+    else {
+        netsnmp_tlsbase_free_tlsdata(tlsdata);
+        SNMP_FREE(cachep);
         DIEHERE("unknown address family");
+    }
+
+    cachep->sock = t->sock;
+
+    expire_bio_cache();
+    if (add_bio_cache(cachep) != SNMPERR_SUCCESS) {
+        netsnmp_tlsbase_free_tlsdata(tlsdata);
+        SNMP_FREE(cachep);
+        DIEHERE("failed to add the connection to the cache");
+    }
 
     /* create caching memory bios for OpenSSL to read and write to */
 
@@ -326,11 +526,16 @@ start_new_cached_connection(netsnmp_transport *t,
         DEBUGMSGTL(("dtlsudp",
                     "starting a new connection as a client to sock: %d\n",
                     t->sock));
-        tlsdata->ssl = SSL_new(sslctx_client_setup(DTLS_method(), tlsdata));
-
-        /* XXX: session setting 735 */
+        tlsdata->ssl_context = sslctx_client_setup(DTLS_method(), tlsdata);
+        if (tlsdata->ssl_context)
+            tlsdata->ssl = SSL_new(tlsdata->ssl_context);
+        if (tlsdata->ssl)
+            netsnmp_tlsbase_resume_session(tlsdata->ssl, tlsdata,
+                                           &cachep->sas, sizeof(cachep->sas));
     } else {
         /* we're the server */
+        /* the context is shared with the other connections, which lets
+           them resume each other's sessions */
         SSL_CTX *ctx = sslctx_server_setup(DTLS_method());
         if (!ctx) {
             BIO_free(cachep->read_bio);
@@ -348,6 +553,7 @@ start_new_cached_connection(netsnmp_transport *t,
 #endif
 
         tlsdata->ssl = SSL_new(ctx);
+        SSL_CTX_free(ctx); /* the connection holds its own reference */
     }
 
     if (!tlsdata->ssl) {
@@ -423,7 +629,7 @@ find_or_create_bio_cache(netsnmp_transport *t,
                          const netsnmp_sockaddr_storage *from_addr,
                          int we_are_client)
 {
-    bio_cache *cachep = find_bio_cache(from_addr);
+    bio_cache *cachep = find_bio_cache(t->sock, from_addr);
 
     if (NULL == cachep) {
         /* none found; need to start a new context */
@@ -431,6 +637,14 @@ find_or_create_bio_cache(netsnmp_transport *t,
         if (NULL == cachep) {
             snmp_log(LOG_ERR, "failed to open a new dtls connection\n");
         }
+        DEBUGIF("dtlsudp:stats") {
+            size_t connections;
+            u_long evictions;
+
+            netsnmp_dtlsudp_cache_stats(&connections, &evictions);
+            DEBUGMSGTL(("dtlsudp:stats", "%" NETSNMP_PRIz "u connections"
+                        " cached, %lu evicted\n", connections, evictions));
+        }
     } else {
         DEBUGMSGT(("9:dtlsudp:bio_cache:found", "%p\n", cachep));
     }
@@ -506,6 +720,7 @@ _netsnmp_send_queued_dtls_pkts(netsnmp_transport *t, bio_cache *cachep)
     outsize = BIO_ctrl_pending(cachep->write_bio);
     outbuf = malloc(outsize);
     if (outsize > 0 && outbuf) {
+        netsnmp_indexed_addr_pair addr_pair;
         int socksize;
         void *sa;
 
@@ -515,8 +730,12 @@ _netsnmp_send_queued_dtls_pkts(netsnmp_transport *t, bio_cache *cachep)
         MAKE_MEM_DEFINED(outbuf, outsize);
         sa = NETSNMP_REMOVE_CONST(struct sockaddr *,
                                   _find_remote_sockaddr(t, NULL, 0, &socksize));
-        if (NULL == sa)
-            sa = &cachep->sas.sa;
+        if (NULL == sa) {
+            /* the base transport reads a whole address pair from sa */
+            memset(&addr_pair, 0, sizeof(addr_pair));
+            memcpy(&addr_pair.remote_addr, &cachep->sas, sizeof(cachep->sas));
+            sa = &addr_pair;
+        }
         socksize = netsnmp_sockaddr_size(sa);
         rc2 = t->base_transport->f_send(t, outbuf, outsize, &sa, &socksize);
         if (rc2 == -1) {
@@ -1060,6 +1279,7 @@ netsnmp_dtlsudp_send(netsnmp_transport *t, const void *buf, int size,
 {
     int rc = -1;
     const netsnmp_indexed_addr_pair *addr_pair = NULL;
+    netsnmp_indexed_addr_pair to;
     bio_cache *cachep = NULL;
     const netsnmp_tmStateReference *tmStateRef = NULL;
     void *outbuf;
@@ -1272,8 +1492,11 @@ netsnmp_dtlsudp_send(netsnmp_transport *t, const void *buf, int size,
         return -1;
     rc = BIO_read(cachep->write_bio, outbuf, rc);
     MAKE_MEM_DEFINED(outbuf, rc);
+    /* the base transport reads a whole address pair from sa */
+    memset(&to, 0, sizeof(to));
+    memcpy(&to.remote_addr, &cachep->sas, sizeof(cachep->sas));
     socksize = netsnmp_sockaddr_size(&cachep->sas.sa);
-    sa = &cachep->sas.sa;
+    sa = &to;
     rc = t->base_transport->f_send(t, outbuf, rc, &sa, &socksize);
     free(outbuf);
 
@@ -1310,7 +1533,7 @@ netsnmp_dtlsudp_close(netsnmp_transport *t)
         tlsbase = t->data;
 
         if (tlsbase->addr)
-            cachep = find_bio_cache(&tlsbase->addr->remote_addr);
+            cachep = find_bio_cache(t->sock, &tlsbase->addr->remote_addr);
     }
 
     /* RFC5953: section 5.4, step 3:
@@ -1665,6 +1888,14 @@ netsnmp_dtlsudp_ctor(void)
 
     /* config settings */
 
+    /* how many connections to keep, and for how long when idle */
+    netsnmp_ds_register_config(ASN_INTEGER, "snmp", "dtlsMaxConnections",
+                               NETSNMP_DS_LIBRARY_ID,
+                               NETSNMP_DS_LIB_DTLS_MAX_CONNECTIONS);
+    netsnmp_ds_register_config(ASN_INTEGER, "snmp", "dtlsIdleTimeout",
+                               NETSNMP_DS_LIBRARY_ID,
+                               NETSNMP_DS_LIB_DTLS_IDLE_TIMEOUT);
+
 #ifdef NETSNMP_TRANSPORT_UDPIPV6_DOMAIN
     if (!openssl_addr_index6)
         openssl_addr_index6 =
@@ -30,7 +30,11 @@
 #ifdef HAVE_SYS_SOCKET_H
 #include <sys/socket.h>
 #endif
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
 #include <errno.h>
+#include <limits.h>
 
 #include <net-snmp/types.h>
 #include <net-snmp/library/snmp_debug.h>
@@ -53,6 +57,54 @@ int netsnmp_socketbase_close(netsnmp_transport *t) {
     return rc;
 }
 
+#ifdef HAVE_SYS_UIO_H
+#ifndef IOV_MAX
+#define IOV_MAX 16
+#endif
+
+/*
+ * gather write for connected stream sockets: sends all of iov, continuing
+ * after partial writes, or as much as a non-blocking socket takes
+ */
+int netsnmp_socketbase_sendv(netsnmp_transport *t, const struct iovec *iov,
+                             int iovcnt) {
+    size_t off = 0, n;
+    int i = 0, rc, total = 0;
+
+    if (t == NULL || t->sock < 0)
+        return -1;
+
+    while (i < iovcnt) {
+        if (off > 0)
+            rc = send(t->sock, (const char *) iov[i].iov_base + off,
+                      iov[i].iov_len - off, 0);
+        else
+            rc = writev(t->sock, iov + i, SNMP_MIN(iovcnt - i, IOV_MAX));
+        if (rc < 0) {
+            if (errno == EINTR)
+                continue;
+#if defined(EWOULDBLOCK) && EWOULDBLOCK != EAGAIN
+            if (errno == EWOULDBLOCK)
+                break;
+#endif
+            if (errno == EAGAIN)
+                break;
+            DEBUGMSGTL(("netsnmp_socketbase", "sendv fd %d err %d (\"%s\")\n",
+                        t->sock, errno, strerror(errno)));
+            return -1;
+        }
+        total += rc;
+        /* step past what was written */
+        for (n = rc; i < iovcnt && n >= iov[i].iov_len - off; i++) {
+            n -= iov[i].iov_len - off;
+            off = 0;
+        }
+        off += n;
+    }
+    return total;
+}
+#endif /* HAVE_SYS_UIO_H */
+
 /*
  * find largest possible buffer between current size and specified size.
  *
@@ -311,6 +311,9 @@ netsnmp_tcp6_transport(const struct netsnmp_ep *ep, int local)
     t->msgMaxSize = SNMP_MAX_PACKET_LEN;
     t->f_recv     = netsnmp_tcpbase_recv;
     t->f_send     = netsnmp_tcpbase_send;
+#ifdef HAVE_SYS_UIO_H
+    t->f_sendv    = netsnmp_socketbase_sendv;
+#endif
     t->f_close    = netsnmp_socketbase_close;
     t->f_accept   = netsnmp_tcp6_accept;
     t->f_fmtaddr  = netsnmp_tcp6_fmtaddr;
@@ -163,6 +163,326 @@ int verify_callback(int ok, X509_STORE_CTX *ctx) {
     return(ok);
 }
 
+/*
+ * (D)TLS session resumption
+ *
+ * A client keeps the last session it got from each server, keyed on the
+ * server address and on the identities configured for the transport, so
+ * that its next connection to that server can resume the session rather
+ * than doing a full handshake.  Servers share one context per method
+ * (see sslctx_server_setup()) and so one session cache and one set of
+ * ticket keys.  A server also remembers the securityName derived from
+ * each client certificate, by fingerprint, until the certificate maps
+ * change.
+ *
+ * Both caches are direct-mapped: a new entry replaces whatever was kept
+ * in the slot its key hashes to.
+ */
+#define TLSBASE_CACHE_SIZE 4096 /* a power of 2 */
+
+typedef struct tlsbase_session_s {
+    char           *key;
+    size_t          key_len;
+    SSL_SESSION    *session;
+} tlsbase_session;
+
+typedef struct tlsbase_secname_s {
+    char           *fingerprint;
+    char           *securityName;
+    u_long          maps_sync;
+} tlsbase_secname;
+
+static tlsbase_session *tls_sessions;
+static tlsbase_secname *tls_secnames;
+static u_long tls_resumed_handshakes, tls_full_handshakes;
+static int openssl_tlsdata_index = -1;
+
+static struct {
+    const SSL_METHOD *method;
+    SSL_CTX          *ctx;
+} tls_server_ctx[2];
+
+static int
+_tlsbase_resumption(void)
+{
+    return !netsnmp_ds_get_boolean(NETSNMP_DS_LIBRARY_ID,
+                                   NETSNMP_DS_LIB_TLS_DISABLE_RESUMPTION);
+}
+
+static u_int
+_tlsbase_hash(const char *key, size_t key_len)
+{
+    u_int           h = 2166136261U;
+
+    while (key_len--) {
+        h ^= (u_char) *key++;
+        h *= 16777619U;
+    }
+    return h & (TLSBASE_CACHE_SIZE - 1);
+}
+
+/*
+ * the session key: the peer address followed by the identities that
+ * decide which certificates are presented and accepted
+ */
+static char *
+_tlsbase_session_key(_netsnmpTLSBaseData *tlsdata, const void *peer,
+                     size_t peer_len, size_t *key_len)
+{
+    const char     *ids[5];
+    char           *key, *cp;
+    size_t          len = peer_len, l;
+    int             i;
+
+    ids[0] = tlsdata->our_identity;
+    ids[1] = tlsdata->their_identity;
+    ids[2] = tlsdata->their_fingerprint;
+    ids[3] = tlsdata->their_hostname;
+    ids[4] = tlsdata->trust_cert;
+    for (i = 0; i < 5; i++)
+        len += (ids[i] ? strlen(ids[i]) : 0) + 1;
+
+    key = malloc(len);
+    if (!key)
+        return NULL;
+    memcpy(key, peer, peer_len);
+    cp = key + peer_len;
+    for (i = 0; i < 5; i++) {
+        l = ids[i] ? strlen(ids[i]) : 0;
+        if (l)
+            memcpy(cp, ids[i], l);
+        cp[l] = '\0';
+        cp += l + 1;
+    }
+    *key_len = len;
+    return key;
+}
+
+static void
+_tlsbase_drop_session(tlsbase_session *slot)
+{
+    if (slot->session)
+        SSL_SESSION_free(slot->session);
+    slot->session = NULL;
+    SNMP_FREE(slot->key);
+    slot->key_len = 0;
+}
+
+/*
+ * keep a session for the next connection with the same key.
+ *
+ * @return 1 if the session was kept (and our reference to it taken over),
+ *         0 otherwise
+ */
+static int
+_tlsbase_store_session(_netsnmpTLSBaseData *tlsdata, SSL_SESSION *session)
+{
+    tlsbase_session *slot;
+
+    if (!session || !tlsdata->session_key || !_tlsbase_resumption())
+        return 0;
+#ifdef HAVE_SSL_SESSION_IS_RESUMABLE
+    /* a TLS 1.3 session can only be resumed once its ticket has arrived */
+    if (!SSL_SESSION_is_resumable(session))
+        return 0;
+#endif
+
+    if (!tls_sessions) {
+        tls_sessions = calloc(TLSBASE_CACHE_SIZE, sizeof(*tls_sessions));
+        if (!tls_sessions)
+            return 0;
+    }
+    slot = &tls_sessions[_tlsbase_hash(tlsdata->session_key,
+                                       tlsdata->session_key_len)];
+    if (slot->session == session)
+        return 0;
+    if (slot->key_len != tlsdata->session_key_len ||
+        memcmp(slot->key, tlsdata->session_key, slot->key_len) != 0) {
+        _tlsbase_drop_session(slot);
+        slot->key = netsnmp_memdup(tlsdata->session_key,
+                                   tlsdata->session_key_len);
+        if (!slot->key)
+            return 0;
+        slot->key_len = tlsdata->session_key_len;
+    } else if (slot->session)
+        SSL_SESSION_free(slot->session);
+    slot->session = session;
+    DEBUGMSGTL(("tls:resume", "keeping a session for %s\n",
+                tlsdata->addr_string ? tlsdata->addr_string : "a peer"));
+    return 1;
+}
+
+/* called by openssl when a client gets a session, possibly as a ticket
+   after the handshake itself */
+static int
+_tlsbase_new_session(SSL *ssl, SSL_SESSION *session)
+{
+    _netsnmpTLSBaseData *tlsdata;
+
+    tlsdata = SSL_get_ex_data(ssl, openssl_tlsdata_index);
+    /* only keep sessions with servers that we have verified */
+    if (!tlsdata || !(tlsdata->flags & NETSNMP_TLSBASE_CERT_FP_VERIFIED))
+        return 0;
+    return _tlsbase_store_session(tlsdata, session);
+}
+
+/**
+ * Offers the session kept for a peer, if any, on a new client connection.
+ *
+ * Must be called after SSL_new() and before the handshake.
+ *
+ * @param ssl      the new connection
+ * @param tlsdata  the transport data the connection belongs to
+ * @param peer     the peer's address
+ * @param peer_len the length of peer
+ */
+void
+netsnmp_tlsbase_resume_session(SSL *ssl, _netsnmpTLSBaseData *tlsdata,
+                               const void *peer, size_t peer_len)
+{
+    tlsbase_session *slot;
+
+    if (!ssl || !tlsdata || !_tlsbase_resumption())
+        return;
+
+    SNMP_FREE(tlsdata->session_key);
+    tlsdata->session_key =
+        _tlsbase_session_key(tlsdata, peer, peer_len,
+                             &tlsdata->session_key_len);
+    if (!tlsdata->session_key)
+        return;
+    SSL_set_ex_data(ssl, openssl_tlsdata_index, tlsdata);
+
+    if (!tls_sessions)
+        return;
+    slot = &tls_sessions[_tlsbase_hash(tlsdata->session_key,
+                                       tlsdata->session_key_len)];
+    if (!slot->session || slot->key_len != tlsdata->session_key_len ||
+        memcmp(slot->key, tlsdata->session_key, slot->key_len) != 0)
+        return;
+    if (SSL_SESSION_get_time(slot->session) +
+        SSL_SESSION_get_timeout(slot->session) < (long) time(NULL)) {
+        _tlsbase_drop_session(slot);
+        return;
+    }
+    if (SSL_set_session(ssl, slot->session) == 1)
+        DEBUGMSGTL(("tls:resume", "offering the kept session\n"));
+}
+
+/**
+ * Returns the number of handshakes that resumed a session and of those
+ * that did not, for both the client and the server side.
+ */
+void
+netsnmp_tlsbase_session_stats(u_long *resumed, u_long *full)
+{
+    if (resumed)
+        *resumed = tls_resumed_handshakes;
+    if (full)
+        *full = tls_full_handshakes;
+}
+
+static void
+_tlsbase_count_handshake(SSL *ssl)
+{
+    if (SSL_session_reused(ssl))
+        tls_resumed_handshakes++;
+    else
+        tls_full_handshakes++;
+}
+
+static char *
+_tlsbase_peer_fingerprint(SSL *ssl)
+{
+    X509           *remote_cert;
+    char           *fingerprint;
+
+    remote_cert = SSL_get_peer_certificate(ssl);
+    if (!remote_cert)
+        return NULL;
+    fingerprint =
+        netsnmp_openssl_cert_get_fingerprint(remote_cert, NS_HASH_SHA1);
+    X509_free(remote_cert);
+    return fingerprint;
+}
+
+static u_long
+_tlsbase_maps_sync(void)
+{
+    netsnmp_container *maps = netsnmp_cert_map_container();
+
+    return maps ? maps->sync : 0;
+}
+
+static const char *
+_tlsbase_find_secname(const char *fingerprint)
+{
+    tlsbase_secname *slot;
+
+    if (!tls_secnames)
+        return NULL;
+    slot = &tls_secnames[_tlsbase_hash(fingerprint, strlen(fingerprint))];
+    if (!slot->fingerprint || strcmp(slot->fingerprint, fingerprint) != 0 ||
+        slot->maps_sync != _tlsbase_maps_sync())
+        return NULL;
+    return slot->securityName;
+}
+
+static void
+_tlsbase_save_secname(const char *fingerprint, const char *securityName)
+{
+    tlsbase_secname *slot;
+    char           *fp, *sn;
+
+    if (!tls_secnames) {
+        tls_secnames = calloc(TLSBASE_CACHE_SIZE, sizeof(*tls_secnames));
+        if (!tls_secnames)
+            return;
+    }
+    fp = strdup(fingerprint);
+    sn = strdup(securityName);
+    if (!fp || !sn) {
+        free(fp);
+        free(sn);
+        return;
+    }
+    slot = &tls_secnames[_tlsbase_hash(fingerprint, strlen(fingerprint))];
+    free(slot->fingerprint);
+    free(slot->securityName);
+    slot->fingerprint = fp;
+    slot->securityName = sn;
+    slot->maps_sync = _tlsbase_maps_sync();
+}
+
+/* forget everything, since the certificates or their maps may change */
+static int
+_tlsbase_flush_caches(int majorid, int minorid, void *serverarg,
+                      void *clientarg)
+{
+    size_t          i;
+
+    DEBUGMSGTL(("tls:resume", "flushing the session caches\n"));
+    if (tls_sessions) {
+        for (i = 0; i < TLSBASE_CACHE_SIZE; i++)
+            _tlsbase_drop_session(&tls_sessions[i]);
+        SNMP_FREE(tls_sessions);
+    }
+    if (tls_secnames) {
+        for (i = 0; i < TLSBASE_CACHE_SIZE; i++) {
+            free(tls_secnames[i].fingerprint);
+            free(tls_secnames[i].securityName);
+        }
+        SNMP_FREE(tls_secnames);
+    }
+    for (i = 0; i < sizeof(tls_server_ctx) / sizeof(tls_server_ctx[0]); i++) {
+        if (tls_server_ctx[i].ctx)
+            SSL_CTX_free(tls_server_ctx[i].ctx);
+        tls_server_ctx[i].ctx = NULL;
+        tls_server_ctx[i].method = NULL;
+    }
+    return 0;
+}
+
 #define VERIFIED_FINGERPRINT      0
 #define NO_FINGERPRINT_AVAILABLE  1
 #define FAILED_FINGERPRINT_VERIFY 2
@@ -226,10 +546,8 @@ _netsnmp_tlsbase_verify_remote_fingerprint(X509 *remote_cert,
     return VERIFIED_FINGERPRINT;
 }
 
-/* this is called after the connection on the client side by us to check
-   other aspects about the connection */
-int
-netsnmp_tlsbase_verify_server_cert(SSL *ssl, _netsnmpTLSBaseData *tlsdata) {
+static int
+_tlsbase_verify_server_cert(SSL *ssl, _netsnmpTLSBaseData *tlsdata) {
     /* XXX */
     X509            *remote_cert;
     char            *their_hostname;
@@ -300,6 +618,28 @@ netsnmp_tlsbase_verify_server_cert(SSL *ssl, _netsnmpTLSBaseData *tlsdata) {
     return SNMPERR_GENERR;
 }
 
+/* this is called after the connection on the client side by us to check
+   other aspects about the connection */
+int
+netsnmp_tlsbase_verify_server_cert(SSL *ssl, _netsnmpTLSBaseData *tlsdata) {
+    SSL_SESSION *session;
+    int          rc;
+
+    rc = _tlsbase_verify_server_cert(ssl, tlsdata);
+    if (rc != SNMPERR_SUCCESS)
+        return rc;
+
+    tlsdata->flags |= NETSNMP_TLSBASE_CERT_FP_VERIFIED;
+    _tlsbase_count_handshake(ssl);
+
+    /* before TLS 1.3 the session is complete by now; TLS 1.3 tickets
+       arrive later, through _tlsbase_new_session() */
+    session = SSL_get1_session(ssl);
+    if (session && !_tlsbase_store_session(tlsdata, session))
+        SSL_SESSION_free(session);
+    return SNMPERR_SUCCESS;
+}
+
 /* this is called after the connection on the server side by us to check
    the validity of the client's certificate */
 int
@@ -342,11 +682,13 @@ netsnmp_tlsbase_verify_client_cert(SSL *ssl, _netsnmpTLSBaseData *tlsdata) {
 
     case NO_FINGERPRINT_AVAILABLE:
         DEBUGMSGTL(("tls_x509:verify", "no known fingerprint available (not a failure case)\n"));
+        _tlsbase_count_handshake(ssl);
         return SNMPERR_SUCCESS;
 
     case VERIFIED_FINGERPRINT:
         DEBUGMSGTL(("tls_x509:verify", "Verified client fingerprint\n"));
         tlsdata->flags |= NETSNMP_TLSBASE_CERT_FP_VERIFIED;
+        _tlsbase_count_handshake(ssl);
         return SNMPERR_SUCCESS;
     }
 
@@ -354,11 +696,8 @@ netsnmp_tlsbase_verify_client_cert(SSL *ssl, _netsnmpTLSBaseData *tlsdata) {
     return SNMPERR_GENERR;
 }
 
-/* this is called after the connection on the server side by us to
-   check other aspects about the connection and obtain the
-   securityName from the remote certificate. */
-int
-netsnmp_tlsbase_extract_security_name(SSL *ssl, _netsnmpTLSBaseData *tlsdata) {
+static int
+_tlsbase_map_security_name(SSL *ssl, _netsnmpTLSBaseData *tlsdata) {
     netsnmp_container  *chain_maps;
     netsnmp_cert_map   *cert_map, *peer_cert;
     netsnmp_iterator  *itr;
@@ -400,6 +739,35 @@ netsnmp_tlsbase_extract_security_name(SSL *ssl, _netsnmpTLSBaseData *tlsdata) {
     return (tlsdata->securityName ? SNMPERR_SUCCESS : SNMPERR_GENERR);
 }
 
+/* this is called after the connection on the server side by us to
+   check other aspects about the connection and obtain the
+   securityName from the remote certificate. */
+int
+netsnmp_tlsbase_extract_security_name(SSL *ssl, _netsnmpTLSBaseData *tlsdata) {
+    const char *securityName;
+    char       *fingerprint = NULL;
+    int         rc;
+
+    netsnmp_assert_or_return(ssl != NULL, SNMPERR_GENERR);
+    netsnmp_assert_or_return(tlsdata != NULL, SNMPERR_GENERR);
+
+    if (_tlsbase_resumption() &&
+        NULL != (fingerprint = _tlsbase_peer_fingerprint(ssl)) &&
+        NULL != (securityName = _tlsbase_find_secname(fingerprint))) {
+        DEBUGMSGTL(("tls:resume", "known fingerprint %s maps to %s\n",
+                    fingerprint, securityName));
+        free(fingerprint);
+        tlsdata->securityName = strdup(securityName);
+        return (tlsdata->securityName ? SNMPERR_SUCCESS : SNMPERR_GENERR);
+    }
+
+    rc = _tlsbase_map_security_name(ssl, tlsdata);
+    if (SNMPERR_SUCCESS == rc && fingerprint)
+        _tlsbase_save_secname(fingerprint, tlsdata->securityName);
+    SNMP_FREE(fingerprint);
+    return rc;
+}
+
 int
 _trust_this_cert(SSL_CTX *the_ctx, char *certspec) {
     netsnmp_cert *trustcert;
@@ -602,6 +970,13 @@ sslctx_client_setup(const SSL_METHOD *method, _netsnmpTLSBaseData *tlsbase) {
                        SSL_VERIFY_CLIENT_ONCE,
                        &verify_callback);
 
+    if (_tlsbase_resumption()) {
+        /* sessions are kept by _tlsbase_new_session(), once verified */
+        SSL_CTX_set_session_cache_mode(the_ctx, SSL_SESS_CACHE_CLIENT |
+                                       SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(the_ctx, _tlsbase_new_session);
+    }
+
     if (tlsbase->our_identity) {
         DEBUGMSGTL(("sslctx_client", "looking for local id: %s\n", tlsbase->our_identity));
         id_cert = netsnmp_cert_find(NS_CERT_IDENTITY, NS_CERTKEY_MULTIPLE,
@@ -688,8 +1063,9 @@ err:
     return 0;
 }
 
-SSL_CTX *
-sslctx_server_setup(const SSL_METHOD *method) {
+static SSL_CTX *
+_sslctx_server_new(const SSL_METHOD *method) {
+    static const unsigned char sid_ctx[] = "net-snmp";
     netsnmp_cert *id_cert;
     X509         *ocert;
     const char	 *msg;
@@ -759,7 +1135,24 @@ sslctx_server_setup(const SSL_METHOD *method) {
 
     SSL_CTX_set_options(the_ctx, SSL_OP_CIPHER_SERVER_PREFERENCE);
 
-    return _sslctx_common_setup(the_ctx, NULL);
+    /* needed to resume sessions of verified clients */
+    SSL_CTX_set_session_id_context(the_ctx, sid_ctx, sizeof(sid_ctx) - 1);
+    if (_tlsbase_resumption()) {
+        SSL_CTX_set_session_cache_mode(the_ctx, SSL_SESS_CACHE_SERVER);
+        SSL_CTX_sess_set_cache_size(the_ctx, TLSBASE_CACHE_SIZE);
+    } else {
+        SSL_CTX_set_session_cache_mode(the_ctx, SSL_SESS_CACHE_OFF);
+        SSL_CTX_set_options(the_ctx, SSL_OP_NO_TICKET);
+#ifdef HAVE_SSL_CTX_SET_NUM_TICKETS
+        SSL_CTX_set_num_tickets(the_ctx, 0);
+#endif
+    }
+
+    if (!_sslctx_common_setup(the_ctx, NULL)) {
+        SSL_CTX_free(the_ctx);
+        return NULL;
+    }
+    return the_ctx;
     
 err:
     snmp_log(LOG_ERR, "%s\n", msg);
@@ -767,6 +1160,48 @@ err:
     return NULL;
 }
 
+/* takes another reference to a shared server context */
+static void
+_sslctx_up_ref(SSL_CTX *ctx) {
+#ifdef HAVE_SSL_CTX_UP_REF
+    SSL_CTX_up_ref(ctx);
+#else
+    /* OpenSSL before 1.1.0 */
+    CRYPTO_add(&ctx->references, 1, CRYPTO_LOCK_SSL_CTX);
+#endif
+}
+
+/*
+ * Returns a reference to the server context for a method.  The context
+ * is shared by all the connections accepted with that method, so that
+ * they share its session cache and ticket keys, until the configuration
+ * is read again.
+ */
+SSL_CTX *
+sslctx_server_setup(const SSL_METHOD *method) {
+    SSL_CTX *the_ctx;
+    size_t   i;
+
+    for (i = 0; i < sizeof(tls_server_ctx) / sizeof(tls_server_ctx[0]); i++)
+        if (tls_server_ctx[i].ctx && tls_server_ctx[i].method == method) {
+            _sslctx_up_ref(tls_server_ctx[i].ctx);
+            return tls_server_ctx[i].ctx;
+        }
+
+    the_ctx = _sslctx_server_new(method);
+    if (!the_ctx)
+        return NULL;
+
+    for (i = 0; i < sizeof(tls_server_ctx) / sizeof(tls_server_ctx[0]); i++)
+        if (!tls_server_ctx[i].ctx) {
+            _sslctx_up_ref(the_ctx);
+            tls_server_ctx[i].method = method;
+            tls_server_ctx[i].ctx = the_ctx;
+            break;
+        }
+    return the_ctx;
+}
+
 int
 netsnmp_tlsbase_config(struct netsnmp_transport_s *t, const char *token, const char *value) {
     _netsnmpTLSBaseData *tlsdata;
@@ -845,6 +1280,7 @@ static int have_done_bootstrap = 0;
 static int
 tls_bootstrap(int majorid, int minorid, void *serverarg, void *clientarg) {
     char indexname[] = "_netsnmp_verify_info";
+    char tlsdataname[] = "_netsnmpTLSBaseData";
 
     /* don't do this more than once */
     if (have_done_bootstrap)
@@ -855,6 +1291,8 @@ tls_bootstrap(int majorid, int minorid, void *serverarg, void *clientarg) {
 
     openssl_local_index =
         SSL_get_ex_new_index(0, indexname, NULL, NULL, NULL);
+    openssl_tlsdata_index =
+        SSL_get_ex_new_index(0, tlsdataname, NULL, NULL, NULL);
 
     return 0;
 }
@@ -921,6 +1359,11 @@ netsnmp_tlsbase_ctor(void) {
                                NETSNMP_DS_LIBRARY_ID,
                                NETSNMP_DS_LIB_TLS_MAX_VERSION);
 
+    /* Should sessions be resumed */
+    netsnmp_ds_register_config(ASN_BOOLEAN, "snmp", "tlsDisableResumption",
+                               NETSNMP_DS_LIBRARY_ID,
+                               NETSNMP_DS_LIB_TLS_DISABLE_RESUMPTION);
+
     /*
      * for the client
      */
@@ -952,7 +1395,11 @@ netsnmp_tlsbase_ctor(void) {
     snmp_register_callback(SNMP_CALLBACK_LIBRARY,
 			   SNMP_CALLBACK_POST_PREMIB_READ_CONFIG,
 			   tls_bootstrap, NULL);
-
+    snmp_register_callback(SNMP_CALLBACK_LIBRARY,
+                           SNMP_CALLBACK_POST_READ_CONFIG,
+                           _tlsbase_flush_caches, NULL);
+    snmp_register_callback(SNMP_CALLBACK_LIBRARY, SNMP_CALLBACK_SHUTDOWN,
+                           _tlsbase_flush_caches, NULL);
 }
 
 _netsnmpTLSBaseData *
@@ -1006,6 +1453,7 @@ void netsnmp_tlsbase_free_tlsdata(_netsnmpTLSBaseData *tlsbase) {
     SNMP_FREE(tlsbase->their_fingerprint);
     SNMP_FREE(tlsbase->their_hostname);
     SNMP_FREE(tlsbase->trust_cert);
+    SNMP_FREE(tlsbase->session_key);
 
     /* free the base itself */
     SNMP_FREE(tlsbase);
@@ -163,6 +163,9 @@ netsnmp_tlstcp_copy(const netsnmp_transport *oldt, netsnmp_transport *newt)
     if (oldtlsdata->addr)
         newtlsdata->addr = netsnmp_memdup(oldtlsdata->addr,
                                           sizeof(*oldtlsdata->addr));
+    if (oldtlsdata->session_key)
+        newtlsdata->session_key = netsnmp_memdup(oldtlsdata->session_key,
+                                                 oldtlsdata->session_key_len);
 
     return 0;
 }
@@ -773,6 +776,8 @@ netsnmp_tlstcp_open_client(netsnmp_transport *t)
     /* Bind the SSL layer to the BIO */
     SSL_set_bio(ssl, bio, bio);
     SSL_set_mode(ssl, SSL_MODE_AUTO_RETRY);
+    netsnmp_tlsbase_resume_session(ssl, tlsdata, tlsdata->addr_string,
+                                   strlen(tlsdata->addr_string));
 
     verify_info = SNMP_MALLOC_TYPEDEF(_netsnmp_verify_info);
     if (NULL == verify_info) {
@@ -249,14 +249,177 @@ struct com2SecEntry_s {
     const char *secName;
     const char *contextName;
     struct com2SecEntry_s *next;
+    struct com2SecEntry_s *next_same;   /* same community, see below */
     in_addr_t   network;
     in_addr_t   mask;
     int         negate;
+    int         order;
     const char  community[1];
 };
 
 static com2SecEntry   *com2SecList = NULL, *com2SecListLast = NULL;
 
+/*
+ * Index of com2SecList, rebuilt on the first lookup after the list
+ * changed.  A hash on the community leads to the entries for that
+ * community and to a prefix trie over their source networks.  Of all the
+ * entries whose network contains the source address, the one that comes
+ * first in com2SecList wins, as it did when the list was walked.  Entries
+ * with a mask that is not a prefix length cannot go in the trie; the
+ * entries of a community that has any are walked instead.
+ */
+
+typedef struct com2SecIndex_s {
+    struct com2SecIndex_s *next;
+    const char     *community;
+    size_t          community_len;
+    com2SecEntry   *first, *last;
+    netsnmp_prefix_trie *trie;
+} com2SecIndex;
+
+static com2SecIndex  **com2SecIndexTable = NULL;
+static unsigned int    com2SecIndexSize = 0;
+static int             com2SecIndexStale = 1;
+
+static unsigned int
+_com2sec_hash(const char *community, size_t len)
+{
+    unsigned int    h = 2166136261U;
+
+    while (len--)
+        h = (h ^ (u_char) *community++) * 16777619U;
+    return h & (com2SecIndexSize - 1);
+}
+
+static void
+_com2sec_index_free(void)
+{
+    com2SecIndex   *idx;
+    unsigned int    i;
+
+    for (i = 0; i < com2SecIndexSize; i++) {
+        while ((idx = com2SecIndexTable[i])) {
+            com2SecIndexTable[i] = idx->next;
+            netsnmp_prefix_trie_free(idx->trie, NULL);
+            free(idx);
+        }
+    }
+    SNMP_FREE(com2SecIndexTable);
+    com2SecIndexSize = 0;
+    com2SecIndexStale = 1;
+}
+
+static com2SecIndex *
+_com2sec_index_find(const char *community, size_t len)
+{
+    com2SecIndex   *idx;
+
+    for (idx = com2SecIndexTable[_com2sec_hash(community, len)]; idx;
+         idx = idx->next)
+        if (idx->community_len == len &&
+            memcmp(idx->community, community, len) == 0)
+            return idx;
+    return NULL;
+}
+
+/* the prefix length of mask, or -1 if it isn't one */
+static int
+_com2sec_mask_bits(in_addr_t mask)
+{
+    uint32_t        m = ntohl(mask);
+    int             bits = 0;
+
+    while (bits < 32 && (m & (0x80000000U >> bits)))
+        bits++;
+    return (bits == 32 || !(m << bits)) ? bits : -1;
+}
+
+static int
+_com2sec_index_build(void)
+{
+    com2SecEntry   *c;
+    com2SecIndex   *idx;
+    unsigned int    n = 0, h;
+    int             bits;
+
+    _com2sec_index_free();
+    for (c = com2SecList; c; c = c->next)
+        n++;
+    for (com2SecIndexSize = 16; com2SecIndexSize < n; com2SecIndexSize <<= 1)
+        ;
+    com2SecIndexTable = calloc(com2SecIndexSize, sizeof(com2SecIndex *));
+    if (!com2SecIndexTable) {
+        com2SecIndexSize = 0;
+        return -1;
+    }
+
+    for (c = com2SecList, n = 0; c; c = c->next) {
+        size_t          len = strlen(c->community);
+
+        c->order = n++;
+        c->next_same = NULL;
+        idx = _com2sec_index_find(c->community, len);
+        if (!idx) {
+            idx = SNMP_MALLOC_TYPEDEF(com2SecIndex);
+            if (!idx) {
+                _com2sec_index_free();
+                return -1;
+            }
+            idx->community = c->community;
+            idx->community_len = len;
+            idx->trie = netsnmp_prefix_trie_create();
+            h = _com2sec_hash(c->community, len);
+            idx->next = com2SecIndexTable[h];
+            com2SecIndexTable[h] = idx;
+            idx->first = c;
+        } else
+            idx->last->next_same = c;
+        idx->last = c;
+
+        if (!idx->trie)
+            continue;
+        bits = _com2sec_mask_bits(c->mask);
+        if (bits < 0 ||
+            netsnmp_prefix_trie_insert(idx->trie, (u_char *) &c->network,
+                                       bits, c) < 0) {
+            netsnmp_prefix_trie_free(idx->trie, NULL);
+            idx->trie = NULL;
+        }
+    }
+    DEBUGMSGTL(("netsnmp_udp_getSecName", "indexed %u com2sec entries\n",
+                n));
+    com2SecIndexStale = 0;
+    return 0;
+}
+
+static const com2SecEntry *
+_com2sec_index_lookup(const char *community, size_t community_len,
+                      in_addr_t addr)
+{
+    const com2SecIndex *idx;
+    const com2SecEntry *c, *best = NULL;
+    void           *matches[33];
+    int             i, n;
+
+    idx = _com2sec_index_find(community, community_len);
+    if (!idx)
+        return NULL;
+    if (!idx->trie) {
+        for (c = idx->first; c; c = c->next_same)
+            if ((addr & c->mask) == c->network)
+                return c;
+        return NULL;
+    }
+    n = netsnmp_prefix_trie_matches(idx->trie, (u_char *) &addr, 32,
+                                    matches, 33);
+    for (i = 0; i < n; i++) {
+        c = matches[i];
+        if (!best || c->order < best->order)
+            best = c;
+    }
+    return best;
+}
+
 int
 netsnmp_udp_com2SecEntry_create(com2SecEntry **entryp, const char *community,
                     const char *secName, const char *contextName,
@@ -331,6 +494,7 @@ netsnmp_udp_com2SecEntry_create(com2SecEntry **entryp, const char *community,
     e->mask = mask->s_addr;
     e->negate = negate;
     e->next = NULL;
+    com2SecIndexStale = 1;
 
     if (com2SecListLast != NULL) {
         com2SecListLast->next = e;
@@ -536,6 +700,7 @@ netsnmp_udp_com2SecList_remove(com2SecEntry *e)
 
     if (e == com2SecListLast)
         com2SecListLast = p;
+    com2SecIndexStale = 1;
 
     return 0;
 }
@@ -550,6 +715,7 @@ netsnmp_udp_com2SecList_free(void)
         netsnmp_udp_com2Sec_free(tmp);
     }
     com2SecList = com2SecListLast = NULL;
+    _com2sec_index_free();
 }
 #endif /* support for community based SNMP */
 
@@ -624,35 +790,39 @@ netsnmp_udp_getSecName(void *opaque, int olength,
 		    (unsigned long)(from->sin_addr.s_addr)));
     }
 
-    for (c = com2SecList; c != NULL; c = c->next) {
-        {
-            char buf1[INET_ADDRSTRLEN];
-            char buf2[INET_ADDRSTRLEN];
-            DEBUGMSGTL(("netsnmp_udp_getSecName","compare <\"%s\", %s/%s>",
-                        c->community,
-                        inet_ntop(AF_INET, &c->network, buf1, sizeof(buf1)),
-                        inet_ntop(AF_INET, &c->mask, buf2, sizeof(buf2))));
-        }
-        if ((community_len == strlen(c->community)) &&
-	    (memcmp(community, c->community, community_len) == 0) &&
-            ((from->sin_addr.s_addr & c->mask) == c->network)) {
-            DEBUGMSG(("netsnmp_udp_getSecName", "... SUCCESS\n"));
-            if (c->negate) {
-                /*
-                 * If we matched a negative entry, then we are done - claim that we
-                 * matched nothing.
-                 */
-                DEBUGMSG(("netsnmp_udp_getSecName", "... <negative entry>\n"));
+    if (com2SecIndexStale)
+        _com2sec_index_build();
+    if (!com2SecIndexStale) {
+        c = _com2sec_index_lookup(community, community_len,
+                                  from->sin_addr.s_addr);
+    } else {
+        /* couldn't index the list, walk it */
+        for (c = com2SecList; c != NULL; c = c->next) {
+            if ((community_len == strlen(c->community)) &&
+                (memcmp(community, c->community, community_len) == 0) &&
+                ((from->sin_addr.s_addr & c->mask) == c->network))
                 break;
-            }
-            if (secName != NULL) {
-                *secName = c->secName;
-                *contextName = c->contextName;
-            }
-            break;
         }
-        DEBUGMSG(("netsnmp_udp_getSecName", "... nope\n"));
     }
+    if (c) {
+        char buf1[INET_ADDRSTRLEN];
+        char buf2[INET_ADDRSTRLEN];
+        DEBUGMSGTL(("netsnmp_udp_getSecName","matched <\"%s\", %s/%s>\n",
+                    c->community,
+                    inet_ntop(AF_INET, &c->network, buf1, sizeof(buf1)),
+                    inet_ntop(AF_INET, &c->mask, buf2, sizeof(buf2))));
+        if (c->negate) {
+            /*
+             * If we matched a negative entry, then we are done - claim that we
+             * matched nothing.
+             */
+            DEBUGMSGTL(("netsnmp_udp_getSecName", "... <negative entry>\n"));
+        } else if (secName != NULL) {
+            *secName = c->secName;
+            *contextName = c->contextName;
+        }
+    } else
+        DEBUGMSGTL(("netsnmp_udp_getSecName", "... no match\n"));
     if (ztcommunity != NULL) {
         free(ztcommunity);
     }
@@ -736,14 +736,181 @@ typedef struct com2Sec6Entry_s {
     const char     *secName;
     const char     *contextName;
     struct com2Sec6Entry_s *next;
+    struct com2Sec6Entry_s *next_same;  /* same community, see below */
     struct in6_addr network;
     struct in6_addr mask;
     int             negate;
+    int             order;
     const char      community[1];
 } com2Sec6Entry;
 
 static com2Sec6Entry  *com2Sec6List = NULL, *com2Sec6ListLast = NULL;
 
+/*
+ * Index of com2Sec6List, rebuilt on the first lookup after the list
+ * changed; see the com2sec index in snmpUDPDomain.c.  The first matching
+ * entry in the list wins.
+ */
+
+typedef struct com2Sec6Index_s {
+    struct com2Sec6Index_s *next;
+    const char     *community;
+    size_t          community_len;
+    com2Sec6Entry  *first, *last;
+    netsnmp_prefix_trie *trie;
+} com2Sec6Index;
+
+static com2Sec6Index **com2Sec6IndexTable = NULL;
+static unsigned int    com2Sec6IndexSize = 0;
+static int             com2Sec6IndexStale = 1;
+
+static unsigned int
+_com2sec6_hash(const char *community, size_t len)
+{
+    unsigned int    h = 2166136261U;
+
+    while (len--)
+        h = (h ^ (u_char) *community++) * 16777619U;
+    return h & (com2Sec6IndexSize - 1);
+}
+
+static void
+_com2sec6_index_free(void)
+{
+    com2Sec6Index  *idx;
+    unsigned int    i;
+
+    for (i = 0; i < com2Sec6IndexSize; i++) {
+        while ((idx = com2Sec6IndexTable[i])) {
+            com2Sec6IndexTable[i] = idx->next;
+            netsnmp_prefix_trie_free(idx->trie, NULL);
+            free(idx);
+        }
+    }
+    SNMP_FREE(com2Sec6IndexTable);
+    com2Sec6IndexSize = 0;
+    com2Sec6IndexStale = 1;
+}
+
+static com2Sec6Index *
+_com2sec6_index_find(const char *community, size_t len)
+{
+    com2Sec6Index  *idx;
+
+    for (idx = com2Sec6IndexTable[_com2sec6_hash(community, len)]; idx;
+         idx = idx->next)
+        if (idx->community_len == len &&
+            memcmp(idx->community, community, len) == 0)
+            return idx;
+    return NULL;
+}
+
+/* the prefix length of mask, or -1 if it isn't one */
+static int
+_com2sec6_mask_bits(const struct in6_addr *mask)
+{
+    int             bits = 0, i;
+
+    while (bits < 128 && (mask->s6_addr[bits / 8] & (0x80 >> (bits % 8))))
+        bits++;
+    for (i = bits; i < 128; i++)
+        if (mask->s6_addr[i / 8] & (0x80 >> (i % 8)))
+            return -1;
+    return bits;
+}
+
+static int
+_com2sec6_index_build(void)
+{
+    com2Sec6Entry  *c;
+    com2Sec6Index  *idx;
+    unsigned int    n = 0, h;
+    int             bits;
+
+    _com2sec6_index_free();
+    for (c = com2Sec6List; c; c = c->next)
+        n++;
+    for (com2Sec6IndexSize = 16; com2Sec6IndexSize < n;
+         com2Sec6IndexSize <<= 1)
+        ;
+    com2Sec6IndexTable = calloc(com2Sec6IndexSize, sizeof(com2Sec6Index *));
+    if (!com2Sec6IndexTable) {
+        com2Sec6IndexSize = 0;
+        return -1;
+    }
+
+    for (c = com2Sec6List, n = 0; c; c = c->next) {
+        size_t          len = strlen(c->community);
+
+        c->order = n++;
+        c->next_same = NULL;
+        idx = _com2sec6_index_find(c->community, len);
+        if (!idx) {
+            idx = SNMP_MALLOC_TYPEDEF(com2Sec6Index);
+            if (!idx) {
+                _com2sec6_index_free();
+                return -1;
+            }
+            idx->community = c->community;
+            idx->community_len = len;
+            idx->trie = netsnmp_prefix_trie_create();
+            h = _com2sec6_hash(c->community, len);
+            idx->next = com2Sec6IndexTable[h];
+            com2Sec6IndexTable[h] = idx;
+            idx->first = c;
+        } else
+            idx->last->next_same = c;
+        idx->last = c;
+
+        if (!idx->trie)
+            continue;
+        bits = _com2sec6_mask_bits(&c->mask);
+        if (bits < 0 ||
+            netsnmp_prefix_trie_insert(idx->trie, c->network.s6_addr, bits,
+                                       c) < 0) {
+            netsnmp_prefix_trie_free(idx->trie, NULL);
+            idx->trie = NULL;
+        }
+    }
+    DEBUGMSGTL(("netsnmp_udp6_getSecName", "indexed %u com2sec6 entries\n",
+                n));
+    com2Sec6IndexStale = 0;
+    return 0;
+}
+
+static const com2Sec6Entry *
+_com2sec6_index_lookup(const char *community, size_t community_len,
+                       const struct in6_addr *addr)
+{
+    const com2Sec6Index *idx;
+    const com2Sec6Entry *c, *best = NULL;
+    void           *matches[129];
+    int             i, n;
+
+    idx = _com2sec6_index_find(community, community_len);
+    if (!idx)
+        return NULL;
+    if (!idx->trie) {
+        for (c = idx->first; c; c = c->next_same) {
+            for (i = 0; i < 16; ++i)
+                if ((addr->s6_addr[i] & c->mask.s6_addr[i]) !=
+                    c->network.s6_addr[i])
+                    break;
+            if (i == 16)
+                return c;
+        }
+        return NULL;
+    }
+    n = netsnmp_prefix_trie_matches(idx->trie, addr->s6_addr, 128,
+                                    matches, 129);
+    for (i = 0; i < n; i++) {
+        c = matches[i];
+        if (!best || c->order < best->order)
+            best = c;
+    }
+    return best;
+}
+
 
 NETSNMP_STATIC_INLINE int
 create_com2Sec6Entry(const struct addrinfo* const run,
@@ -1035,9 +1202,11 @@ netsnmp_udp6_parse_security(const char *token, char *param)
                         free(end);
                     }
                 } else if (com2Sec6ListLast != NULL) {
+                    com2Sec6IndexStale = 1;
                     com2Sec6ListLast->next = begin;
                     com2Sec6ListLast = end;
                 } else {
+                    com2Sec6IndexStale = 1;
                     com2Sec6List = begin;
                     com2Sec6ListLast = end;
                 }
@@ -1060,6 +1229,7 @@ netsnmp_udp6_com2Sec6List_free(void)
         free(tmp);
     }
     com2Sec6List = com2Sec6ListLast = NULL;
+    _com2sec6_index_free();
 }
 
 #endif /* support for community based SNMP */
@@ -1126,57 +1296,60 @@ netsnmp_udp6_getSecName(void *opaque, int olength,
         return 1;
     }
 
-    ztcommunity = (char *) malloc(community_len + 1);
-    if (ztcommunity != NULL) {
-        memcpy(ztcommunity, community, community_len);
-        ztcommunity[community_len] = '\0';
-    }
+    DEBUGIF("netsnmp_udp6_getSecName") {
+        ztcommunity = (char *) malloc(community_len + 1);
+        if (ztcommunity != NULL) {
+            memcpy(ztcommunity, community, community_len);
+            ztcommunity[community_len] = '\0';
+        }
 
-    inet_ntop(AF_INET6, &from->sin6_addr, str6, sizeof(str6));
-    DEBUGMSGTL(("netsnmp_udp6_getSecName", "resolve <\"%s\", %s>\n",
-                ztcommunity ? ztcommunity : "<malloc error>", str6));
+        inet_ntop(AF_INET6, &from->sin6_addr, str6, sizeof(str6));
+        DEBUGMSGTL(("netsnmp_udp6_getSecName", "resolve <\"%s\", %s>\n",
+                    ztcommunity ? ztcommunity : "<malloc error>", str6));
+        free(ztcommunity);
+    }
 
-    for (c = com2Sec6List; c != NULL; c = c->next) {
-        {
-            char buf1[INET6_ADDRSTRLEN];
-            char buf2[INET6_ADDRSTRLEN];
-            DEBUGMSGTL(("netsnmp_udp6_getSecName",
-                        "compare <\"%s\", %s/%s>", c->community,
-                        inet_ntop(AF_INET6, &c->network, buf1, sizeof(buf1)),
-                        inet_ntop(AF_INET6, &c->mask, buf2, sizeof(buf2))));
-        }
-        if ((community_len == (int)strlen(c->community)) &&
-            (memcmp(community, c->community, community_len) == 0)) {
-            int i, ok = 1;
-            for (i = 0; ok && i < 16; ++i)
+    if (com2Sec6IndexStale)
+        _com2sec6_index_build();
+    if (!com2Sec6IndexStale) {
+        c = _com2sec6_index_lookup(community, community_len,
+                                   &from->sin6_addr);
+    } else {
+        /* couldn't index the list, walk it */
+        for (c = com2Sec6List; c != NULL; c = c->next) {
+            int i;
+
+            if (community_len != (int)strlen(c->community) ||
+                memcmp(community, c->community, community_len) != 0)
+                continue;
+            for (i = 0; i < 16; ++i)
                 if ((from->sin6_addr.s6_addr[i] & c->mask.s6_addr[i]) !=
                     c->network.s6_addr[i])
-                    ok = 0;
-            if (ok) {
-                DEBUGMSG(("netsnmp_udp6_getSecName", "... SUCCESS\n"));
-                if (c->negate) {
-                   /*
-                    * If we matched a negative entry, then we are done - claim that we
-                    * matched nothing.
-                    */
-                   DEBUGMSG(("netsnmp_udp6_getSecName", "... <negative entry>\n"));
-                   break;
-                }
-                if (secName != NULL) {
-                    *secName = c->secName;
-                    *contextName = c->contextName;
-                }
+                    break;
+            if (i == 16)
                 break;
-            }
-        }
-        else {
-            DEBUGMSG(("netsnmp_udp6_getSecName", "... nope\n"));
         }
     }
+    if (c) {
+        char buf1[INET6_ADDRSTRLEN];
+        char buf2[INET6_ADDRSTRLEN];
+        DEBUGMSGTL(("netsnmp_udp6_getSecName",
+                    "matched <\"%s\", %s/%s>\n", c->community,
+                    inet_ntop(AF_INET6, &c->network, buf1, sizeof(buf1)),
+                    inet_ntop(AF_INET6, &c->mask, buf2, sizeof(buf2))));
+        if (c->negate) {
+            /*
+             * If we matched a negative entry, then we are done - claim that we
+             * matched nothing.
+             */
+            DEBUGMSGTL(("netsnmp_udp6_getSecName", "... <negative entry>\n"));
+        } else if (secName != NULL) {
+            *secName = c->secName;
+            *contextName = c->contextName;
+        }
+    } else
+        DEBUGMSGTL(("netsnmp_udp6_getSecName", "... no match\n"));
 
-    if (ztcommunity != NULL) {
-        free(ztcommunity);
-    }
     return 1;
 }
 #endif /* support for community based SNMP */
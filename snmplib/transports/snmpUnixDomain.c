@@ -46,6 +46,27 @@ netsnmp_feature_child_of(unix_socket_paths, transport_unix_socket_all);
 #define NETSNMP_STREAM_QUEUE_LEN  5
 #endif
 
+/*
+ * Connections to a local peer can be moved onto a pair of shared memory
+ * rings (see netsnmp_unix_ring_offer()).  This needs memfd_create(),
+ * eventfd() and epoll, i.e. Linux.
+ */
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_SYS_EVENTFD_H) && \
+    defined(HAVE_SYS_MMAN_H) && defined(HAVE_MEMFD_CREATE) && \
+    defined(__GNUC__)
+#define NETSNMP_UNIX_RING 1
+#include <stdint.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#if !defined(MFD_ALLOW_SEALING) || !defined(F_GET_SEALS)
+#undef NETSNMP_UNIX_RING    /* the size of the memfd must be sealed */
+#endif
+#endif
+
 #undef SUN_LEN
 /*
  * Evaluate to actual length of the `sockaddr_un' structure.
@@ -117,6 +138,11 @@ netsnmp_unix_get_taddr(netsnmp_transport *t, void **addr, size_t *addr_len)
  * remember where a PDU came from, so that you can send a reply there...
  */
 
+#ifdef NETSNMP_UNIX_RING
+static int _unix_ring_accept(netsnmp_transport *t, const void *buf, int len,
+                             struct msghdr *msg);
+#endif
+
 static int
 netsnmp_unix_recv(netsnmp_transport *t, void *buf, int size,
                   void **opaque, int *olength)
@@ -124,6 +150,14 @@ netsnmp_unix_recv(netsnmp_transport *t, void *buf, int size,
     int rc = -1;
     socklen_t       tolen = sizeof(struct sockaddr_un);
     struct sockaddr *to;
+#ifdef NETSNMP_UNIX_RING
+    struct iovec    iov;
+    struct msghdr   msg;
+    union {
+        struct cmsghdr  cm;
+        char            buf[CMSG_SPACE(3 * sizeof(int))];
+    } cmsg;
+#endif
 
 
     if (t != NULL && t->sock >= 0) {
@@ -142,7 +176,20 @@ netsnmp_unix_recv(netsnmp_transport *t, void *buf, int size,
             return -1;
         };
         while (rc < 0) {
-#ifdef MSG_DONTWAIT
+#ifdef NETSNMP_UNIX_RING
+            /*
+             * Use recvmsg() so that a peer offering a shared memory ring
+             * can pass us its descriptors.
+             */
+            iov.iov_base = buf;
+            iov.iov_len = size;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = &cmsg;
+            msg.msg_controllen = sizeof(cmsg);
+            rc = recvmsg(t->sock, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+#elif defined(MSG_DONTWAIT)
             rc = recvfrom(t->sock, buf, size, MSG_DONTWAIT, NULL, NULL);
 #else
             rc = recvfrom(t->sock, buf, size, 0, NULL, NULL);
@@ -156,6 +203,17 @@ netsnmp_unix_recv(netsnmp_transport *t, void *buf, int size,
             *opaque = (void*)to;
             *olength = sizeof(struct sockaddr_un);
         }
+#ifdef NETSNMP_UNIX_RING
+        if (rc > 0 && msg.msg_controllen > 0) {
+            rc = _unix_ring_accept(t, buf, rc, &msg);
+            if (rc == 0) {
+                free(to);
+                *opaque = NULL;
+                *olength = 0;
+                return rc;
+            }
+        }
+#endif
         DEBUGMSGTL(("netsnmp_unix", "recv fd %d got %d bytes\n", t->sock, rc));
     }
     return rc;
@@ -265,6 +323,572 @@ netsnmp_unix_accept(netsnmp_transport *t)
     }
 }
 
+#ifdef NETSNMP_UNIX_RING
+/*
+ * Shared memory rings for local peers.
+ *
+ * The client creates a memfd holding two single producer / single consumer
+ * byte rings, one per direction, and two eventfds, and passes them over the
+ * connection together with a handshake message.  Once the server has
+ * acknowledged, both sides move all further traffic onto the rings.  The
+ * eventfds tell the consumer that a ring went from empty to non-empty.  The
+ * socket stays open so that either side notices the other going away.
+ *
+ * To keep the session's file descriptor usable with select(), t->sock is
+ * replaced by an epoll descriptor watching the receive eventfd and the
+ * socket.
+ *
+ * The peer can write to all of the shared memory.  The server only maps a
+ * memfd whose size is sealed, so that it cannot be truncated under us, and
+ * either side drops a ring whose head and tail are further apart than its
+ * size and goes back to the socket.
+ */
+
+#define NETSNMP_UNIX_RING_MAGIC     "\0NSRING1"
+#define NETSNMP_UNIX_RING_MIN       (64 * 1024)
+#define NETSNMP_UNIX_RING_MAX       (64 * 1024 * 1024)
+#define NETSNMP_UNIX_RING_HDR       4096
+#define NETSNMP_UNIX_RING_TIMEOUT   1000    /* ms to wait for the ack */
+
+/*
+ * Control block of one direction, in shared memory.  head and tail are
+ * free running byte counters written only by the producer and the
+ * consumer respectively.  waiting is set by a producer that found the
+ * ring full, and cleared by the consumer when it signals it.
+ */
+struct netsnmp_unix_ring_ctl {
+    uint32_t        head __attribute__ ((aligned(64)));
+    uint32_t        tail __attribute__ ((aligned(64)));
+    uint32_t        closed __attribute__ ((aligned(64)));
+    uint32_t        waiting __attribute__ ((aligned(64)));
+};
+
+struct netsnmp_unix_ring_hello {
+    char            magic[8];
+    uint32_t        size;
+};
+
+typedef struct netsnmp_unix_ring_s {
+    struct netsnmp_unix_ring_ctl *tx, *rx;
+    u_char         *tx_data, *rx_data;
+    uint32_t        size;
+    void           *map;
+    size_t          map_len;
+    int             tx_efd;
+    int             rx_efd;
+    int             sock;           /* the connection, t->sock is epoll */
+    struct sockaddr_un local;
+} netsnmp_unix_ring;
+
+/*
+ * Replaces t->data while a ring is in use.  data_length is left alone, so
+ * a copy of the transport only gets the address part.
+ */
+typedef struct netsnmp_unix_ring_data_s {
+    union {
+        sockaddr_un_pair pair;
+        struct sockaddr_un addr;
+    } u;
+    netsnmp_unix_ring *ring;
+} netsnmp_unix_ring_data;
+
+static netsnmp_unix_ring *
+_unix_ring(netsnmp_transport *t)
+{
+    return t && t->data ? ((netsnmp_unix_ring_data *) t->data)->ring : NULL;
+}
+
+static size_t
+_unix_ring_map_len(uint32_t size)
+{
+    return NETSNMP_UNIX_RING_HDR + 2 * (size_t) size;
+}
+
+static void
+_unix_ring_signal(int efd)
+{
+    uint64_t        one = 1;
+
+    if (write(efd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        DEBUGMSGTL(("netsnmp_unix", "ring signal fd %d err %d\n", efd,
+                    errno));
+}
+
+static void     _unix_ring_free(netsnmp_unix_ring *r);
+
+/*
+ * Gives up on the ring of transport t, which the peer has corrupted, and
+ * moves the connection back onto the socket.  The peer is told that the
+ * ring is closed; whatever was on it is lost.
+ */
+static void
+_unix_ring_drop(netsnmp_transport *t)
+{
+    netsnmp_unix_ring_data *rd = (netsnmp_unix_ring_data *) t->data;
+    netsnmp_unix_ring *r = rd->ring;
+
+    snmp_log(LOG_WARNING, "unix: bad ring on fd %d, using the socket\n",
+             t->sock);
+    __atomic_store_n(&r->tx->closed, 1, __ATOMIC_SEQ_CST);
+    _unix_ring_signal(r->tx_efd);
+    /* the epoll descriptor goes, the session keeps its number */
+    if (dup2(r->sock, t->sock) < 0)
+        DEBUGMSGTL(("netsnmp_unix", "ring drop on fd %d: %s\n", t->sock,
+                    strerror(errno)));
+    _unix_ring_free(r);
+    rd->ring = NULL;
+    t->f_recv = netsnmp_unix_recv;
+    t->f_send = netsnmp_unix_send;
+    t->f_sendv = netsnmp_socketbase_sendv;
+    t->f_close = netsnmp_unix_close;
+    t->f_copy = NULL;
+}
+
+static int
+_unix_ring_recv(netsnmp_transport *t, void *buf, int size,
+                void **opaque, int *olength)
+{
+    netsnmp_unix_ring *r = _unix_ring(t);
+    uint32_t        head, tail, n, off, first;
+    uint64_t        count;
+    char            c;
+    int             rc;
+
+    *opaque = NULL;
+    *olength = 0;
+    if (r == NULL || size <= 0)
+        return -1;
+
+    if (read(r->rx_efd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+        return -1;
+    tail = r->rx->tail;
+    head = __atomic_load_n(&r->rx->head, __ATOMIC_SEQ_CST);
+    if (head == tail) {
+        /*
+         * Nothing to read.  Data on or the end of the socket means the
+         * peer has gone away (or broke the protocol), so report a close.
+         */
+        rc = recv(r->sock, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (__atomic_load_n(&r->rx->closed, __ATOMIC_SEQ_CST) || rc >= 0 ||
+            (errno != EAGAIN && errno != EINTR)) {
+            DEBUGMSGTL(("netsnmp_unix", "ring fd %d: peer closed\n",
+                        t->sock));
+            return 0;
+        }
+        t->flags |= NETSNMP_TRANSPORT_FLAG_EMPTY_PKT;
+        return 0;
+    }
+
+    n = head - tail;
+    if (n > r->size) {
+        _unix_ring_drop(t);
+        t->flags |= NETSNMP_TRANSPORT_FLAG_EMPTY_PKT;
+        return 0;
+    }
+    /* n <= r->size, so neither copy goes past the end of the ring */
+    if (n > (uint32_t) size)
+        n = size;
+    off = tail & (r->size - 1);
+    first = r->size - off < n ? r->size - off : n;
+    memcpy(buf, r->rx_data + off, first);
+    memcpy((u_char *) buf + first, r->rx_data, n - first);
+    __atomic_store_n(&r->rx->tail, tail + n, __ATOMIC_SEQ_CST);
+
+    /*
+     * Wake up the producer if it is waiting for room.  Our tx eventfd is
+     * its rx one.
+     */
+    if (__atomic_load_n(&r->rx->waiting, __ATOMIC_SEQ_CST) &&
+        __atomic_exchange_n(&r->rx->waiting, 0, __ATOMIC_SEQ_CST))
+        _unix_ring_signal(r->tx_efd);
+
+    /*
+     * The producer only signals when it finds the ring empty, so make sure
+     * we are woken up again for anything left over or added meanwhile.
+     */
+    if (__atomic_load_n(&r->rx->head, __ATOMIC_SEQ_CST) != tail + n)
+        _unix_ring_signal(r->rx_efd);
+
+    *opaque = netsnmp_memdup(&r->local, sizeof(r->local));
+    if (*opaque)
+        *olength = sizeof(r->local);
+    DEBUGMSGTL(("netsnmp_unix", "ring fd %d got %u bytes\n", t->sock, n));
+    return n;
+}
+
+static int
+_unix_ring_send(netsnmp_transport *t, const void *buf, int size,
+                void **opaque, int *olength)
+{
+    netsnmp_unix_ring *r = _unix_ring(t);
+    const u_char   *p = (const u_char *) buf;
+    uint32_t        head, tail, n, off, first, left;
+    uint64_t        count;
+    struct pollfd   pfd[2];
+    int             rc = size, woken = 0;
+
+    if (r == NULL || size < 0)
+        return -1;
+
+    DEBUGMSGTL(("netsnmp_unix", "ring send %d bytes on fd %d\n", size,
+                t->sock));
+    for (left = size; left > 0; p += n, left -= n) {
+        if (__atomic_load_n(&r->rx->closed, __ATOMIC_SEQ_CST)) {
+            errno = EPIPE;
+            rc = -1;
+            break;
+        }
+        head = r->tx->head;
+        tail = __atomic_load_n(&r->tx->tail, __ATOMIC_SEQ_CST);
+        if (head - tail > r->size) {
+            _unix_ring_drop(t);
+            return netsnmp_unix_send(t, p, left, opaque, olength) ==
+                (int) left ? size : -1;
+        }
+        /* as for receiving, n <= r->size */
+        n = r->size - (head - tail);
+        if (n == 0) {
+            /*
+             * Full: sleep on our eventfd, as a blocking socket would,
+             * until the consumer finds us waiting and signals it after
+             * making room, but give up if the peer goes away.  The
+             * flag is set before looking at tail again, so either we
+             * see the room or the consumer sees the flag.
+             */
+            __atomic_store_n(&r->tx->waiting, 1, __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&r->tx->tail, __ATOMIC_SEQ_CST) != tail) {
+                __atomic_store_n(&r->tx->waiting, 0, __ATOMIC_SEQ_CST);
+                continue;
+            }
+            pfd[0].fd = r->rx_efd;
+            pfd[0].events = POLLIN;
+            pfd[0].revents = 0;
+            pfd[1].fd = r->sock;
+            pfd[1].events = POLLRDHUP;
+            pfd[1].revents = 0;
+            if (poll(pfd, 2, -1) < 0 && errno != EINTR) {
+                rc = -1;
+                break;
+            }
+            if (pfd[1].revents & (POLLRDHUP | POLLHUP | POLLERR)) {
+                errno = EPIPE;
+                rc = -1;
+                break;
+            }
+            if (pfd[0].revents & POLLIN) {
+                if (read(r->rx_efd, &count, sizeof(count)) < 0 &&
+                    errno != EAGAIN) {
+                    rc = -1;
+                    break;
+                }
+                woken = 1;
+            }
+            continue;
+        }
+        if (n > left)
+            n = left;
+        off = head & (r->size - 1);
+        first = r->size - off < n ? r->size - off : n;
+        memcpy(r->tx_data + off, p, first);
+        memcpy(r->tx_data, p + first, n - first);
+        __atomic_store_n(&r->tx->head, head + n, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&r->tx->tail, __ATOMIC_SEQ_CST) == head)
+            _unix_ring_signal(r->tx_efd);
+    }
+    /*
+     * The eventfd we slept on also says that there is something to
+     * receive, so pass that on to whoever waits for it.
+     */
+    if (woken)
+        _unix_ring_signal(r->rx_efd);
+    return rc;
+}
+
+static void
+_unix_ring_free(netsnmp_unix_ring *r)
+{
+    if (r->map)
+        munmap(r->map, r->map_len);
+    if (r->tx_efd >= 0)
+        close(r->tx_efd);
+    if (r->rx_efd >= 0)
+        close(r->rx_efd);
+    if (r->sock >= 0)
+        close(r->sock);
+    free(r);
+}
+
+static int
+_unix_ring_close(netsnmp_transport *t)
+{
+    netsnmp_unix_ring *r = _unix_ring(t);
+
+    if (r != NULL) {
+        __atomic_store_n(&r->tx->closed, 1, __ATOMIC_SEQ_CST);
+        _unix_ring_signal(r->tx_efd);
+        _unix_ring_free(r);
+        ((netsnmp_unix_ring_data *) t->data)->ring = NULL;
+    }
+    return netsnmp_unix_close(t);
+}
+
+static int
+_unix_ring_copy(const netsnmp_transport *t, netsnmp_transport *n)
+{
+    /* the copy only has the address, not the ring */
+    n->f_recv = netsnmp_unix_recv;
+    n->f_send = netsnmp_unix_send;
+    n->f_sendv = netsnmp_socketbase_sendv;
+    n->f_close = netsnmp_unix_close;
+    n->f_copy = NULL;
+    return 0;
+}
+
+/*
+ * Moves transport t onto the ring in map.  Takes over map and the eventfds,
+ * also on failure.
+ *
+ * @return 0 on success, -1 on failure (t is unchanged)
+ */
+static int
+_unix_ring_install(netsnmp_transport *t, void *map, uint32_t size,
+                   int rx_efd, int tx_efd, int server)
+{
+    struct netsnmp_unix_ring_ctl *ctl = (struct netsnmp_unix_ring_ctl *) map;
+    u_char         *data = (u_char *) map + NETSNMP_UNIX_RING_HDR;
+    netsnmp_unix_ring *r;
+    netsnmp_unix_ring_data *rd = NULL;
+    struct epoll_event ev;
+    socklen_t       len = sizeof(struct sockaddr_un);
+    int             epfd = -1;
+
+    r = SNMP_MALLOC_TYPEDEF(netsnmp_unix_ring);
+    if (r == NULL) {
+        munmap(map, _unix_ring_map_len(size));
+        close(rx_efd);
+        close(tx_efd);
+        return -1;
+    }
+    r->map = map;
+    r->map_len = _unix_ring_map_len(size);
+    r->size = size;
+    r->rx_efd = rx_efd;
+    r->tx_efd = tx_efd;
+    /* the client sends on direction 0, the server on direction 1 */
+    r->tx = &ctl[server ? 1 : 0];
+    r->rx = &ctl[server ? 0 : 1];
+    r->tx_data = data + (server ? size : 0);
+    r->rx_data = data + (server ? 0 : size);
+    r->sock = fcntl(t->sock, F_DUPFD_CLOEXEC, 0);
+    if (r->sock < 0 ||
+        getsockname(r->sock, (struct sockaddr *) &r->local, &len) != 0)
+        goto fail;
+
+    rd = SNMP_MALLOC_TYPEDEF(netsnmp_unix_ring_data);
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (rd == NULL || epfd < 0)
+        goto fail;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = rx_efd;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, rx_efd, &ev) != 0)
+        goto fail;
+    ev.data.fd = r->sock;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, r->sock, &ev) != 0)
+        goto fail;
+
+    /* keep the descriptor number the session knows */
+    if (dup2(epfd, t->sock) < 0)
+        goto fail;
+    close(epfd);
+
+    if (t->data != NULL) {
+        memcpy(&rd->u, t->data, SNMP_MIN((size_t) t->data_length,
+                                         sizeof(rd->u)));
+        free(t->data);
+    }
+    rd->ring = r;
+    t->data = rd;
+    t->f_recv = _unix_ring_recv;
+    t->f_send = _unix_ring_send;
+    t->f_sendv = NULL;
+    t->f_close = _unix_ring_close;
+    t->f_copy = _unix_ring_copy;
+    DEBUGMSGTL(("netsnmp_unix", "fd %d moved onto a %u byte ring (%s)\n",
+                t->sock, size, server ? "server" : "client"));
+    return 0;
+
+  fail:
+    DEBUGMSGTL(("netsnmp_unix", "ring setup on fd %d failed: %s\n",
+                t->sock, strerror(errno)));
+    if (epfd >= 0)
+        close(epfd);
+    free(rd);
+    _unix_ring_free(r);
+    return -1;
+}
+
+/*
+ * Called by netsnmp_unix_recv() when descriptors came in.  A valid
+ * handshake on an accepted connection moves it onto the offered ring.
+ *
+ * @return 0 if the data was a handshake (answered and consumed), else len
+ */
+static int
+_unix_ring_accept(netsnmp_transport *t, const void *buf, int len,
+                  struct msghdr *msg)
+{
+    struct netsnmp_unix_ring_hello hello;
+    struct cmsghdr *cm;
+    struct stat     st;
+    void           *map = MAP_FAILED;
+    int             fds[3], nfds = 0, fd, i, n, seals, ok = 0;
+    char            ack;
+
+    for (cm = CMSG_FIRSTHDR(msg); cm; cm = CMSG_NXTHDR(msg, cm)) {
+        if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS)
+            continue;
+        n = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (i = 0; i < n; i++) {
+            memcpy(&fd, CMSG_DATA(cm) + i * sizeof(int), sizeof(int));
+            if (nfds < 3)
+                fds[nfds++] = fd;
+            else
+                close(fd);
+        }
+    }
+
+    if (len != sizeof(hello) ||
+        memcmp(buf, NETSNMP_UNIX_RING_MAGIC, sizeof(hello.magic)) != 0 ||
+        (t->flags & NETSNMP_TRANSPORT_FLAG_LISTEN) ||
+        t->f_recv != netsnmp_unix_recv) {
+        for (i = 0; i < nfds; i++)
+            close(fds[i]);
+        return len;
+    }
+
+    memcpy(&hello, buf, sizeof(hello));
+    if (nfds == 3 && hello.size >= NETSNMP_UNIX_RING_MIN &&
+        hello.size <= NETSNMP_UNIX_RING_MAX &&
+        (hello.size & (hello.size - 1)) == 0 &&
+        (seals = fcntl(fds[0], F_GET_SEALS)) >= 0 &&
+        (seals & (F_SEAL_SHRINK | F_SEAL_GROW)) ==
+        (F_SEAL_SHRINK | F_SEAL_GROW) &&
+        fstat(fds[0], &st) == 0 &&
+        st.st_size == (off_t) _unix_ring_map_len(hello.size))
+        map = mmap(NULL, _unix_ring_map_len(hello.size),
+                   PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+    for (i = 0; i < nfds; i++)
+        if (i == 0 || map == MAP_FAILED)
+            close(fds[i]);
+    if (map != MAP_FAILED)
+        ok = _unix_ring_install(t, map, hello.size, fds[1], fds[2], 1) == 0;
+
+    /* on success t->sock is the epoll descriptor now */
+    ack = ok ? 'Y' : 'N';
+    if (send(ok ? _unix_ring(t)->sock : t->sock, &ack, 1, 0) != 1)
+        DEBUGMSGTL(("netsnmp_unix", "ring ack failed: %s\n",
+                    strerror(errno)));
+    t->flags |= NETSNMP_TRANSPORT_FLAG_EMPTY_PKT;
+    return 0;
+}
+#endif /* NETSNMP_UNIX_RING */
+
+/**
+ * Offers the peer of a connected Unix domain stream transport to exchange
+ * all further data over shared memory rings of (at least) size bytes
+ * each, instead of the socket.  Must be called before anything else is
+ * sent.
+ *
+ * @return 0 if the transport now uses the rings, 1 if no offer was made
+ * (not a Unix domain stream client, no support or no resources) and the
+ * transport can be used as before, -1 if the peer did not accept, in which
+ * case the connection is no longer usable and must be re-opened.
+ */
+int
+netsnmp_unix_ring_offer(netsnmp_transport *t, size_t size)
+{
+#ifdef NETSNMP_UNIX_RING
+    struct netsnmp_unix_ring_hello hello;
+    struct iovec    iov;
+    struct msghdr   msg;
+    struct cmsghdr *cm;
+    union {
+        struct cmsghdr  cm;
+        char            buf[CMSG_SPACE(3 * sizeof(int))];
+    } cmsg;
+    struct pollfd   pfd;
+    void           *map = MAP_FAILED;
+    uint32_t        rsize;
+    int             fds[3] = { -1, -1, -1 };
+    int             rc, i;
+    char            ack = 0;
+
+    if (t == NULL || t->sock < 0 || t->f_recv != netsnmp_unix_recv ||
+        !(t->flags & NETSNMP_TRANSPORT_FLAG_STREAM) ||
+        (t->flags & NETSNMP_TRANSPORT_FLAG_LISTEN))
+        return 1;
+
+    for (rsize = NETSNMP_UNIX_RING_MIN;
+         rsize < size && rsize < NETSNMP_UNIX_RING_MAX; rsize <<= 1)
+        ;
+    fds[0] = memfd_create("snmp-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fds[0] < 0 ||
+        ftruncate(fds[0], _unix_ring_map_len(rsize)) != 0 ||
+        fcntl(fds[0], F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW) != 0 ||
+        (map = mmap(NULL, _unix_ring_map_len(rsize), PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fds[0], 0)) == MAP_FAILED ||
+        (fds[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0 ||
+        (fds[2] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+        DEBUGMSGTL(("netsnmp_unix", "no ring: %s\n", strerror(errno)));
+        rc = 1;
+        goto out;
+    }
+
+    memcpy(hello.magic, NETSNMP_UNIX_RING_MAGIC, sizeof(hello.magic));
+    hello.size = rsize;
+    iov.iov_base = &hello;
+    iov.iov_len = sizeof(hello);
+    memset(&msg, 0, sizeof(msg));
+    memset(&cmsg, 0, sizeof(cmsg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = &cmsg;
+    msg.msg_controllen = sizeof(cmsg);
+    cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cm), fds, sizeof(fds));
+
+    rc = -1;
+    if (sendmsg(t->sock, &msg, 0) != sizeof(hello))
+        goto out;
+    pfd.fd = t->sock;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, NETSNMP_UNIX_RING_TIMEOUT) != 1 ||
+        recv(t->sock, &ack, 1, 0) != 1 || ack != 'Y') {
+        DEBUGMSGTL(("netsnmp_unix", "ring offer on fd %d refused\n",
+                    t->sock));
+        goto out;
+    }
+
+    close(fds[0]);
+    rc = _unix_ring_install(t, map, rsize, fds[2], fds[1], 0);
+    return rc;
+
+  out:
+    for (i = 0; i < 3; i++)
+        if (fds[i] >= 0)
+            close(fds[i]);
+    if (map != MAP_FAILED)
+        munmap(map, _unix_ring_map_len(rsize));
+    return rc;
+#else
+    return 1;
+#endif /* NETSNMP_UNIX_RING */
+}
+
 static int create_path = 0;
 static mode_t create_mode;
 
@@ -459,6 +1083,9 @@ netsnmp_unix_transport(const struct sockaddr_un *addr, int local)
     t->msgMaxSize = SNMP_MAX_PACKET_LEN;
     t->f_recv     = netsnmp_unix_recv;
     t->f_send     = netsnmp_unix_send;
+#ifdef HAVE_SYS_UIO_H
+    t->f_sendv    = netsnmp_socketbase_sendv;
+#endif
     t->f_close    = netsnmp_unix_close;
     t->f_accept   = netsnmp_unix_accept;
     t->f_fmtaddr  = netsnmp_unix_fmtaddr;
@@ -21,6 +21,7 @@
  */
 
 #include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-features.h>
 
 #ifdef HAVE_STDLIB_H
 #include <stdlib.h>
@@ -61,12 +62,42 @@
 #include <net-snmp/library/snmp_api.h>
 #include <net-snmp/library/system.h> /* strlcpy() */
 #include <net-snmp/library/tools.h>
+#include <net-snmp/library/oid_stash.h>
 #include <net-snmp/library/vacm.h>
 
+netsnmp_feature_require(oid_stash);
+netsnmp_feature_require(oid_stash_add_data);
+netsnmp_feature_require(oid_stash_no_free);
+
 static struct vacm_viewEntry *viewList = NULL, *viewScanPtr = NULL;
 static struct vacm_accessEntry *accessList = NULL, *accessScanPtr = NULL;
 static struct vacm_groupEntry *groupList = NULL, *groupScanPtr = NULL;
 
+/*
+ * Compiled views: the subtrees of a view without wildcards are kept in an
+ * OID trie, so that a lookup costs one step per sub-identifier instead of
+ * a pass over the whole view list.  Subtrees with wildcards in their mask
+ * are listed in a second trie under the part of the subtree before the
+ * first wildcard, and only those met on the way down are compared.  The
+ * compiled views are built on demand and thrown away whenever the
+ * generation of the VACM tables changes.
+ */
+struct vacm_maskedView {
+    struct vacm_maskedView *next;
+    struct vacm_viewEntry *view;
+};
+
+struct vacm_compiledView_s {
+    struct vacm_compiledView_s *next;
+    char            viewName[VACMSTRINGLEN];
+    netsnmp_oid_stash_node *tree;       /* exact subtrees */
+    netsnmp_oid_stash_node *masked;     /* wildcarded, by prefix */
+    struct vacm_maskedView *wild;       /* wildcarded from the start */
+};
+
+static vacm_compiledView *compiledViews = NULL;
+static u_int    vacmGeneration = 0, compiledGeneration = 0;
+
 /*
  * Macro to extend view masks with 1 bits when shorter than subtree lengths
  * REF: vacmViewTreeFamilyMask [RFC3415], snmpNotifyFilterMask [RFC3413]
@@ -836,6 +867,8 @@ vacm_createGroupEntry(int securityModel, const char *securityName)
     struct vacm_groupEntry *gp, *lg, *og;
     int             cmp, glen;
 
+    vacm_tablesChanged();
+
     glen = (int) strlen(securityName);
     if (glen < 0 || glen > VACM_MAX_STRING)
         return NULL;
@@ -880,6 +913,8 @@ vacm_destroyGroupEntry(int securityModel, const char *securityName)
 {
     struct vacm_groupEntry *vp, *lastvp = NULL;
 
+    vacm_tablesChanged();
+
     if (groupList && groupList->securityModel == securityModel
         && !strcmp(groupList->securityName + 1, securityName)) {
         vp = groupList;
@@ -906,6 +941,8 @@ void
 vacm_destroyAllGroupEntries(void)
 {
     struct vacm_groupEntry *gp;
+
+    vacm_tablesChanged();
     while ((gp = groupList)) {
         groupList = gp->next;
         if (gp->reserved)
@@ -1015,6 +1052,8 @@ vacm_createAccessEntry(const char *groupName,
     struct vacm_accessEntry *vp, *lp, *op = NULL;
     int             cmp, glen, clen;
 
+    vacm_tablesChanged();
+
     glen = (int) strlen(groupName);
     if (glen < 0 || glen > VACM_MAX_STRING)
         return NULL;
@@ -1075,6 +1114,8 @@ vacm_destroyAccessEntry(const char *groupName,
 {
     struct vacm_accessEntry *vp, *lastvp = NULL;
 
+    vacm_tablesChanged();
+
     if (accessList && accessList->securityModel == securityModel
         && accessList->securityLevel == securityLevel
         && !strcmp(accessList->groupName + 1, groupName)
@@ -1104,6 +1145,8 @@ void
 vacm_destroyAllAccessEntries(void)
 {
     struct vacm_accessEntry *ap;
+
+    vacm_tablesChanged();
     while ((ap = accessList)) {
         accessList = ap->next;
         if (ap->reserved)
@@ -1145,6 +1188,255 @@ vacm_is_configured(void)
     return 1;
 }
 
+/*
+ * Records that the group, access or view tables have changed, which
+ * invalidates the compiled views and anything else derived from them.
+ * Code that modifies table entries in place has to call this itself.
+ */
+void
+vacm_tablesChanged(void)
+{
+    vacmGeneration++;
+}
+
+u_int
+vacm_tablesGeneration(void)
+{
+    return vacmGeneration;
+}
+
+static void
+_vacm_free_masked(void *data)
+{
+    struct vacm_maskedView *mv;
+
+    while ((mv = (struct vacm_maskedView *) data)) {
+        data = mv->next;
+        free(mv);
+    }
+}
+
+static void
+_vacm_free_compiled_views(void)
+{
+    vacm_compiledView *cv;
+
+    while ((cv = compiledViews)) {
+        compiledViews = cv->next;
+        netsnmp_oid_stash_free(&cv->tree, netsnmp_oid_stash_no_free);
+        netsnmp_oid_stash_free(&cv->masked, _vacm_free_masked);
+        _vacm_free_masked(cv->wild);
+        free(cv);
+    }
+}
+
+/*
+ * returns the number of sub-identifiers of the subtree of vp before the
+ * first one its mask wildcards
+ */
+static size_t
+_vacm_view_prefix_len(const struct vacm_viewEntry *vp)
+{
+    int             mask = 0x80;
+    unsigned int    oidpos, maskpos = 0;
+
+    for (oidpos = 0; oidpos < vp->viewSubtreeLen - 1; oidpos++) {
+        if (VIEW_MASK(vp, maskpos, mask) == 0)
+            break;
+        if (mask == 1) {
+            mask = 0x80;
+            maskpos++;
+        } else
+            mask >>= 1;
+    }
+    return oidpos;
+}
+
+/*
+ * keeps the better of two matching view entries, as netsnmp_view_get()
+ * does: the longer subtree, or the lexicographically greater one
+ */
+static struct vacm_viewEntry *
+_vacm_view_better(struct vacm_viewEntry *vpret, struct vacm_viewEntry *vp)
+{
+    if (vpret == NULL
+        || vp->viewSubtreeLen > vpret->viewSubtreeLen
+        || (vp->viewSubtreeLen == vpret->viewSubtreeLen
+            && snmp_oid_compare(vp->viewSubtree + 1, vp->viewSubtreeLen - 1,
+                                vpret->viewSubtree + 1,
+                                vpret->viewSubtreeLen - 1) > 0))
+        return vp;
+    return vpret;
+}
+
+/*
+ * returns 1 if name lies within the (masked) subtree of vp
+ */
+static int
+_vacm_view_matches(const struct vacm_viewEntry *vp,
+                   const oid * name, size_t namelen)
+{
+    int             mask = 0x80;
+    unsigned int    oidpos, maskpos = 0;
+
+    if (namelen < vp->viewSubtreeLen - 1)
+        return 0;
+    for (oidpos = 0; oidpos < vp->viewSubtreeLen - 1; oidpos++) {
+        if (VIEW_MASK(vp, maskpos, mask) != 0 &&
+            name[oidpos] != vp->viewSubtree[oidpos + 1])
+            return 0;
+        if (mask == 1) {
+            mask = 0x80;
+            maskpos++;
+        } else
+            mask >>= 1;
+    }
+    return 1;
+}
+
+/*
+ * checks the wildcarded entries in list against name
+ */
+static struct vacm_viewEntry *
+_vacm_masked_get(struct vacm_maskedView *list, struct vacm_viewEntry *vpret,
+                 const oid * name, size_t namelen)
+{
+    for (; list; list = list->next)
+        if (_vacm_view_matches(list->view, name, namelen))
+            vpret = _vacm_view_better(vpret, list->view);
+    return vpret;
+}
+
+/**
+ * Returns the compiled form of a view from the view table, building it
+ * if needed.  The result stays valid until vacm_tablesGeneration()
+ * changes.
+ *
+ * @param viewName the name of the view
+ *
+ * @return the compiled view, or NULL if it could not be built
+ */
+vacm_compiledView *
+vacm_getCompiledView(const char *viewName)
+{
+    vacm_compiledView *cv;
+    struct vacm_viewEntry *vp;
+    struct vacm_maskedView *mv;
+    netsnmp_oid_stash_node *node;
+    char            view[VACMSTRINGLEN];
+    size_t          plen;
+    int             glen, n = 0, nmasked = 0;
+
+    if (compiledGeneration != vacmGeneration) {
+        _vacm_free_compiled_views();
+        compiledGeneration = vacmGeneration;
+    }
+
+    glen = (int) strlen(viewName);
+    if (glen < 0 || glen > VACM_MAX_STRING)
+        return NULL;
+    view[0] = glen;
+    strlcpy(view + 1, viewName, sizeof(view) - 1);
+    for (cv = compiledViews; cv; cv = cv->next)
+        if (!memcmp(view, cv->viewName, glen + 1))
+            return cv;
+
+    cv = calloc(1, sizeof(*cv));
+    if (cv == NULL)
+        return NULL;
+    memcpy(cv->viewName, view, glen + 1);
+    cv->next = compiledViews;
+    compiledViews = cv;
+
+    for (vp = viewList; vp; vp = vp->next) {
+        if (memcmp(view, vp->viewName, glen + 1))
+            continue;
+        n++;
+        plen = vp->viewSubtreeLen > 0 ? _vacm_view_prefix_len(vp) : 0;
+        if (plen > 0 && plen == vp->viewSubtreeLen - 1 &&
+            netsnmp_oid_stash_add_data(&cv->tree, vp->viewSubtree + 1,
+                                       plen, vp) == SNMPERR_SUCCESS)
+            continue;
+
+        /*
+         * wildcarded, or a duplicate of an exact subtree
+         */
+        mv = calloc(1, sizeof(*mv));
+        if (mv == NULL) {
+            compiledViews = cv->next;
+            cv->next = NULL;
+            netsnmp_oid_stash_free(&cv->tree, netsnmp_oid_stash_no_free);
+            netsnmp_oid_stash_free(&cv->masked, _vacm_free_masked);
+            _vacm_free_masked(cv->wild);
+            free(cv);
+            return NULL;
+        }
+        mv->view = vp;
+        nmasked++;
+        node = NULL;
+        if (plen > 0) {
+            node = netsnmp_oid_stash_get_node(cv->masked,
+                                              vp->viewSubtree + 1, plen);
+            if (node == NULL &&
+                netsnmp_oid_stash_add_data(&cv->masked, vp->viewSubtree + 1,
+                                           plen, mv) == SNMPERR_SUCCESS)
+                continue;
+        }
+        if (node) {
+            mv->next = (struct vacm_maskedView *) node->thedata;
+            node->thedata = mv;
+        } else {
+            mv->next = cv->wild;
+            cv->wild = mv;
+        }
+    }
+    DEBUGMSGTL(("vacm:compile", "view %s: %d entries, %d wildcarded\n",
+                viewName, n, nmasked));
+    return cv;
+}
+
+/**
+ * Looks up the view entry that decides whether name is in a compiled
+ * view; the same one netsnmp_view_get() returns in VACM_MODE_FIND.
+ */
+struct vacm_viewEntry *
+vacm_compiledViewGet(vacm_compiledView *cv, const oid * name,
+                     size_t namelen)
+{
+    struct vacm_viewEntry *vpret = NULL;
+    netsnmp_oid_stash_node *node, *child;
+    size_t          i;
+
+    /*
+     * the longest exact subtree containing name
+     */
+    for (node = cv->tree, i = 0; node && i < namelen; i++, node = child) {
+        for (child = node->children[name[i] % node->children_size];
+             child && child->value != name[i]; child = child->next_sibling)
+            ;
+        if (!child)
+            break;
+        if (child->thedata)
+            vpret = (struct vacm_viewEntry *) child->thedata;
+    }
+
+    /*
+     * and the wildcarded ones whose prefix name shares
+     */
+    vpret = _vacm_masked_get(cv->wild, vpret, name, namelen);
+    for (node = cv->masked, i = 0; node && i < namelen; i++, node = child) {
+        for (child = node->children[name[i] % node->children_size];
+             child && child->value != name[i]; child = child->next_sibling)
+            ;
+        if (!child)
+            break;
+        if (child->thedata)
+            vpret = _vacm_masked_get((struct vacm_maskedView *)
+                                     child->thedata, vpret, name, namelen);
+    }
+    return vpret;
+}
+
 /*
  * backwards compatability
  */
@@ -1152,6 +1444,10 @@ struct vacm_viewEntry *
 vacm_getViewEntry(const char *viewName,
                   oid * viewSubtree, size_t viewSubtreeLen, int mode)
 {
+    vacm_compiledView *cv;
+
+    if (mode == VACM_MODE_FIND && (cv = vacm_getCompiledView(viewName)))
+        return vacm_compiledViewGet(cv, viewSubtree, viewSubtreeLen);
     return netsnmp_view_get( viewList, viewName, viewSubtree, viewSubtreeLen,
                              mode);
 }
@@ -1168,6 +1464,7 @@ struct vacm_viewEntry *
 vacm_createViewEntry(const char *viewName,
                      oid * viewSubtree, size_t viewSubtreeLen)
 {
+    vacm_tablesChanged();
     return netsnmp_view_create( &viewList, viewName, viewSubtree,
                                 viewSubtreeLen);
 }
@@ -1176,13 +1473,16 @@ void
 vacm_destroyViewEntry(const char *viewName,
                       oid * viewSubtree, size_t viewSubtreeLen)
 {
+    vacm_tablesChanged();
     netsnmp_view_destroy( &viewList, viewName, viewSubtree, viewSubtreeLen);
 }
 
 void
 vacm_destroyAllViewEntries(void)
 {
+    vacm_tablesChanged();
     netsnmp_view_clear( &viewList );
+    _vacm_free_compiled_views();
 }
 
 /*
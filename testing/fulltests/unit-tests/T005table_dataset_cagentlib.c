@@ -12,8 +12,12 @@ static const oid Oid[] = { 1, 3, 6, 1, 3, 277 };
 netsnmp_table_data_set* tds;
 netsnmp_handler_registration* th;
 netsnmp_table_row* row;
+netsnmp_table_row* clone;
+netsnmp_table_data_set_storage* data;
 int32_t ival;
 int32_t i, j;
+int ok;
+static const char long_str[] = "a value too long to be kept in a cell";
 
 SOCK_STARTUP;
 
@@ -52,6 +56,68 @@ for (i = 1; i <= 2; i++) {
     }
 }
 
+/*
+ * a row with many columns, set in reverse order: once stored in the
+ * table its columns are packed into a single block sorted by column
+ */
+row = netsnmp_create_table_data_row();
+i = 3;
+netsnmp_table_row_add_index(row, ASN_INTEGER, &i, sizeof(i));
+netsnmp_table_row_add_index(row, ASN_INTEGER, &i, sizeof(i));
+for (j = 100; j >= COL3; j--) {
+    ival = j;
+    netsnmp_set_row_column(row, j, ASN_INTEGER, &ival, sizeof(ival));
+}
+netsnmp_table_dataset_add_row(tds, row);
+data = (netsnmp_table_data_set_storage *) row->data;
+OK(data && (data->flags & NETSNMP_TABLE_DATA_SET_BLOCK_HEAD) &&
+   data->block_len == 100 - COL3 + 1 && data->column == COL3,
+   "row packed into a sorted block");
+ok = 1;
+for (j = COL3; j <= 100; j++) {
+    data = netsnmp_table_data_set_find_column(
+        (netsnmp_table_data_set_storage *) row->data, j);
+    if (!data || data->column != j || *(int32_t *) data->data.voidp != j)
+        ok = 0;
+}
+OK(ok, "every column found in the block");
+OK(netsnmp_table_data_set_find_column(
+       (netsnmp_table_data_set_storage *) row->data, 101) == NULL,
+   "missing column not found");
+
+/* values change in place, short ones within the cell */
+OK(netsnmp_set_row_column(row, 101, ASN_OCTET_STR, long_str,
+                          sizeof(long_str) - 1) == SNMPERR_SUCCESS,
+   "column added to a packed row");
+data = netsnmp_table_data_set_find_column(
+    (netsnmp_table_data_set_storage *) row->data, 101);
+OK(data && data->data_len == sizeof(long_str) - 1 &&
+   memcmp(data->data.string, long_str, data->data_len) == 0,
+   "long value stored");
+OK(netsnmp_set_row_column(row, 101, ASN_OCTET_STR, "short", 5)
+   == SNMPERR_SUCCESS && data->data_len == 5 &&
+   memcmp(data->data.string, "short", 5) == 0, "long value replaced");
+data = netsnmp_table_data_set_find_column(
+    (netsnmp_table_data_set_storage *) row->data, 60);
+OK(data && *(int32_t *) data->data.voidp == 60, "column behind an added cell found");
+
+/* a clone is a single block with its own copies of the values */
+clone = netsnmp_table_data_set_clone_row(row);
+data = clone ? (netsnmp_table_data_set_storage *) clone->data : NULL;
+OK(data && data->block_len == 100 - COL3 + 2 &&
+   data[data->block_len - 1].column == 101 &&
+   data[data->block_len - 1].data.string != (u_char *)
+   netsnmp_table_data_set_find_column(
+       (netsnmp_table_data_set_storage *) row->data, 101)->data.string,
+   "clone packed");
+ival = 1000;
+netsnmp_set_row_column(clone, 60, ASN_INTEGER, &ival, sizeof(ival));
+data = netsnmp_table_data_set_find_column(
+    (netsnmp_table_data_set_storage *) row->data, 60);
+OK(*(int32_t *) data->data.voidp == 60,
+   "clone does not share values");
+netsnmp_table_dataset_delete_row(clone);
+
 netsnmp_delete_table_data_set(tds);
 
 snmp_shutdown("snmpd");
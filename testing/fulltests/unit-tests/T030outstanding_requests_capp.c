@@ -0,0 +1,236 @@
+/*
+ * HEADER Testing response matching with many outstanding requests
+ *
+ * A client session keeps NREQ requests outstanding against a responder
+ * session in the same process.  The responder answers them in reverse
+ * order, so that each response matches the newest outstanding request.
+ * A second client checks that unanswered requests time out in order.
+ * The time taken to match the responses is reported as a comment.
+ */
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/library/large_fd_set.h>
+#include <net-snmp/library/testing.h>
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+#ifdef HAVE_NETINET_IN_H
+#include <netinet/in.h>
+#endif
+
+#define NREQ     10000
+#define NTIMEOUT 1000
+#define BATCH    64
+
+static const oid sysUpTime_oid[] = { 1, 3, 6, 1, 2, 1, 1, 3, 0 };
+static u_char   community[] = "public";
+
+static netsnmp_pdu *held[NREQ];
+static int      nheld;
+static int      answer;
+static int      received, mismatched, timed_out, out_of_order;
+static long     last_timeout_reqid;
+
+static int
+responder_cb(int op, netsnmp_session *sess, int reqid, netsnmp_pdu *pdu,
+             void *magic)
+{
+    if (op != NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE ||
+        pdu->command != SNMP_MSG_GET)
+        return 1;
+    if (answer && nheld < NREQ)
+        held[nheld++] = snmp_clone_pdu(pdu);
+    return 1;
+}
+
+static int
+client_cb(int op, netsnmp_session *sess, int reqid, netsnmp_pdu *pdu,
+          void *magic)
+{
+    switch (op) {
+    case NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE:
+        if (pdu->command == SNMP_MSG_RESPONSE && pdu->reqid == reqid)
+            ++received;
+        else
+            ++mismatched;
+        break;
+    case NETSNMP_CALLBACK_OP_TIMED_OUT:
+        if (reqid < last_timeout_reqid)
+            ++out_of_order;
+        last_timeout_reqid = reqid;
+        ++timed_out;
+        break;
+    }
+    return 1;
+}
+
+/* Handle everything that is ready without blocking. */
+static void
+pump(void)
+{
+    netsnmp_large_fd_set fdset;
+    struct timeval  tv;
+    int             numfds, block, count;
+
+    netsnmp_large_fd_set_init(&fdset, FD_SETSIZE);
+    do {
+        numfds = 0;
+        block = 0;
+        tv.tv_sec = 0;
+        tv.tv_usec = 0;
+        NETSNMP_LARGE_FD_ZERO(&fdset);
+        snmp_select_info2(&numfds, &fdset, &tv, &block);
+        tv.tv_sec = 0;
+        tv.tv_usec = 0;
+        count = netsnmp_large_fd_set_select(numfds, &fdset, NULL, NULL, &tv);
+        if (count > 0)
+            snmp_read2(&fdset);
+    } while (count > 0);
+    snmp_timeout();
+    netsnmp_large_fd_set_cleanup(&fdset);
+}
+
+static int
+wait_for(int *counter, int target, int seconds)
+{
+    struct timeval  start, now;
+
+    netsnmp_get_monotonic_clock(&start);
+    while (*counter < target) {
+        pump();
+        netsnmp_get_monotonic_clock(&now);
+        if (now.tv_sec - start.tv_sec > seconds)
+            break;
+    }
+    return *counter >= target;
+}
+
+static int
+send_get(netsnmp_session *ss)
+{
+    netsnmp_pdu    *pdu = snmp_pdu_create(SNMP_MSG_GET);
+
+    snmp_add_null_var(pdu, sysUpTime_oid, OID_LENGTH(sysUpTime_oid));
+    if (snmp_async_send(ss, pdu, client_cb, NULL))
+        return 1;
+    snmp_free_pdu(pdu);
+    return 0;
+}
+
+static double
+elapsed(const struct timeval *start)
+{
+    struct timeval  now;
+
+    netsnmp_get_monotonic_clock(&now);
+    return (now.tv_sec - start->tv_sec) +
+        (now.tv_usec - start->tv_usec) / 1000000.0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    netsnmp_transport *transport;
+    netsnmp_session sess, *responder, *client, *slow;
+    struct sockaddr_in addr;
+    socklen_t       addr_len = sizeof(addr);
+    struct timeval  start;
+    char            peer[64];
+    int             i, sent;
+
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DONT_READ_CONFIGS, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_LOAD, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_SAVE, 1);
+    init_snmp("T030");
+
+    transport = netsnmp_transport_open_server("T030", "udp:127.0.0.1:0");
+    OKF(transport != NULL, ("responder transport opened"));
+    if (!transport)
+        return 1;
+    getsockname(transport->sock, (struct sockaddr *) &addr, &addr_len);
+    snprintf(peer, sizeof(peer), "udp:127.0.0.1:%d", ntohs(addr.sin_port));
+
+    snmp_sess_init(&sess);
+    sess.version = SNMP_VERSION_2c;
+    sess.callback = responder_cb;
+    sess.isAuthoritative = SNMP_SESS_AUTHORITATIVE;
+    responder = snmp_add(&sess, transport, NULL, NULL);
+
+    snmp_sess_init(&sess);
+    sess.version = SNMP_VERSION_2c;
+    sess.peername = peer;
+    sess.community = community;
+    sess.community_len = sizeof(community) - 1;
+    sess.retries = 0;
+    sess.timeout = 60 * 1000000L;
+    client = snmp_open(&sess);
+    sess.timeout = 200 * 1000L;
+    slow = snmp_open(&sess);
+    OKF(responder && client && slow, ("sessions opened"));
+    if (!responder || !client || !slow)
+        return 1;
+
+    /*
+     * Keep NREQ requests outstanding.
+     */
+    answer = 1;
+    for (sent = 0; sent < NREQ; sent++) {
+        if (!send_get(client))
+            break;
+        if (sent % BATCH == 0)
+            pump();
+    }
+    OKF(sent == NREQ, ("%d of %d requests sent", sent, NREQ));
+    OKF(wait_for(&nheld, sent, 30), ("responder holds %d requests", nheld));
+
+    netsnmp_get_monotonic_clock(&start);
+    for (i = nheld - 1; i >= 0; i--) {
+        held[i]->command = SNMP_MSG_RESPONSE;
+        held[i]->errstat = 0;
+        held[i]->errindex = 0;
+        if (!snmp_send(responder, held[i]))
+            snmp_free_pdu(held[i]);
+        held[i] = NULL;
+        if (i % BATCH == 0)
+            pump();
+    }
+    wait_for(&received, nheld, 30);
+    printf("# matched %d responses to %d outstanding requests in %.3f s\n",
+           received, nheld, elapsed(&start));
+    OKF(received == NREQ && mismatched == 0,
+        ("%d responses matched, %d mismatched", received, mismatched));
+
+    /*
+     * Unanswered requests time out, earliest first.
+     */
+    answer = 0;
+    netsnmp_get_monotonic_clock(&start);
+    for (sent = 0; sent < NTIMEOUT; sent++)
+        if (!send_get(slow))
+            break;
+    wait_for(&timed_out, sent, 30);
+    printf("# %d of %d requests timed out in %.3f s\n", timed_out, sent,
+           elapsed(&start));
+    OKF(timed_out == NTIMEOUT && out_of_order == 0,
+        ("%d requests timed out, %d out of order", timed_out, out_of_order));
+
+    snmp_close(slow);
+    snmp_close(client);
+    snmp_close(responder);
+    snmp_shutdown("T030");
+
+    PLAN(__test_counter);
+    return 0;
+}
@@ -0,0 +1,313 @@
+/*
+ * HEADER Testing GETBULK over tdata tables with HANDLER_CAN_GETBULK_NATIVE
+ *
+ * Two identical tdata tables with NROWS rows are registered in an agent
+ * running in this process, one with HANDLER_CAN_GETBULK_NATIVE set and
+ * one without.  Both are walked with GETBULK requests and the results
+ * must be identical.  Column 3 is sparse, and one row is excluded by an
+ * access control callback.  Then rows are removed from both tables, and
+ * the walks must still agree.  The walk times are reported as comments.
+ */
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/agent/net-snmp-agent-includes.h>
+#include <net-snmp/agent/agent_callbacks.h>
+#include <net-snmp/library/testing.h>
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+#ifdef HAVE_NETINET_IN_H
+#include <netinet/in.h>
+#endif
+
+#define NROWS      10000
+#define DENIED_ROW 778
+#define FIRST_GONE 5001
+#define NGONE      10
+#define REPS       50
+#define ROUNDS     5
+#define MAXRESULTS (2 * NROWS)
+
+struct entry {
+    long            index;
+};
+
+struct result {
+    oid             column;
+    oid             index;
+    u_char          type;
+    long            value;
+};
+
+static const oid base_oid[] = { 1, 3, 6, 1, 4, 1, 8072, 9999, 31 };
+static u_char   community[] = "public";
+static char     access_line[] = "rocommunity public 127.0.0.1";
+
+static struct entry entries[NROWS];
+static netsnmp_tdata *tables[2];
+static struct result results[2][MAXRESULTS];
+
+static int
+table_handler(netsnmp_mib_handler *handler,
+              netsnmp_handler_registration *reginfo,
+              netsnmp_agent_request_info *reqinfo,
+              netsnmp_request_info *requests)
+{
+    netsnmp_request_info *request;
+    netsnmp_table_request_info *table_info;
+    struct entry   *entry;
+
+    if (reqinfo->mode != MODE_GET)
+        return SNMP_ERR_NOERROR;
+
+    for (request = requests; request; request = request->next) {
+        if (request->processed)
+            continue;
+        entry = (struct entry *) netsnmp_tdata_extract_entry(request);
+        table_info = netsnmp_extract_table_info(request);
+        if (!entry || !table_info) {
+            netsnmp_set_request_error(reqinfo, request, SNMP_NOSUCHINSTANCE);
+            continue;
+        }
+        switch (table_info->colnum) {
+        case 2:
+            snmp_set_var_typed_integer(request->requestvb, ASN_INTEGER,
+                                       entry->index * 3);
+            break;
+        case 3:
+            if (entry->index % 2)
+                netsnmp_set_request_error(reqinfo, request,
+                                          SNMP_NOSUCHINSTANCE);
+            else
+                snmp_set_var_typed_integer(request->requestvb, ASN_INTEGER,
+                                           entry->index * 7);
+            break;
+        }
+    }
+    return SNMP_ERR_NOERROR;
+}
+
+/* Exclude row DENIED_ROW of both tables from the view. */
+static int
+acm_check(int majorID, int minorID, void *serverarg, void *clientarg)
+{
+    struct view_parameters *view_parms = (struct view_parameters *) serverarg;
+
+    if (view_parms->namelen == OID_LENGTH(base_oid) + 4 &&
+        view_parms->name[view_parms->namelen - 1] == DENIED_ROW &&
+        netsnmp_oid_is_subtree(base_oid, OID_LENGTH(base_oid),
+                               view_parms->name, view_parms->namelen) == 0)
+        view_parms->errorcode = VACM_NOTINVIEW;
+    return SNMP_ERR_NOERROR;
+}
+
+static int
+register_table(const char *name, oid table, int modes)
+{
+    netsnmp_handler_registration *reginfo;
+    netsnmp_table_registration_info *table_info;
+    netsnmp_tdata  *tdata;
+    netsnmp_tdata_row *row;
+    oid             table_oid[OID_LENGTH(base_oid) + 1];
+    int             i;
+
+    memcpy(table_oid, base_oid, sizeof(base_oid));
+    table_oid[OID_LENGTH(base_oid)] = table;
+
+    tdata = netsnmp_tdata_create_table(name, 0);
+    tables[table - 1] = tdata;
+    for (i = 0; i < NROWS; i++) {
+        row = netsnmp_tdata_create_row();
+        row->data = &entries[i];
+        netsnmp_tdata_row_add_index(row, ASN_INTEGER, &entries[i].index,
+                                    sizeof(entries[i].index));
+        netsnmp_tdata_add_row(tdata, row);
+    }
+
+    reginfo = netsnmp_create_handler_registration(name, table_handler,
+                                                  table_oid,
+                                                  OID_LENGTH(table_oid),
+                                                  modes);
+    table_info = SNMP_MALLOC_TYPEDEF(netsnmp_table_registration_info);
+    netsnmp_table_helper_add_indexes(table_info, ASN_INTEGER, 0);
+    table_info->min_column = 2;
+    table_info->max_column = 3;
+    return netsnmp_tdata_register(reginfo, tdata, table_info);
+}
+
+/* Compare the results of both walks; returns the number that differ. */
+static int
+compare(const int *count)
+{
+    int             i, differ = 0;
+
+    for (i = 0; i < count[0] && i < count[1]; i++)
+        if (results[0][i].column != results[1][i].column ||
+            results[0][i].index != results[1][i].index ||
+            results[0][i].type != results[1][i].type ||
+            results[0][i].value != results[1][i].value ||
+            results[0][i].index == DENIED_ROW)
+            ++differ;
+    return differ;
+}
+
+/* Walk one table with GETBULK requests; returns the number of results. */
+static int
+walk(netsnmp_session *ss, oid table, struct result *res)
+{
+    netsnmp_pdu    *pdu, *response;
+    netsnmp_variable_list *vb;
+    oid             root[OID_LENGTH(base_oid) + 1];
+    oid             name[MAX_OID_LEN];
+    size_t          name_len;
+    int             count = 0, done = 0;
+
+    memcpy(root, base_oid, sizeof(base_oid));
+    root[OID_LENGTH(base_oid)] = table;
+    memcpy(name, root, sizeof(root));
+    name_len = OID_LENGTH(root);
+
+    while (!done) {
+        pdu = snmp_pdu_create(SNMP_MSG_GETBULK);
+        pdu->non_repeaters = 0;
+        pdu->max_repetitions = REPS;
+        snmp_add_null_var(pdu, name, name_len);
+        if (snmp_synch_response(ss, pdu, &response) != STAT_SUCCESS ||
+            response->errstat != SNMP_ERR_NOERROR) {
+            if (response)
+                snmp_free_pdu(response);
+            return -1;
+        }
+        for (vb = response->variables; vb; vb = vb->next_variable) {
+            if (vb->type == SNMP_ENDOFMIBVIEW ||
+                netsnmp_oid_is_subtree(root, OID_LENGTH(root), vb->name,
+                                       vb->name_length) != 0 ||
+                count == MAXRESULTS) {
+                done = 1;
+                break;
+            }
+            res[count].column = vb->name[OID_LENGTH(root) + 1];
+            res[count].index = vb->name[vb->name_length - 1];
+            res[count].type = vb->type;
+            res[count].value = vb->val.integer ? *vb->val.integer : 0;
+            count++;
+            memcpy(name, vb->name, vb->name_length * sizeof(oid));
+            name_len = vb->name_length;
+        }
+        snmp_free_pdu(response);
+    }
+    return count;
+}
+
+static double
+elapsed(const struct timeval *start)
+{
+    struct timeval  now;
+
+    netsnmp_get_monotonic_clock(&now);
+    return (now.tv_sec - start->tv_sec) +
+        (now.tv_usec - start->tv_usec) / 1000000.0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    netsnmp_transport *transport;
+    netsnmp_session sess, *client;
+    struct sockaddr_in addr;
+    socklen_t       addr_len = sizeof(addr);
+    struct timeval  start;
+    char            peer[64];
+    netsnmp_tdata_row *row;
+    oid             index;
+    int             count[2], expected, i, t;
+
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DONT_READ_CONFIGS, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_LOAD, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_SAVE, 1);
+    init_agent("T031");
+    netsnmp_config(access_line);
+    init_snmp("T031");
+
+    snmp_register_callback(SNMP_CALLBACK_APPLICATION,
+                           SNMPD_CALLBACK_ACM_CHECK, acm_check, NULL);
+    for (i = 0; i < NROWS; i++)
+        entries[i].index = i + 1;
+    OKF(register_table("T031native", 1, HANDLER_CAN_RONLY |
+                       HANDLER_CAN_GETBULK_NATIVE) == SNMPERR_SUCCESS &&
+        register_table("T031classic", 2, HANDLER_CAN_RONLY) ==
+        SNMPERR_SUCCESS, ("tables registered"));
+
+    transport = netsnmp_transport_open_server("T031", "udp:127.0.0.1:0");
+    OKF(transport != NULL, ("agent transport opened"));
+    if (!transport)
+        return 1;
+    getsockname(transport->sock, (struct sockaddr *) &addr, &addr_len);
+    snprintf(peer, sizeof(peer), "udp:127.0.0.1:%d", ntohs(addr.sin_port));
+    OKF(netsnmp_register_agent_nsap(transport) > 0, ("agent listening"));
+
+    snmp_sess_init(&sess);
+    sess.version = SNMP_VERSION_2c;
+    sess.peername = peer;
+    sess.community = community;
+    sess.community_len = sizeof(community) - 1;
+    sess.timeout = 10 * 1000000L;
+    client = snmp_open(&sess);
+    OKF(client != NULL, ("client session opened"));
+    if (!client)
+        return 1;
+
+    /*
+     * the native table first, then the classic one
+     */
+    for (t = 0; t < 2; t++) {
+        netsnmp_get_monotonic_clock(&start);
+        for (i = 0; i < ROUNDS; i++)
+            count[t] = walk(client, t + 1, results[t]);
+        printf("# %s: %d rounds of %d varbinds in %.3f s\n",
+               t ? "classic" : "native", ROUNDS, count[t], elapsed(&start));
+    }
+
+    expected = (NROWS - 1) + (NROWS / 2 - 1);
+    OKF(count[0] == expected && count[1] == expected,
+        ("walked %d and %d varbinds, expected %d", count[0], count[1],
+         expected));
+    OKF(compare(count) == 0, ("%d varbinds differ", compare(count)));
+
+    /*
+     * the native table has to notice that its container changed
+     */
+    for (t = 0; t < 2; t++)
+        for (index = FIRST_GONE; index < FIRST_GONE + NGONE; index++) {
+            row = netsnmp_tdata_row_get_byoid(tables[t], &index, 1);
+            if (row)
+                netsnmp_tdata_remove_and_delete_row(tables[t], row);
+        }
+    for (t = 0; t < 2; t++)
+        count[t] = walk(client, t + 1, results[t]);
+    expected -= NGONE + NGONE / 2;
+    OKF(count[0] == expected && count[1] == expected,
+        ("after removing rows, walked %d and %d varbinds, expected %d",
+         count[0], count[1], expected));
+    OKF(compare(count) == 0, ("after removing rows, %d varbinds differ",
+                              compare(count)));
+
+    snmp_close(client);
+    snmp_shutdown("T031");
+    shutdown_agent();
+
+    PLAN(__test_counter);
+    return 0;
+}
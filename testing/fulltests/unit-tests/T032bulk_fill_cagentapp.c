@@ -0,0 +1,265 @@
+/*
+ * HEADER Testing that GETBULK responses are packed to msgMaxSize
+ *
+ * A tdata table with NROWS rows of strings of varying length is
+ * registered in an agent running in this process, and walked with
+ * GETBULK requests for two columns at once.  The agent transport
+ * records the size of every response it sends: each response but the
+ * last must be as large as the agent predicted, and no larger than
+ * msgMaxSize.
+ */
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/agent/net-snmp-agent-includes.h>
+#include <net-snmp/library/testing.h>
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+#ifdef HAVE_NETINET_IN_H
+#include <netinet/in.h>
+#endif
+
+#define NROWS      2000
+#define MAXSIZE    1472
+#define REPS       1000
+#define MAXSENT    1000
+
+struct entry {
+    long            index;
+};
+
+static const oid table_oid[] = { 1, 3, 6, 1, 4, 1, 8072, 9999, 32, 1 };
+static u_char   community[] = "public";
+static char     access_line[] = "rocommunity public 127.0.0.1";
+static char     value[256];
+
+static struct entry entries[NROWS];
+static int      sent_len[MAXSENT];
+static int      nsent;
+static int      (*agent_send) (netsnmp_transport *, const void *, int,
+                               void **, int *);
+
+/* Column 2 holds index % 200 bytes, column 3 holds 200 - that. */
+static int
+table_handler(netsnmp_mib_handler *handler,
+              netsnmp_handler_registration *reginfo,
+              netsnmp_agent_request_info *reqinfo,
+              netsnmp_request_info *requests)
+{
+    netsnmp_request_info *request;
+    netsnmp_table_request_info *table_info;
+    struct entry   *entry;
+    size_t          len;
+
+    if (reqinfo->mode != MODE_GET)
+        return SNMP_ERR_NOERROR;
+
+    for (request = requests; request; request = request->next) {
+        if (request->processed)
+            continue;
+        entry = (struct entry *) netsnmp_tdata_extract_entry(request);
+        table_info = netsnmp_extract_table_info(request);
+        if (!entry || !table_info) {
+            netsnmp_set_request_error(reqinfo, request, SNMP_NOSUCHINSTANCE);
+            continue;
+        }
+        len = entry->index % 200;
+        if (table_info->colnum == 3)
+            len = 200 - len;
+        snmp_set_var_typed_value(request->requestvb, ASN_OCTET_STR,
+                                 value, len);
+    }
+    return SNMP_ERR_NOERROR;
+}
+
+static int
+record_send(netsnmp_transport *t, const void *buf, int size,
+            void **opaque, int *olength)
+{
+    if (nsent < MAXSENT)
+        sent_len[nsent] = size;
+    ++nsent;
+    return agent_send(t, buf, size, opaque, olength);
+}
+
+static int
+register_table(void)
+{
+    netsnmp_handler_registration *reginfo;
+    netsnmp_table_registration_info *table_info;
+    netsnmp_tdata  *tdata;
+    netsnmp_tdata_row *row;
+    int             i;
+
+    tdata = netsnmp_tdata_create_table("T032", 0);
+    for (i = 0; i < NROWS; i++) {
+        entries[i].index = i + 1;
+        row = netsnmp_tdata_create_row();
+        row->data = &entries[i];
+        netsnmp_tdata_row_add_index(row, ASN_INTEGER, &entries[i].index,
+                                    sizeof(entries[i].index));
+        netsnmp_tdata_add_row(tdata, row);
+    }
+
+    reginfo = netsnmp_create_handler_registration("T032", table_handler,
+                                                  table_oid,
+                                                  OID_LENGTH(table_oid),
+                                                  HANDLER_CAN_RONLY);
+    table_info = SNMP_MALLOC_TYPEDEF(netsnmp_table_registration_info);
+    netsnmp_table_helper_add_indexes(table_info, ASN_INTEGER, 0);
+    table_info->min_column = 2;
+    table_info->max_column = 3;
+    return netsnmp_tdata_register(reginfo, tdata, table_info);
+}
+
+/*
+ * Walk columns 2 and 3 side by side, each until it ends; returns the
+ * number of rows seen in both, or -1 if a value is wrong.
+ */
+static int
+walk(netsnmp_session *ss, int *responses)
+{
+    netsnmp_pdu    *pdu, *response;
+    netsnmp_variable_list *vb;
+    oid             name[2][MAX_OID_LEN];
+    size_t          name_len[2];
+    long            expect[2] = { 1, 1 };
+    int             active[2], nactive = 2, c, k;
+
+    for (c = 0; c < 2; c++) {
+        memcpy(name[c], table_oid, sizeof(table_oid));
+        name[c][OID_LENGTH(table_oid)] = 1;
+        name[c][OID_LENGTH(table_oid) + 1] = c + 2;
+        name_len[c] = OID_LENGTH(table_oid) + 2;
+        active[c] = c;
+    }
+
+    *responses = 0;
+    while (nactive) {
+        pdu = snmp_pdu_create(SNMP_MSG_GETBULK);
+        pdu->non_repeaters = 0;
+        pdu->max_repetitions = REPS;
+        for (k = 0; k < nactive; k++)
+            snmp_add_null_var(pdu, name[active[k]], name_len[active[k]]);
+        if (snmp_synch_response(ss, pdu, &response) != STAT_SUCCESS ||
+            response->errstat != SNMP_ERR_NOERROR) {
+            if (response)
+                snmp_free_pdu(response);
+            return -1;
+        }
+        ++*responses;
+        for (vb = response->variables, k = 0; vb;
+             vb = vb->next_variable, k = (k + 1) % nactive) {
+            c = active[k];
+            if (vb->type != ASN_OCTET_STR ||
+                vb->name_length != OID_LENGTH(table_oid) + 3 ||
+                vb->name[OID_LENGTH(table_oid) + 1] != c + 2) {
+                /* this column is done */
+                active[k] = active[--nactive];
+                break;
+            }
+            if (vb->name[vb->name_length - 1] != expect[c] ||
+                vb->val_len != (c ? 200 - expect[c] % 200 :
+                                expect[c] % 200)) {
+                snmp_free_pdu(response);
+                return -1;
+            }
+            ++expect[c];
+            memcpy(name[c], vb->name, vb->name_length * sizeof(oid));
+            name_len[c] = vb->name_length;
+        }
+        snmp_free_pdu(response);
+    }
+    return expect[0] == expect[1] ? expect[0] - 1 : -1;
+}
+
+int
+main(int argc, char *argv[])
+{
+    netsnmp_transport *transport;
+    netsnmp_session sess, *client;
+    struct sockaddr_in addr;
+    socklen_t       addr_len = sizeof(addr);
+    char            peer[64];
+    int             rows, responses, i, oversize = 0;
+    u_long          bulk_responses, full, bytes, budget, sent_bytes = 0;
+
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DONT_READ_CONFIGS, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_LOAD, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_SAVE, 1);
+    netsnmp_ds_set_int(NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_MSG_SEND_MAX,
+                       MAXSIZE);
+    netsnmp_ds_set_int(NETSNMP_DS_APPLICATION_ID,
+                       NETSNMP_DS_AGENT_MAX_GETBULKRESPONSES, 2 * REPS);
+    init_agent("T032");
+    netsnmp_config(access_line);
+    init_snmp("T032");
+
+    memset(value, 'x', sizeof(value));
+    OKF(register_table() == SNMPERR_SUCCESS, ("table registered"));
+
+    transport = netsnmp_transport_open_server("T032", "udp:127.0.0.1:0");
+    OKF(transport != NULL, ("agent transport opened"));
+    if (!transport)
+        return 1;
+    agent_send = transport->f_send;
+    transport->f_send = record_send;
+    getsockname(transport->sock, (struct sockaddr *) &addr, &addr_len);
+    snprintf(peer, sizeof(peer), "udp:127.0.0.1:%d", ntohs(addr.sin_port));
+    OKF(netsnmp_register_agent_nsap(transport) > 0, ("agent listening"));
+
+    snmp_sess_init(&sess);
+    sess.version = SNMP_VERSION_2c;
+    sess.peername = peer;
+    sess.community = community;
+    sess.community_len = sizeof(community) - 1;
+    sess.timeout = 10 * 1000000L;
+    client = snmp_open(&sess);
+    OKF(client != NULL, ("client session opened"));
+    if (!client)
+        return 1;
+
+    rows = walk(client, &responses);
+    OKF(rows == NROWS, ("walked %d rows in %d responses, expected %d rows",
+                        rows, responses, NROWS));
+    OKF(nsent == responses && nsent <= MAXSENT,
+        ("agent sent %d responses", nsent));
+
+    for (i = 0; i < nsent && i < MAXSENT; i++) {
+        if (sent_len[i] > MAXSIZE)
+            ++oversize;
+        if (i < nsent - 1)
+            sent_bytes += sent_len[i];
+    }
+    OKF(oversize == 0, ("%d responses larger than %d bytes", oversize,
+                        MAXSIZE));
+
+#ifndef NETSNMP_NO_PDU_STATS
+    netsnmp_get_pdu_stats_getbulk(&bulk_responses, &full, &bytes, &budget);
+    OKF(bulk_responses == nsent && full == nsent - 1,
+        ("%lu getbulk responses, %lu full", bulk_responses, full));
+    OKF(bytes == sent_bytes,
+        ("full responses were %lu bytes, predicted %lu", sent_bytes, bytes));
+    printf("# average fill %.1f%% of %d bytes\n",
+           budget ? 100.0 * bytes / budget : 0.0, MAXSIZE);
+#endif /* NETSNMP_NO_PDU_STATS */
+
+    snmp_close(client);
+    snmp_shutdown("T032");
+    shutdown_agent();
+
+    PLAN(__test_counter);
+    return 0;
+}
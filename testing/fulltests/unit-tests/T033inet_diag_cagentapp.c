@@ -0,0 +1,290 @@
+/*
+ * HEADER Testing the sock_diag loaders for the TCP and UDP tables
+ *
+ * Opens NCONN loopback TCP connections (and their listeners) and NUDP
+ * UDP sockets, then loads the tcpconn and udp_endpoint containers from
+ * /proc and with sock_diag, and checks that both see the same sockets.
+ * The load times are printed as a rough benchmark.
+ */
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/agent/net-snmp-agent-includes.h>
+#include <net-snmp/library/testing.h>
+#include <net-snmp/data_access/tcpConn.h>
+#include <net-snmp/data_access/udp_endpoint.h>
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#if defined(linux) && defined(HAVE_LINUX_INET_DIAG_H)
+#include "util_funcs/inet_diag.h"
+
+#define NCONN   1000
+#define NUDP    1000
+#define LOADS   5
+
+struct sock_key {
+    u_short         lport, rport;
+    u_char          laddr[4], raddr[4];
+    int             state;
+};
+
+static u_char   our_port[65536];
+static struct sock_key keys[2][4 * NCONN];
+static int      nkeys[2];
+
+static int
+_key_cmp(const void *a, const void *b)
+{
+    return memcmp(a, b, sizeof(struct sock_key));
+}
+
+static void
+_tcp_key(void *data, void *ctx)
+{
+    netsnmp_tcpconn_entry *entry = (netsnmp_tcpconn_entry *) data;
+    int             which = (int) (intptr_t) ctx;
+    struct sock_key *key;
+
+    if (entry->loc_addr_len != 4 ||
+        !(our_port[entry->loc_port] || our_port[entry->rmt_port]) ||
+        nkeys[which] >= 4 * NCONN)
+        return;
+    key = &keys[which][nkeys[which]++];
+    memset(key, 0, sizeof(*key));
+    key->lport = entry->loc_port;
+    key->rport = entry->rmt_port;
+    memcpy(key->laddr, entry->loc_addr, 4);
+    memcpy(key->raddr, entry->rmt_addr, 4);
+    key->state = entry->tcpConnState;
+}
+
+static void
+_udp_key(void *data, void *ctx)
+{
+    netsnmp_udp_endpoint_entry *ep = (netsnmp_udp_endpoint_entry *) data;
+    int             which = (int) (intptr_t) ctx;
+    struct sock_key *key;
+
+    if (ep->loc_addr_len != 4 || !our_port[ep->loc_port] ||
+        nkeys[which] >= 4 * NCONN)
+        return;
+    key = &keys[which][nkeys[which]++];
+    memset(key, 0, sizeof(*key));
+    key->lport = ep->loc_port;
+    memcpy(key->laddr, ep->loc_addr, 4);
+    key->state = ep->state;
+}
+
+static int
+_count(const struct inet_diag_msg *r, void *ctx)
+{
+    if (our_port[ntohs(r->id.idiag_sport)])
+        ++*(int *) ctx;
+    return 0;
+}
+
+static double
+_now(void)
+{
+    struct timeval  tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+static int
+_port_of(int fd)
+{
+    struct sockaddr_in addr;
+    socklen_t       addr_len = sizeof(addr);
+
+    if (getsockname(fd, (struct sockaddr *) &addr, &addr_len) < 0)
+        return -1;
+    return ntohs(addr.sin_port);
+}
+
+/* load with the given flags, returning the keys of our sockets */
+static double
+_load_tcp(int which, u_int flags)
+{
+    netsnmp_container *c;
+    double          start = _now(), elapsed;
+    int             i;
+
+    for (i = 0; i < LOADS; i++) {
+        c = netsnmp_access_tcpconn_container_load(NULL, flags);
+        if (!c)
+            return -1;
+        nkeys[which] = 0;
+        CONTAINER_FOR_EACH(c, _tcp_key, (void *) (intptr_t) which);
+        netsnmp_access_tcpconn_container_free(c, 0);
+    }
+    elapsed = (_now() - start) / LOADS;
+    qsort(keys[which], nkeys[which], sizeof(struct sock_key), _key_cmp);
+    return elapsed;
+}
+
+static double
+_load_udp(int which, u_int flags)
+{
+    netsnmp_container *c;
+    double          start = _now(), elapsed;
+    int             i;
+
+    for (i = 0; i < LOADS; i++) {
+        c = netsnmp_access_udp_endpoint_container_load(NULL, flags);
+        if (!c)
+            return -1;
+        nkeys[which] = 0;
+        CONTAINER_FOR_EACH(c, _udp_key, (void *) (intptr_t) which);
+        netsnmp_access_udp_endpoint_container_free(c, 0);
+    }
+    elapsed = (_now() - start) / LOADS;
+    qsort(keys[which], nkeys[which], sizeof(struct sock_key), _key_cmp);
+    return elapsed;
+}
+
+static int
+_same_keys(void)
+{
+    return nkeys[0] == nkeys[1] &&
+        memcmp(keys[0], keys[1], nkeys[0] * sizeof(struct sock_key)) == 0;
+}
+#endif /* linux && HAVE_LINUX_INET_DIAG_H */
+
+int
+main(int argc, char *argv[])
+{
+#if defined(linux) && defined(HAVE_LINUX_INET_DIAG_H)
+    struct sockaddr_in addr;
+    struct rlimit   rl;
+    static int      lfd[NCONN], cfd[NCONN], afd[NCONN], ufd[NUDP];
+    int             nconn, nudp, i, port, listeners;
+    double          proc_ms, diag_ms;
+
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DONT_READ_CONFIGS, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_LOAD, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_SAVE, 1);
+    init_agent("T033");
+    init_snmp("T033");
+
+    /* three descriptors per connection, one per udp socket */
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    nconn = NCONN;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 &&
+        rl.rlim_cur < 4 * NCONN + 64)
+        nconn = (rl.rlim_cur - 64) / 4;
+    nudp = nconn;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (i = 0; i < nconn; i++) {
+        socklen_t       addr_len = sizeof(addr);
+
+        addr.sin_port = 0;
+        lfd[i] = socket(AF_INET, SOCK_STREAM, 0);
+        cfd[i] = socket(AF_INET, SOCK_STREAM, 0);
+        if (lfd[i] < 0 || cfd[i] < 0 ||
+            bind(lfd[i], (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+            listen(lfd[i], 1) < 0 ||
+            getsockname(lfd[i], (struct sockaddr *) &addr, &addr_len) < 0 ||
+            connect(cfd[i], (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+            (afd[i] = accept(lfd[i], NULL, NULL)) < 0)
+            break;
+        port = ntohs(addr.sin_port);
+        our_port[port] = 1;
+    }
+    OKF(i == nconn, ("opened %d of %d tcp connections", i, nconn));
+    nconn = i;
+
+    /*
+     * tcpConnectionTable: each connection shows up twice, the listeners
+     * are filtered out
+     */
+    proc_ms = _load_tcp(0, NETSNMP_ACCESS_TCPCONN_LOAD_NOLISTEN);
+    diag_ms = _load_tcp(1, NETSNMP_ACCESS_TCPCONN_LOAD_NOLISTEN |
+                        NETSNMP_ACCESS_TCPCONN_LOAD_NETLINK);
+    OKF(nkeys[0] == 2 * nconn, ("/proc: %d of %d connections", nkeys[0],
+                                2 * nconn));
+    OKF(_same_keys(), ("sock_diag: %d connections, same as /proc",
+                       nkeys[1]));
+    printf("# tcp connections: /proc %.2f ms, sock_diag %.2f ms\n",
+           proc_ms, diag_ms);
+
+    /* tcpListenerTable */
+    _load_tcp(0, NETSNMP_ACCESS_TCPCONN_LOAD_ONLYLISTEN);
+    _load_tcp(1, NETSNMP_ACCESS_TCPCONN_LOAD_ONLYLISTEN |
+              NETSNMP_ACCESS_TCPCONN_LOAD_NETLINK);
+    OKF(nkeys[0] == nconn, ("/proc: %d of %d listeners", nkeys[0], nconn));
+    OKF(_same_keys(), ("sock_diag: %d listeners, same as /proc",
+                       nkeys[1]));
+
+    /* the state filter is applied by the kernel */
+    listeners = 0;
+    netsnmp_inet_diag_dump(AF_INET, IPPROTO_TCP, 1 << TCP_LISTEN,
+                           _count, &listeners);
+    OKF(listeners == nconn, ("%d of %d listeners in the LISTEN dump",
+                             listeners, nconn));
+
+    for (i = 0; i < nconn; i++) {
+        close(afd[i]);
+        close(cfd[i]);
+        close(lfd[i]);
+    }
+
+    /* udpEndpointTable */
+    memset(our_port, 0, sizeof(our_port));
+    for (i = 0; i < nudp; i++) {
+        addr.sin_port = 0;
+        ufd[i] = socket(AF_INET, SOCK_DGRAM, 0);
+        if (ufd[i] < 0 ||
+            bind(ufd[i], (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+            (port = _port_of(ufd[i])) < 0)
+            break;
+        our_port[port] = 1;
+    }
+    OKF(i == nudp, ("opened %d of %d udp sockets", i, nudp));
+    nudp = i;
+
+    proc_ms = _load_udp(0, 0);
+    diag_ms = _load_udp(1, NETSNMP_ACCESS_UDP_ENDPOINT_LOAD_NETLINK);
+    OKF(nkeys[0] == nudp, ("/proc: %d of %d udp sockets", nkeys[0], nudp));
+    OKF(_same_keys(), ("sock_diag: %d udp sockets, same as /proc",
+                       nkeys[1]));
+    printf("# udp endpoints: /proc %.2f ms, sock_diag %.2f ms\n",
+           proc_ms, diag_ms);
+
+    for (i = 0; i < nudp; i++)
+        close(ufd[i]);
+
+    snmp_shutdown("T033");
+    shutdown_agent();
+#else
+    OK(1, "sock_diag is only available on linux");
+#endif
+
+    PLAN(__test_counter);
+    return 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * HEADER Testing incremental reloads of the swrun container
+ *
+ * On architectures that keep swrun entries from one load to the next,
+ * check that processes which are still running keep their entry, that
+ * new and exited processes are added and removed, that a reused pid is
+ * noticed through the start time, and that the name of a process which
+ * called exec() and its status and perf values are only read again when
+ * asked for.
+ */
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/agent/net-snmp-agent-includes.h>
+#include <net-snmp/library/testing.h>
+#include <net-snmp/data_access/swrun.h>
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <signal.h>
+#include <sys/wait.h>
+
+#include "host/data_access/swrun.h"
+
+int
+main(int argc, char *argv[])
+{
+#ifdef NETSNMP_SWRUN_INCREMENTAL
+    netsnmp_container *container;
+    netsnmp_swrun_entry *self, *entry;
+    unsigned long long start_time;
+    pid_t           child;
+    int             go[2], i;
+    char            comm[32];
+    FILE           *fp;
+
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DONT_READ_CONFIGS, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_LOAD, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_SAVE, 1);
+    init_agent("T034");
+    init_snmp("T034");
+    init_swrun();
+
+    container = netsnmp_swrun_container();
+    OKF(netsnmp_swrun_container_load(container, 0) == container,
+        ("loaded %d processes", (int) CONTAINER_SIZE(container)));
+    self = netsnmp_swrun_entry_get_by_index(container, getpid());
+    OKF(self && self->hrSWRunPath_len > 0 &&
+        strstr(argv[0], self->hrSWRunName) &&
+        !(self->flags & NETSNMP_SWRUN_ENTRY_STALE),
+        ("new entry for ourselves is complete"));
+    if (!self)
+        return 1;
+
+    if (pipe(go) < 0)
+        return 1;
+    child = fork();
+    if (0 == child) {
+        alarm(60);              /* in case we die before killing it */
+        close(go[1]);
+        if (read(go[0], comm, 1) == 1)
+            execl("/bin/sleep", "sleep", "60", (char *) NULL);
+        _exit(0);
+    }
+    close(go[0]);
+
+    netsnmp_swrun_container_load(container, 0);
+    OKF(netsnmp_swrun_entry_get_by_index(container, getpid()) == self,
+        ("entry kept across reloads"));
+    OKF(self->flags & NETSNMP_SWRUN_ENTRY_STALE,
+        ("status and perf values left for later"));
+    netsnmp_swrun_entry_update(self);
+    OKF(!(self->flags & NETSNMP_SWRUN_ENTRY_STALE) &&
+        self->hrSWRunStatus == HRSWRUNSTATUS_RUNNING &&
+        self->hrSWRunPerfMem > 0,
+        ("updated on request: status %d, %d kB", self->hrSWRunStatus,
+         self->hrSWRunPerfMem));
+    entry = netsnmp_swrun_entry_get_by_index(container, child);
+    OKF(entry && strcmp(entry->hrSWRunName, self->hrSWRunName) == 0,
+        ("new child %d found", (int) child));
+
+    /* same pid and start time, but a new /proc inode: kept */
+    self->generation = 0;
+    netsnmp_swrun_container_load(container, 0);
+    OKF(netsnmp_swrun_entry_get_by_index(container, getpid()) == self,
+        ("entry kept when only the inode changed"));
+
+    /* a different start time means another process got our pid */
+    start_time = self->start_time;
+    self->generation = 0;
+    self->start_time = 0;
+    strcpy(self->hrSWRunName, "old process");
+    netsnmp_swrun_container_load(container, 0);
+    self = netsnmp_swrun_entry_get_by_index(container, getpid());
+    OKF(self && self->start_time == start_time &&
+        strcmp(self->hrSWRunName, "old process") != 0,
+        ("entry read again for a reused pid"));
+
+    /* same pid, start time and inode, but another program: noticed when
+       the entry is asked for */
+    entry = netsnmp_swrun_entry_get_by_index(container, child);
+    if (write(go[1], "x", 1) != 1)
+        return 1;
+    for (i = 0; i < 500; i++) {
+        snprintf(comm, sizeof(comm), "/proc/%d/comm", (int) child);
+        fp = fopen(comm, "r");
+        comm[0] = '\0';
+        if (fp) {
+            if (fgets(comm, sizeof(comm), fp) == NULL)
+                comm[0] = '\0';
+            fclose(fp);
+        }
+        if (strncmp(comm, "sleep", 5) == 0)
+            break;
+        usleep(10000);
+    }
+    netsnmp_swrun_container_load(container, 0);
+    if (entry)
+        netsnmp_swrun_entry_update(entry);
+    OKF(entry && netsnmp_swrun_entry_get_by_index(container, child) == entry &&
+        strcmp(entry->hrSWRunName, "sleep") == 0 &&
+        strstr(entry->hrSWRunPath, "sleep") &&
+        strcmp(entry->hrSWRunParameters, "60") == 0,
+        ("entry read again after exec: %s %s",
+         entry ? entry->hrSWRunPath : "(none)",
+         entry ? entry->hrSWRunParameters : ""));
+
+    kill(child, SIGKILL);
+    waitpid(child, NULL, 0);
+    netsnmp_swrun_container_load(container, 0);
+    OKF(netsnmp_swrun_entry_get_by_index(container, child) == NULL,
+        ("exited child %d removed", (int) child));
+
+    snmp_shutdown("T034");
+    shutdown_agent();
+#else
+    OK(1, "swrun entries are not kept between loads on this platform");
+#endif
+
+    PLAN(__test_counter);
+    return 0;
+}
@@ -0,0 +1,146 @@
+/*
+ * HEADER Testing the filesystem statistics collected by statfs workers
+ *
+ * Loads the hardware/fsys container with statfs() run by the worker
+ * threads and from the agent thread (statfsTimeout 0), and checks both
+ * against a direct statfs() of the root filesystem.  Then makes statfs()
+ * hang for HUNG other filesystems, with a single worker thread, and
+ * checks that the root filesystem is still refreshed.
+ */
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/agent/net-snmp-agent-includes.h>
+#include <net-snmp/library/testing.h>
+
+#include <stdio.h>
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_VFS_H
+#include <sys/vfs.h>
+#endif
+
+#include "hardware/fsys/fsys.h"
+#include "hardware/fsys/hw_fsys.h"
+#include "hardware/fsys/hw_fsys_private.h"
+
+#if defined(linux) && defined(HAVE_SYS_VFS_H)
+#define HUNG    3
+
+static int      hang[2], hung;
+
+/*
+ * block until the test closes the pipe, for the first HUNG filesystems
+ * other than /.  Only one worker is not stuck at any time.
+ */
+static int
+_hung_statfs(const char *path, void *stat_buf)
+{
+    char            c;
+
+    if (strcmp(path, "/") != 0 && hung < HUNG) {
+        ++hung;
+        while (read(hang[0], &c, 1) > 0)
+            ;
+    }
+    return statfs(path, (struct statfs *) stat_buf);
+}
+#endif
+
+int
+main(int argc, char *argv[])
+{
+#if defined(linux) && defined(HAVE_SYS_VFS_H)
+    netsnmp_cache     *cache;
+    netsnmp_fsys_info *root;
+    struct statfs      stat_buf;
+    char               line[] = "statfsTimeout 0";
+    char               timeout_line[] = "statfsTimeout 1";
+    char               threads_line[] = "statfsThreads 1";
+    netsnmp_fsys_info *fs;
+    int                i, stale;
+
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DONT_READ_CONFIGS, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_LOAD, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_SAVE, 1);
+    init_agent("T035");
+    init_hw_fsys();
+    init_snmp("T035");
+
+    cache = netsnmp_fsys_get_cache();
+    OKF(cache != NULL, ("fsys cache"));
+    if (!cache)
+        return 1;
+
+    netsnmp_config(threads_line);
+    OKF(statfs("/", &stat_buf) == 0, ("statfs /"));
+    for (i = 0; i < 3; i++) {
+        netsnmp_cache_check_and_reload(cache);
+        cache->expired = 1;
+    }
+    root = netsnmp_fsys_by_path(NETSNMP_REMOVE_CONST(char *, "/"),
+                                NETSNMP_FS_FIND_EXIST);
+    OKF(root && (root->flags & NETSNMP_FS_FLAG_ACTIVE) &&
+        !(root->flags & NETSNMP_FS_FLAG_STALE),
+        ("/ loaded by the workers"));
+    OKF(root && root->size == stat_buf.f_blocks &&
+        root->units == stat_buf.f_bsize,
+        ("/ has %llu blocks of %llu bytes", root ? root->size : 0,
+         root ? root->units : 0));
+
+    /* and once more from the agent thread */
+    netsnmp_config(line);
+    if (root)
+        root->size = 0;
+    netsnmp_cache_check_and_reload(cache);
+    OKF(root && root->size == stat_buf.f_blocks &&
+        !(root->flags & NETSNMP_FS_FLAG_STALE),
+        ("/ loaded by the agent thread"));
+
+    /* hung filesystems do not starve the others */
+    netsnmp_config(timeout_line);
+    OKF(pipe(hang) == 0, ("pipe"));
+    netsnmp_fsys_statfs_hook = _hung_statfs;
+    if (root)
+        root->size = 0;
+    for (i = 0; i < HUNG + 2; i++) {
+        cache->expired = 1;
+        netsnmp_cache_check_and_reload(cache);
+    }
+    stale = 0;
+    for (fs = netsnmp_fsys_get_first(); fs; fs = netsnmp_fsys_get_next(fs))
+        if (fs->flags & NETSNMP_FS_FLAG_STALE)
+            ++stale;
+    OKF(root && root->size == stat_buf.f_blocks &&
+        !(root->flags & NETSNMP_FS_FLAG_STALE) && stale == hung,
+        ("/ loaded while %d filesystems hang, %d stale", hung, stale));
+
+    /* and the hung ones catch up once they return */
+    close(hang[1]);
+    sleep(1);
+    cache->expired = 1;
+    netsnmp_cache_check_and_reload(cache);
+    stale = 0;
+    for (fs = netsnmp_fsys_get_first(); fs; fs = netsnmp_fsys_get_next(fs))
+        if (fs->flags & NETSNMP_FS_FLAG_STALE)
+            ++stale;
+    OKF(0 == stale, ("%d filesystems still stale", stale));
+    netsnmp_fsys_statfs_hook = NULL;
+    close(hang[0]);
+
+    snmp_shutdown("T035");
+    shutdown_agent();
+#else
+    OK(1, "only tested on linux");
+#endif
+
+    PLAN(__test_counter);
+    return 0;
+}
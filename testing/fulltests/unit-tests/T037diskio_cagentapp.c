@@ -0,0 +1,168 @@
+/*
+ * HEADER Testing the diskIOTable loaded from /proc/diskstats
+ *
+ * Walks the diskIOTable through var_diskio() and checks the devices and
+ * their 64-bit read counters against /proc/diskstats, first for all the
+ * devices and then for a single one named by a 'diskio' line.
+ */
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/agent/net-snmp-agent-includes.h>
+#include <net-snmp/library/testing.h>
+
+#include <stdio.h>
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <sys/stat.h>
+
+#include "ucd-snmp/diskio.h"
+
+#ifdef linux
+#define MAX_DEVS 1024
+
+static char     dev_name[MAX_DEVS][256];
+static unsigned long long dev_rsect[MAX_DEVS];
+static int      ndevs;
+
+/* our own, slow, parse of /proc/diskstats */
+static int
+_read_diskstats(void)
+{
+    FILE           *f = fopen("/proc/diskstats", "r");
+    char            line[1024];
+
+    ndevs = 0;
+    if (!f)
+        return -1;
+    while (ndevs < MAX_DEVS && fgets(line, sizeof(line), f))
+        if (sscanf(line, "%*d %*d %255s %*u %*u %llu", dev_name[ndevs],
+                   &dev_rsect[ndevs]) == 2)
+            ndevs++;
+    fclose(f);
+    return ndevs;
+}
+
+static u_char  *
+_get(int column, int row, size_t *var_len)
+{
+    struct variable vp;
+    oid             name[MAX_OID_LEN] = { 1, 3, 6, 1, 4, 1, 2021, 13, 15,
+                                          1, 1 };
+    size_t          length = 13;
+    WriteMethod    *write_method;
+
+    memset(&vp, 0, sizeof(vp));
+    memcpy(vp.name, name, 12 * sizeof(oid));
+    vp.name[11] = column;
+    vp.namelen = 12;
+    vp.magic = column;
+    name[11] = column;
+    name[12] = row;
+    return var_diskio(&vp, name, &length, 1, var_len, &write_method);
+}
+
+static int
+_find(const char *device)
+{
+    int             i;
+
+    for (i = 0; i < ndevs; i++)
+        if (strcmp(dev_name[i], device) == 0)
+            return i;
+    return -1;
+}
+
+/*
+ * check every row of the table against /proc/diskstats
+ *
+ * @return the number of rows
+ */
+static int
+_check_table(void)
+{
+    u_char         *val;
+    size_t          len;
+    char            device[256];
+    struct counter64 *c64;
+    unsigned long long bytes;
+    int             row, i, bad = 0;
+
+    for (row = 1; (val = _get(DISKIO_DEVICE, row, &len)) != NULL; row++) {
+        snprintf(device, sizeof(device), "%.*s", (int) len, val);
+        i = _find(device);
+        c64 = (struct counter64 *) _get(DISKIO_NREADX, row, &len);
+        if (i < 0 || !c64 || len != sizeof(struct counter64)) {
+            bad++;
+            continue;
+        }
+        /* the table was read at about the same time as our copy */
+        bytes = ((unsigned long long) c64->high << 32) | c64->low;
+        if (bytes < dev_rsect[i] * 512) {
+            printf("# %s: %llu bytes read, %llu in /proc/diskstats\n",
+                   device, bytes, dev_rsect[i] * 512);
+            bad++;
+        }
+    }
+    OKF(bad == 0, ("%d rows match /proc/diskstats", row - 1 - bad));
+    return row - 1;
+}
+#endif /* linux */
+
+int
+main(int argc, char *argv[])
+{
+#ifdef linux
+    char            line[300], path[300];
+    struct stat     st;
+    size_t          len;
+    int             i, rows;
+
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DONT_READ_CONFIGS, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_LOAD, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_SAVE, 1);
+    init_agent("T037");
+    init_diskio();
+    init_snmp("T037");
+
+    OKF(_read_diskstats() > 0, ("%d devices in /proc/diskstats", ndevs));
+    rows = _check_table();
+    OKF(rows == ndevs, ("%d of %d devices in the table", rows, ndevs));
+
+    /* the load averages are kept for all the devices */
+    devla_getstats(0, NULL);
+    OKF(_get(DISKIO_LA15, rows, &len) != NULL,
+        ("load average of the last device"));
+
+    /* a single configured device, the last one with a device node */
+    for (i = ndevs - 1; i >= 0; i--) {
+        snprintf(path, sizeof(path), "/dev/%s", dev_name[i]);
+        if (stat(path, &st) == 0 && S_ISBLK(st.st_mode))
+            break;
+    }
+    if (i >= 0) {
+        snprintf(line, sizeof(line), "diskio %s", path);
+        netsnmp_config(line);
+        sleep(1);               /* the stats are cached for a second */
+        _read_diskstats();
+        rows = _check_table();
+        OKF(rows == 1, ("%d row for %s", rows, path));
+    } else
+        OK(1, "no device node to configure");
+
+    snmp_shutdown("T037");
+    shutdown_agent();
+#else
+    OK(1, "only tested on linux");
+#endif
+
+    PLAN(__test_counter);
+    return 0;
+}
@@ -0,0 +1,160 @@
+/*
+ * HEADER Testing shared mteTrigger samples
+ *
+ * Sets up two delta-valued boolean triggers on the same object, one
+ * testing for a delta of 10 and the other for anything else, over an
+ * object that goes up by 10 each time it is read.  Checks that both
+ * triggers share a sample, that the object is read once per period
+ * rather than once per trigger, and that each trigger still sees a
+ * delta of 10.
+ */
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/agent/net-snmp-agent-includes.h>
+#include <net-snmp/library/testing.h>
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "disman/event/mteTrigger.h"
+#include "disman/event/mteEvent.h"
+#include "utilities/iquery.h"
+
+static oid      value_oid[] = { 1, 3, 6, 1, 4, 1, 8072, 9999, 38, 1, 0 };
+static long     fetches;
+
+static int
+_value_handler(netsnmp_mib_handler *handler,
+               netsnmp_handler_registration *reginfo,
+               netsnmp_agent_request_info *reqinfo,
+               netsnmp_request_info *requests)
+{
+    if (reqinfo->mode == MODE_GET) {
+        fetches++;
+        snmp_set_var_typed_integer(requests->requestvb, ASN_INTEGER,
+                                   10 * fetches);
+    }
+    return SNMP_ERR_NOERROR;
+}
+
+static int
+_uptime_handler(netsnmp_mib_handler *handler,
+                netsnmp_handler_registration *reginfo,
+                netsnmp_agent_request_info *reqinfo,
+                netsnmp_request_info *requests)
+{
+    if (reqinfo->mode == MODE_GET)
+        snmp_set_var_typed_integer(requests->requestvb, ASN_TIMETICKS,
+                                   netsnmp_get_agent_uptime());
+    return SNMP_ERR_NOERROR;
+}
+
+static struct mteTrigger *
+_trigger(char *name, long comparison, netsnmp_session *sess)
+{
+    netsnmp_tdata_row *row;
+    struct mteTrigger *entry;
+
+    row = mteTrigger_createEntry("T038", name, 1);
+    if (!row)
+        return NULL;
+    entry = (struct mteTrigger *) row->data;
+    memcpy(entry->mteTriggerValueID, value_oid, sizeof(value_oid));
+    entry->mteTriggerValueID_len = OID_LENGTH(value_oid);
+    entry->mteTriggerTest      = MTE_TRIGGER_BOOLEAN;
+    entry->mteTBoolComparison  = comparison;
+    entry->mteTBoolValue       = 10;
+    /* no such event: firing only disarms the trigger */
+    strcpy(entry->mteTBoolEvOwner, "T038");
+    strcpy(entry->mteTBoolEvent,   "none");
+    entry->mteTriggerFrequency = 1;
+    entry->session             = sess;
+    entry->flags |= MTE_TRIGGER_FLAG_DELTA  | MTE_TRIGGER_FLAG_SYSUPT |
+                    MTE_TRIGGER_FLAG_ENABLED | MTE_TRIGGER_FLAG_ACTIVE |
+                    MTE_TRIGGER_FLAG_VALID;
+    mteTrigger_enable(entry);
+    return entry;
+}
+
+static int
+_armed(struct mteTrigger *entry)
+{
+    return entry->old_results &&
+        (entry->old_results->index & MTE_ARMED_BOOLEAN);
+}
+
+int
+main(int argc, char *argv[])
+{
+    netsnmp_session *sess;
+    struct mteTrigger *equal, *unequal;
+    char            line[] = "rouser t038";
+
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DONT_READ_CONFIGS, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_LOAD, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_SAVE, 1);
+    init_agent("T038");
+    init_snmp("T038");
+    init_trigger_table_data();
+    init_event_table_data();
+    netsnmp_config(line);
+
+    netsnmp_register_instance(
+        netsnmp_create_handler_registration("T038", _value_handler,
+                                            value_oid,
+                                            OID_LENGTH(value_oid),
+                                            HANDLER_CAN_RONLY));
+    netsnmp_register_instance(
+        netsnmp_create_handler_registration("T038 sysUpTime",
+                                            _uptime_handler,
+                                            _sysUpTime_instance,
+                                            _sysUpTime_inst_len,
+                                            HANDLER_CAN_RONLY));
+
+    sess = netsnmp_iquery_user_session(NETSNMP_REMOVE_CONST(char *, "t038"));
+    OKF(sess != NULL, ("internal query session"));
+    if (!sess)
+        return 1;
+
+    equal   = _trigger(NETSNMP_REMOVE_CONST(char *, "equal"),
+                       MTE_BOOL_EQUAL, sess);
+    unequal = _trigger(NETSNMP_REMOVE_CONST(char *, "unequal"),
+                       MTE_BOOL_UNEQUAL, sess);
+    OKF(equal && unequal && equal->sample &&
+        equal->sample == unequal->sample, ("both triggers share a sample"));
+    if (!equal || !unequal)
+        return 1;
+
+    /* the immediate run for the new triggers */
+    run_alarms();
+    OKF(fetches == 1 && equal->old_results && unequal->old_results,
+        ("first sample: %ld fetches", fetches));
+
+    usleep(1100000);
+    run_alarms();
+    OKF(fetches == 2, ("second sample: %ld fetches", fetches));
+    OKF(!_armed(equal) && _armed(unequal),
+        ("delta of 10 seen by both triggers (%ld)",
+         equal->old_results ? *equal->old_results->val.integer : 0));
+
+    usleep(1100000);
+    run_alarms();
+    OKF(fetches == 3 && !_armed(equal) && _armed(unequal),
+        ("third sample: %ld fetches", fetches));
+
+    mteTrigger_disable(equal);
+    mteTrigger_disable(unequal);
+    snmp_shutdown("T038");
+    shutdown_agent();
+
+    PLAN(__test_counter);
+    return 0;
+}
@@ -0,0 +1,309 @@
+/*
+ * HEADER Testing the compiled DISMAN-EXPRESSION-MIB evaluator
+ *
+ * Evaluates expressions made of constants, checking operator precedence
+ * and associativity, and that badly formed expressions are reported with
+ * the right error code and position.  Then evaluates expressions over a
+ * wildcarded column and an exact instance, looked up by index, and over
+ * delta samples of that column, checking that each evaluation (or walk
+ * of the expValueTable) reads the column exactly once.
+ */
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/agent/net-snmp-agent-includes.h>
+#include <net-snmp/library/testing.h>
+
+#include <stdio.h>
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include "disman/expr/expExpression.h"
+#include "disman/expr/expObject.h"
+#include "disman/expr/expValue.h"
+#include "disman/expr/expValueTable.h"
+#include "utilities/iquery.h"
+
+netsnmp_variable_list *expValueTable_getEntry(netsnmp_variable_list *,
+                                              int, unsigned int);
+
+static struct expExpression *exp;
+
+/* column .1 has instances 1-3, and .2.0 is an exact instance */
+static oid      column_oid[] = { 1, 3, 6, 1, 4, 1, 8072, 9999, 39, 1 };
+static oid      scalar_oid[] = { 1, 3, 6, 1, 4, 1, 8072, 9999, 39, 2, 0 };
+static long     fetches[4];
+
+static int
+_column_handler(netsnmp_mib_handler *handler,
+                netsnmp_handler_registration *reginfo,
+                netsnmp_agent_request_info *reqinfo,
+                netsnmp_request_info *requests)
+{
+    oid             i = reginfo->rootoid[reginfo->rootoid_len - 1];
+
+    /* each read goes up by 10 */
+    if (reqinfo->mode == MODE_GET)
+        snmp_set_var_typed_integer(requests->requestvb, ASN_INTEGER,
+                                   100 * i + 10 * fetches[i]++);
+    return SNMP_ERR_NOERROR;
+}
+
+static int
+_scalar_handler(netsnmp_mib_handler *handler,
+                netsnmp_handler_registration *reginfo,
+                netsnmp_agent_request_info *reqinfo,
+                netsnmp_request_info *requests)
+{
+    if (reqinfo->mode == MODE_GET)
+        snmp_set_var_typed_integer(requests->requestvb, ASN_INTEGER, 5);
+    return SNMP_ERR_NOERROR;
+}
+
+static struct expExpression *
+_expression(const char *name, const char *expression, long sample_type,
+            netsnmp_session *sess)
+{
+    struct expExpression *entry;
+    struct expObject *obj;
+
+    entry = expExpression_createEntry("T039", name, 0);
+    if (!entry)
+        return NULL;
+    strlcpy(entry->expExpression, expression, sizeof(entry->expExpression));
+    memcpy(entry->expPrefix, column_oid, sizeof(column_oid));
+    entry->expPrefix_len = OID_LENGTH(column_oid);
+    entry->expValueType  = EXPVALTYPE_INTEGER;
+    entry->session       = sess;
+    entry->flags |= EXP_FLAG_VALID | EXP_FLAG_ACTIVE;
+
+    obj = expObject_createEntry("T039", name, 1, 0);
+    if (!obj)
+        return NULL;
+    memcpy(obj->expObjectID, column_oid, sizeof(column_oid));
+    obj->expObjectID_len     = OID_LENGTH(column_oid);
+    obj->expObjectSampleType = sample_type;
+    obj->flags |= EXP_OBJ_FLAG_VALID | EXP_OBJ_FLAG_ACTIVE |
+                  EXP_OBJ_FLAG_OWILD | EXP_OBJ_FLAG_PREFIX;
+
+    obj = expObject_createEntry("T039", name, 2, 0);
+    if (!obj)
+        return NULL;
+    memcpy(obj->expObjectID, scalar_oid, sizeof(scalar_oid));
+    obj->expObjectID_len     = OID_LENGTH(scalar_oid);
+    obj->expObjectSampleType = EXPSAMPLETYPE_ABSOLUTE;
+    obj->flags |= EXP_OBJ_FLAG_VALID | EXP_OBJ_FLAG_ACTIVE;
+
+    expExpression_enable(entry);
+    return entry;
+}
+
+static long
+_total(void)
+{
+    return fetches[1] + fetches[2] + fetches[3];
+}
+
+static netsnmp_variable_list *
+_eval(const char *expression)
+{
+    strlcpy(exp->expExpression, expression, sizeof(exp->expExpression));
+    exp->expErrorCode  = 0;
+    exp->expErrorIndex = 0;
+    return expValue_evaluateExpression(exp, NULL, 0);
+}
+
+static void
+_check_value(const char *expression, long expected)
+{
+    netsnmp_variable_list *var = _eval(expression);
+
+    OKF(var && var->type == ASN_INTEGER && *var->val.integer == expected,
+        ("%s = %ld (%ld)", expression, expected,
+         var && var->val.integer ? *var->val.integer : 0));
+    snmp_free_var(var);
+}
+
+static void
+_check_error(const char *expression, long code, long pos)
+{
+    netsnmp_variable_list *var = _eval(expression);
+
+    OKF(!var && exp->expErrorCode == code && exp->expErrorIndex == pos,
+        ("%s: error %ld at %ld (%ld at %ld)", expression, code, pos,
+         exp->expErrorCode, exp->expErrorIndex));
+    snmp_free_var(var);
+}
+
+int
+main(int argc, char *argv[])
+{
+    netsnmp_variable_list *var;
+    oid             oid_const[] = { 1, 3, 6, 1 };
+    netsnmp_session *sess;
+    struct expExpression *wild, *delta;
+    netsnmp_variable_list owner_var, name_var, inst_var;
+    oid             inst[MAX_OID_LEN];
+    oid             suffix[] = { 2 };
+    oid             missing[] = { 9 };
+    char            line[] = "rouser t039";
+    long            total;
+    int             i, walk;
+
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DONT_READ_CONFIGS, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_LOAD, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_SAVE, 1);
+    init_agent("T039");
+    init_expr_table_data();
+    init_expObject_table_data();
+    init_expValue();
+    init_snmp("T039");
+
+    exp = expExpression_createEntry("T039", "test", 0);
+    OKF(exp != NULL, ("expression entry"));
+    if (!exp)
+        return 1;
+
+    _check_value("1 + 2 * 3", 7);
+    _check_value("(1 + 2) * 3", 9);
+    _check_value("10 - 4 - 3", 3);
+    _check_value("64 / 4 / 2", 8);
+    _check_value("-5 - -3", -2);
+    _check_value("-(2 + 3) * 2", -10);
+    _check_value("1 << 2 ^ 1", 5);
+    _check_value("12 & 10 | 1", 9);
+    _check_value("3 < 4 == 1 && !0", 1);
+    _check_value("2 >= 3 || ~0 != -1", 0);
+    _check_value("17 % 5", 2);
+
+    /* the same program is used until the text changes */
+    _check_value("1 + 2 * 3", 7);
+
+    var = _eval(".1.3.6.1");
+    OKF(var && var->type == ASN_OBJECT_ID &&
+        var->val_len == sizeof(oid_const) &&
+        memcmp(var->val.objid, oid_const, sizeof(oid_const)) == 0,
+        ("OID constant"));
+    snmp_free_var(var);
+    var = _eval("\"a \\\"b\\\"\"");
+    OKF(var && var->type == ASN_OCTET_STR && var->val_len == 5 &&
+        memcmp(var->val.string, "a \"b\"", 5) == 0, ("string constant"));
+    snmp_free_var(var);
+
+    _check_error("7 / (3 - 3)", EXPERRCODE_DIVZERO, 2);
+    _check_error("(1 + 2", EXPERRCODE_PARENTHESIS, 6);
+    _check_error("1 + 2)", EXPERRCODE_PARENTHESIS, 5);
+    _check_error("1 + * 2", EXPERRCODE_SYNTAX, 4);
+    _check_error("1 2", EXPERRCODE_SYNTAX, 2);
+    _check_error("1 +", EXPERRCODE_SYNTAX, 3);
+    _check_error("1 # 2", EXPERRCODE_OPERATOR, 2);
+    _check_error("foo(1)", EXPERRCODE_FUNCTION, 0);
+    _check_error("$1 + 1", EXPERRCODE_INDEX, 0);
+
+    /*
+     * Expressions over MIB objects
+     */
+    netsnmp_config(line);
+    for (i = 1; i <= 3; i++) {
+        memcpy(inst, column_oid, sizeof(column_oid));
+        inst[OID_LENGTH(column_oid)] = i;
+        netsnmp_register_instance(
+            netsnmp_create_handler_registration("T039", _column_handler,
+                                                inst,
+                                                OID_LENGTH(column_oid) + 1,
+                                                HANDLER_CAN_RONLY));
+    }
+    netsnmp_register_instance(
+        netsnmp_create_handler_registration("T039 scalar", _scalar_handler,
+                                            scalar_oid,
+                                            OID_LENGTH(scalar_oid),
+                                            HANDLER_CAN_RONLY));
+    sess = netsnmp_iquery_user_session(NETSNMP_REMOVE_CONST(char *, "t039"));
+    OKF(sess != NULL, ("internal query session"));
+    if (!sess)
+        return 1;
+
+    wild  = _expression("wild",  "$1 + $2", EXPSAMPLETYPE_ABSOLUTE, sess);
+    delta = _expression("delta", "$1",      EXPSAMPLETYPE_DELTA,    sess);
+    OKF(wild && delta, ("wildcarded expressions"));
+    if (!wild || !delta)
+        return 1;
+
+    /* a wildcarded object, plus an exact instance, by index */
+    var = expValue_evaluateExpression(wild, suffix, OID_LENGTH(suffix));
+    OKF(var && var->type == ASN_INTEGER &&
+        *var->val.integer == 200 + 10 * (fetches[2] - 1) + 5 &&
+        _total() == 3, ("wildcarded $1 + $2 for .2 (%ld, %ld fetches)",
+                        var && var->val.integer ? *var->val.integer : 0,
+                        _total()));
+    snmp_free_var(var);
+    var = expValue_evaluateExpression(wild, missing, OID_LENGTH(missing));
+    OKF(!var && wild->expErrorCode == EXPERRCODE_INDEX,
+        ("no instance .9 (error %ld)", wild->expErrorCode));
+    snmp_free_var(var);
+    var = expValue_evaluateExpression(wild, NULL, 0);
+    OKF(!var && wild->expErrorCode == EXPERRCODE_INDEX,
+        ("wildcarded object without an instance (error %ld)",
+         wild->expErrorCode));
+    snmp_free_var(var);
+
+    /* each on-demand evaluation is a new delta sample */
+    total = _total();
+    var = expValue_evaluateExpression(delta, suffix, OID_LENGTH(suffix));
+    OKF(!var && delta->expErrorCode == EXPERRCODE_RESOURCE,
+        ("no delta from the first sample (error %ld)", delta->expErrorCode));
+    snmp_free_var(var);
+    for (i = 0; i < 2; i++) {
+        var = expValue_evaluateExpression(delta, suffix, OID_LENGTH(suffix));
+        OKF(var && var->type == ASN_INTEGER && *var->val.integer == 10 &&
+            _total() == total + 3 * (i + 2),
+            ("delta of 10 (%ld, %ld fetches)",
+             var && var->val.integer ? *var->val.integer : 0,
+             _total() - total));
+        snmp_free_var(var);
+    }
+
+    /*
+     * a walk of the expValueTable samples once, when it reaches the
+     * first instance, and finds the next instance in that sample
+     */
+    memset(&owner_var, 0, sizeof(owner_var));
+    memset(&name_var,  0, sizeof(name_var));
+    memset(&inst_var,  0, sizeof(inst_var));
+    owner_var.next_variable = &name_var;
+    name_var.next_variable  = &inst_var;
+    snmp_set_var_typed_value(&owner_var, ASN_OCTET_STR, "T039", 4);
+    snmp_set_var_typed_value(&name_var,  ASN_OCTET_STR, "delta", 5);
+    snmp_set_var_typed_value(&inst_var, ASN_PRIV_IMPLIED_OBJECT_ID, NULL, 0);
+    for (walk = 0; walk < 2; walk++) {
+        snmp_set_var_typed_value(&inst_var, ASN_PRIV_IMPLIED_OBJECT_ID,
+                                 NULL, 0);
+        total = _total();
+        for (i = 1; i <= 3; i++) {
+            var = expValueTable_getEntry(&owner_var, MODE_GETNEXT,
+                                         COLUMN_EXPVALUEINTEGER32VAL);
+            inst[0] = 0;
+            inst[1] = i;
+            OKF(var && *var->val.integer == 10 && _total() == total + 3 &&
+                inst_var.val_len == 2 * sizeof(oid) &&
+                memcmp(inst_var.val.objid, inst, 2 * sizeof(oid)) == 0,
+                ("walk %d finds .0.%d (%ld, %ld fetches)", walk, i,
+                 var && var->val.integer ? *var->val.integer : 0,
+                 _total() - total));
+            snmp_free_var(var);
+        }
+    }
+    snmp_free_var_internals(&owner_var);
+    snmp_free_var_internals(&name_var);
+    snmp_free_var_internals(&inst_var);
+
+    snmp_shutdown("T039");
+    shutdown_agent();
+
+    PLAN(__test_counter);
+    return 0;
+}
@@ -0,0 +1,181 @@
+/*
+ * HEADER Testing the value cache helper
+ *
+ * Injects a value cache above a handler that counts its calls, and checks
+ * that repeated GET and GETNEXT requests are answered from the cache
+ * until it is invalidated or disabled, and that nsCacheTable's hit and
+ * miss counters follow.  GETNEXT requests that differ only in being
+ * inclusive, or in their range, must not share cached values.
+ */
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/agent/net-snmp-agent-includes.h>
+#include <net-snmp/library/testing.h>
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+static const oid root_oid[]  = { 1, 3, 6, 1, 4, 1, 8072, 9999, 40 };
+static const oid value_oid[] = { 1, 3, 6, 1, 4, 1, 8072, 9999, 40, 1, 0 };
+static const oid next_oid[]  = { 1, 3, 6, 1, 4, 1, 8072, 9999, 40, 2, 0 };
+static long calls;
+
+static int
+_count_handler(netsnmp_mib_handler *handler,
+               netsnmp_handler_registration *reginfo,
+               netsnmp_agent_request_info *reqinfo,
+               netsnmp_request_info *requests)
+{
+    netsnmp_request_info *request;
+    netsnmp_variable_list *var;
+    int             cmp;
+
+    calls++;
+    for (request = requests; request; request = request->next) {
+        var = request->requestvb;
+        if (reqinfo->mode == MODE_GETNEXT) {
+            cmp = snmp_oid_compare(var->name, var->name_length,
+                                   value_oid, OID_LENGTH(value_oid));
+            if (cmp < 0 || (cmp == 0 && request->inclusive))
+                snmp_set_var_objid(var, value_oid, OID_LENGTH(value_oid));
+            else
+                snmp_set_var_objid(var, next_oid, OID_LENGTH(next_oid));
+        }
+        snmp_set_var_typed_integer(var, ASN_INTEGER, calls);
+    }
+    return SNMP_ERR_NOERROR;
+}
+
+/*
+ * @return the value returned for name, if it was returned for answer
+ */
+static long
+_request_range(netsnmp_handler_registration *reginfo, int mode,
+               int inclusive, const oid *name, size_t name_len,
+               oid *range_end, size_t range_end_len,
+               const oid *answer, size_t answer_len)
+{
+    netsnmp_agent_request_info reqinfo;
+    netsnmp_request_info request;
+    netsnmp_variable_list *var;
+    long            value = -1;
+
+    memset(&reqinfo, 0, sizeof(reqinfo));
+    memset(&request, 0, sizeof(request));
+    var = SNMP_MALLOC_TYPEDEF(netsnmp_variable_list);
+    if (!var)
+        return -1;
+    snmp_set_var_objid(var, name, name_len);
+    reqinfo.mode = mode;
+    request.requestvb = var;
+    request.inclusive = inclusive;
+    request.range_end = range_end;
+    request.range_end_len = range_end_len;
+    netsnmp_call_handlers(reginfo, &reqinfo, &request);
+    if (var->type == ASN_INTEGER &&
+        netsnmp_oid_equals(var->name, var->name_length,
+                           answer, answer_len) == 0)
+        value = *var->val.integer;
+    snmp_free_var(var);
+    return value;
+}
+
+static long
+_request(netsnmp_handler_registration *reginfo, int mode,
+         const oid *name, size_t name_len)
+{
+    return _request_range(reginfo, mode, 0, name, name_len, NULL, 0,
+                          value_oid, OID_LENGTH(value_oid));
+}
+
+int
+main(int argc, char *argv[])
+{
+    netsnmp_handler_registration *reginfo;
+    netsnmp_mib_handler *handler;
+    netsnmp_cache  *cache;
+
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DONT_READ_CONFIGS, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_LOAD, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_SAVE, 1);
+    init_agent("T040");
+    init_snmp("T040");
+
+    reginfo = netsnmp_create_handler_registration("T040", _count_handler,
+                                                  root_oid,
+                                                  OID_LENGTH(root_oid),
+                                                  HANDLER_CAN_RONLY);
+    handler = netsnmp_get_value_cache_handler(60, root_oid,
+                                              OID_LENGTH(root_oid));
+    OKF(reginfo && handler &&
+        netsnmp_inject_handler(reginfo, handler) == SNMPERR_SUCCESS,
+        ("value cache injected"));
+    if (!reginfo || !handler)
+        return 1;
+    cache = (netsnmp_cache *) handler->myvoid;
+    OKF(netsnmp_cache_find_by_oid(root_oid, OID_LENGTH(root_oid)) == cache,
+        ("value cache listed"));
+
+    OKF(_request(reginfo, MODE_GET, value_oid, OID_LENGTH(value_oid)) == 1,
+        ("first GET answered by the handler"));
+    OKF(_request(reginfo, MODE_GET, value_oid, OID_LENGTH(value_oid)) == 1 &&
+        calls == 1, ("second GET answered from the cache"));
+    OKF(_request(reginfo, MODE_GETNEXT, root_oid, OID_LENGTH(root_oid)) == 2,
+        ("GETNEXT is cached separately"));
+    OKF(_request(reginfo, MODE_GETNEXT, root_oid, OID_LENGTH(root_oid)) == 2 &&
+        calls == 2, ("second GETNEXT answered from the cache"));
+    OKF(cache->hits == 2 && cache->misses == 2,
+        ("%lu hits, %lu misses", cache->hits, cache->misses));
+
+    /* the same OID, asked for by GETNEXT and then inclusively */
+    OKF(_request_range(reginfo, MODE_GETNEXT, 0, value_oid,
+                       OID_LENGTH(value_oid), NULL, 0,
+                       next_oid, OID_LENGTH(next_oid)) == 3,
+        ("GETNEXT of the value answered by the handler"));
+    OKF(_request_range(reginfo, MODE_GETNEXT, 1, value_oid,
+                       OID_LENGTH(value_oid), NULL, 0,
+                       value_oid, OID_LENGTH(value_oid)) == 4,
+        ("inclusive GETNEXT of the value is not the cached GETNEXT"));
+    OKF(_request_range(reginfo, MODE_GETNEXT, 1, value_oid,
+                       OID_LENGTH(value_oid), NULL, 0,
+                       value_oid, OID_LENGTH(value_oid)) == 4 &&
+        calls == 4, ("second inclusive GETNEXT answered from the cache"));
+    OKF(_request_range(reginfo, MODE_GETNEXT, 0, value_oid,
+                       OID_LENGTH(value_oid), NULL, 0,
+                       next_oid, OID_LENGTH(next_oid)) == 3 &&
+        calls == 4, ("GETNEXT still answered from the cache"));
+    /* ... and within a range */
+    OKF(_request_range(reginfo, MODE_GETNEXT, 0, value_oid,
+                       OID_LENGTH(value_oid),
+                       NETSNMP_REMOVE_CONST(oid *, next_oid),
+                       OID_LENGTH(next_oid),
+                       next_oid, OID_LENGTH(next_oid)) == 5,
+        ("GETNEXT within a range is not the cached GETNEXT"));
+
+    netsnmp_cache_invalidate(cache);
+    OKF(_request(reginfo, MODE_GET, value_oid, OID_LENGTH(value_oid)) == 6,
+        ("GET answered by the handler after invalidation"));
+
+    cache->enabled = 0;
+    OKF(_request(reginfo, MODE_GET, value_oid, OID_LENGTH(value_oid)) == 7 &&
+        _request(reginfo, MODE_GET, value_oid, OID_LENGTH(value_oid)) == 8,
+        ("every GET answered by the handler when disabled"));
+    cache->enabled = 1;
+
+    cache->timeout = -1;
+    OKF(_request(reginfo, MODE_GET, value_oid, OID_LENGTH(value_oid)) == 9 &&
+        _request(reginfo, MODE_GET, value_oid, OID_LENGTH(value_oid)) == 10,
+        ("every GET answered by the handler once expired"));
+
+    netsnmp_handler_registration_free(reginfo);
+    snmp_shutdown("T040");
+    shutdown_agent();
+
+    PLAN(__test_counter);
+    return 0;
+}
@@ -0,0 +1,225 @@
+/*
+ * HEADER Testing (D)TLS session resumption
+ *
+ * Forks an agent listening for TLSTCP and DTLSUDP on the loopback, then
+ * repeatedly opens a session to it, sends a GET and closes the session
+ * again, first with session resumption disabled and then enabled.  Checks
+ * that the client resumes its sessions and that the agent still derives
+ * the right securityName from them.  The handshake rates are reported as
+ * a rough benchmark.
+ */
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/agent/net-snmp-agent-includes.h>
+#include <net-snmp/library/testing.h>
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#if defined(NETSNMP_TRANSPORT_TLSTCP_DOMAIN) && \
+    defined(NETSNMP_TRANSPORT_DTLSUDP_DOMAIN)
+#include <net-snmp/library/snmpTLSBaseDomain.h>
+#include "mibII/vacm_conf.h"
+
+#define NCONN   50
+
+static const oid sysUpTime_oid[] = { 1, 3, 6, 1, 2, 1, 1, 3, 0 };
+
+static int
+_gencert(const char *dir, const char *name)
+{
+    char            cmd[1024];
+
+    snprintf(cmd, sizeof(cmd),
+             "openssl req -x509 -newkey rsa:2048 -nodes -days 2"
+             " -subj /CN=%s -keyout %s/tls/private/%s.key"
+             " -out %s/tls/certs/%s.crt >/dev/null 2>&1",
+             name, dir, name, dir, name);
+    return system(cmd) == 0;
+}
+
+static void
+_run_agent(const char *ports)
+{
+    netsnmp_ds_set_string(NETSNMP_DS_APPLICATION_ID, NETSNMP_DS_AGENT_PORTS,
+                          ports);
+    netsnmp_ds_set_string(NETSNMP_DS_LIBRARY_ID,
+                          NETSNMP_DS_LIB_TLS_LOCAL_CERT, "agent");
+    init_agent("T041");
+    init_vacm_conf();
+    init_snmp("T041");
+    netsnmp_config("certSecName 10 client --sn tester");
+    netsnmp_config("rouser -s tsm tester authpriv");
+    if (init_master_agent() != 0)
+        exit(1);
+    for (;;)
+        agent_check_and_process(1);
+}
+
+/*
+ * open NCONN sessions one after the other, with a GET on each
+ *
+ * @return the number of GETs that were answered without an error
+ */
+static int
+_connect(const char *peer, double *rate)
+{
+    netsnmp_session session, *ss;
+    netsnmp_pdu    *pdu, *response;
+    struct timeval  start, end;
+    int             i, ok = 0;
+
+    netsnmp_get_monotonic_clock(&start);
+    for (i = 0; i < NCONN; i++) {
+        snmp_sess_init(&session);
+        session.peername = NETSNMP_REMOVE_CONST(char *, peer);
+        session.version = SNMP_VERSION_3;
+        session.timeout = 2000000;
+        session.retries = 1;
+        ss = snmp_open(&session);
+        if (!ss)
+            continue;
+        pdu = snmp_pdu_create(SNMP_MSG_GET);
+        snmp_add_null_var(pdu, sysUpTime_oid, OID_LENGTH(sysUpTime_oid));
+        response = NULL;
+        if (snmp_synch_response(ss, pdu, &response) == STAT_SUCCESS &&
+            response->errstat == SNMP_ERR_NOERROR)
+            ok++;
+        snmp_free_pdu(response);
+        snmp_close(ss);
+    }
+    netsnmp_get_monotonic_clock(&end);
+    *rate = NCONN / ((end.tv_sec - start.tv_sec) +
+                     (end.tv_usec - start.tv_usec) / 1e6);
+    return ok;
+}
+
+static void
+_test_transport(const char *peer)
+{
+    double          full_rate, resumed_rate;
+    u_long          resumed, full, resumed0, full0;
+    int             ok;
+
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_TLS_DISABLE_RESUMPTION, 1);
+    netsnmp_tlsbase_session_stats(&resumed0, &full0);
+    ok = _connect(peer, &full_rate);
+    netsnmp_tlsbase_session_stats(&resumed, &full);
+    OKF(ok == NCONN && resumed == resumed0 && full - full0 == NCONN,
+        ("%s: %d of %d answered, %lu full handshakes, without resumption",
+         peer, ok, NCONN, full - full0));
+
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_TLS_DISABLE_RESUMPTION, 0);
+    resumed0 = resumed;
+    full0 = full;
+    ok = _connect(peer, &resumed_rate);
+    netsnmp_tlsbase_session_stats(&resumed, &full);
+    OKF(ok == NCONN && resumed - resumed0 == NCONN - 1,
+        ("%s: %d of %d answered, %lu resumed handshakes", peer, ok, NCONN,
+         resumed - resumed0));
+
+    printf("# %s: %.0f handshakes/s without resumption, %.0f with\n",
+           peer, full_rate, resumed_rate);
+}
+#endif /* TLSTCP and DTLSUDP */
+
+int
+main(int argc, char *argv[])
+{
+#if defined(NETSNMP_TRANSPORT_TLSTCP_DOMAIN) && \
+    defined(NETSNMP_TRANSPORT_DTLSUDP_DOMAIN)
+    char            dir[] = "/tmp/T041XXXXXX";
+    char            path[256], ports[128], tlstcp[64], dtlsudp[64];
+    netsnmp_session session, *ss;
+    pid_t           pid;
+    int             port, i;
+
+    if (!mkdtemp(dir)) {
+        OK(0, "temporary directory");
+        PLAN(__test_counter);
+        return 1;
+    }
+    snprintf(path, sizeof(path), "%s/tls", dir);
+    mkdir(path, 0700);
+    snprintf(path, sizeof(path), "%s/tls/certs", dir);
+    mkdir(path, 0700);
+    snprintf(path, sizeof(path), "%s/tls/private", dir);
+    mkdir(path, 0700);
+    if (!_gencert(dir, "agent") || !_gencert(dir, "client")) {
+        OK(1, "no openssl command to create certificates with");
+        PLAN(__test_counter);
+        return 0;
+    }
+    setenv("SNMPCONFPATH", dir, 1);
+
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DONT_READ_CONFIGS, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_LOAD, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_SAVE, 1);
+    netsnmp_ds_set_string(NETSNMP_DS_LIBRARY_ID,
+                          NETSNMP_DS_LIB_PERSISTENT_DIR, dir);
+
+    port = 20000 + getpid() % 10000;
+    snprintf(tlstcp, sizeof(tlstcp), "tlstcp:127.0.0.1:%d", port);
+    snprintf(dtlsudp, sizeof(dtlsudp), "dtlsudp:127.0.0.1:%d", port);
+    snprintf(ports, sizeof(ports), "%s,%s", tlstcp, dtlsudp);
+
+    /* either side may write to a connection the other has just closed */
+    signal(SIGPIPE, SIG_IGN);
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0)
+        _run_agent(ports);
+
+    netsnmp_ds_set_string(NETSNMP_DS_LIBRARY_ID,
+                          NETSNMP_DS_LIB_TLS_LOCAL_CERT, "client");
+    netsnmp_ds_set_string(NETSNMP_DS_LIBRARY_ID,
+                          NETSNMP_DS_LIB_TLS_PEER_CERT, "agent");
+    init_snmp("T041");
+
+    /* wait for the agent to listen */
+    for (i = 0, ss = NULL; !ss && i < 50 && pid > 0; i++) {
+        usleep(100000);
+        snmp_sess_init(&session);
+        session.peername = tlstcp;
+        session.version = SNMP_VERSION_3;
+        ss = snmp_open(&session);
+    }
+    OKF(ss != NULL, ("agent listening on %s", ports));
+    if (ss) {
+        snmp_close(ss);
+        _test_transport(tlstcp);
+        _test_transport(dtlsudp);
+    }
+
+    if (pid > 0) {
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+    }
+    snmp_shutdown("T041");
+    snprintf(path, sizeof(path), "rm -rf %s", dir);
+    if (system(path) != 0)
+        printf("# could not remove %s\n", dir);
+#else
+    OK(1, "no TLSTCP and DTLSUDP support");
+#endif
+
+    PLAN(__test_counter);
+    return 0;
+}
@@ -0,0 +1,258 @@
+/*
+ * HEADER Testing the com2sec index
+ *
+ * Checks that looking up a community and source address in the com2sec
+ * index still returns the first matching entry in configuration order,
+ * including negative entries and masks that are not prefix lengths.
+ * Then compares the index with a walk of the list for random lookups
+ * against NENTRY entries and reports the lookup rates as a comment.
+ */
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/library/snmpUDPDomain.h>
+#ifdef NETSNMP_TRANSPORT_UDPIPV6_DOMAIN
+#include <net-snmp/library/snmpUDPIPv6Domain.h>
+#endif
+#include <net-snmp/library/testing.h>
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_NETINET_IN_H
+#include <netinet/in.h>
+#endif
+#ifdef HAVE_ARPA_INET_H
+#include <arpa/inet.h>
+#endif
+
+#if !defined(NETSNMP_DISABLE_SNMPV1) || !defined(NETSNMP_DISABLE_SNMPV2C)
+
+#define NENTRY   10000
+#define NCOMM    1000
+#define NLOOKUP  100000
+#define NCHECK   20000
+
+static struct {
+    char            community[16];
+    char            secName[16];
+    in_addr_t       network, mask;
+    int             negate;
+} entries[NENTRY];
+
+static const char *
+_lookup(const char *community, const char *addr)
+{
+    netsnmp_indexed_addr_pair pair;
+    struct sockaddr_in *from = (struct sockaddr_in *) &pair.remote_addr;
+    const char     *secName = NULL, *contextName = NULL;
+
+    memset(&pair, 0, sizeof(pair));
+    from->sin_family = AF_INET;
+    inet_pton(AF_INET, addr, &from->sin_addr);
+    netsnmp_udp_getSecName(&pair, sizeof(pair), community,
+                           strlen(community), &secName, &contextName);
+    return secName;
+}
+
+static com2SecEntry *
+_add(const char *community, const char *secName, const char *network,
+     const char *mask, int negate)
+{
+    struct in_addr  n, m;
+    com2SecEntry   *e = NULL;
+
+    inet_pton(AF_INET, network, &n);
+    inet_pton(AF_INET, mask, &m);
+    netsnmp_udp_com2SecEntry_create(&e, community, secName, NULL, &n, &m,
+                                    negate);
+    return e;
+}
+
+static int
+_check(const char *community, const char *addr, const char *expected)
+{
+    const char     *secName = _lookup(community, addr);
+
+    return expected ? secName && strcmp(secName, expected) == 0 : !secName;
+}
+
+#ifdef NETSNMP_TRANSPORT_UDPIPV6_DOMAIN
+static int
+_check6(const char *community, const char *addr, const char *expected)
+{
+    netsnmp_indexed_addr_pair pair;
+    struct sockaddr_in6 *from = (struct sockaddr_in6 *) &pair.remote_addr;
+    const char     *secName = NULL, *contextName = NULL;
+
+    memset(&pair, 0, sizeof(pair));
+    from->sin6_family = AF_INET6;
+    inet_pton(AF_INET6, addr, &from->sin6_addr);
+    netsnmp_udp6_getSecName(&pair, sizeof(pair), community,
+                            strlen(community), &secName, &contextName);
+    return expected ? secName && strcmp(secName, expected) == 0 : !secName;
+}
+#endif
+
+/* what walking the list used to do */
+static int
+_walk(const char *community, size_t community_len, in_addr_t addr)
+{
+    int             i;
+
+    for (i = 0; i < NENTRY; i++)
+        if (community_len == strlen(entries[i].community) &&
+            memcmp(community, entries[i].community, community_len) == 0 &&
+            (addr & entries[i].mask) == entries[i].network)
+            return entries[i].negate ? -1 : i;
+    return -1;
+}
+#endif /* support for community based SNMP */
+
+int
+main(int argc, char *argv[])
+{
+#if !defined(NETSNMP_DISABLE_SNMPV1) || !defined(NETSNMP_DISABLE_SNMPV2C)
+    netsnmp_indexed_addr_pair pair;
+    struct sockaddr_in *from = (struct sockaddr_in *) &pair.remote_addr;
+    com2SecEntry   *broad;
+    const char     *secName, *contextName;
+    static char     communities[NLOOKUP][16];
+    static in_addr_t addrs[NLOOKUP];
+    struct timeval  start, end;
+    double          indexed, walked;
+    int             i, j, bits, wrong, expected;
+
+    _add("public", "broad", "10.0.0.0", "255.0.0.0", 0);
+    _add("public", "narrow", "10.1.0.0", "255.255.0.0", 0);
+    _add("private", "deny", "10.9.0.0", "255.255.0.0", 1);
+    _add("private", "ok", "10.0.0.0", "255.0.0.0", 0);
+    _add("odd", "odd", "10.0.0.5", "255.0.0.255", 0);
+    _add("odd", "odd2", "10.1.0.0", "255.255.0.0", 0);
+    _add("any", "any", "0.0.0.0", "0.0.0.0", 0);
+    _add("host", "host", "192.0.2.1", "255.255.255.255", 0);
+
+    OKF(_check("public", "10.1.2.3", "broad"),
+        ("an earlier broader entry wins over a later narrower one"));
+    OKF(_check("private", "10.9.1.1", NULL),
+        ("a matching negative entry matches nothing"));
+    OKF(_check("private", "10.8.1.1", "ok"),
+        ("entries after a negative one are used"));
+    OKF(_check("odd", "10.7.7.5", "odd") && _check("odd", "10.1.7.6", "odd2"),
+        ("masks that are not prefix lengths"));
+    OKF(_check("any", "203.0.113.9", "any"), ("default source"));
+    OKF(_check("host", "192.0.2.1", "host") && _check("host", "192.0.2.2", NULL),
+        ("host source"));
+    OKF(_check("nobody", "10.1.2.3", NULL) && _check("publi", "10.1.2.3", NULL),
+        ("unknown community"));
+
+    broad = _add("public", "later", "10.2.0.0", "255.255.0.0", 0);
+    OKF(_check("public", "10.2.0.1", "broad"), ("entry added after a lookup"));
+    netsnmp_udp_com2SecList_remove(broad);
+    netsnmp_udp_com2Sec_free(broad);
+    OKF(_check("public", "10.2.0.1", "broad"), ("entry removed"));
+
+    netsnmp_udp_com2SecList_free();
+    OKF(_check("public", "10.1.2.3", NULL), ("list freed"));
+
+#ifdef NETSNMP_TRANSPORT_UDPIPV6_DOMAIN
+    {
+        char            line[] = "broad 2001:db8::/32 public";
+        char            line2[] = "narrow 2001:db8:1::/48 public";
+        char            line3[] = "deny !2001:db8:2::/48 private";
+        char            line4[] = "ok 2001:db8::/32 private";
+
+        netsnmp_udp6_parse_security("com2sec6", line);
+        netsnmp_udp6_parse_security("com2sec6", line2);
+        netsnmp_udp6_parse_security("com2sec6", line3);
+        netsnmp_udp6_parse_security("com2sec6", line4);
+        OKF(_check6("public", "2001:db8:1::1", "broad") &&
+            _check6("public", "2001:db9::1", NULL),
+            ("com2sec6: first matching entry"));
+        OKF(_check6("private", "2001:db8:2::1", NULL) &&
+            _check6("private", "2001:db8:3::1", "ok"),
+            ("com2sec6: negative entry"));
+        netsnmp_udp6_com2Sec6List_free();
+    }
+#endif
+
+    /*
+     * NCOMM communities with NENTRY / NCOMM random networks each, some of
+     * them negative.
+     */
+    srandom(42);
+    for (i = 0; i < NENTRY; i++) {
+        bits = 8 + random() % 25;
+        snprintf(entries[i].community, sizeof(entries[i].community),
+                 "community%d", (int)(random() % NCOMM));
+        snprintf(entries[i].secName, sizeof(entries[i].secName), "sec%d", i);
+        entries[i].mask = htonl(bits == 32 ? 0xffffffffU :
+                                ~(0xffffffffU >> bits));
+        entries[i].network = htonl(0x0a000000U | (random() & 0xffffff)) &
+            entries[i].mask;
+        entries[i].negate = random() % 20 == 0;
+        netsnmp_udp_com2SecEntry_create(NULL, entries[i].community,
+                                        entries[i].secName, NULL,
+                                        (struct in_addr *) &entries[i].network,
+                                        (struct in_addr *) &entries[i].mask,
+                                        entries[i].negate);
+    }
+    /* mostly addresses within the network of some entry */
+    for (i = 0; i < NLOOKUP; i++) {
+        j = random() % NENTRY;
+        strcpy(communities[i], random() % 4 ? entries[j].community :
+               entries[random() % NENTRY].community);
+        addrs[i] = entries[j].network |
+            (htonl(random() & 0xffffff) & ~entries[j].mask);
+    }
+
+    memset(&pair, 0, sizeof(pair));
+    from->sin_family = AF_INET;
+    wrong = 0;
+    for (i = 0; i < NCHECK; i++) {
+        from->sin_addr.s_addr = addrs[i];
+        secName = NULL;
+        netsnmp_udp_getSecName(&pair, sizeof(pair), communities[i],
+                               strlen(communities[i]), &secName,
+                               &contextName);
+        expected = _walk(communities[i], strlen(communities[i]), addrs[i]);
+        if (expected < 0 ? secName != NULL :
+            !secName || strcmp(secName, entries[expected].secName) != 0)
+            wrong++;
+    }
+    OKF(wrong == 0, ("%d of %d lookups in %d entries differ from the list",
+                     wrong, NCHECK, NENTRY));
+
+    netsnmp_get_monotonic_clock(&start);
+    for (i = 0; i < NLOOKUP; i++) {
+        from->sin_addr.s_addr = addrs[i];
+        netsnmp_udp_getSecName(&pair, sizeof(pair), communities[i],
+                               strlen(communities[i]), &secName,
+                               &contextName);
+    }
+    netsnmp_get_monotonic_clock(&end);
+    indexed = NLOOKUP / ((end.tv_sec - start.tv_sec) +
+                         (end.tv_usec - start.tv_usec) / 1e6);
+
+    netsnmp_get_monotonic_clock(&start);
+    for (i = 0, j = 0; i < NCHECK; i++)
+        j += _walk(communities[i], strlen(communities[i]), addrs[i]) >= 0;
+    netsnmp_get_monotonic_clock(&end);
+    walked = NCHECK / ((end.tv_sec - start.tv_sec) +
+                       (end.tv_usec - start.tv_usec) / 1e6);
+    printf("# %d entries, %d%% matching: %.0f lookups/s indexed,"
+           " %.0f walking the list\n", NENTRY, j * 100 / NCHECK, indexed,
+           walked);
+
+    netsnmp_udp_com2SecList_free();
+#else
+    OK(1, "no community based SNMP");
+#endif
+
+    PLAN(__test_counter);
+    return 0;
+}
@@ -0,0 +1,63 @@
+/* HEADER Testing source address filtering */
+
+struct sockaddr_in sin;
+#ifdef NETSNMP_ENABLE_IPV6
+struct sockaddr_in6 sin6;
+#endif
+
+netsnmp_container_init_list();
+
+memset(&sin, 0, sizeof(sin));
+sin.sin_family = AF_INET;
+
+OKF(netsnmp_transport_filter_add("192.0.2.0/24") == 0, ("add network"));
+OKF(netsnmp_transport_filter_add("192.0.2.7") == 0, ("add host"));
+OKF(netsnmp_transport_filter_add("10.0.0.0/8") == 0, ("add another network"));
+OKF(netsnmp_transport_filter_add("10.0.0.1/8") != 0, ("host bits set"));
+OKF(netsnmp_transport_filter_add("10.0.0.0/33") != 0, ("prefix too long"));
+
+inet_pton(AF_INET, "192.0.2.9", &sin.sin_addr);
+OKF(netsnmp_transport_filter_check_addr((struct sockaddr *) &sin) == 1,
+    ("address within network"));
+inet_pton(AF_INET, "192.0.2.7", &sin.sin_addr);
+OKF(netsnmp_transport_filter_check_addr((struct sockaddr *) &sin) == 1,
+    ("host address"));
+inet_pton(AF_INET, "192.0.3.1", &sin.sin_addr);
+OKF(netsnmp_transport_filter_check_addr((struct sockaddr *) &sin) == 0,
+    ("address outside networks"));
+OKF(netsnmp_transport_filter_check("10.20.30.40") == 1 &&
+    netsnmp_transport_filter_check("11.0.0.1") == 0,
+    ("string form of addresses"));
+OKF(netsnmp_transport_filter_hits("192.0.2.0/24") == 1 &&
+    netsnmp_transport_filter_hits("192.0.2.7") == 1 &&
+    netsnmp_transport_filter_hits("10.0.0.0/8") == 1 &&
+    netsnmp_transport_filter_hits("10.0.0.0/9") == -1,
+    ("matches are counted per entry, longest prefix first"));
+
+OKF(netsnmp_transport_filter_remove("192.0.2.7") == 0, ("remove host"));
+inet_pton(AF_INET, "192.0.2.7", &sin.sin_addr);
+OKF(netsnmp_transport_filter_check_addr((struct sockaddr *) &sin) == 1 &&
+    netsnmp_transport_filter_hits("192.0.2.0/24") == 2,
+    ("network matches after removing host"));
+
+#ifdef NETSNMP_ENABLE_IPV6
+memset(&sin6, 0, sizeof(sin6));
+sin6.sin6_family = AF_INET6;
+OKF(netsnmp_transport_filter_add("2001:db8::/32") == 0, ("add IPv6 network"));
+inet_pton(AF_INET6, "2001:db8:1::1", &sin6.sin6_addr);
+OKF(netsnmp_transport_filter_check_addr((struct sockaddr *) &sin6) == 1,
+    ("IPv6 address within network"));
+inet_pton(AF_INET6, "2001:db9::1", &sin6.sin6_addr);
+OKF(netsnmp_transport_filter_check_addr((struct sockaddr *) &sin6) == 0,
+    ("IPv6 address outside network"));
+#endif
+
+OKF(netsnmp_transport_filter_add("/var/run/agentx") == 0 &&
+    netsnmp_transport_filter_check("/var/run/agentx") == 1,
+    ("other entries are compared as strings"));
+OKF(netsnmp_transport_filter_check_addr((struct sockaddr *) &sin) == -1,
+    ("string entries need the formatted address"));
+
+netsnmp_transport_filter_cleanup();
+OKF(netsnmp_transport_filter_check("192.0.2.9") == 0 &&
+    netsnmp_transport_filter_hits("192.0.2.0/24") == -1, ("cleanup"));
@@ -0,0 +1,280 @@
+/*
+ * HEADER Testing compiled VACM views and the access decision cache
+ *
+ * Builds a large view with and without wildcarded subtrees, and checks
+ * that lookups in its compiled form agree with netsnmp_view_get() on the
+ * same entries, also after the view has been changed.  Then checks that
+ * vacm_check_view_contents() follows changes to the access and view
+ * tables, and reports the rate of per-varbind view checks.
+ */
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/agent/net-snmp-agent-includes.h>
+#include <net-snmp/library/testing.h>
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include "mibII/vacm_conf.h"
+
+#define NVIEWS  2000
+#define NCHECK  20000
+#define NBENCH  500000
+
+/* exported by vacm.c, but not declared in its header */
+struct vacm_viewEntry *netsnmp_view_create(struct vacm_viewEntry **head,
+                                           const char *viewName,
+                                           oid * viewSubtree,
+                                           size_t viewSubtreeLen);
+void            netsnmp_view_destroy(struct vacm_viewEntry **head,
+                                     const char *viewName,
+                                     oid * viewSubtree,
+                                     size_t viewSubtreeLen);
+void            netsnmp_view_clear(struct vacm_viewEntry **head);
+
+static struct vacm_viewEntry *reference;
+
+/*
+ * adds the same view subtree to the VACM table and the reference list
+ */
+static void
+_add_view(const char *view, const oid *subtree, size_t len,
+          const u_char *mask, size_t masklen, int type)
+{
+    struct vacm_viewEntry *vp, *rp;
+
+    vp = vacm_createViewEntry(view, NETSNMP_REMOVE_CONST(oid *, subtree),
+                              len);
+    rp = netsnmp_view_create(&reference, view,
+                             NETSNMP_REMOVE_CONST(oid *, subtree), len);
+    if (!vp || !rp)
+        return;
+    vp->viewType = rp->viewType = type;
+    vp->viewMaskLen = rp->viewMaskLen = masklen;
+    if (masklen) {
+        memcpy(vp->viewMask, mask, masklen);
+        memcpy(rp->viewMask, mask, masklen);
+    }
+    vp->viewStatus = rp->viewStatus = RS_ACTIVE;
+}
+
+static void
+_random_oid(oid *name, size_t *len)
+{
+    size_t          i;
+
+    name[0] = 1;
+    name[1] = 3;
+    name[2] = 6;
+    name[3] = 1;
+    *len = 5 + random() % 8;
+    for (i = 4; i < *len; i++)
+        name[i] = random() % 4;
+}
+
+/*
+ * returns the number of names for which the compiled view and the
+ * reference list disagree
+ */
+static int
+_compare(const char *view)
+{
+    struct vacm_viewEntry *vp, *rp;
+    oid             name[MAX_OID_LEN];
+    size_t          len;
+    int             i, bad = 0;
+
+    for (i = 0; i < NCHECK; i++) {
+        _random_oid(name, &len);
+        vp = vacm_getViewEntry(view, name, len, VACM_MODE_FIND);
+        rp = netsnmp_view_get(reference, view, name, len, VACM_MODE_FIND);
+        if (!vp != !rp ||
+            (vp && (vp->viewType != rp->viewType ||
+                    snmp_oid_compare(vp->viewSubtree, vp->viewSubtreeLen,
+                                     rp->viewSubtree,
+                                     rp->viewSubtreeLen) != 0)))
+            bad++;
+    }
+    return bad;
+}
+
+static double
+_elapsed(const struct timeval *start)
+{
+    struct timeval  end;
+
+    netsnmp_get_monotonic_clock(&end);
+    return (end.tv_sec - start->tv_sec) +
+        (end.tv_usec - start->tv_usec) / 1e6;
+}
+
+int
+main(int argc, char *argv[])
+{
+    static const oid mib2[] = { 1, 3, 6, 1, 2, 1 };
+    static const oid sysDescr[] = { 1, 3, 6, 1, 2, 1, 1, 1, 0 };
+    static const oid ifDescr[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 2, 1 };
+    static const oid ifEntry[] = { 1, 3, 6, 1, 2, 1, 2, 2, 1, 0, 1 };
+    static const u_char ifMask[] = { 0xff, 0xa0 };
+    struct vacm_groupEntry *gp;
+    struct vacm_accessEntry *ap;
+    struct vacm_viewEntry *rp;
+    netsnmp_pdu     pdu;
+    oid             name[MAX_OID_LEN];
+    size_t          len;
+    u_char          mask[2];
+    struct timeval  start;
+    double          compiled_time, linear_time;
+    int             i, hits;
+
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DONT_READ_CONFIGS, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_LOAD, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_SAVE, 1);
+    init_agent("T044");
+    init_vacm_conf();
+    init_snmp("T044");
+
+    /*
+     * a large view, partly with wildcards
+     */
+    srandom(44);
+    for (i = 0; i < NVIEWS; i++) {
+        _random_oid(name, &len);
+        if (i % 10 == 0 || i % 50 == 5) {
+            mask[0] = i % 10 ? (u_char) (random() & 0xff) : 0xff;
+            mask[1] = (u_char) (random() & 0xff);
+            _add_view("big", name, len, mask, 2,
+                      i % 3 ? SNMP_VIEW_INCLUDED : SNMP_VIEW_EXCLUDED);
+        } else
+            _add_view("big", name, len, NULL, 0,
+                      i % 3 ? SNMP_VIEW_INCLUDED : SNMP_VIEW_EXCLUDED);
+    }
+    _add_view("big", mib2, 4, NULL, 0, SNMP_VIEW_INCLUDED);
+    OKF(_compare("big") == 0, ("compiled view matches the view list"));
+
+    /*
+     * the compiled view has to follow changes to the view table
+     */
+    vacm_destroyViewEntry("big", NETSNMP_REMOVE_CONST(oid *, mib2), 4);
+    netsnmp_view_destroy(&reference, "big",
+                         NETSNMP_REMOVE_CONST(oid *, mib2), 4);
+    for (i = 0; i < NVIEWS / 10; i++) {
+        _random_oid(name, &len);
+        _add_view("big", name, len, NULL, 0, SNMP_VIEW_EXCLUDED);
+    }
+    OKF(_compare("big") == 0, ("compiled view matches after changes"));
+    OKF(_compare("nosuchview") == 0, ("unknown views match nothing"));
+
+    /*
+     * access decisions
+     */
+    _add_view("small", mib2, OID_LENGTH(mib2), NULL, 0, SNMP_VIEW_INCLUDED);
+    _add_view("small", ifEntry, OID_LENGTH(ifEntry), ifMask, sizeof(ifMask),
+              SNMP_VIEW_EXCLUDED);
+    gp = vacm_createGroupEntry(SNMP_SEC_MODEL_USM, "tester");
+    if (gp) {
+        strlcpy(gp->groupName, "testers", sizeof(gp->groupName));
+        gp->status = RS_ACTIVE;
+    }
+    ap = vacm_createAccessEntry("testers", "", SNMP_SEC_MODEL_USM,
+                                SNMP_SEC_LEVEL_NOAUTH);
+    if (ap) {
+        strlcpy(ap->views[VACM_VIEW_READ], "small",
+                sizeof(ap->views[VACM_VIEW_READ]));
+        ap->contextMatch = CONTEXT_MATCH_EXACT;
+        ap->status = RS_ACTIVE;
+    }
+    OKF(gp && ap, ("group and access entries"));
+    if (!gp || !ap)
+        return 1;
+
+    memset(&pdu, 0, sizeof(pdu));
+    pdu.version = SNMP_VERSION_3;
+    pdu.securityModel = SNMP_SEC_MODEL_USM;
+    pdu.securityLevel = SNMP_SEC_LEVEL_AUTHNOPRIV;
+    pdu.securityName = NETSNMP_REMOVE_CONST(char *, "tester");
+    pdu.securityNameLen = 6;
+
+#define CHECK(oid_) \
+    vacm_check_view_contents(&pdu, NETSNMP_REMOVE_CONST(oid *, oid_), \
+                             OID_LENGTH(oid_), 0, VACM_VIEW_READ, \
+                             VACM_CHECK_VIEW_CONTENTS_DNE_CONTEXT_OK)
+
+    OKF(CHECK(sysDescr) == VACM_SUCCESS, ("sysDescr is in view"));
+    OKF(CHECK(ifDescr) == VACM_NOTINVIEW, ("ifDescr is excluded"));
+    pdu.securityName = NETSNMP_REMOVE_CONST(char *, "nobody");
+    OKF(CHECK(sysDescr) == VACM_NOGROUP, ("unknown user has no group"));
+    pdu.securityName = NETSNMP_REMOVE_CONST(char *, "tester");
+
+    strlcpy(ap->views[VACM_VIEW_READ], "big",
+            sizeof(ap->views[VACM_VIEW_READ]));
+    vacm_tablesChanged();
+    rp = netsnmp_view_get(reference, "big",
+                          NETSNMP_REMOVE_CONST(oid *, sysDescr),
+                          OID_LENGTH(sysDescr), VACM_MODE_FIND);
+    OKF(CHECK(sysDescr) == (!rp ? VACM_NOVIEW :
+                            rp->viewType == SNMP_VIEW_INCLUDED ?
+                            VACM_SUCCESS : VACM_NOTINVIEW),
+        ("access entry changed in place"));
+    strlcpy(ap->views[VACM_VIEW_READ], "small",
+            sizeof(ap->views[VACM_VIEW_READ]));
+    vacm_tablesChanged();
+
+    vacm_destroyAccessEntry("testers", "", SNMP_SEC_MODEL_USM,
+                            SNMP_SEC_LEVEL_NOAUTH);
+    OKF(CHECK(sysDescr) == VACM_NOACCESS, ("access entry removed"));
+    ap = vacm_createAccessEntry("testers", "", SNMP_SEC_MODEL_USM,
+                                SNMP_SEC_LEVEL_NOAUTH);
+    if (ap) {
+        strlcpy(ap->views[VACM_VIEW_READ], "big",
+                sizeof(ap->views[VACM_VIEW_READ]));
+        ap->contextMatch = CONTEXT_MATCH_EXACT;
+        ap->status = RS_ACTIVE;
+    }
+    OKF(ap != NULL, ("access entry recreated"));
+    if (!ap)
+        return 1;
+
+    /*
+     * per-varbind checks against the large view, compiled and walked
+     */
+    _random_oid(name, &len);
+    hits = 0;
+    netsnmp_get_monotonic_clock(&start);
+    for (i = 0; i < NBENCH; i++) {
+        name[len - 1] = i & 3;
+        if (vacm_check_view_contents(&pdu, name, len, 0, VACM_VIEW_READ,
+                                     VACM_CHECK_VIEW_CONTENTS_DNE_CONTEXT_OK)
+            == VACM_SUCCESS)
+            hits++;
+    }
+    compiled_time = _elapsed(&start);
+    netsnmp_get_monotonic_clock(&start);
+    for (i = 0; i < NBENCH / 100; i++) {
+        name[len - 1] = i & 3;
+        rp = netsnmp_view_get(reference, "big", name, len, VACM_MODE_FIND);
+        if (rp && rp->viewType == SNMP_VIEW_INCLUDED)
+            hits++;
+    }
+    linear_time = _elapsed(&start) * 100;
+    printf("# %d views: %.0f checks/s cached and compiled,"
+           " %.0f walking the view list (%d in view)\n",
+           NVIEWS, NBENCH / compiled_time, NBENCH / linear_time, hits);
+    OK(1, "benchmark");
+
+    netsnmp_view_clear(&reference);
+    snmp_shutdown("T044");
+    shutdown_agent();
+
+    PLAN(__test_counter);
+    return 0;
+}
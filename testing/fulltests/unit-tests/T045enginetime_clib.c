@@ -0,0 +1,62 @@
+/* HEADER Testing the engine time list */
+
+#define NENGINES 100000
+#define ENGINE(n) (id[8] = (u_char) ((n) >> 24), id[9] = (u_char) ((n) >> 16), \
+                   id[10] = (u_char) ((n) >> 8), id[11] = (u_char) (n), id)
+
+u_char          id[12] = { 0x80, 0x00, 0x1f, 0x88, 0x04 };
+u_int           boots, etime, last;
+struct timeval  start, end;
+double          set_rate, get_rate;
+int             i, ok;
+
+netsnmp_get_monotonic_clock(&start);
+for (i = 0, ok = 0; i < NENGINES; i++)
+    if (set_enginetime(ENGINE(i), sizeof(id), i % 7, i, TRUE) ==
+        SNMPERR_SUCCESS)
+        ok++;
+netsnmp_get_monotonic_clock(&end);
+set_rate = NENGINES / ((end.tv_sec - start.tv_sec) +
+                       (end.tv_usec - start.tv_usec) / 1e6);
+OKF(ok == NENGINES, ("%d of %d engines recorded", ok, NENGINES));
+
+netsnmp_get_monotonic_clock(&start);
+for (i = 0, ok = 0; i < NENGINES; i++)
+    if (get_enginetime_ex(ENGINE(i), sizeof(id), &boots, &etime, &last,
+                          TRUE) == SNMPERR_SUCCESS &&
+        boots == (u_int) i % 7 && last == (u_int) i)
+        ok++;
+netsnmp_get_monotonic_clock(&end);
+get_rate = NENGINES / ((end.tv_sec - start.tv_sec) +
+                       (end.tv_usec - start.tv_usec) / 1e6);
+OKF(ok == NENGINES, ("%d of %d engines found", ok, NENGINES));
+printf("# %d engines: %.0f set_enginetime()/s, %.0f get_enginetime_ex()/s\n",
+       NENGINES, set_rate, get_rate);
+
+OKF(get_enginetime(ENGINE(NENGINES), sizeof(id), &boots, &etime, TRUE) ==
+    SNMPERR_GENERR, ("unknown engine"));
+
+free_enginetime(ENGINE(5), sizeof(id));
+OKF(search_enginetime_list(ENGINE(5), sizeof(id)) == NULL &&
+    search_enginetime_list(ENGINE(6), sizeof(id)) != NULL &&
+    search_enginetime_list(ENGINE(5 + ETIMELIST_SIZE), sizeof(id)) != NULL,
+    ("only the freed engine is forgotten"));
+
+/* engines not used for a second are dropped when the next one is added */
+netsnmp_ds_set_int(NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_ENGINETIME_EXPIRY, 1);
+sleep(2);
+get_enginetime(ENGINE(7), sizeof(id), &boots, &etime, TRUE);
+set_enginetime(ENGINE(NENGINES), sizeof(id), 1, 1, TRUE);
+OKF(search_enginetime_list(ENGINE(7), sizeof(id)) != NULL &&
+    search_enginetime_list(ENGINE(NENGINES), sizeof(id)) != NULL &&
+    search_enginetime_list(ENGINE(8), sizeof(id)) == NULL &&
+    search_enginetime_list(ENGINE(NENGINES - 1), sizeof(id)) == NULL,
+    ("idle engines expired"));
+netsnmp_ds_set_int(NETSNMP_DS_LIBRARY_ID, NETSNMP_DS_LIB_ENGINETIME_EXPIRY, 0);
+
+free_etimelist();
+OKF(search_enginetime_list(ENGINE(7), sizeof(id)) == NULL &&
+    set_enginetime(ENGINE(7), sizeof(id), 1, 1, TRUE) == SNMPERR_SUCCESS &&
+    search_enginetime_list(ENGINE(7), sizeof(id)) != NULL,
+    ("list freed and reused"));
+free_etimelist();
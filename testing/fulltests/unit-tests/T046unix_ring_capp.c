@@ -0,0 +1,652 @@
+/*
+ * HEADER Testing shared memory rings on Unix domain connections
+ *
+ * Forks an echo server on a Unix domain socket, then talks to it over a
+ * plain connection and over one that was moved onto shared memory rings
+ * with netsnmp_unix_ring_offer().  Checks that messages of odd sizes come
+ * back intact, also when they wrap around the end of the ring or do not
+ * fit into it (the sender waits for the echo server to make room), that a PDU
+ * sent by a session makes it there and back, and reports round trip
+ * latency and throughput for both as a benchmark.
+ *
+ * Then plays a misbehaving peer: checks that a refused offer leaves the
+ * transport alone, that the server refuses a memfd whose size is not
+ * sealed, and that it goes back to the socket when the head or tail of a
+ * ring is corrupted.
+ */
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/library/testing.h>
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <signal.h>
+#include <sys/wait.h>
+
+#ifdef NETSNMP_TRANSPORT_UNIX_DOMAIN
+#include <net-snmp/library/snmpUnixDomain.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/* the same test as in snmpUnixDomain.c */
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_SYS_EVENTFD_H) && \
+    defined(HAVE_SYS_MMAN_H) && defined(HAVE_MEMFD_CREATE) && \
+    defined(__GNUC__)
+#include <stdint.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#if defined(MFD_ALLOW_SEALING) && defined(F_GET_SEALS)
+#define RING 1
+#endif
+#endif
+
+#define NPING    20000
+#define NBULK    20000
+#define MSGLEN   100
+#define BULKLEN  1000
+#define WINDOW   16
+#define MAXLEN   4093
+#define FULLLEN  (2 * 64 * 1024 - 1000)
+
+static u_char   rxbuf[65536];
+
+/*
+ * receives exactly len bytes
+ *
+ * @return 0 on success, -1 if the connection failed or was closed
+ */
+static int
+_recv_all(netsnmp_transport *t, u_char *buf, int len)
+{
+    void           *opaque;
+    int             olength, got = 0, rc;
+    fd_set          fdset;
+
+    while (got < len) {
+        FD_ZERO(&fdset);
+        FD_SET(t->sock, &fdset);
+        if (select(t->sock + 1, &fdset, NULL, NULL, NULL) < 0)
+            return -1;
+        opaque = NULL;
+        rc = t->f_recv(t, buf + got, len - got, &opaque, &olength);
+        free(opaque);
+        if (rc == 0 && (t->flags & NETSNMP_TRANSPORT_FLAG_EMPTY_PKT)) {
+            t->flags &= ~NETSNMP_TRANSPORT_FLAG_EMPTY_PKT;
+            continue;
+        }
+        if (rc <= 0)
+            return -1;
+        got += rc;
+    }
+    return 0;
+}
+
+/*
+ * accepts connections one at a time, the way snmp_api does, and echoes
+ * whatever arrives on them
+ */
+static void
+_run_server(netsnmp_transport *listener)
+{
+    netsnmp_transport *t;
+    void           *opaque;
+    fd_set          fdset;
+    int             sock, olength, rc;
+
+    for (;;) {
+        sock = listener->f_accept(listener);
+        if (sock < 0)
+            exit(1);
+        t = netsnmp_transport_copy(listener);
+        if (t == NULL)
+            exit(1);
+        t->sock = sock;
+        t->flags &= ~NETSNMP_TRANSPORT_FLAG_LISTEN;
+        for (;;) {
+            FD_ZERO(&fdset);
+            FD_SET(t->sock, &fdset);
+            if (select(t->sock + 1, &fdset, NULL, NULL, NULL) < 0)
+                break;
+            opaque = NULL;
+            rc = t->f_recv(t, rxbuf, sizeof(rxbuf), &opaque, &olength);
+            free(opaque);
+            if (rc == 0 && (t->flags & NETSNMP_TRANSPORT_FLAG_EMPTY_PKT)) {
+                t->flags &= ~NETSNMP_TRANSPORT_FLAG_EMPTY_PKT;
+                continue;
+            }
+            if (rc <= 0 || t->f_send(t, rxbuf, rc, NULL, NULL) != rc)
+                break;
+        }
+        t->f_close(t);
+        netsnmp_transport_free(t);
+    }
+}
+
+static double
+_elapsed(const struct timeval *start)
+{
+    struct timeval  end;
+
+    netsnmp_get_monotonic_clock(&end);
+    return (end.tv_sec - start->tv_sec) +
+        (end.tv_usec - start->tv_usec) / 1e6;
+}
+
+/*
+ * sends messages of many odd sizes and checks that they come back intact
+ *
+ * @return the number of messages that did not
+ */
+static int
+_check_echo(netsnmp_transport *t)
+{
+    static u_char   msg[MAXLEN], echo[MAXLEN];
+    int             len, i, bad = 0;
+
+    for (len = 1; len <= MAXLEN; len += 7) {
+        for (i = 0; i < len; i++)
+            msg[i] = (u_char) (len + i);
+        if (t->f_send(t, msg, len, NULL, NULL) != len ||
+            _recv_all(t, echo, len) != 0 || memcmp(msg, echo, len) != 0)
+            bad++;
+    }
+    return bad;
+}
+
+/*
+ * sends a message of almost twice the (smallest) ring size, so the send
+ * has to wait for the server to make room, and checks that it comes back
+ *
+ * @return 0 on success, -1 on failure
+ */
+static int
+_check_full(netsnmp_transport *t)
+{
+    static u_char   msg[FULLLEN], echo[FULLLEN];
+    int             i;
+
+    for (i = 0; i < FULLLEN; i++)
+        msg[i] = (u_char) (i / 7);
+    if (t->f_send(t, msg, FULLLEN, NULL, NULL) != FULLLEN ||
+        _recv_all(t, echo, FULLLEN) != 0)
+        return -1;
+    return memcmp(msg, echo, FULLLEN) == 0 ? 0 : -1;
+}
+
+/*
+ * @return round trips per second of a MSGLEN byte message
+ */
+static double
+_ping(netsnmp_transport *t)
+{
+    u_char          msg[MSGLEN];
+    struct timeval  start;
+    int             i;
+
+    memset(msg, 'p', sizeof(msg));
+    netsnmp_get_monotonic_clock(&start);
+    for (i = 0; i < NPING; i++)
+        if (t->f_send(t, msg, sizeof(msg), NULL, NULL) != sizeof(msg) ||
+            _recv_all(t, msg, sizeof(msg)) != 0)
+            return 0;
+    return NPING / _elapsed(&start);
+}
+
+/*
+ * @return messages per second with WINDOW BULKLEN byte messages in flight
+ */
+static double
+_bulk(netsnmp_transport *t)
+{
+    u_char          msg[BULKLEN * WINDOW];
+    struct timeval  start;
+    int             i, j;
+
+    memset(msg, 'b', sizeof(msg));
+    netsnmp_get_monotonic_clock(&start);
+    for (i = 0; i < NBULK; i += WINDOW) {
+        for (j = 0; j < WINDOW; j++)
+            if (t->f_send(t, msg + j * BULKLEN, BULKLEN, NULL, NULL) !=
+                BULKLEN)
+                return 0;
+        if (_recv_all(t, msg, sizeof(msg)) != 0)
+            return 0;
+    }
+    return NBULK / _elapsed(&start);
+}
+
+static int      received;
+
+static int
+_pdu_cb(int op, netsnmp_session *sess, int reqid, netsnmp_pdu *pdu,
+        void *magic)
+{
+    static const oid sysUpTime_oid[] = { 1, 3, 6, 1, 2, 1, 1, 3, 0 };
+
+    if (op == NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE &&
+        pdu->command == SNMP_MSG_GET && pdu->variables &&
+        snmp_oid_compare(pdu->variables->name, pdu->variables->name_length,
+                         sysUpTime_oid, OID_LENGTH(sysUpTime_oid)) == 0)
+        received++;
+    return 1;
+}
+
+/*
+ * sends a GET from a session on transport t, which the server echoes
+ *
+ * @return 1 if it came back as sent, else 0
+ */
+static int
+_check_pdu(netsnmp_transport *t)
+{
+    static const oid sysUpTime_oid[] = { 1, 3, 6, 1, 2, 1, 1, 3, 0 };
+    static u_char   community[] = "public";
+    netsnmp_session sess, *ss;
+    netsnmp_pdu    *pdu;
+    fd_set          fdset;
+    struct timeval  tv;
+    int             i, numfds, block;
+
+    snmp_sess_init(&sess);
+    sess.version = SNMP_VERSION_2c;
+    sess.community = community;
+    sess.community_len = sizeof(community) - 1;
+    sess.callback = _pdu_cb;
+    ss = snmp_add(&sess, t, NULL, NULL);
+    if (ss == NULL)
+        return 0;
+    pdu = snmp_pdu_create(SNMP_MSG_GET);
+    snmp_add_null_var(pdu, sysUpTime_oid, OID_LENGTH(sysUpTime_oid));
+    if (snmp_send(ss, pdu) == 0)
+        snmp_free_pdu(pdu);
+    for (i = 0; !received && i < 20; i++) {
+        numfds = 0;
+        block = 0;
+        FD_ZERO(&fdset);
+        tv.tv_sec = 0;
+        tv.tv_usec = 100000;
+        snmp_select_info(&numfds, &fdset, &tv, &block);
+        tv.tv_sec = 0;
+        tv.tv_usec = 100000;
+        if (select(numfds, &fdset, NULL, NULL, &tv) > 0)
+            snmp_read(&fdset);
+    }
+    /* the session closes t */
+    snmp_close(ss);
+    return received == 1;
+}
+
+static netsnmp_transport *
+_connect(const struct sockaddr_un *addr)
+{
+    netsnmp_transport *t = NULL;
+    int             i;
+
+    for (i = 0; !t && i < 50; i++) {
+        t = netsnmp_unix_transport(addr, 0);
+        if (!t)
+            usleep(100000);
+    }
+    return t;
+}
+
+#ifdef RING
+#define RAWSIZE  (64 * 1024)
+#define RAWHDR   4096
+
+/* the layout of the shared memory, as in snmpUnixDomain.c */
+struct raw_ctl {
+    uint32_t        head __attribute__ ((aligned(64)));
+    uint32_t        tail __attribute__ ((aligned(64)));
+    uint32_t        closed __attribute__ ((aligned(64)));
+    uint32_t        waiting __attribute__ ((aligned(64)));
+};
+
+struct raw_hello {
+    char            magic[8];
+    uint32_t        size;
+};
+
+typedef struct raw_peer_s {
+    int             sock;
+    int             efd[2];         /* to the server, from the server */
+    struct raw_ctl *ctl;            /* we send on ctl[0], it on ctl[1] */
+    u_char         *data;
+} raw_peer;
+
+/*
+ * offers the server a ring the way netsnmp_unix_ring_offer() does, with
+ * the size of the memfd sealed or not
+ *
+ * @return the ack of the server, or 0 if there was none
+ */
+static char
+_raw_offer(const struct sockaddr_un *addr, int sealed, raw_peer *peer)
+{
+    struct raw_hello hello;
+    struct iovec    iov;
+    struct msghdr   msg;
+    struct cmsghdr *cm;
+    union {
+        struct cmsghdr  cm;
+        char            buf[CMSG_SPACE(3 * sizeof(int))];
+    } cmsg;
+    struct pollfd   pfd;
+    void           *map;
+    int             fds[3], i;
+    char            ack = 0;
+
+    memset(peer, 0, sizeof(*peer));
+    peer->sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (peer->sock < 0 ||
+        connect(peer->sock, (const struct sockaddr *) addr,
+                sizeof(*addr)) != 0)
+        return 0;
+    fds[0] = memfd_create("T046", sealed ? MFD_ALLOW_SEALING : 0);
+    fds[1] = eventfd(0, EFD_NONBLOCK);
+    fds[2] = eventfd(0, EFD_NONBLOCK);
+    if (fds[0] < 0 || fds[1] < 0 || fds[2] < 0 ||
+        ftruncate(fds[0], RAWHDR + 2 * RAWSIZE) != 0 ||
+        (sealed &&
+         fcntl(fds[0], F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW) != 0))
+        return 0;
+    map = mmap(NULL, RAWHDR + 2 * RAWSIZE, PROT_READ | PROT_WRITE,
+               MAP_SHARED, fds[0], 0);
+    if (map == MAP_FAILED)
+        return 0;
+    peer->ctl = (struct raw_ctl *) map;
+    peer->data = (u_char *) map + RAWHDR;
+
+    memcpy(hello.magic, "\0NSRING1", sizeof(hello.magic));
+    hello.size = RAWSIZE;
+    iov.iov_base = &hello;
+    iov.iov_len = sizeof(hello);
+    memset(&msg, 0, sizeof(msg));
+    memset(&cmsg, 0, sizeof(cmsg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = &cmsg;
+    msg.msg_controllen = sizeof(cmsg);
+    cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cm), fds, sizeof(fds));
+    if (sendmsg(peer->sock, &msg, 0) == sizeof(hello)) {
+        pfd.fd = peer->sock;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, 2000) != 1 || recv(peer->sock, &ack, 1, 0) != 1)
+            ack = 0;
+    }
+    close(fds[0]);
+    for (i = 0; i < 2; i++)
+        peer->efd[i] = fds[i + 1];
+    return ack;
+}
+
+static void
+_raw_close(raw_peer *peer)
+{
+    if (peer->ctl)
+        munmap(peer->ctl, RAWHDR + 2 * RAWSIZE);
+    if (peer->efd[0] > 0)
+        close(peer->efd[0]);
+    if (peer->efd[1] > 0)
+        close(peer->efd[1]);
+    if (peer->sock >= 0)
+        close(peer->sock);
+}
+
+static void
+_raw_signal(raw_peer *peer)
+{
+    uint64_t        one = 1;
+
+    if (write(peer->efd[0], &one, sizeof(one)) != sizeof(one))
+        perror("eventfd");
+}
+
+/*
+ * @return 1 if the server closed its side of the ring within 2 s
+ */
+static int
+_raw_closed(raw_peer *peer)
+{
+    int             i;
+
+    for (i = 0; i < 200; i++) {
+        if (__atomic_load_n(&peer->ctl[1].closed, __ATOMIC_SEQ_CST))
+            return 1;
+        usleep(10000);
+    }
+    return 0;
+}
+
+/*
+ * @return 1 if len bytes of msg came back on the socket, else 0
+ */
+static int
+_raw_echo(raw_peer *peer, const char *msg, int len, int send_it)
+{
+    char            echo[64];
+    struct pollfd   pfd;
+    int             got = 0, rc;
+
+    if (send_it && send(peer->sock, msg, len, 0) != len)
+        return 0;
+    pfd.fd = peer->sock;
+    pfd.events = POLLIN;
+    while (got < len && poll(&pfd, 1, 2000) == 1) {
+        rc = recv(peer->sock, echo + got, sizeof(echo) - got, 0);
+        if (rc <= 0)
+            return 0;
+        got += rc;
+    }
+    return got == len && memcmp(echo, msg, len) == 0;
+}
+
+/*
+ * plays a misbehaving peer of the server at addr
+ */
+static void
+_check_bad_peers(const struct sockaddr_un *addr)
+{
+    raw_peer        peer;
+    char            ack;
+
+    ack = _raw_offer(addr, 0, &peer);
+    OKF(ack == 'N', ("unsealed memfd refused: %c", ack ? ack : '-'));
+    OKF(_raw_echo(&peer, "unsealed", 8, 1),
+        ("unsealed: the socket still works"));
+    _raw_close(&peer);
+
+    /* a head too far ahead of the tail */
+    ack = _raw_offer(addr, 1, &peer);
+    OKF(ack == 'Y', ("sealed memfd accepted: %c", ack ? ack : '-'));
+    if (ack == 'Y') {
+        __atomic_store_n(&peer.ctl[0].head, RAWSIZE + 1, __ATOMIC_SEQ_CST);
+        _raw_signal(&peer);
+        OKF(_raw_closed(&peer), ("bad head: server dropped the ring"));
+        OKF(_raw_echo(&peer, "bad head", 8, 1),
+            ("bad head: the socket works again"));
+    }
+    _raw_close(&peer);
+
+    /*
+     * a tail too far behind the head, seen by the server when it echoes
+     * the message, which then goes over the socket
+     */
+    ack = _raw_offer(addr, 1, &peer);
+    if (ack == 'Y') {
+        __atomic_store_n(&peer.ctl[1].tail, 0x80000000U, __ATOMIC_SEQ_CST);
+        memcpy(peer.data, "bad tail", 8);
+        __atomic_store_n(&peer.ctl[0].head, 8, __ATOMIC_SEQ_CST);
+        _raw_signal(&peer);
+        OKF(_raw_echo(&peer, "bad tail", 8, 0),
+            ("bad tail: echoed on the socket"));
+        OKF(_raw_closed(&peer), ("bad tail: server dropped the ring"));
+    } else
+        OKF(0, ("sealed memfd accepted again: %c", ack ? ack : '-'));
+    _raw_close(&peer);
+}
+
+/*
+ * offers a ring to a peer that answers no
+ *
+ * @return 1 if the offer failed and left the transport alone, else 0
+ */
+static int
+_check_refused(const struct sockaddr_un *addr)
+{
+    netsnmp_transport *t;
+    int             lsock, sock, rc = -2, ok = 0;
+    int             (*recv_fn) (netsnmp_transport *, void *, int,
+                                void **, int *);
+
+    lsock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (lsock < 0 ||
+        bind(lsock, (const struct sockaddr *) addr, sizeof(*addr)) != 0 ||
+        listen(lsock, 1) != 0)
+        return 0;
+    t = netsnmp_unix_transport(addr, 0);
+    sock = t ? accept(lsock, NULL, NULL) : -1;
+    /* the answer is there before the question */
+    if (sock >= 0 && send(sock, "N", 1, 0) == 1) {
+        recv_fn = t->f_recv;
+        rc = netsnmp_unix_ring_offer(t, 0);
+        ok = rc == -1 && t->f_recv == recv_fn && t->f_sendv != NULL;
+    }
+    if (t) {
+        t->f_close(t);
+        netsnmp_transport_free(t);
+    }
+    if (sock >= 0)
+        close(sock);
+    close(lsock);
+    unlink(addr->sun_path);
+    if (!ok)
+        printf("# refused offer: %d\n", rc);
+    return ok;
+}
+#endif /* RING */
+#endif /* NETSNMP_TRANSPORT_UNIX_DOMAIN */
+
+int
+main(int argc, char *argv[])
+{
+#ifdef NETSNMP_TRANSPORT_UNIX_DOMAIN
+    struct sockaddr_un addr, refuser;
+    netsnmp_transport *listener, *t, other;
+    double          sock_ping, sock_bulk, ring_ping = 0, ring_bulk = 0;
+    pid_t           pid;
+    int             rc;
+    int             (*sock_recv) (netsnmp_transport *, void *, int,
+                                  void **, int *);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "/tmp/T046-%d",
+             (int) getpid());
+
+    init_snmp("T046");
+    listener = netsnmp_unix_transport(&addr, 1);
+    OKF(listener != NULL, ("listening on %s", addr.sun_path));
+    if (!listener) {
+        PLAN(__test_counter);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0)
+        _run_server(listener);
+
+    memset(&other, 0, sizeof(other));
+    OKF(netsnmp_unix_ring_offer(&other, 0) == 1,
+        ("no offer on other transports"));
+
+    /*
+     * over shared memory
+     */
+    t = _connect(&addr);
+    sock_recv = t ? t->f_recv : NULL;
+    rc = t ? netsnmp_unix_ring_offer(t, 0) : -1;
+#ifdef RING
+    OKF(rc == 0 && t->f_recv != sock_recv, ("ring offer: %d", rc));
+#else
+    OKF(rc == 1, ("no ring offer: %d", rc));
+#endif
+    if (rc == 0) {
+        OKF(_check_echo(t) == 0, ("ring: messages intact"));
+        OKF(_check_full(t) == 0, ("ring: message larger than the ring"));
+        ring_ping = _ping(t);
+        ring_bulk = _bulk(t);
+        OKF(ring_ping > 0 && ring_bulk > 0, ("ring: benchmark"));
+    } else
+        printf("# no shared memory rings on this platform\n");
+    if (t) {
+        t->f_close(t);
+        netsnmp_transport_free(t);
+    }
+
+    /* a PDU, through snmp_api */
+    t = _connect(&addr);
+    rc = t ? netsnmp_unix_ring_offer(t, 0) : -1;
+    OKF(t && rc >= 0 && _check_pdu(t), ("PDU round trip (offer: %d)", rc));
+
+#ifdef RING
+    refuser = addr;
+    snprintf(refuser.sun_path, sizeof(refuser.sun_path), "%s-n",
+             addr.sun_path);
+    OKF(_check_refused(&refuser), ("refused offer, transport unchanged"));
+    _check_bad_peers(&addr);
+#else
+    (void) refuser;
+#endif
+
+    /*
+     * over the socket; this also needs the server to have noticed that
+     * the previous connection went away
+     */
+    t = _connect(&addr);
+    OKF(t != NULL, ("connected"));
+    if (t) {
+        OKF(_check_echo(t) == 0, ("socket: messages intact"));
+        sock_ping = _ping(t);
+        sock_bulk = _bulk(t);
+        OKF(sock_ping > 0 && sock_bulk > 0, ("socket: benchmark"));
+        t->f_close(t);
+        netsnmp_transport_free(t);
+        printf("# socket: %.0f round trips/s, %.0f %d byte messages/s\n",
+               sock_ping, sock_bulk, BULKLEN);
+        if (rc == 0)
+            printf("# ring:   %.0f round trips/s, %.0f %d byte messages/s\n",
+                   ring_ping, ring_bulk, BULKLEN);
+    }
+
+    if (pid > 0) {
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+    }
+    listener->f_close(listener);
+    netsnmp_transport_free(listener);
+    unlink(addr.sun_path);
+    snmp_shutdown("T046");
+#else
+    OK(1, "no Unix domain support");
+#endif
+
+    PLAN(__test_counter);
+    return 0;
+}
@@ -0,0 +1,387 @@
+/*
+ * HEADER Testing pipelined requests over a stream transport
+ *
+ * A responder session listens on TCP and answers every GET right away.  A
+ * raw socket sends it a long run of back to back requests, split at
+ * arbitrary points, and checks that every one of them is answered.  Then
+ * a client session sends requests one at a time and with many of them in
+ * flight, and the request rates are reported as a comment.  Last, a raw
+ * socket sends requests without reading the answers: the responder must
+ * stop taking its input, keep answering the client session, and send all
+ * the answers once they are read.
+ */
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/library/large_fd_set.h>
+#include <net-snmp/library/fd_event_manager.h>
+#include <net-snmp/library/testing.h>
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+#ifdef HAVE_NETINET_IN_H
+#include <netinet/in.h>
+#endif
+#ifdef HAVE_ARPA_INET_H
+#include <arpa/inet.h>
+#endif
+
+#define NRAW     20000
+#define CHUNK    9973
+#define NREQ     20000
+#define WINDOW   64
+
+static const oid sysUpTime_oid[] = { 1, 3, 6, 1, 2, 1, 1, 3, 0 };
+static u_char   community[] = "public";
+
+static int      requests, received, mismatched;
+
+static int
+responder_cb(int op, netsnmp_session *sess, int reqid, netsnmp_pdu *pdu,
+             void *magic)
+{
+    netsnmp_pdu    *reply;
+
+    if (op != NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE ||
+        pdu->command != SNMP_MSG_GET)
+        return 1;
+    ++requests;
+    reply = snmp_clone_pdu(pdu);
+    if (reply) {
+        reply->command = SNMP_MSG_RESPONSE;
+        reply->errstat = 0;
+        reply->errindex = 0;
+        if (!snmp_send(sess, reply))
+            snmp_free_pdu(reply);
+    }
+    return 1;
+}
+
+static int
+client_cb(int op, netsnmp_session *sess, int reqid, netsnmp_pdu *pdu,
+          void *magic)
+{
+    if (op == NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE &&
+        pdu->command == SNMP_MSG_RESPONSE && pdu->reqid == reqid)
+        ++received;
+    else
+        ++mismatched;
+    return 1;
+}
+
+/* Handle everything that is ready without blocking. */
+static void
+pump(void)
+{
+    netsnmp_large_fd_set fdset, wfdset, efdset;
+    struct timeval  tv;
+    int             numfds, block, count;
+
+    netsnmp_large_fd_set_init(&fdset, FD_SETSIZE);
+    netsnmp_large_fd_set_init(&wfdset, FD_SETSIZE);
+    netsnmp_large_fd_set_init(&efdset, FD_SETSIZE);
+    do {
+        numfds = 0;
+        block = 0;
+        tv.tv_sec = 0;
+        tv.tv_usec = 0;
+        NETSNMP_LARGE_FD_ZERO(&fdset);
+        NETSNMP_LARGE_FD_ZERO(&wfdset);
+        NETSNMP_LARGE_FD_ZERO(&efdset);
+        snmp_select_info2(&numfds, &fdset, &tv, &block);
+        netsnmp_external_event_info2(&numfds, &fdset, &wfdset, &efdset);
+        tv.tv_sec = 0;
+        tv.tv_usec = 0;
+        count = netsnmp_large_fd_set_select(numfds, &fdset, &wfdset, &efdset,
+                                            &tv);
+        if (count > 0) {
+            netsnmp_dispatch_external_events2(&count, &fdset, &wfdset,
+                                              &efdset);
+            snmp_read2(&fdset);
+        }
+    } while (count > 0);
+    netsnmp_large_fd_set_cleanup(&efdset);
+    netsnmp_large_fd_set_cleanup(&wfdset);
+    netsnmp_large_fd_set_cleanup(&fdset);
+}
+
+static int
+send_get(netsnmp_session *ss)
+{
+    netsnmp_pdu    *pdu = snmp_pdu_create(SNMP_MSG_GET);
+
+    snmp_add_null_var(pdu, sysUpTime_oid, OID_LENGTH(sysUpTime_oid));
+    if (snmp_async_send(ss, pdu, client_cb, NULL))
+        return 1;
+    snmp_free_pdu(pdu);
+    return 0;
+}
+
+static double
+elapsed(const struct timeval *start)
+{
+    struct timeval  now;
+
+    netsnmp_get_monotonic_clock(&now);
+    return (now.tv_sec - start->tv_sec) +
+        (now.tv_usec - start->tv_usec) / 1000000.0;
+}
+
+/*
+ * sends NRAW copies of pkt over a plain socket, in pieces of odd sizes,
+ * and counts the complete responses that come back
+ */
+static int
+raw_pipeline(const struct sockaddr_in *addr, const u_char *pkt,
+             size_t pkt_len, double *rate)
+{
+    u_char         *out, in[16384];
+    size_t          out_len = NRAW * pkt_len, sent = 0, in_len = 0, n;
+    struct timeval  start;
+    int             sock, answers = 0, rc, i;
+
+    out = malloc(out_len);
+    sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (!out || sock < 0 ||
+        connect(sock, (const struct sockaddr *) addr, sizeof(*addr)) != 0) {
+        free(out);
+        if (sock >= 0)
+            close(sock);
+        return -1;
+    }
+    for (i = 0; i < NRAW; i++)
+        memcpy(out + i * pkt_len, pkt, pkt_len);
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+
+    netsnmp_get_monotonic_clock(&start);
+    while (answers < NRAW && elapsed(&start) < 30) {
+        if (sent < out_len) {
+            n = out_len - sent < CHUNK ? out_len - sent : CHUNK;
+            rc = send(sock, out + sent, n, 0);
+            if (rc > 0)
+                sent += rc;
+        }
+        pump();
+        rc = recv(sock, in + in_len, sizeof(in) - in_len, 0);
+        if (rc <= 0)
+            continue;
+        in_len += rc;
+        while ((n = asn_check_packet(in, in_len)) > 0 && n <= in_len) {
+            answers++;
+            memmove(in, in + n, in_len - n);
+            in_len -= n;
+        }
+    }
+    *rate = answers / elapsed(&start);
+    close(sock);
+    free(out);
+    return answers;
+}
+
+/*
+ * sends requests (copies of pkt) without reading the answers until the
+ * responder stops taking them, checks that the client session is still
+ * answered, and then reads all the answers
+ */
+static int
+lazy_peer(const struct sockaddr_in *addr, const u_char *pkt, size_t pkt_len,
+          netsnmp_session *client, int *stalled, int *answered)
+{
+    u_char          in[16384];
+    size_t          sent = 0, in_len = 0, n;
+    struct timeval  start;
+    int             sock, answers = 0, before, idle = 0, bufsize = 4096;
+    int             rc, total;
+
+    sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0)
+        return -1;
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+    if (connect(sock, (const struct sockaddr *) addr, sizeof(*addr)) != 0) {
+        close(sock);
+        return -1;
+    }
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+
+    /* until neither the socket nor the responder takes any more */
+    before = requests;
+    netsnmp_get_monotonic_clock(&start);
+    while (idle < 50 && elapsed(&start) < 30) {
+        rc = send(sock, pkt + sent % pkt_len, pkt_len - sent % pkt_len, 0);
+        if (rc > 0)
+            sent += rc;
+        n = requests;
+        pump();
+        idle = (rc <= 0 && requests == n) ? idle + 1 : 0;
+    }
+    total = (sent + pkt_len - 1) / pkt_len;
+    *stalled = requests - before < total;
+
+    /* the client session is served meanwhile */
+    received = 0;
+    if (send_get(client))
+        while (received == 0 && elapsed(&start) < 30)
+            pump();
+    *answered = received;
+    before += received;
+
+    /* the rest of the last request, and all the answers */
+    while (answers < total && elapsed(&start) < 60) {
+        if (sent % pkt_len) {
+            rc = send(sock, pkt + sent % pkt_len,
+                      pkt_len - sent % pkt_len, 0);
+            if (rc > 0)
+                sent += rc;
+        }
+        pump();
+        rc = recv(sock, in + in_len, sizeof(in) - in_len, 0);
+        if (rc <= 0)
+            continue;
+        in_len += rc;
+        while ((n = asn_check_packet(in, in_len)) > 0 && n <= in_len) {
+            answers++;
+            memmove(in, in + n, in_len - n);
+            in_len -= n;
+        }
+    }
+    close(sock);
+    printf("# %d requests sent without reading the answers\n", total);
+    return answers == total && requests - before == total ? total : -1;
+}
+
+int
+main(int argc, char *argv[])
+{
+    netsnmp_transport *transport;
+    netsnmp_session sess, *responder, *client;
+    netsnmp_pdu    *pdu;
+    struct sockaddr_in addr;
+    socklen_t       addr_len = sizeof(addr);
+    struct timeval  start;
+    double          raw_rate = 0, single_rate, window_rate;
+    u_char         *pkt = NULL;
+    size_t          pkt_len = 0;
+    char            peer[64];
+    int             sent, answers, stalled = 0, answered = 0;
+
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DONT_READ_CONFIGS, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_LOAD, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_SAVE, 1);
+    init_snmp("T047");
+
+    transport = netsnmp_transport_open_server("T047", "tcp:127.0.0.1:0");
+    OKF(transport != NULL, ("responder transport opened"));
+    if (!transport) {
+        PLAN(__test_counter);
+        return 1;
+    }
+    getsockname(transport->sock, (struct sockaddr *) &addr, &addr_len);
+    snprintf(peer, sizeof(peer), "tcp:127.0.0.1:%d", ntohs(addr.sin_port));
+
+    snmp_sess_init(&sess);
+    sess.version = SNMP_VERSION_2c;
+    sess.callback = responder_cb;
+    sess.isAuthoritative = SNMP_SESS_AUTHORITATIVE;
+    responder = snmp_add(&sess, transport, NULL, NULL);
+
+    snmp_sess_init(&sess);
+    sess.version = SNMP_VERSION_2c;
+    sess.peername = peer;
+    sess.community = community;
+    sess.community_len = sizeof(community) - 1;
+    sess.retries = 0;
+    sess.timeout = 30 * 1000000L;
+    client = snmp_open(&sess);
+    OKF(responder && client, ("sessions opened"));
+    if (!responder || !client) {
+        PLAN(__test_counter);
+        return 1;
+    }
+
+    /*
+     * requests back to back, split at arbitrary points
+     */
+    pdu = snmp_pdu_create(SNMP_MSG_GET);
+    snmp_add_null_var(pdu, sysUpTime_oid, OID_LENGTH(sysUpTime_oid));
+    OKF(snmp_sess_build_packet(snmp_sess_pointer(client), pdu, &pkt,
+                               &pkt_len) == SNMPERR_SUCCESS,
+        ("request encoded"));
+    snmp_free_pdu(pdu);
+    answers = pkt ? raw_pipeline(&addr, pkt, pkt_len, &raw_rate) : -1;
+    OKF(answers == NRAW && requests == NRAW,
+        ("%d of %d pipelined requests answered", answers, NRAW));
+    free(pkt);
+
+    /*
+     * one request at a time, and a window of them
+     */
+    netsnmp_get_monotonic_clock(&start);
+    for (sent = 0; sent < NREQ / 10; sent++) {
+        if (!send_get(client))
+            break;
+        while (received <= sent && elapsed(&start) < 30)
+            pump();
+    }
+    single_rate = received / elapsed(&start);
+    OKF(received == NREQ / 10 && mismatched == 0,
+        ("%d of %d requests answered one at a time", received, NREQ / 10));
+
+    received = 0;
+    netsnmp_get_monotonic_clock(&start);
+    for (sent = 0; sent < NREQ; sent++) {
+        if (!send_get(client))
+            break;
+        while (sent - received >= WINDOW && elapsed(&start) < 30)
+            pump();
+    }
+    while (received < sent && elapsed(&start) < 30)
+        pump();
+    window_rate = received / elapsed(&start);
+    OKF(received == NREQ && mismatched == 0,
+        ("%d of %d requests answered %d at a time", received, NREQ,
+         WINDOW));
+    printf("# %.0f requests/s one at a time, %.0f with %d in flight,"
+           " %.0f back to back\n", single_rate, window_rate, WINDOW,
+           raw_rate);
+
+    /*
+     * a peer that does not read its answers
+     */
+    pdu = snmp_pdu_create(SNMP_MSG_GET);
+    snmp_add_null_var(pdu, sysUpTime_oid, OID_LENGTH(sysUpTime_oid));
+    pkt = NULL;
+    pkt_len = 0;
+    snmp_sess_build_packet(snmp_sess_pointer(client), pdu, &pkt, &pkt_len);
+    snmp_free_pdu(pdu);
+    answers = pkt ? lazy_peer(&addr, pkt, pkt_len, client, &stalled,
+                              &answered) : -1;
+    free(pkt);
+    OKF(stalled, ("input from a peer that does not read is held back"));
+    OKF(answered == 1 && mismatched == 0,
+        ("another session is answered meanwhile"));
+    OKF(answers > 0, ("all its requests are answered once it reads"));
+
+    snmp_close(client);
+    snmp_close(responder);
+    snmp_shutdown("T047");
+
+    PLAN(__test_counter);
+    return 0;
+}
@@ -0,0 +1,109 @@
+/* HEADER Testing snmp_var_op_len() against the varbind encoder */
+
+#ifdef NETSNMP_USE_REVERSE_ASNENCODING
+
+static oid short_name[] = { 1, 3, 6, 1, 2, 1, 1, 3, 0 };
+static oid long_name[] = { 1, 3, 6, 1, 4, 1, 8072, 127, 128, 16383,
+                           16384, 0x7fffffff, 0xffffffffU, 2 };
+static oid zero_name[] = { 0, 0 };
+static oid one_name[] = { 2 };
+static u_char string[70000];
+
+long intval[] = {
+    0, 1, 127, 128, -128, -129, 0xffff, 0x7fffffff, -0x7fffffffL - 1,
+#if defined(LONG_MAX) && LONG_MAX > 0x7fffffffL
+    0x80000000L, 0xffffffffL, 0x100000000L, -0x80000001L,
+#endif
+};
+u_long uintval[] = {
+    0, 1, 127, 128, 255, 256, 0x7fffffff, 0x80000000U, 0xffffffffU,
+#if defined(LONG_MAX) && LONG_MAX > 0x7fffffffL
+    0x100000000UL,
+#endif
+};
+struct counter64 c64val[] = {
+    { 0, 0 }, { 0, 0x7f }, { 0, 0x80 }, { 0, 0xffffffff }, { 1, 0 },
+    { 0x7f, 0xffffffff }, { 0x80, 0 }, { 0x7fffffff, 0xdeadbeef },
+    { 0xffffffff, 0xffffffff },
+};
+const size_t strlens[] = { 0, 1, 126, 127, 128, 255, 256, 65535, 65536,
+                           sizeof(string) };
+const u_char exceptions[] = { ASN_NULL, SNMP_NOSUCHOBJECT,
+                              SNMP_NOSUCHINSTANCE, SNMP_ENDOFMIBVIEW };
+struct {
+    const oid      *name;
+    size_t          name_len;
+} names[] = {
+    { short_name, OID_LENGTH(short_name) },
+    { long_name, OID_LENGTH(long_name) },
+    { zero_name, OID_LENGTH(zero_name) },
+    { one_name, OID_LENGTH(one_name) },
+    { NULL, 0 },
+};
+unsigned        i, n, failed = 0, checked = 0;
+
+#define CHECK_VB(type, val, val_len) do {                               \
+        u_char         *pkt = NULL;                                     \
+        size_t          pkt_len = 0, offset = 0, nl = names[n].name_len; \
+        size_t          predicted;                                      \
+                                                                        \
+        predicted = snmp_var_op_len(names[n].name, nl, type,            \
+                                    (u_char *) (val), val_len);         \
+        if (!snmp_realloc_rbuild_var_op(&pkt, &pkt_len, &offset, 1,     \
+                                        names[n].name, &nl, type,       \
+                                        (u_char *) (val), val_len) ||   \
+            predicted != offset) {                                      \
+            printf("# type %d, value %u, name %u: %" NETSNMP_PRIz       \
+                   "u <> %" NETSNMP_PRIz "u\n", type, i, n, predicted,   \
+                   offset);                                             \
+            ++failed;                                                   \
+        }                                                               \
+        ++checked;                                                      \
+        free(pkt);                                                      \
+    } while (0)
+
+memset(string, 'x', sizeof(string));
+for (n = 0; n < sizeof(names) / sizeof(names[0]); n++) {
+    for (i = 0; i < sizeof(intval) / sizeof(intval[0]); i++)
+        CHECK_VB(ASN_INTEGER, &intval[i], sizeof(intval[i]));
+    for (i = 0; i < sizeof(uintval) / sizeof(uintval[0]); i++) {
+        CHECK_VB(ASN_COUNTER, &uintval[i], sizeof(uintval[i]));
+        CHECK_VB(ASN_TIMETICKS, &uintval[i], sizeof(uintval[i]));
+    }
+    for (i = 0; i < sizeof(c64val) / sizeof(c64val[0]); i++) {
+        CHECK_VB(ASN_COUNTER64, &c64val[i], sizeof(c64val[i]));
+#ifdef NETSNMP_WITH_OPAQUE_SPECIAL_TYPES
+        CHECK_VB(ASN_OPAQUE_COUNTER64, &c64val[i], sizeof(c64val[i]));
+        CHECK_VB(ASN_OPAQUE_U64, &c64val[i], sizeof(c64val[i]));
+        CHECK_VB(ASN_OPAQUE_I64, &c64val[i], sizeof(c64val[i]));
+#endif
+    }
+    for (i = 0; i < sizeof(strlens) / sizeof(strlens[0]); i++) {
+        CHECK_VB(ASN_OCTET_STR, string, strlens[i]);
+        CHECK_VB(ASN_OPAQUE, string, strlens[i]);
+    }
+    i = 0;
+    CHECK_VB(ASN_IPADDRESS, string, 4);
+    CHECK_VB(ASN_OBJECT_ID, long_name, sizeof(long_name));
+    CHECK_VB(ASN_OBJECT_ID, zero_name, sizeof(zero_name));
+    CHECK_VB(ASN_OBJECT_ID, one_name, sizeof(one_name));
+    CHECK_VB(ASN_OBJECT_ID, NULL, 0);
+    for (i = 0; i < sizeof(exceptions); i++)
+        CHECK_VB(exceptions[i], NULL, 0);
+#ifdef NETSNMP_WITH_OPAQUE_SPECIAL_TYPES
+    {
+        float           f = 3.14;
+        double          d = 2.71828;
+
+        i = 0;
+        CHECK_VB(ASN_OPAQUE_FLOAT, &f, sizeof(f));
+        CHECK_VB(ASN_OPAQUE_DOUBLE, &d, sizeof(d));
+    }
+#endif
+}
+OKF(failed == 0, ("%u of %u predicted varbind sizes differ", failed,
+                  checked));
+
+#else
+OK(1, "reverse encoding is not enabled");
+#endif
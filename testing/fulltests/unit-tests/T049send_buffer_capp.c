@@ -0,0 +1,235 @@
+/*
+ * HEADER Testing the send buffer kept by each session
+ *
+ * Sends requests from a client session to a responder session in the
+ * same process, recording where each packet was encoded.  Checks that
+ * consecutive requests are encoded in the same buffer, even when other
+ * allocations are made in between, that a small request sent after a
+ * large one arrives intact, and that a retransmission encoded in the
+ * kept buffer is the same packet as the original.
+ */
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/library/large_fd_set.h>
+#include <net-snmp/library/testing.h>
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+#ifdef HAVE_NETINET_IN_H
+#include <netinet/in.h>
+#endif
+
+#define NSEND   4
+#define NLARGE  64
+
+static const oid sysUpTime_oid[] = { 1, 3, 6, 1, 2, 1, 1, 3, 0 };
+static u_char   community[] = "public";
+
+static int      (*real_send) (netsnmp_transport *, const void *, int,
+                              void **, int *);
+static const u_char *sent_end[NSEND];
+static u_char   sent[2][1024];
+static int      sent_len[2];
+static int      nsent;
+static int      received, received_vars;
+
+/* note where each packet was encoded, and keep the last two */
+static int
+capture_send(netsnmp_transport *t, const void *buf, int size,
+             void **opaque, int *olength)
+{
+    if (nsent < NSEND)
+        sent_end[nsent] = (const u_char *) buf + size;
+    if (size <= (int) sizeof(sent[0])) {
+        memmove(sent[0], sent[1], sent_len[1]);
+        sent_len[0] = sent_len[1];
+        memcpy(sent[1], buf, size);
+        sent_len[1] = size;
+    }
+    ++nsent;
+    return real_send(t, buf, size, opaque, olength);
+}
+
+static int
+responder_cb(int op, netsnmp_session *sess, int reqid, netsnmp_pdu *pdu,
+             void *magic)
+{
+    netsnmp_variable_list *vp;
+
+    if (op != NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE ||
+        pdu->command != SNMP_MSG_GET)
+        return 1;
+    ++received;
+    received_vars = 0;
+    for (vp = pdu->variables; vp; vp = vp->next_variable)
+        ++received_vars;
+    return 1;
+}
+
+static int
+client_cb(int op, netsnmp_session *sess, int reqid, netsnmp_pdu *pdu,
+          void *magic)
+{
+    return 1;
+}
+
+/* Handle everything that is ready without blocking. */
+static void
+pump(void)
+{
+    netsnmp_large_fd_set fdset;
+    struct timeval  tv;
+    int             numfds, block, count;
+
+    netsnmp_large_fd_set_init(&fdset, FD_SETSIZE);
+    do {
+        numfds = 0;
+        block = 0;
+        tv.tv_sec = 0;
+        tv.tv_usec = 0;
+        NETSNMP_LARGE_FD_ZERO(&fdset);
+        snmp_select_info2(&numfds, &fdset, &tv, &block);
+        tv.tv_sec = 0;
+        tv.tv_usec = 0;
+        count = netsnmp_large_fd_set_select(numfds, &fdset, NULL, NULL, &tv);
+        if (count > 0)
+            snmp_read2(&fdset);
+    } while (count > 0);
+    snmp_timeout();
+    netsnmp_large_fd_set_cleanup(&fdset);
+}
+
+static int
+send_get(netsnmp_session *ss, int nvars)
+{
+    netsnmp_pdu    *pdu = snmp_pdu_create(SNMP_MSG_GET);
+    int             i;
+
+    for (i = 0; i < nvars; i++)
+        snmp_add_null_var(pdu, sysUpTime_oid, OID_LENGTH(sysUpTime_oid));
+    if (snmp_async_send(ss, pdu, client_cb, NULL))
+        return 1;
+    snmp_free_pdu(pdu);
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    netsnmp_transport *transport, *client_transport;
+    netsnmp_session sess, *responder, *client, *resender;
+    struct sockaddr_in addr;
+    socklen_t       addr_len = sizeof(addr);
+    char            peer[64];
+    void           *held[NSEND];
+    int             i, same;
+
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DONT_READ_CONFIGS, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_LOAD, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_SAVE, 1);
+    init_snmp("T049");
+
+    transport = netsnmp_transport_open_server("T049", "udp:127.0.0.1:0");
+    OKF(transport != NULL, ("responder transport opened"));
+    if (!transport)
+        return 1;
+    getsockname(transport->sock, (struct sockaddr *) &addr, &addr_len);
+    snprintf(peer, sizeof(peer), "udp:127.0.0.1:%d", ntohs(addr.sin_port));
+
+    snmp_sess_init(&sess);
+    sess.version = SNMP_VERSION_2c;
+    sess.callback = responder_cb;
+    sess.isAuthoritative = SNMP_SESS_AUTHORITATIVE;
+    responder = snmp_add(&sess, transport, NULL, NULL);
+
+    snmp_sess_init(&sess);
+    sess.version = SNMP_VERSION_2c;
+    sess.peername = peer;
+    sess.community = community;
+    sess.community_len = sizeof(community) - 1;
+    sess.retries = 0;
+    sess.timeout = 60 * 1000000L;
+    client = snmp_open(&sess);
+    sess.retries = 1;
+    sess.timeout = 200 * 1000L;
+    resender = snmp_open(&sess);
+    OKF(responder && client && resender, ("sessions opened"));
+    if (!responder || !client || !resender)
+        return 1;
+    client_transport = snmp_sess_transport(snmp_sess_pointer(client));
+    real_send = client_transport->f_send;
+    client_transport->f_send = capture_send;
+    client_transport = snmp_sess_transport(snmp_sess_pointer(resender));
+    client_transport->f_send = capture_send;
+
+    /*
+     * Requests of the same size are encoded at the same place, however
+     * much else is allocated and freed in between.
+     */
+    for (i = 0; i < NSEND; i++) {
+        send_get(client, 1);
+        held[i] = malloc(SNMP_MIN_MAX_LEN);
+        pump();
+    }
+    same = 1;
+    for (i = 1; i < NSEND; i++)
+        if (sent_end[i] != sent_end[0])
+            same = 0;
+    OKF(nsent == NSEND && same, ("%d requests encoded in one buffer", nsent));
+    OKF(received == NSEND && received_vars == 1,
+        ("%d requests received", received));
+    for (i = 0; i < NSEND; i++)
+        free(held[i]);
+
+    /*
+     * A large request grows the buffer, and the next request still
+     * carries only its own varbinds.
+     */
+    send_get(client, NLARGE);
+    pump();
+    OKF(received == NSEND + 1 && received_vars == NLARGE,
+        ("large request received with %d varbinds", received_vars));
+    send_get(client, 1);
+    pump();
+    OKF(received == NSEND + 2 && received_vars == 1,
+        ("small request after a large one received with %d varbinds",
+         received_vars));
+
+    /*
+     * An unanswered request is sent again, unchanged.
+     */
+    send_get(resender, 1);
+    pump();
+    i = nsent;
+    usleep(300 * 1000);
+    pump();
+    OKF(nsent == i + 1 && sent_len[0] == sent_len[1] &&
+        memcmp(sent[0], sent[1], sent_len[1]) == 0,
+        ("retransmission of %d bytes matches the original", sent_len[1]));
+    pump();
+    OKF(received == NSEND + 4 && received_vars == 1,
+        ("retransmission received with %d varbinds", received_vars));
+
+    snmp_close(resender);
+    snmp_close(client);
+    snmp_close(responder);
+    snmp_shutdown("T049");
+
+    PLAN(__test_counter);
+    return 0;
+}
@@ -0,0 +1,287 @@
+/*
+ * HEADER Testing the DTLS connection cache of the agent
+ *
+ * Forks an agent listening for DTLSUDP on the loopback with limits on
+ * the number of connections it keeps and on how long they may be idle,
+ * and which serves its connection cache statistics.  Opens enough
+ * sessions to it to grow the hash table of connections, and checks that
+ * each is found again on later requests, that the least recently used
+ * connections are the ones dropped over the limit, and that idle ones
+ * are dropped when a new peer connects.
+ */
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include <net-snmp/agent/net-snmp-agent-includes.h>
+#include <net-snmp/library/testing.h>
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#ifdef NETSNMP_TRANSPORT_DTLSUDP_DOMAIN
+#include <net-snmp/library/snmpDTLSUDPDomain.h>
+#include "mibII/vacm_conf.h"
+
+#define NPEER   70      /* more than the initial hash table holds */
+#define NMAX    80      /* dtlsMaxConnections */
+#define NMORE   15      /* peers beyond those, NMAX - NPEER are kept */
+#define IDLE    10      /* dtlsIdleTimeout */
+
+static oid      stats_oid[] = { 1, 3, 6, 1, 4, 1, 8072, 9999, 43, 1, 0 };
+
+static netsnmp_session *peers[NPEER + NMORE];
+
+static int
+_gencert(const char *dir, const char *name)
+{
+    char            cmd[1024];
+
+    snprintf(cmd, sizeof(cmd),
+             "openssl req -x509 -newkey rsa:2048 -nodes -days 2"
+             " -subj /CN=%s -keyout %s/tls/private/%s.key"
+             " -out %s/tls/certs/%s.crt >/dev/null 2>&1",
+             name, dir, name, dir, name);
+    return system(cmd) == 0;
+}
+
+/* .1.0 is the number of connections cached, .2.0 the number evicted */
+static int
+_stats_handler(netsnmp_mib_handler *handler,
+               netsnmp_handler_registration *reginfo,
+               netsnmp_agent_request_info *reqinfo,
+               netsnmp_request_info *requests)
+{
+    size_t          connections;
+    u_long          evictions;
+
+    if (reqinfo->mode != MODE_GET)
+        return SNMP_ERR_NOERROR;
+    netsnmp_dtlsudp_cache_stats(&connections, &evictions);
+    snmp_set_var_typed_integer(requests->requestvb, ASN_GAUGE,
+                               reginfo->rootoid[reginfo->rootoid_len - 2] ==
+                               1 ? connections : evictions);
+    return SNMP_ERR_NOERROR;
+}
+
+static void
+_run_agent(const char *ports)
+{
+    char            certsecname[] = "certSecName 10 client --sn tester";
+    char            rouser[] = "rouser -s tsm tester authpriv";
+    int             i;
+
+    netsnmp_ds_set_string(NETSNMP_DS_APPLICATION_ID, NETSNMP_DS_AGENT_PORTS,
+                          ports);
+    netsnmp_ds_set_string(NETSNMP_DS_LIBRARY_ID,
+                          NETSNMP_DS_LIB_TLS_LOCAL_CERT, "agent");
+    netsnmp_ds_set_int(NETSNMP_DS_LIBRARY_ID,
+                       NETSNMP_DS_LIB_DTLS_MAX_CONNECTIONS, NMAX);
+    netsnmp_ds_set_int(NETSNMP_DS_LIBRARY_ID,
+                       NETSNMP_DS_LIB_DTLS_IDLE_TIMEOUT, IDLE);
+    init_agent("T050");
+    init_vacm_conf();
+    init_snmp("T050");
+    netsnmp_config(certsecname);
+    netsnmp_config(rouser);
+    for (i = 1; i <= 2; i++) {
+        stats_oid[OID_LENGTH(stats_oid) - 2] = i;
+        netsnmp_register_instance(
+            netsnmp_create_handler_registration("T050", _stats_handler,
+                                                stats_oid,
+                                                OID_LENGTH(stats_oid),
+                                                HANDLER_CAN_RONLY));
+    }
+    if (init_master_agent() != 0)
+        exit(1);
+    for (;;)
+        agent_check_and_process(1);
+}
+
+static netsnmp_session *
+_open(const char *peer)
+{
+    netsnmp_session session;
+
+    snmp_sess_init(&session);
+    session.peername = NETSNMP_REMOVE_CONST(char *, peer);
+    session.version = SNMP_VERSION_3;
+    session.timeout = 2000000;
+    session.retries = 1;
+    return snmp_open(&session);
+}
+
+/*
+ * GET the agent's connection cache statistics through a session
+ *
+ * @return 1 if they were answered, and 0 otherwise
+ */
+static int
+_stats(netsnmp_session *ss, long *connections, long *evictions)
+{
+    netsnmp_pdu    *pdu, *response = NULL;
+    int             ok = 0;
+
+    *connections = *evictions = -1;
+    if (!ss)
+        return 0;
+    pdu = snmp_pdu_create(SNMP_MSG_GET);
+    stats_oid[OID_LENGTH(stats_oid) - 2] = 1;
+    snmp_add_null_var(pdu, stats_oid, OID_LENGTH(stats_oid));
+    stats_oid[OID_LENGTH(stats_oid) - 2] = 2;
+    snmp_add_null_var(pdu, stats_oid, OID_LENGTH(stats_oid));
+    if (snmp_synch_response(ss, pdu, &response) == STAT_SUCCESS &&
+        response->errstat == SNMP_ERR_NOERROR &&
+        response->variables->type == ASN_GAUGE &&
+        response->variables->next_variable->type == ASN_GAUGE) {
+        *connections = *response->variables->val.integer;
+        *evictions = *response->variables->next_variable->val.integer;
+        ok = 1;
+    }
+    snmp_free_pdu(response);
+    return ok;
+}
+
+/* @return the number of peers from..to-1 answered, opening them first */
+static int
+_query(const char *peer, int from, int to, long *connections,
+       long *evictions)
+{
+    int             i, ok = 0;
+
+    for (i = from; i < to; i++) {
+        if (!peers[i])
+            peers[i] = _open(peer);
+        ok += _stats(peers[i], connections, evictions);
+    }
+    return ok;
+}
+#endif /* DTLSUDP */
+
+int
+main(int argc, char *argv[])
+{
+#ifdef NETSNMP_TRANSPORT_DTLSUDP_DOMAIN
+    char            dir[] = "/tmp/T050XXXXXX";
+    char            path[256], dtlsudp[64];
+    netsnmp_session *ss;
+    long            connections, evictions;
+    pid_t           pid;
+    int             ok, i;
+
+    if (!mkdtemp(dir)) {
+        OK(0, "temporary directory");
+        PLAN(__test_counter);
+        return 1;
+    }
+    snprintf(path, sizeof(path), "%s/tls", dir);
+    mkdir(path, 0700);
+    snprintf(path, sizeof(path), "%s/tls/certs", dir);
+    mkdir(path, 0700);
+    snprintf(path, sizeof(path), "%s/tls/private", dir);
+    mkdir(path, 0700);
+    if (!_gencert(dir, "agent") || !_gencert(dir, "client")) {
+        OK(1, "no openssl command to create certificates with");
+        PLAN(__test_counter);
+        return 0;
+    }
+    setenv("SNMPCONFPATH", dir, 1);
+
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DONT_READ_CONFIGS, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_LOAD, 1);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+                           NETSNMP_DS_LIB_DISABLE_PERSISTENT_SAVE, 1);
+    netsnmp_ds_set_string(NETSNMP_DS_LIBRARY_ID,
+                          NETSNMP_DS_LIB_PERSISTENT_DIR, dir);
+
+    snprintf(dtlsudp, sizeof(dtlsudp), "dtlsudp:127.0.0.1:%d",
+             20000 + getpid() % 10000);
+
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0)
+        _run_agent(dtlsudp);
+
+    netsnmp_ds_set_string(NETSNMP_DS_LIBRARY_ID,
+                          NETSNMP_DS_LIB_TLS_LOCAL_CERT, "client");
+    netsnmp_ds_set_string(NETSNMP_DS_LIBRARY_ID,
+                          NETSNMP_DS_LIB_TLS_PEER_CERT, "agent");
+    init_snmp("T050");
+
+    /* wait for the agent to listen */
+    for (i = 0, ok = 0; !ok && i < 50 && pid > 0; i++) {
+        usleep(100000);
+        peers[0] = _open(dtlsudp);
+        ok = _stats(peers[0], &connections, &evictions);
+        if (!ok && peers[0]) {
+            snmp_close(peers[0]);
+            peers[0] = NULL;
+        }
+    }
+    OKF(ok, ("agent listening on %s", dtlsudp));
+    if (ok) {
+        /* each peer has its own connection, however many there are */
+        ok = _query(dtlsudp, 0, NPEER, &connections, &evictions);
+        OKF(ok == NPEER && connections == NPEER && evictions == 0,
+            ("%d of %d peers answered, %ld connections, %ld evicted",
+             ok, NPEER, connections, evictions));
+        ok = _query(dtlsudp, 0, NPEER, &connections, &evictions);
+        OKF(ok == NPEER && connections == NPEER && evictions == 0,
+            ("%d of %d peers answered again, %ld connections, %ld evicted",
+             ok, NPEER, connections, evictions));
+
+        /* the least recently used ones make room for more */
+        ok = _query(dtlsudp, NPEER, NPEER + NMORE, &connections,
+                    &evictions);
+        OKF(ok == NMORE && connections == NMAX &&
+            evictions == NPEER + NMORE - NMAX,
+            ("%d of %d more peers answered, %ld connections, %ld evicted",
+             ok, NMORE, connections, evictions));
+        ok = _query(dtlsudp, NPEER + NMORE - NMAX, NPEER + NMORE,
+                    &connections, &evictions);
+        OKF(ok == NMAX && connections == NMAX &&
+            evictions == NPEER + NMORE - NMAX,
+            ("%d of the %d most recent peers kept their connections",
+             ok, NMAX));
+
+        /* and idle ones go when the next peer connects */
+        sleep(IDLE + 1);
+        ss = _open(dtlsudp);
+        ok = _stats(ss, &connections, &evictions);
+        OKF(ok && connections == 1 && evictions == NPEER + NMORE,
+            ("after %d s idle: %ld connections, %ld evicted", IDLE + 1,
+             connections, evictions));
+        if (ss)
+            snmp_close(ss);
+    }
+    for (i = 0; i < NPEER + NMORE; i++)
+        if (peers[i])
+            snmp_close(peers[i]);
+
+    if (pid > 0) {
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+    }
+    snmp_shutdown("T050");
+    snprintf(path, sizeof(path), "rm -rf %s", dir);
+    if (system(path) != 0)
+        printf("# could not remove %s\n", dir);
+#else
+    OK(1, "no DTLSUDP support");
+#endif
+
+    PLAN(__test_counter);
+    return 0;
+}